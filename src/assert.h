@@ -52,12 +52,12 @@
 
 #else
 
-	#define assert(x) ((void) x);
-	#define assert_not_null(x) ((void) x);
-	#define assert_eq(x, y) ((void) x);
-	#define assert_str_eq(x, y) ((void) x);
-	#define assert_neq(x, y) ((void) x);
-	#define assert_str_neq(x, y) ((void) x);
+	#define assert(x) ((void) (x));
+	#define assert_not_null(x) ((void) (x));
+	#define assert_eq(x, y) ((void) (x));
+	#define assert_str_eq(x, y) ((void) (x));
+	#define assert_neq(x, y) ((void) (x));
+	#define assert_str_neq(x, y) ((void) (x));
 
 #endif
 
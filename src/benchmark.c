@@ -1,140 +1,572 @@
 #include "benchmark.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
 #include "assert.h"
 #include "utils.h"
 
 
-#define BENCH_STATE_SIZE 1024
-static benchmark_state_t BENCH_STATE[BENCH_STATE_SIZE];
-static size_t bench_state_index = BENCH_STATE_SIZE;
+// Time spent measuring the ticks of bench_now
+#define BENCH_CALIBRATE_NS 10000000
+
+
+_Thread_local bench_thread_t *bench_thread = NULL;
+
+
+// Names of the sites by id, id 0 means a site hasn't been called yet
+static const char **bench_sites = NULL;
+static size_t bench_sites_amount = 1;
+static size_t bench_sites_size = 0;
+
+static bench_thread_t *bench_threads = NULL;
+static pthread_mutex_t bench_lock = PTHREAD_MUTEX_INITIALIZER;
 
-static vector_t trace;
+static double bench_ticks = 1.0;
+
+// Hardware counters for every call, as far as the first thread could open them
+static bool bench_count = false;
+static bool bench_counter_available[PerfCounter_AMOUNT];
+
+// The trace gets a complete event for every call while it's open
+static FILE *bench_trace = NULL;
+static size_t bench_trace_events = 0;
+static uint64_t bench_trace_start = 0;
+
+static const char *bench_folded_name = NULL;
 
 
 static const char *bench_file_name = "/tmp/bench";
 
 
 
-void bench_prepare(void) {
-	vector_init(&trace, BENCH_STATE_SIZE * BENCH_STATE_SIZE);
+// NOTE: No benchmarking in the profiler itself
+
+
+static void bench_register(bench_site_t *site) {
+	pthread_mutex_lock(&bench_lock);
+
+	// Another thread could have been first
+	if (atomic_load_explicit(&site->id, memory_order_relaxed) == 0) {
+		if (bench_sites_amount >= bench_sites_size) {
+			bench_sites_size = (bench_sites_size == 0) ? 256 : 2 * bench_sites_size;
+			bench_sites = realloc(bench_sites, bench_sites_size * sizeof(char *));
+			assert_not_null(bench_sites);
+		}
+
+		bench_sites[bench_sites_amount] = site->name;
+		atomic_store_explicit(&site->id, (uint32_t) bench_sites_amount, memory_order_relaxed);
+		bench_sites_amount++;
+	}
+
+	pthread_mutex_unlock(&bench_lock);
 }
 
 
-void bench_write_states(void) {
-	FILE *outfile = fopen(bench_file_name, "w+");
+// NOTE: Only for reporting errors, when the lock can already be taken
+static const char *bench_site_name_unlocked(uint32_t id) {
+	return (id > 0 && id < bench_sites_amount) ? bench_sites[id] : "?";
+}
 
-	benchmark_state_t *state;
-	for (size_t i=0; i < bench_state_index && bench_state_index != BENCH_STATE_SIZE; i++) {
-		state = &BENCH_STATE[i];
 
-		double frac = state->effective_time / state->amount;
+static bench_thread_t *bench_thread_create(void) {
+	bench_thread_t *thread = calloc(1, sizeof(bench_thread_t));
+	assert_not_null(thread);
 
-		fprintf(outfile, "%s\t%s = %s / %i \t%s \t%s\n",
-			LEFT_PAD_SPACE(frac, 8),
+	thread->ring = malloc(BENCH_RING_SIZE * sizeof(bench_event_t));
+	assert_not_null(thread->ring);
 
-			LEFT_PAD_SPACE(frac, 8),
-			LEFT_PAD_SPACE(state->effective_time, 8),
-			state->amount,
-			LEFT_PAD_SPACE(state->actual_time, 8),
-			state->func_name
-		);
+	// Counters only count the thread that opens them
+	if (bench_count && perf_counters_init(&thread->counters)) {
+		thread->counter_ring = malloc(BENCH_RING_SIZE * sizeof(perf_values_t));
+		assert_not_null(thread->counter_ring);
 	}
+
+	// Node 0 is the root of the call tree, which is never in the table
+	thread->size_nodes = 256;
+	thread->amount_nodes = 1;
+	thread->nodes = calloc(thread->size_nodes, sizeof(bench_node_t));
+	assert_not_null(thread->nodes);
+
+	thread->size_node_slots = 512;
+	thread->node_slots = calloc(thread->size_node_slots, sizeof(uint32_t));
+	assert_not_null(thread->node_slots);
+
+	// Kept after the thread exits, so its calls are still reported
+	pthread_mutex_lock(&bench_lock);
+	thread->index = (bench_threads == NULL) ? 0 : bench_threads->index + 1;
+	thread->next = bench_threads;
+	bench_threads = thread;
+	pthread_mutex_unlock(&bench_lock);
+
+	return thread;
 }
 
 
-void benchmark_state_init(benchmark_state_t *state) {
-	assert_not_null(state);
+static bench_stats_t *bench_stats(bench_thread_t *thread, uint32_t site) {
+	if (site >= thread->stats_size) {
+		size_t size = (thread->stats_size == 0) ? 256 : thread->stats_size;
+
+		while (size <= site) {
+			size *= 2;
+		}
+
+		thread->stats = realloc(thread->stats, size * sizeof(bench_stats_t));
+		assert_not_null(thread->stats);
 
+		memset(&thread->stats[thread->stats_size], 0, (size - thread->stats_size) * sizeof(bench_stats_t));
+		thread->stats_size = size;
+	}
 
-	state->effective_time = 0;
-	state->actual_time = 0;
-	state->amount = 0;
+	return &thread->stats[site];
 }
 
 
-benchmark_state_t *bench_get_or_create_state_by_name(const char func_name[]) {
-	benchmark_state_t *state;
-	for (size_t i=0; i < bench_state_index && bench_state_index != BENCH_STATE_SIZE; i++) {
-		state = &BENCH_STATE[i];
+static size_t bench_node_slot(bench_thread_t *thread, uint32_t parent, uint32_t site) {
+	uint64_t hash = (((uint64_t) parent << 32) | site) * 0x9E3779B97F4A7C15;
+	size_t mask = thread->size_node_slots - 1;
+
+	for (size_t slot = (size_t) (hash >> 32) & mask; ; slot = (slot + 1) & mask) {
+		uint32_t node = thread->node_slots[slot];
 
-		if (strcmp(state->func_name, func_name) == 0) {
-			return state;
+		if (node == 0 || (thread->nodes[node].parent == parent && thread->nodes[node].site == site)) {
+			return slot;
 		}
 	}
+}
 
-	// No state found
-	bool is_initial = bench_state_index == BENCH_STATE_SIZE;
 
-	// No existing data found, so create a new one
-	state = &BENCH_STATE[is_initial ? 0 : bench_state_index];
-	benchmark_state_init(state);
-	state->func_name = func_name;
+// The node of a site called from a parent node, which is added the first time
+static uint32_t bench_node_child(bench_thread_t *thread, uint32_t parent, uint32_t site) {
+	size_t slot = bench_node_slot(thread, parent, site);
+
+	if (thread->node_slots[slot] != 0) {
+		return thread->node_slots[slot];
+	}
+
 
-	if (is_initial) {
-		bench_state_index = 1;
+	if (thread->amount_nodes == thread->size_nodes) {
+		thread->size_nodes *= 2;
+		thread->nodes = realloc(thread->nodes, thread->size_nodes * sizeof(bench_node_t));
+		assert_not_null(thread->nodes);
 	}
-	else {
-		bench_state_index++;
+
+	uint32_t node = (uint32_t) thread->amount_nodes++;
+	thread->nodes[node] = (bench_node_t) { .site = site, .parent = parent };
+	thread->node_slots[slot] = node;
+
+
+	// Keep the table at most half full
+	if (2 * thread->amount_nodes > thread->size_node_slots) {
+		free(thread->node_slots);
+
+		thread->size_node_slots *= 2;
+		thread->node_slots = calloc(thread->size_node_slots, sizeof(uint32_t));
+		assert_not_null(thread->node_slots);
+
+		for (uint32_t i = 1; i < thread->amount_nodes; i++) {
+			thread->node_slots[bench_node_slot(thread, thread->nodes[i].parent, thread->nodes[i].site)] = i;
+		}
+	}
+
+	return node;
+}
+
+
+// In microseconds since the trace was opened, the skew of every thread moves its calls a little earlier
+static void bench_trace_call(bench_thread_t *thread, uint32_t site, uint64_t start, uint64_t duration) {
+	double ts = (double) (int64_t) (start - bench_trace_start) / bench_ticks / 1e3;
+	double dur = (double) duration / bench_ticks / 1e3;
+
+	fprintf(bench_trace, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+		(bench_trace_events++ == 0) ? "" : ",\n",
+		bench_site_name_unlocked(site), thread->index, ts, dur);
+}
+
+
+// Turn the events that weren't processed yet into stats
+// NOTE: Only call this while holding bench_lock
+static void bench_process(bench_thread_t *thread) {
+	for (size_t i = thread->processed; i < thread->position; i++) {
+		bench_event_t *event = &thread->ring[i];
+		bench_stats_t *stats = bench_stats(thread, event->site);
+
+		if (event->type == BenchEvent_ENTER) {
+			if (thread->depth == BENCH_STACK_SIZE) {
+				panic("Failed to start function %s: more than %d calls deep", bench_site_name_unlocked(event->site), BENCH_STACK_SIZE);
+			}
+
+			uint32_t parent = (thread->depth > 0) ? thread->stack[thread->depth - 1].node : 0;
+
+			thread->stack[thread->depth++] = (bench_frame_t) {
+				.site = event->site,
+				.node = bench_node_child(thread, parent, event->site),
+				.start = event->time,
+				.children = 0
+			};
+
+			if (thread->counter_ring != NULL) {
+				thread->stack[thread->depth - 1].counters_start = thread->counter_ring[i];
+			}
+
+			stats->calls++;
+			stats->depth++;
+
+			continue;
+		}
+
+
+		if (thread->depth == 0 || thread->stack[thread->depth - 1].site != event->site) {
+			const char *started = (thread->depth > 0) ? bench_site_name_unlocked(thread->stack[thread->depth - 1].site) : "nothing";
+			panic("Failed to end function: %s hasn't been started or %s hasn't been ended.", bench_site_name_unlocked(event->site), started);
+		}
+
+		bench_frame_t *frame = &thread->stack[--thread->depth];
+		uint64_t duration = event->time - frame->start;
+
+		stats->self += duration - frame->children;
+
+		if (thread->counter_ring != NULL) {
+			perf_values_t counters;
+			perf_values_sub(&counters, &thread->counter_ring[i], &frame->counters_start);
+
+			perf_values_t self;
+			perf_values_sub(&self, &counters, &frame->counters_children);
+			perf_values_add(&stats->counters, &stats->counters, &self);
+
+			if (thread->depth > 0) {
+				perf_values_t *children = &thread->stack[thread->depth - 1].counters_children;
+				perf_values_add(children, children, &counters);
+			}
+		}
+
+		thread->nodes[frame->node].calls++;
+		thread->nodes[frame->node].self += duration - frame->children;
+
+		if (bench_trace != NULL) {
+			bench_trace_call(thread, event->site, frame->start, duration);
+		}
+
+		if (--stats->depth == 0) {
+			stats->total += duration;
+		}
+
+		if (thread->depth > 0) {
+			thread->stack[thread->depth - 1].children += duration;
+		}
 	}
 
-	return state;
+	thread->processed = thread->position;
 }
 
 
-void bench_apply_starttime(benchmark_state_t *state, struct timespec start) {
-	assert_not_null(state);
+// The first event of a thread or site, or a full ring
+void bench_record_slow(bench_site_t *site, BenchEvent_t type) {
+	if (bench_thread == NULL) {
+		bench_thread = bench_thread_create();
+	}
+
+	if (atomic_load_explicit(&site->id, memory_order_relaxed) == 0) {
+		bench_register(site);
+	}
+
+	bench_thread_t *thread = bench_thread;
+
+	if (thread->position == BENCH_RING_SIZE) {
+		uint64_t start = bench_now();
+
+		pthread_mutex_lock(&bench_lock);
+		bench_process(thread);
+		pthread_mutex_unlock(&bench_lock);
 
+		thread->position = 0;
+		thread->processed = 0;
 
-	state->effective_start = start;
-	state->actual_start = start;
+		thread->skew += bench_now() - start;
+	}
+
+	if (thread->counter_ring == NULL) {
+		bench_record(site, type);
+		return;
+	}
+
+
+	// Reading the counters is a system call, which is left out of the times like processing
+	uint64_t start = bench_now();
+	size_t position = thread->position++;
+
+	perf_counters_read(&thread->counters, &thread->counter_ring[position]);
+
+	thread->ring[position] = (bench_event_t) {
+		.time = start - thread->skew,
+		.site = atomic_load_explicit(&site->id, memory_order_relaxed),
+		.type = type
+	};
+
+	thread->skew += bench_now() - start;
 }
 
 
-void bench_apply_endtime(benchmark_state_t *state, struct timespec end) {
-	assert_not_null(state);
+bool bench_counting(void) {
+	return bench_count;
+}
+
 
+double bench_ticks_per_ns(void) {
+	return bench_ticks;
+}
 
-	long effective_duration = long_time(end) - long_time(state->effective_start);
-	long actual_duration = long_time(end) - long_time(state->actual_start);
 
-	state->effective_time += effective_duration;
-	state->actual_time = actual_duration;
+const char *bench_site_name(uint32_t id) {
+	pthread_mutex_lock(&bench_lock);
+	const char *name = bench_site_name_unlocked(id);
+	pthread_mutex_unlock(&bench_lock);
+
+	return name;
 }
 
 
-void bench_start_func(const char func_name[]) {
-	struct timespec start = {0, 0};
+// Stats of all threads by site id, only call this while no other thread records events
+bench_stats_t *bench_collect(size_t *amount) {
+	assert_not_null(amount);
+
+	pthread_mutex_lock(&bench_lock);
+
+	*amount = bench_sites_amount;
+
+	bench_stats_t *all = calloc(bench_sites_amount, sizeof(bench_stats_t));
+	assert_not_null(all);
+
+	for (bench_thread_t *thread = bench_threads; thread != NULL; thread = thread->next) {
+		bench_process(thread);
+
+		for (size_t i = 0; i < thread->stats_size && i < bench_sites_amount; i++) {
+			all[i].calls += thread->stats[i].calls;
+			all[i].self += thread->stats[i].self;
+			all[i].total += thread->stats[i].total;
+			all[i].depth += thread->stats[i].depth;
+
+			perf_values_add(&all[i].counters, &all[i].counters, &thread->stats[i].counters);
+		}
+	}
+
+	pthread_mutex_unlock(&bench_lock);
+
+	return all;
+}
+
+
+
+// Start writing every call to a Chrome trace, which can be opened in chrome://tracing or Perfetto
+bool bench_trace_open(const char *filename) {
+	assert_not_null(filename);
+
+	pthread_mutex_lock(&bench_lock);
+
+	if (bench_trace != NULL) {
+		pthread_mutex_unlock(&bench_lock);
+
+		warn("Failed to open trace %s: another trace is open", filename);
+		return false;
+	}
+
+	// Calls before the trace is opened aren't in it
+	for (bench_thread_t *thread = bench_threads; thread != NULL; thread = thread->next) {
+		bench_process(thread);
+	}
+
+	bench_trace = fopen(filename, "w");
+
+	if (bench_trace != NULL) {
+		fputs("[\n", bench_trace);
+		bench_trace_events = 0;
+		bench_trace_start = bench_now();
+	}
+
+	pthread_mutex_unlock(&bench_lock);
+
+	if (bench_trace == NULL) {
+		warn("Failed to open trace %s", filename);
+		return false;
+	}
+
+	return true;
+}
+
+
+// Write the calls that ended so far and close the trace, calls that are still running are left out
+void bench_trace_close(void) {
+	pthread_mutex_lock(&bench_lock);
+
+	if (bench_trace != NULL) {
+		for (bench_thread_t *thread = bench_threads; thread != NULL; thread = thread->next) {
+			bench_process(thread);
+		}
+
+		fputs("\n]\n", bench_trace);
+		fclose(bench_trace);
+		bench_trace = NULL;
+	}
+
+	pthread_mutex_unlock(&bench_lock);
+}
+
+
+bool bench_tracing(void) {
+	pthread_mutex_lock(&bench_lock);
+	bool tracing = bench_trace != NULL;
+	pthread_mutex_unlock(&bench_lock);
+
+	return tracing;
+}
+
+
+// Self time in nanoseconds by call stack, one stack per line as flamegraph.pl and speedscope read them
+bool bench_write_folded(const char *filename) {
+	assert_not_null(filename);
+
+	FILE *outfile = fopen(filename, "w");
+
+	if (outfile == NULL) {
+		warn("Failed to open %s", filename);
+		return false;
+	}
+
+	pthread_mutex_lock(&bench_lock);
+
+	uint32_t path[BENCH_STACK_SIZE];
+
+	// Threads aren't merged, the same stack on other threads gets its own line
+	for (bench_thread_t *thread = bench_threads; thread != NULL; thread = thread->next) {
+		bench_process(thread);
+
+		for (uint32_t i = 1; i < thread->amount_nodes; i++) {
+			if (thread->nodes[i].calls == 0) {
+				continue;
+			}
+
+			uint64_t self = (uint64_t) ((double) thread->nodes[i].self / bench_ticks + 0.5);
+
+			size_t depth = 0;
+
+			for (uint32_t node = i; node != 0; node = thread->nodes[node].parent) {
+				path[depth++] = thread->nodes[node].site;
+			}
+
+			for (size_t j = depth; j > 0; j--) {
+				fprintf(outfile, "%s%c", bench_site_name_unlocked(path[j - 1]), (j > 1) ? ';' : ' ');
+			}
+
+			fprintf(outfile, "%lu\n", self);
+		}
+	}
+
+	pthread_mutex_unlock(&bench_lock);
+
+	fclose(outfile);
+	return true;
+}
+
+
+
+// Measure how many ticks of bench_now there are in a nanosecond.
+// BENCH_TRACE and BENCH_FOLDED name files to write a trace and folded stacks to,
+// and BENCH_COUNTERS counts cycles, instructions and misses of every call as well.
+void bench_prepare(void) {
+	struct timespec start, now;
+
 	clock_gettime(CLOCK_MONOTONIC, &start);
+	uint64_t ticks = bench_now();
+
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while (long_time(now) - long_time(start) < BENCH_CALIBRATE_NS);
+
+	bench_ticks = (double) (bench_now() - ticks) / (double) (long_time(now) - long_time(start));
+
+	char *trace = getenv("BENCH_TRACE");
+	bench_folded_name = getenv("BENCH_FOLDED");
+
+	if (trace != NULL) {
+		bench_trace_open(trace);
+	}
+
+	if (getenv("BENCH_COUNTERS") != NULL) {
+		perf_counters_t counters;
+
+		if (perf_counters_init(&counters)) {
+			for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+				bench_counter_available[i] = perf_counters_available(&counters, i);
+			}
 
-	// Apply current time to previous function
-	benchmark_state_t *last = vector_last(&trace);
-	if (last != NULL) {
-		bench_apply_endtime(last, start);
+			bench_count = true;
+			perf_counters_free(&counters);
+		}
+		else {
+			warn("Failed to open hardware counters, only measuring time");
+		}
+	}
+}
+
+
+// Counters per call, a dash for counters that couldn't be opened
+static char *bench_counters_string(char *dest, bench_stats_t *stats) {
+	char *end = dest;
+
+	for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+		if (bench_counter_available[i]) {
+			end += sprintf(end, "%10.1f %s \t", (double) stats->counters.values[i] / (double) stats->calls, perf_counter_name(i));
+		}
+		else {
+			end += sprintf(end, "%10s %s \t", "-", perf_counter_name(i));
+		}
 	}
 
-	benchmark_state_t *state = bench_get_or_create_state_by_name(func_name);
-	bench_apply_starttime(state, start);
-	state->amount++;
-	vector_push(&trace, state);
+	return dest;
 }
 
 
-void bench_end_func(const char func_name[]) {
-	struct timespec end = {0, 0};
-	clock_gettime(CLOCK_MONOTONIC, &end);
+void bench_write_states(void) {
+	size_t amount;
+	bench_stats_t *stats = bench_collect(&amount);
 
-	benchmark_state_t *state = vector_pop(&trace);
-	assert_not_null(state);
+	FILE *outfile = fopen(bench_file_name, "w+");
 
-	if (strcmp(state->func_name, func_name) != 0) {
-		panic("Failed to end function: %s hasn't been started or %s hasn't been ended.", func_name, state->func_name);
-		return;
+	for (size_t i = 1; i < amount; i++) {
+		if (stats[i].calls == 0) {
+			continue;
+		}
+
+		double self = (double) stats[i].self / bench_ticks;
+		double total = (double) stats[i].total / bench_ticks;
+		double frac = self / (double) stats[i].calls;
+
+		char counters[PerfCounter_AMOUNT * 48] = "";
+
+		if (bench_count) {
+			bench_counters_string(counters, &stats[i]);
+		}
+
+		fprintf(outfile, "%s\t%s = %s / %lu \t%s \t%s%s\n",
+			LEFT_PAD_SPACE(frac, 8),
+
+			LEFT_PAD_SPACE(frac, 8),
+			LEFT_PAD_SPACE(self, 8),
+			stats[i].calls,
+			LEFT_PAD_SPACE(total, 8),
+			counters,
+			bench_site_name((uint32_t) i)
+		);
 	}
 
-	bench_apply_endtime(state, end);
+	fclose(outfile);
+	free(stats);
+
+	bench_trace_close();
 
-	benchmark_state_t *last = vector_last(&trace);
-	if (last != NULL) {
-		last->effective_start = end;
+	if (bench_folded_name != NULL) {
+		bench_write_folded(bench_folded_name);
 	}
 }
@@ -3,46 +3,182 @@
 
 
 #include <time.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
 
 #include "vector.h"
+#include "perf_counters.h"
 
 
 #define long_time(time) ((long) 1e9 * (long) time.tv_sec + (long) time.tv_nsec)
 
 
+// Events every thread keeps before they're processed, always a power of 2
+#define BENCH_RING_SIZE 65536
+
+// Deepest nesting of instrumented functions
+#define BENCH_STACK_SIZE 4096
+
+
+// Every function has its own site, which gets an id when it's first called
 #ifdef BENCH
-	#define FUNC_START()  bench_start_func(__FUNCTION__);
-	#define FUNC_END()  bench_end_func(__FUNCTION__);
+	#define FUNC_START() \
+		static bench_site_t __bench_site = { .name = __func__, .id = 0 }; \
+		bench_record(&__bench_site, BenchEvent_ENTER);
+
+	#define FUNC_END()  bench_record(&__bench_site, BenchEvent_EXIT);
 #else
 	#define FUNC_START()
 	#define FUNC_END()
 #endif
 
 
-typedef struct benchmark_state {
-	const char *func_name;
+typedef struct bench_site {
+	const char *name;
+	_Atomic uint32_t id;
+} bench_site_t;
+
+
+typedef enum BenchEvent {
+	BenchEvent_ENTER,
+	BenchEvent_EXIT
+} BenchEvent_t;
+
+
+typedef struct bench_event {
+	uint64_t time;
+	uint32_t site;
+	uint32_t type;
+} bench_event_t;
+
+
+// Time spent in a site, in ticks of bench_now
+typedef struct bench_stats {
+	uint64_t calls;
+
+	// Without the time spent in other sites
+	uint64_t self;
+	// Including other sites, only counting the outermost call of recursion
+	uint64_t total;
+
+	// Calls that haven't ended yet while processing
+	uint32_t depth;
+
+	// Hardware counters without other sites, when they're counted
+	perf_values_t counters;
+} bench_stats_t;
+
+
+// A site as it's called from a path of other sites, node 0 is where every thread starts
+typedef struct bench_node {
+	uint32_t site;
+	uint32_t parent;
+
+	uint64_t calls;
+	uint64_t self;
+} bench_node_t;
+
+
+typedef struct bench_frame {
+	uint32_t site;
+	uint32_t node;
+
+	uint64_t start;
+	uint64_t children;
+
+	perf_values_t counters_start;
+	perf_values_t counters_children;
+} bench_frame_t;
+
 
-	long actual_time;
-	long effective_time;
+typedef struct bench_thread {
+	struct bench_thread *next;
+	uint32_t index;
 
-	unsigned int amount;
+	bench_event_t *ring;
+	size_t position;
+	size_t processed;
 
-	struct timespec actual_start;
-	struct timespec effective_start;
-} benchmark_state_t;
+	// Time spent processing, which is left out of the recorded times
+	uint64_t skew;
+
+	// Counters at every event in the ring, NULL if they aren't counted
+	perf_counters_t counters;
+	perf_values_t *counter_ring;
+
+	// Stats by site id, and the calls that haven't ended yet
+	bench_stats_t *stats;
+	size_t stats_size;
+
+	bench_frame_t stack[BENCH_STACK_SIZE];
+	size_t depth;
+
+	// The call tree, with the nodes by parent and site in an open addressing table
+	bench_node_t *nodes;
+	size_t amount_nodes;
+	size_t size_nodes;
+
+	uint32_t *node_slots;
+	size_t size_node_slots;
+} bench_thread_t;
+
+
+extern _Thread_local bench_thread_t *bench_thread;
+
+
+// NOTE: No benchmarking in the profiler itself
+
+
+static inline uint64_t bench_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t) long_time(now);
+#endif
+}
+
+
+void bench_record_slow(bench_site_t *site, BenchEvent_t type);
+
+
+// Only stores the event, it's processed once the ring is full. Reading counters always takes the slow path.
+static inline void bench_record(bench_site_t *site, BenchEvent_t type) {
+	bench_thread_t *thread = bench_thread;
+	uint32_t id = atomic_load_explicit(&site->id, memory_order_relaxed);
+
+	if (__builtin_expect(thread == NULL || id == 0 || thread->position == BENCH_RING_SIZE || thread->counter_ring != NULL, 0)) {
+		bench_record_slow(site, type);
+		return;
+	}
+
+	bench_event_t *event = &thread->ring[thread->position++];
+
+	event->time = bench_now() - thread->skew;
+	event->site = id;
+	event->type = type;
+}
 
 
 void bench_prepare(void);
 void bench_write_states(void);
 
-benchmark_state_t *bench_get_or_create_state_by_name(const char func_name[]);
-void bench_apply_starttime(benchmark_state_t *state, struct timespec start);
-void bench_apply_endtime(benchmark_state_t *state, struct timespec end);
-
-void bench_start_func(const char func_name[]);
-void bench_end_func(const char func_name[]);
+bool bench_trace_open(const char *filename);
+void bench_trace_close(void);
+bool bench_tracing(void);
+bool bench_write_folded(const char *filename);
 
-void benchmark_state_init(benchmark_state_t *state);
+bool bench_counting(void);
+double bench_ticks_per_ns(void);
+const char *bench_site_name(uint32_t id);
+bench_stats_t *bench_collect(size_t *amount);
 
 
 #endif
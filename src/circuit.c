@@ -3,6 +3,8 @@
 #include "utils.h"
 #include "assert.h"
 #include "benchmark.h"
+#include "event_queue.h"
+#include "intern.h"
 
 
 bool circuit_apply_wire(circuit_t *circ, wire_t *wire) {
@@ -51,6 +53,77 @@ bool circuit_apply_wire(circuit_t *circ, wire_t *wire) {
 }
 
 
+// Whether a port of a custom gate is driven from inside it, found from the inner port it's connected to
+static bool circuit_is_output_node(gate_t *custom, port_t *node) {
+	FUNC_START();
+
+	VEC_EACH(node->connections, port_t *connection) {
+		hex_hashmap_t *gates = &custom->inner_circuit->gates;
+		gate_t *inner = connection->gate;
+
+		// Gates outside have the same names sometimes
+		if (hex_hashmap_find_item(gates, inner->name) != inner) {
+			continue;
+		}
+
+		bool output = (connection->type == PortType_OUTPUT) || (connection->type == PortType_NODE && circuit_is_output_node(inner, connection));
+
+		FUNC_END();
+		return output;
+	}
+
+	FUNC_END();
+	return false;
+}
+
+
+// The inner circuit of a custom gate is settled when its template is read, but the gates
+// around it only get its outputs once they change. Without a queue, they're recursed into.
+static bool circuit_update_custom(gate_t *custom, event_queue_t *queue) {
+	FUNC_START();
+
+	bool success = true;
+
+	VEC_EACH(custom->ports, port_t *node) {
+		if (! circuit_is_output_node(custom, node)) {
+			continue;
+		}
+
+		if (queue != NULL) {
+			success &= event_queue_propagate(queue, node);
+		}
+		else {
+			success &= port_update_state(node);
+		}
+	}
+
+	FUNC_END();
+	return success;
+}
+
+
+// Schedule every gate once, and let the queue sort out the rest
+static bool circuit_schedule(circuit_t *circ, event_queue_t *queue) {
+	FUNC_START();
+
+	bool success = true;
+
+	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
+		assert_not_null(gate);
+
+		if (gate->kind == GateKind_CUSTOM) {
+			success &= circuit_update_custom(gate, queue);
+			continue;
+		}
+
+		success &= event_queue_push(queue, gate);
+	}
+
+	FUNC_END();
+	return success;
+}
+
+
 bool circuit_update_state(circuit_t *circ) {
 	FUNC_START();
 
@@ -58,9 +131,24 @@ bool circuit_update_state(circuit_t *circ) {
 
 	bool success = true;
 
+	if (sim_get_engine() != SimEngine_RECURSIVE) {
+		event_queue_t *queue = sim_get_queue();
+
+		success &= circuit_schedule(circ, queue);
+		success &= sim_run_queue(queue);
+
+		FUNC_END();
+		return success;
+	}
+
 	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
 		assert_not_null(gate);
 
+		if (gate->kind == GateKind_CUSTOM) {
+			success &= circuit_update_custom(gate, NULL);
+			continue;
+		}
+
 		success &= gate_update_state(gate);
 	}
 
@@ -70,6 +158,138 @@ bool circuit_update_state(circuit_t *circ) {
 }
 
 
+// Settle every gate in delta cycles, whatever the engine is, and tell how it went
+settle_result_t circuit_settle(circuit_t *circ, size_t budget) {
+	FUNC_START();
+
+	assert_not_null(circ);
+
+	event_queue_t *queue = sim_get_queue();
+	bool success = circuit_schedule(circ, queue);
+
+	settle_result_t result = event_queue_settle(queue, budget);
+
+	if (! success) {
+		result.status = SettleStatus_FAILED;
+	}
+
+	FUNC_END();
+	return result;
+}
+
+
+// Move the gates of a custom gate into the circuit, and connect them directly
+static bool circuit_inline_gate(circuit_t *circ, gate_t *custom) {
+	FUNC_START();
+
+	assert_not_null(circ);
+	assert_not_null(custom);
+	assert_not_null(custom->inner_circuit);
+
+	circuit_t *inner = custom->inner_circuit;
+
+	// Make sure the inner circuit only has primitive gates
+	bool success = circuit_flatten(inner);
+
+
+	// Move the inner gates, prefixing their names with the name of the custom gate
+	size_t amount = hex_hashmap_amount(&inner->gates);
+	gate_t **gates = malloc((amount + 1) * sizeof(gate_t *));
+
+	HEX_HASHMAP_EACH_VALUE_INDEX(inner->gates, gate_t *gate, i) {
+		gates[i] = gate;
+	}
+
+	for (size_t i = 0; i < amount; i++) {
+		gate_t *gate = gates[i];
+
+		char name[strlen(custom->name) + 1 + strlen(gate->name) + 1];
+		sprintf(name, "%s%c%s", custom->name, CIRCUIT_PATH_SEPARATOR, gate->name);
+
+		gate->name = intern(name);
+
+		success &= hex_hashmap_add_item(&circ->gates, gate->name, gate);
+	}
+
+	free(gates);
+
+	// The gates are owned by the outer circuit now
+	hex_hashmap_free(&inner->gates);
+	hex_hashmap_init(&inner->gates);
+
+
+	// Replace every node by connecting the ports on both sides of it directly. Ports on
+	// different sides of a node were never connected, so the connections are appended
+	// without looking for them first, which would be quadratic in the fanout.
+	VEC_EACH(custom->ports, port_t *node) {
+		VEC_EACH(node->connections, port_t *a) {
+			size_t kept = 0;
+
+			for (size_t i = 0; i < a->connections.amount; i++) {
+				if (a->connections.items[i] != node) {
+					a->connections.items[kept++] = a->connections.items[i];
+				}
+			}
+
+			a->connections.amount = kept;
+			success &= vector_reserve(&a->connections, kept + node->connections.amount);
+
+			// Every pair is seen from both sides, so each side only adds the other one
+			VEC_EACH(node->connections, port_t *b) {
+				// Inputs never drive each other
+				if (a == b || (a->type == PortType_INPUT && b->type == PortType_INPUT)) {
+					continue;
+				}
+
+				success &= vector_push(&a->connections, b);
+			}
+		}
+	}
+
+
+	// Remove the now empty custom gate
+	success &= hex_hashmap_remove_item(&circ->gates, custom->name);
+
+	gate_free(custom);
+	free(custom);
+
+
+	FUNC_END();
+	return success;
+}
+
+
+// Inline all custom gates, so the circuit only consists of primitive gates
+bool circuit_flatten(circuit_t *circ) {
+	FUNC_START();
+
+	assert_not_null(circ);
+
+	bool success = true;
+
+	// Collect the custom gates first, since inlining changes the map
+	size_t amount = hex_hashmap_amount(&circ->gates);
+	gate_t **customs = malloc((amount + 1) * sizeof(gate_t *));
+	size_t amount_customs = 0;
+
+	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
+		if (gate->inner_circuit != NULL) {
+			customs[amount_customs++] = gate;
+		}
+	}
+
+	for (size_t i = 0; i < amount_customs; i++) {
+		success &= circuit_inline_gate(circ, customs[i]);
+	}
+
+	free(customs);
+
+
+	FUNC_END();
+	return success;
+}
+
+
 gate_t *circuit_get_gate_by_name(circuit_t *circ, char *name) {
 	FUNC_START();
 
@@ -129,18 +349,21 @@ port_t *circuit_get_io_port_by_name(circuit_t *circ, char *portname) {
 	assert_not_null(portname);
 
 
+	// Port names are interned, so a name that was never interned can't match
+	char *interned = intern_lookup(portname);
+
 	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
 		assert_not_null(gate);
 
 		// Filter on I/O ports only
-		if (! gate_is_io(gate)) {
+		if (interned == NULL || ! gate_is_io(gate)) {
 			continue;
 		}
 
 		// Check portname
 		port_t *port = gate->ports.items[0];
 
-		if (strcmp(port->name, portname) == 0) {
+		if (port->name == interned) {
 			FUNC_END();
 			return port;
 		}
@@ -153,7 +376,31 @@ port_t *circuit_get_io_port_by_name(circuit_t *circ, char *portname) {
 }
 
 
-circuit_t *circuit_copy(circuit_t *src) {
+// Find the copy of a gate that a port of src_gate is connected to. That's a gate in
+// the same circuit, the gate containing the circuit, or a gate in the inner circuit
+// of src_gate, where the names of the gates can be the same on every level.
+static gate_t *circuit_copy_find_gate(circuit_t *src, circuit_t *dest, gate_t *parents[2], gate_t *src_gate, gate_t *dest_gate, gate_t *old) {
+	if (hex_hashmap_find_item(&src->gates, old->name) == old) {
+		return hex_hashmap_get_item(&dest->gates, old->name);
+	}
+
+	if (old == parents[0]) {
+		return parents[1];
+	}
+
+	circuit_t *inner = src_gate->inner_circuit;
+
+	if (inner != NULL && hex_hashmap_find_item(&inner->gates, old->name) == old) {
+		return hex_hashmap_get_item(&dest_gate->inner_circuit->gates, old->name);
+	}
+
+	return NULL;
+}
+
+
+// Copy a circuit inside the inner circuit of src_parent, to put in dest_parent,
+// which already has copies of all ports
+circuit_t *circuit_copy_nested(circuit_t *src, gate_t *src_parent, gate_t *dest_parent) {
 	FUNC_START();
 
 	assert_not_null(src);
@@ -162,11 +409,10 @@ circuit_t *circuit_copy(circuit_t *src) {
 	circuit_t *dest = malloc(sizeof(circuit_t));
 	circuit_init(dest);
 
-	// Copy name
-	dest->name = malloc(strlen(src->name) + 1);
-	strcpy(dest->name, src->name);
+	// Names are interned, so they can be shared
+	dest->name = src->name;
 
-	// Copy gates + ports
+	// Copy gates + ports, including their inner circuits
 	HEX_HASHMAP_EACH_VALUE(src->gates, gate_t *gate) {
 		gate_t *new_gate = gate_copy(gate);
 
@@ -174,6 +420,8 @@ circuit_t *circuit_copy(circuit_t *src) {
 	}
 
 	// Copy connections
+	gate_t *parents[2] = { src_parent, dest_parent };
+
 	HEX_HASHMAP_EACH_VALUE(src->gates, gate_t *old_gate) {
 		gate_t *new_gate = circuit_get_gate_by_name(dest, old_gate->name);
 		assert_not_null(new_gate);
@@ -189,7 +437,7 @@ circuit_t *circuit_copy(circuit_t *src) {
 				gate_t *old_port_conn_gate = old_port_conn->gate;
 				assert_not_null(old_port_conn_gate);
 
-				gate_t *new_port_conn_gate = circuit_get_gate_by_name(dest, old_port_conn_gate->name);
+				gate_t *new_port_conn_gate = circuit_copy_find_gate(src, dest, parents, old_gate, new_gate, old_port_conn_gate);
 				assert_not_null(new_port_conn_gate);
 
 				// Get corresponding new port
@@ -208,6 +456,10 @@ circuit_t *circuit_copy(circuit_t *src) {
 }
 
 
+circuit_t *circuit_copy(circuit_t *src) {
+	return circuit_copy_nested(src, NULL, NULL);
+}
+
 
 void circuit_print(circuit_t *circ, unsigned int depth) {
 	assert_not_null(circ);
@@ -238,8 +490,6 @@ void circuit_init(circuit_t *circ) {
 void circuit_free(circuit_t *circ) {
 	assert_not_null(circ);
 
-	if (circ->name) free(circ->name);
-
 	// Free gates
 	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t* g) {
 		assert_not_null(g);
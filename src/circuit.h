@@ -4,9 +4,15 @@
 
 #include "wire.h"
 #include "gate.h"
+#include "event_queue.h"
 #include "hex_hashmap.h"
 
 
+// Separates the names of nested gates in the names of flattened gates
+// example:  a0055d19/867350cd
+#define CIRCUIT_PATH_SEPARATOR '/'
+
+
 typedef struct circuit {
 	char *name;
 	hex_hashmap_t gates;
@@ -15,12 +21,15 @@ typedef struct circuit {
 
 bool circuit_apply_wire(circuit_t *circ, wire_t *wire);
 bool circuit_update_state(circuit_t *circ);
+settle_result_t circuit_settle(circuit_t *circ, size_t budget);
+bool circuit_flatten(circuit_t *circ);
 gate_t *circuit_get_gate_by_name(circuit_t *circ, char *name);
 port_t *circuit_get_port_by_name(circuit_t *circ, char *gatename, char *portname);
 port_t *circuit_get_io_port_by_name(circuit_t *circ, char *portname);
 
 
 circuit_t *circuit_copy(circuit_t *src);
+circuit_t *circuit_copy_nested(circuit_t *src, gate_t *src_parent, gate_t *dest_parent);
 void circuit_print(circuit_t *circ, unsigned int depth);
 void circuit_init(circuit_t *circ);
 void circuit_free(circuit_t *circ);
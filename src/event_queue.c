@@ -0,0 +1,460 @@
+#include "event_queue.h"
+
+#include <stdlib.h>
+
+#include "assert.h"
+#include "benchmark.h"
+
+
+static SimEngine_t sim_engine = SimEngine_RECURSIVE;
+static size_t sim_budget = SIM_DEFAULT_BUDGET;
+
+// Every thread simulates its own circuits
+static _Thread_local event_queue_t sim_queue;
+static _Thread_local bool sim_queue_initialised = false;
+
+
+void sim_set_engine(SimEngine_t engine) {
+	FUNC_START();
+
+	sim_engine = engine;
+
+	FUNC_END();
+}
+
+
+SimEngine_t sim_get_engine(void) {
+	return sim_engine;
+}
+
+
+event_queue_t *sim_get_queue(void) {
+	FUNC_START();
+
+	// Create the queue of this thread on first use
+	if (! sim_queue_initialised) {
+		event_queue_init(&sim_queue, BUF_SIZE);
+		sim_queue_initialised = true;
+	}
+
+	FUNC_END();
+	return &sim_queue;
+}
+
+
+// Free the queue of this thread, has to be called before a thread that simulated exits
+void sim_free_queue(void) {
+	FUNC_START();
+
+	if (sim_queue_initialised) {
+		event_queue_free(&sim_queue);
+		sim_queue_initialised = false;
+	}
+
+	FUNC_END();
+}
+
+
+void sim_set_budget(size_t budget) {
+	FUNC_START();
+
+	assert(budget > 0);
+	sim_budget = budget;
+
+	FUNC_END();
+}
+
+
+// Run the scheduled gates the way the engine does, the delta engine fails unless it settles
+bool sim_run_queue(event_queue_t *queue) {
+	FUNC_START();
+
+	if (sim_engine != SimEngine_DELTA) {
+		bool success = event_queue_run(queue);
+
+		FUNC_END();
+		return success;
+	}
+
+	queue->settle = event_queue_settle(queue, sim_budget);
+
+	FUNC_END();
+	return queue->settle.status == SettleStatus_SETTLED;
+}
+
+
+bool event_queue_push(event_queue_t *queue, gate_t *gate) {
+	FUNC_START();
+
+	assert_not_null(queue);
+	assert_not_null(gate);
+
+	// Every gate is in the queue at most once, which bounds its size
+	if (gate->queued) {
+		FUNC_END();
+		return true;
+	}
+
+
+	// Grow the ring buffer when it's full
+	if (queue->amount == queue->size) {
+		size_t new_size = queue->size * 2;
+		gate_t **gates = malloc(new_size * sizeof(gate_t *));
+
+		if (gates == NULL) {
+			panic("Failed to grow event queue to %lu gates", new_size);
+			FUNC_END();
+			return false;
+		}
+
+		// Unwrap the old items to the start of the new buffer
+		for (size_t i = 0; i < queue->amount; i++) {
+			gates[i] = queue->gates[(queue->head + i) % queue->size];
+		}
+
+		free(queue->gates);
+
+		queue->gates = gates;
+		queue->head = 0;
+		queue->size = new_size;
+	}
+
+
+	// Add gate to the tail
+	queue->gates[(queue->head + queue->amount) % queue->size] = gate;
+	queue->amount++;
+
+	gate->queued = true;
+
+	FUNC_END();
+	return true;
+}
+
+
+gate_t *event_queue_pop(event_queue_t *queue) {
+	FUNC_START();
+
+	assert_not_null(queue);
+
+	// Check for underflow
+	if (queue->amount == 0) {
+		FUNC_END();
+		return NULL;
+	}
+
+	// Take gate from the head
+	gate_t *gate = queue->gates[queue->head];
+
+	queue->head = (queue->head + 1) % queue->size;
+	queue->amount--;
+
+	gate->queued = false;
+
+	FUNC_END();
+	return gate;
+}
+
+
+// Copy the state of the given port to everything it drives, without recursing
+bool event_queue_propagate(event_queue_t *queue, port_t *port) {
+	FUNC_START();
+
+	assert_not_null(queue);
+	assert_not_null(port);
+
+	bool success = true;
+
+	queue->ports[0] = port;
+	queue->ports_amount = 1;
+
+
+	while (queue->ports_amount > 0) {
+		port_t *current = queue->ports[--queue->ports_amount];
+
+		if (current->type == PortType_INPUT) {
+			// Input ports should schedule the gate they are attached to
+			success &= event_queue_push(queue, current->gate);
+			continue;
+		}
+
+
+		// Outputs and nodes should copy their state to their connected inputs and nodes
+		VEC_EACH(current->connections, port_t *connection) {
+			// Filter on inputs and nodes
+			if (connection->type != PortType_INPUT && connection->type != PortType_NODE) {
+				continue;
+			}
+
+			// Stop at connections that already match
+			if (connection->state == current->state) {
+				continue;
+			}
+
+			connection->state = current->state;
+
+
+			// Grow the port stack when it's full
+			if (queue->ports_amount == queue->ports_size) {
+				queue->ports_size *= 2;
+				queue->ports = realloc(queue->ports, queue->ports_size * sizeof(port_t *));
+				assert_not_null(queue->ports);
+			}
+
+			queue->ports[queue->ports_amount++] = connection;
+		}
+	}
+
+
+	FUNC_END();
+	return success;
+}
+
+
+bool event_queue_run(event_queue_t *queue) {
+	FUNC_START();
+
+	assert_not_null(queue);
+
+	bool success = true;
+
+	struct timespec start = {0, 0};
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+
+	for (gate_t *gate = event_queue_pop(queue); gate != NULL; gate = event_queue_pop(queue)) {
+		queue->events++;
+
+		port_t *output;
+		bool state;
+
+		success &= gate_evaluate(gate, &output, &state);
+
+		// Only changed outputs have to be propagated
+		if (output == NULL || output->state == state) {
+			continue;
+		}
+
+		output->state = state;
+
+		success &= event_queue_propagate(queue, output);
+	}
+
+
+	struct timespec end = {0, 0};
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	queue->time += long_time(end) - long_time(start);
+
+
+	FUNC_END();
+	return success;
+}
+
+
+// A random key per port, whose state is in the hash of a delta cycle when it's set
+static uint64_t event_queue_port_key(port_t *port) {
+	uint64_t key = (uint64_t) (uintptr_t) port;
+
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ull;
+	key ^= key >> 33;
+
+	return key;
+}
+
+
+// Evaluate the queue in delta cycles: all scheduled gates see the same state, and their
+// new outputs are applied together, scheduling the next delta cycle. Every state follows
+// from the one before, so a state that repeats while gates still change will repeat
+// forever. The hash of the outputs that changed since the start finds it, with Brent's
+// cycle detection. Gates still scheduled at the end are dropped.
+// NOTE: Like in any zero delay simulation, a latch that starts out of balance races,
+//       its gates flip together forever
+
+settle_result_t event_queue_settle(event_queue_t *queue, size_t budget) {
+	FUNC_START();
+
+	assert_not_null(queue);
+
+	settle_result_t result = {
+		.status = SettleStatus_SETTLED,
+		.deltas = 0,
+		.events = 0,
+		.period = 0,
+		.changes = 0
+	};
+
+	struct timespec start = {0, 0};
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	bool success = true;
+
+	uint64_t hash = 0;
+	uint64_t saved = 0;
+	size_t power = 1;
+	size_t period = 1;
+
+	while (queue->amount > 0) {
+		if (result.deltas == budget) {
+			result.status = SettleStatus_BUDGET_EXCEEDED;
+			break;
+		}
+
+		result.deltas++;
+
+
+		// Gates scheduled during this delta cycle wait for the next one
+		size_t amount = queue->amount;
+		queue->changes_amount = 0;
+
+		for (size_t i = 0; i < amount; i++) {
+			gate_t *gate = event_queue_pop(queue);
+
+			port_t *output;
+			bool state;
+
+			success &= gate_evaluate(gate, &output, &state);
+			result.events++;
+
+			if (output == NULL || output->state == state) {
+				continue;
+			}
+
+			if (queue->changes_amount == queue->changes_size) {
+				queue->changes_size *= 2;
+				queue->changes = realloc(queue->changes, queue->changes_size * sizeof(port_t *));
+				assert_not_null(queue->changes);
+			}
+
+			queue->changes[queue->changes_amount++] = output;
+		}
+
+		for (size_t i = 0; i < queue->changes_amount; i++) {
+			port_t *output = queue->changes[i];
+
+			output->state = ! output->state;
+			hash ^= event_queue_port_key(output);
+
+			success &= event_queue_propagate(queue, output);
+		}
+
+		result.changes = queue->changes_amount;
+
+
+		if (queue->amount > 0 && hash == saved) {
+			result.status = SettleStatus_OSCILLATING;
+			result.period = period;
+			break;
+		}
+
+		// Compare against the state at every power of 2
+		if (period == power) {
+			saved = hash;
+			power *= 2;
+			period = 0;
+		}
+
+		period++;
+	}
+
+
+	// A gate that failed makes the whole state unreliable
+	if (! success) {
+		result.status = SettleStatus_FAILED;
+	}
+
+	// Leave the queue empty, without gates that think they're queued
+	while (event_queue_pop(queue) != NULL);
+
+	struct timespec end = {0, 0};
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	queue->events += result.events;
+	queue->time += long_time(end) - long_time(start);
+
+
+	FUNC_END();
+	return result;
+}
+
+
+const char *settle_status_name(SettleStatus_t status) {
+	switch (status) {
+		case SettleStatus_SETTLED:         return "settled";
+		case SettleStatus_OSCILLATING:     return "oscillating";
+		case SettleStatus_BUDGET_EXCEEDED: return "budget exceeded";
+		case SettleStatus_FAILED:          return "failed";
+	}
+
+	return "unknown";
+}
+
+
+double event_queue_events_per_second(event_queue_t *queue) {
+	assert_not_null(queue);
+
+	if (queue->time == 0) {
+		return 0;
+	}
+
+	return (double) queue->events * 1e9 / (double) queue->time;
+}
+
+
+void event_queue_reset_stats(event_queue_t *queue) {
+	assert_not_null(queue);
+
+	queue->events = 0;
+	queue->time = 0;
+}
+
+
+void event_queue_print(event_queue_t *queue) {
+	assert_not_null(queue);
+
+	printf("%lu events in %.3f ms (%.0f events/s), %lu / %lu queued\n",
+		queue->events,
+		(double) queue->time / 1e6,
+		event_queue_events_per_second(queue),
+		queue->amount,
+		queue->size
+	);
+}
+
+
+void event_queue_init(event_queue_t *queue, size_t size) {
+	assert_not_null(queue);
+	assert(size > 0);
+
+	queue->gates = malloc(size * sizeof(gate_t *));
+	queue->head = 0;
+	queue->amount = 0;
+	queue->size = size;
+
+	queue->ports = malloc(size * sizeof(port_t *));
+	queue->ports_amount = 0;
+	queue->ports_size = size;
+
+	queue->changes = malloc(size * sizeof(port_t *));
+	queue->changes_amount = 0;
+	queue->changes_size = size;
+
+	queue->settle = (settle_result_t) { .status = SettleStatus_SETTLED };
+
+	queue->events = 0;
+	queue->time = 0;
+}
+
+
+void event_queue_free(event_queue_t *queue) {
+	assert_not_null(queue);
+
+	// Make sure no gate thinks it's still queued
+	while (event_queue_pop(queue) != NULL);
+
+	free(queue->gates);
+	free(queue->ports);
+	free(queue->changes);
+}
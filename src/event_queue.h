@@ -0,0 +1,103 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+
+#include "gate.h"
+
+
+// The engine used to propagate state changes
+typedef enum SimEngine {
+	// Recurse through port_update_state and gate_update_state
+	SimEngine_RECURSIVE,
+
+	// Schedule gates in a FIFO and evaluate them iteratively
+	SimEngine_QUEUE,
+
+	// Evaluate the queue in delta cycles, and give up on oscillations and at the budget
+	SimEngine_DELTA
+} SimEngine_t;
+
+
+// Delta cycles of the delta engine, when sim_set_budget isn't called
+#define SIM_DEFAULT_BUDGET 10000
+
+
+typedef enum SettleStatus {
+	SettleStatus_SETTLED,
+
+	// The state of the circuit repeated while gates were still changing
+	SettleStatus_OSCILLATING,
+
+	// Still changing after the budget, without repeating yet
+	SettleStatus_BUDGET_EXCEEDED,
+
+	// A gate couldn't be scheduled or evaluated, like one of an unknown type
+	SettleStatus_FAILED
+} SettleStatus_t;
+
+
+typedef struct settle_result {
+	SettleStatus_t status;
+
+	// Delta cycles run, and gates evaluated in them
+	size_t deltas;
+	unsigned long events;
+
+	// Delta cycles between two equal states, only when oscillating
+	size_t period;
+
+	// Gates whose output changed in the last delta cycle
+	size_t changes;
+} settle_result_t;
+
+
+typedef struct event_queue {
+	// Ring buffer of gates waiting to be evaluated
+	gate_t **gates;
+	size_t head;
+	size_t amount;
+	size_t size;
+
+	// Ports whose new state still has to be copied to their connections
+	port_t **ports;
+	size_t ports_amount;
+	size_t ports_size;
+
+	// Outputs changing at the end of the current delta cycle
+	port_t **changes;
+	size_t changes_amount;
+	size_t changes_size;
+
+	// How the delta engine settled last
+	settle_result_t settle;
+
+	// Statistics
+	unsigned long events;
+	long time;
+} event_queue_t;
+
+
+void sim_set_engine(SimEngine_t engine);
+SimEngine_t sim_get_engine(void);
+event_queue_t *sim_get_queue(void);
+void sim_free_queue(void);
+void sim_set_budget(size_t budget);
+bool sim_run_queue(event_queue_t *queue);
+
+
+bool event_queue_push(event_queue_t *queue, gate_t *gate);
+gate_t *event_queue_pop(event_queue_t *queue);
+bool event_queue_propagate(event_queue_t *queue, port_t *port);
+bool event_queue_run(event_queue_t *queue);
+settle_result_t event_queue_settle(event_queue_t *queue, size_t budget);
+const char *settle_status_name(SettleStatus_t status);
+double event_queue_events_per_second(event_queue_t *queue);
+void event_queue_reset_stats(event_queue_t *queue);
+
+
+void event_queue_print(event_queue_t *queue);
+void event_queue_init(event_queue_t *queue, size_t size);
+void event_queue_free(event_queue_t *queue);
+
+
+#endif
@@ -2,7 +2,8 @@
 
 #include "assert.h"
 #include "benchmark.h"
-#include "utils.h"
+#include "intern.h"
+#include "library.h"
 
 
 port_t *gate_get_port_by_name(gate_t *gate, char *name) {
@@ -12,10 +13,13 @@ port_t *gate_get_port_by_name(gate_t *gate, char *name) {
 	assert_not_null(name);
 
 
+	// Port names are interned, so a name that was never interned can't match
+	char *interned = intern_lookup(name);
+
 	VEC_EACH(gate->ports, port_t *port) {
 		assert_not_null(port);
 
-		if (strcmp(port->name, name) == 0) {
+		if (interned != NULL && port->name == interned) {
 			FUNC_END();
 			return port;
 		}
@@ -37,10 +41,11 @@ bool gate_add_port(gate_t *gate, unsigned int i, char *name, PortType_t type) {
 
 	if (name == NULL) {
 		// Set default name format
-		name = malloc(BUF_SIZE);
+		char buf[BUF_SIZE];
 		char typechar = (type == PortType_INPUT) ? 'I' : 'O';
 
-		sprintf(name, "%c%i", typechar, i);
+		sprintf(buf, "%c%i", typechar, i);
+		name = intern(buf);
 	}
 
 
@@ -75,37 +80,58 @@ bool gate_add_node(gate_t *gate, char *name) {
 }
 
 
-bool gate_set_ports(gate_t *gate, char *portname, vector_t *dependencies) {
+GateKind_t gate_get_kind(char *type) {
 	FUNC_START();
 
-	assert_not_null(gate);
+	assert_not_null(type);
 
-	bool success = true;
+	GateKind_t kind = GateKind_CUSTOM;
 
-	switch_str(gate->type) {
+	switch_str(type) {
 		case_str("AND") {
-			success &= gate_add_input(gate, 0, NULL);
-			success &= gate_add_input(gate, 1, NULL);
-			success &= gate_add_output(gate, 0, NULL);
-
+			kind = GateKind_AND;
+		}
 
-			FUNC_END();
-			return success;
+		else case_str("OR") {
+			kind = GateKind_OR;
 		}
 
+		else case_str("XOR") {
+			kind = GateKind_XOR;
+		}
 
-		else case_str("OR") {
-			success &= gate_add_input(gate, 0, NULL);
-			success &= gate_add_input(gate, 1, NULL);
-			success &= gate_add_output(gate, 0, NULL);
+		else case_str("NOT") {
+			kind = GateKind_NOT;
+		}
 
+		else case_str("IN") {
+			kind = GateKind_IN;
+		}
 
-			FUNC_END();
-			return success;
+		else case_str("OUT") {
+			kind = GateKind_OUT;
 		}
+	}
 
+	FUNC_END();
+	return kind;
+}
 
-		else case_str("XOR") {
+
+bool gate_set_ports(gate_t *gate, char *portname, library_t *library) {
+	FUNC_START();
+
+	assert_not_null(gate);
+
+	bool success = true;
+
+	// Resolve the type once, so it never has to be compared again
+	gate->kind = gate_get_kind(gate->type);
+
+	switch (gate->kind) {
+		case GateKind_AND:
+		case GateKind_OR:
+		case GateKind_XOR: {
 			success &= gate_add_input(gate, 0, NULL);
 			success &= gate_add_input(gate, 1, NULL);
 			success &= gate_add_output(gate, 0, NULL);
@@ -116,7 +142,7 @@ bool gate_set_ports(gate_t *gate, char *portname, vector_t *dependencies) {
 		}
 
 
-		else case_str("NOT") {
+		case GateKind_NOT: {
 			success &= gate_add_input(gate, 0, NULL);
 			success &= gate_add_output(gate, 0, NULL);
 
@@ -126,7 +152,7 @@ bool gate_set_ports(gate_t *gate, char *portname, vector_t *dependencies) {
 		}
 
 
-		else case_str("IN") {
+		case GateKind_IN: {
 			success &= gate_add_output(gate, 0, portname);
 
 
@@ -135,7 +161,7 @@ bool gate_set_ports(gate_t *gate, char *portname, vector_t *dependencies) {
 		}
 
 
-		else case_str("OUT") {
+		case GateKind_OUT: {
 			success &= gate_add_input(gate, 0, portname);
 
 
@@ -144,13 +170,15 @@ bool gate_set_ports(gate_t *gate, char *portname, vector_t *dependencies) {
 		}
 
 
-		else {
-			// Try to find circuit in dependencies
-			circuit_t *custom = find_dependency(dependencies, gate->type);
+		case GateKind_CUSTOM: {
+			// Try to find circuit in the library
+			circuit_t *custom = (library != NULL) ? library_get(library, gate->type) : NULL;
 
 			// If failed to find custom circuit
 			if (custom == NULL) {
 				warn("Failed to set ports for gate of type %s", gate->type);
+				gate->kind = GateKind_UNKNOWN;
+
 				FUNC_END();
 				return false;
 			}
@@ -165,6 +193,10 @@ bool gate_set_ports(gate_t *gate, char *portname, vector_t *dependencies) {
 			FUNC_END();
 			return success;
 		}
+
+
+		case GateKind_UNKNOWN:
+			break;
 	}
 
 
@@ -185,29 +217,33 @@ bool gate_link_inner_circuit(gate_t *gate) {
 	bool success = true;
 
 
+	// Collect the IO gates first, since they're removed from the map
+	size_t amount = hex_hashmap_amount(&gate->inner_circuit->gates);
+	gate_t **io_gates = malloc((amount + 1) * sizeof(gate_t *));
+	size_t amount_io = 0;
+
 	HEX_HASHMAP_EACH_VALUE(gate->inner_circuit->gates, gate_t *inner_gate) {
 		assert_not_null(inner_gate);
 
-		if (! gate_is_io(inner_gate)) {
-			continue;
+		if (gate_is_io(inner_gate)) {
+			io_gates[amount_io++] = inner_gate;
 		}
+	}
+
+
+	for (size_t i = 0; i < amount_io; i++) {
+		gate_t *inner_gate = io_gates[i];
 
 		// Get inner port
 		port_t *inner_port = inner_gate->ports.items[0];
 		assert_not_null(inner_port);
 
-		// Get old portname
-		char *portname = inner_port->name;
-
-		// Copy portname
-		char *newportname = malloc(strlen(portname) + 1);
-		strcpy(newportname, portname);
+		// Add new port, sharing the interned portname
+		success &= gate_add_node(gate, inner_port->name);
 
-		// Add new port
-		success &= gate_add_node(gate, newportname);
-
-		// Copy connections
+		// Copy connections, and the state the inner circuit settled on
 		port_t *node = gate->ports.items[gate->ports.amount - 1];
+		node->state = inner_port->state;
 
 		assert(vector_copy(&node->connections, &inner_port->connections));
 
@@ -229,167 +265,205 @@ bool gate_link_inner_circuit(gate_t *gate) {
 		assert(hex_hashmap_remove_item(&gate->inner_circuit->gates, inner_gate->name));
 		gate_free(inner_gate);
 		free(inner_gate);
-
 	}
 
+	free(io_gates);
+
 
 	FUNC_END();
 	return success;
 }
 
 
-bool gate_update_state(gate_t *gate) {
-	FUNC_START();
+// NOTE: The evaluators are only called through gate_evaluate, which already benchmarks them
 
-	assert_not_null(gate);
 
+static bool gate_evaluate_and(gate_t *gate, port_t **output, bool *state) {
+	port_t *i0 = gate->ports.items[0];
+	port_t *i1 = gate->ports.items[1];
+	port_t *o0 = gate->ports.items[2];
 
-	switch_str(gate->type) {
-		case_str("AND") {
-			port_t *i0 = gate->ports.items[0];
-			port_t *i1 = gate->ports.items[1];
-			port_t *o0 = gate->ports.items[2];
+	assert_not_null(i0);
+	assert_not_null(i1);
+	assert_not_null(o0);
 
-			assert_not_null(i0);
-			assert_not_null(i1);
-			assert_not_null(o0);
+	assert_eq(i0->type, PortType_INPUT);
+	assert_eq(i1->type, PortType_INPUT);
+	assert_eq(o0->type, PortType_OUTPUT);
 
-			assert_eq(i0->type, PortType_INPUT);
-			assert_eq(i1->type, PortType_INPUT);
-			assert_eq(o0->type, PortType_OUTPUT);
+	// Apply AND
+	*output = o0;
+	*state = i0->state & i1->state;
 
-			// Apply AND
-			o0->state = i0->state & i1->state;
+	return true;
+}
 
 
-			bool success = port_update_state(o0);
+static bool gate_evaluate_or(gate_t *gate, port_t **output, bool *state) {
+	port_t *i0 = gate->ports.items[0];
+	port_t *i1 = gate->ports.items[1];
+	port_t *o0 = gate->ports.items[2];
 
+	assert_not_null(i0);
+	assert_not_null(i1);
+	assert_not_null(o0);
 
-			FUNC_END();
-			return success;
-		}
+	assert_eq(i0->type, PortType_INPUT);
+	assert_eq(i1->type, PortType_INPUT);
+	assert_eq(o0->type, PortType_OUTPUT);
 
+	// Apply OR
+	*output = o0;
+	*state = i0->state | i1->state;
 
-		else case_str("OR") {
-			port_t *i0 = gate->ports.items[0];
-			port_t *i1 = gate->ports.items[1];
-			port_t *o0 = gate->ports.items[2];
+	return true;
+}
 
-			assert_not_null(i0);
-			assert_not_null(i1);
-			assert_not_null(o0);
 
-			assert_eq(i0->type, PortType_INPUT);
-			assert_eq(i1->type, PortType_INPUT);
-			assert_eq(o0->type, PortType_OUTPUT);
+static bool gate_evaluate_xor(gate_t *gate, port_t **output, bool *state) {
+	port_t *i0 = gate->ports.items[0];
+	port_t *i1 = gate->ports.items[1];
+	port_t *o0 = gate->ports.items[2];
 
-			// Apply OR
-			o0->state = i0->state | i1->state;
+	assert_not_null(i0);
+	assert_not_null(i1);
+	assert_not_null(o0);
 
+	assert_eq(i0->type, PortType_INPUT);
+	assert_eq(i1->type, PortType_INPUT);
+	assert_eq(o0->type, PortType_OUTPUT);
 
-			bool success = port_update_state(o0);
+	// Apply XOR
+	*output = o0;
+	*state = i0->state ^ i1->state;
 
+	return true;
+}
 
-			FUNC_END();
-			return success;
-		}
 
+static bool gate_evaluate_not(gate_t *gate, port_t **output, bool *state) {
+	port_t *i0 = gate->ports.items[0];
+	port_t *o0 = gate->ports.items[1];
 
-		else case_str("XOR") {
-			port_t *i0 = gate->ports.items[0];
-			port_t *i1 = gate->ports.items[1];
-			port_t *o0 = gate->ports.items[2];
+	assert_not_null(i0);
+	assert_not_null(o0);
 
-			assert_not_null(i0);
-			assert_not_null(i1);
-			assert_not_null(o0);
+	assert_eq(i0->type, PortType_INPUT);
+	assert_eq(o0->type, PortType_OUTPUT);
 
-			assert_eq(i0->type, PortType_INPUT);
-			assert_eq(i1->type, PortType_INPUT);
-			assert_eq(o0->type, PortType_OUTPUT);
+	// Apply NOT
+	*output = o0;
+	*state = ! i0->state;
 
-			// Appl XOR
-			o0->state = i0->state ^ i1->state;
+	return true;
+}
 
 
-			bool success = port_update_state(o0);
+static bool gate_evaluate_in(gate_t *gate, port_t **output, bool *state) {
+	(void) output;
+	(void) state;
 
+	port_t *o0 = gate->ports.items[0];
 
-			FUNC_END();
-			return success;
-		}
+	assert_not_null(o0);
 
+	assert_eq(o0->type, PortType_OUTPUT);
 
-		else case_str("NOT") {
-			port_t *i0 = gate->ports.items[0];
-			port_t *o0 = gate->ports.items[1];
+	return true;
+}
 
-			assert_not_null(i0);
-			assert_not_null(o0);
 
-			assert_eq(i0->type, PortType_INPUT);
-			assert_eq(o0->type, PortType_OUTPUT);
+static bool gate_evaluate_out(gate_t *gate, port_t **output, bool *state) {
+	(void) output;
+	(void) state;
 
-			// Apply NOT
-			o0->state = ! i0->state;
+	port_t *i0 = gate->ports.items[0];
 
+	assert_not_null(i0);
 
-			bool success = port_update_state(o0);
+	assert_eq(i0->type, PortType_INPUT);
 
+	return true;
+}
 
-			FUNC_END();
-			return success;
-		}
 
+static bool gate_evaluate_custom(gate_t *gate, port_t **output, bool *state) {
+	(void) output;
+	(void) state;
 
-		else case_str("IN") {
-			port_t *o0 = gate->ports.items[0];
+	assert_not_null(gate->inner_circuit);
 
-			assert_not_null(o0);
+	// Everything should get handled automatically :)
 
-			assert_eq(o0->type, PortType_OUTPUT);
+	return true;
+}
 
-			FUNC_END();
-			return true;
-		}
 
+static bool gate_evaluate_unknown(gate_t *gate, port_t **output, bool *state) {
+	(void) output;
+	(void) state;
 
-		else case_str("OUT") {
-			port_t *i0 = gate->ports.items[0];
+	warn("Can't update the state of the gate with unknown type %s", gate->type);
 
-			assert_not_null(i0);
+	return false;
+}
 
-			assert_eq(i0->type, PortType_INPUT);
 
-			FUNC_END();
-			return true;
-		}
+// Evaluators, indexed by GateKind_t
+static const gate_evaluator_t gate_evaluators[GATE_KIND_AMOUNT] = {
+	[GateKind_UNKNOWN] = gate_evaluate_unknown,
+	[GateKind_AND] = gate_evaluate_and,
+	[GateKind_OR] = gate_evaluate_or,
+	[GateKind_XOR] = gate_evaluate_xor,
+	[GateKind_NOT] = gate_evaluate_not,
+	[GateKind_IN] = gate_evaluate_in,
+	[GateKind_OUT] = gate_evaluate_out,
+	[GateKind_CUSTOM] = gate_evaluate_custom,
+};
 
 
-		else {
-			if (gate->inner_circuit == NULL) {
-				warn("Can't update the state of the gate with unknown type %s", gate->type);
-				FUNC_END();
-				return false;
-			}
+bool gate_evaluate(gate_t *gate, port_t **output, bool *state) {
+	FUNC_START();
+
+	assert_not_null(gate);
+	assert_not_null(output);
+	assert_not_null(state);
 
-			// Everything should get handled automatically :)
+	// Gates without a computed output don't drive anything themselves
+	*output = NULL;
 
-			FUNC_END();
-			return true;
-		}
+	bool success = gate_evaluators[gate->kind](gate, output, state);
+
+	FUNC_END();
+	return success;
+}
+
+
+bool gate_update_state(gate_t *gate) {
+	FUNC_START();
+
+	assert_not_null(gate);
+
+	port_t *output;
+	bool state;
+
+	bool success = gate_evaluate(gate, &output, &state);
+
+	// Apply the new state and let it ripple through the connections
+	if (output != NULL) {
+		output->state = state;
+
+		success &= port_update_state(output);
 	}
 
 
-	// Shouldn't reach this
-	warn("Reached invalid point!");
 	FUNC_END();
-	return false;
+	return success;
 }
 
 
 bool gate_is_io(gate_t *gate) {
-	return strcmp(gate->type, "IN") == 0 || strcmp(gate->type, "OUT") == 0;
+	return gate->kind == GateKind_IN || gate->kind == GateKind_OUT;
 }
 
 
@@ -402,18 +476,10 @@ gate_t *gate_copy(gate_t *src) {
 	gate_t *dest = malloc(sizeof(gate_t));
 	gate_init(dest);
 
-	// Copy name
-	dest->name = malloc(strlen(src->name) + 1);
-	strcpy(dest->name, src->name);
-
-	// Copy type
-	dest->type = malloc(strlen(src->type) + 1);
-	strcpy(dest->type, src->type);
-
-	// Copy inner circuit if any
-	if (src->inner_circuit != NULL) {
-		dest->inner_circuit = circuit_copy(src->inner_circuit);
-	}
+	// Names are interned, so they can be shared
+	dest->name = src->name;
+	dest->type = src->type;
+	dest->kind = src->kind;
 
 	// Copy ports
 	VEC_EACH(src->ports, port_t *port) {
@@ -425,6 +491,11 @@ gate_t *gate_copy(gate_t *src) {
 		assert(vector_push(&dest->ports, new_port));
 	}
 
+	// Copy inner circuit if any, after the ports its gates are connected to
+	if (src->inner_circuit != NULL) {
+		dest->inner_circuit = circuit_copy_nested(src->inner_circuit, src, dest);
+	}
+
 
 	FUNC_END();
 	return dest;
@@ -458,16 +529,15 @@ void gate_print(gate_t *gate, unsigned int depth) {
 void gate_init(gate_t *gate) {
 	gate->name = NULL;
 	gate->type = NULL;
+	gate->kind = GateKind_UNKNOWN;
 	gate->inner_circuit = NULL;
+	gate->queued = false;
 
-	vector_init(&gate->ports, BUF_SIZE);
+	vector_init(&gate->ports, 0);
 }
 
 
 void gate_free(gate_t *gate) {
-	if (gate->name) free(gate->name);
-	if (gate->type) free(gate->type);
-
 	if (gate->inner_circuit != NULL) {
 		circuit_free(gate->inner_circuit);
 		free(gate->inner_circuit);
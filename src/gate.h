@@ -6,23 +6,49 @@
 
 
 typedef struct circuit circuit_t;
+typedef struct library library_t;
+
+
+// The type of a gate, resolved once when its ports are set
+typedef enum GateKind {
+	GateKind_UNKNOWN,
+	GateKind_AND,
+	GateKind_OR,
+	GateKind_XOR,
+	GateKind_NOT,
+	GateKind_IN,
+	GateKind_OUT,
+	GateKind_CUSTOM
+} GateKind_t;
+
+#define GATE_KIND_AMOUNT 8
 
 
 typedef struct gate {
 	char *name;
 	char *type;
+	GateKind_t kind;
 
 	vector_t ports;
 	circuit_t *inner_circuit;
+
+	// Whether the gate is waiting in the event queue
+	bool queued;
 } gate_t;
 
 
+// Compute the new state of the output of a gate, without applying it
+typedef bool (*gate_evaluator_t)(gate_t *gate, port_t **output, bool *state);
+
+
+GateKind_t gate_get_kind(char *type);
 bool gate_add_port(gate_t *gate, unsigned int i, char *X_name, PortType_t type);
 bool gate_add_input(gate_t *gate, unsigned int i, char *name);
 bool gate_add_output(gate_t *gate, unsigned int i, char *name);
 bool gate_add_node(gate_t *gate, char *name);
-bool gate_set_ports(gate_t *gate, char *portname, vector_t *dependencies);
+bool gate_set_ports(gate_t *gate, char *portname, library_t *library);
 bool gate_link_inner_circuit(gate_t *gate);
+bool gate_evaluate(gate_t *gate, port_t **output, bool *state);
 bool gate_update_state(gate_t *gate);
 bool gate_is_io(gate_t *gate);
 port_t *gate_get_port_by_name(gate_t *gate, char *name);
@@ -0,0 +1,779 @@
+#include "generate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "defines.h"
+#include "gate.h"
+#include "intern.h"
+
+
+// A signal that's always 0, only used while building
+#define GENERATE_NONE UINT32_MAX
+
+#define GENERATE_FULL_ADDER "gen_full_adder"
+#define GENERATE_HALF_ADDER "gen_half_adder"
+
+
+// Find a template that was added before, NULL if there is none
+static generate_template_t *generate_find(generate_t *gen, char *name) {
+	for (size_t i = 0; i < gen->amount_templates; i++) {
+		if (strcmp(gen->templates[i].name, name) == 0) {
+			return &gen->templates[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+// Add an empty template, which has to be finished before the next one is added
+// NOTE: Adding a template moves all templates, so pointers to them aren't valid anymore
+generate_template_t *generate_template(generate_t *gen, char *name) {
+	FUNC_START();
+
+	assert_not_null(gen);
+	assert_not_null(name);
+
+	if (gen->amount_templates == gen->size_templates) {
+		gen->size_templates = (gen->size_templates == 0) ? 8 : 2 * gen->size_templates;
+		gen->templates = realloc(gen->templates, gen->size_templates * sizeof(generate_template_t));
+		assert_not_null(gen->templates);
+	}
+
+	generate_template_t *template = &gen->templates[gen->amount_templates++];
+
+	*template = (generate_template_t) {
+		.name = intern(name),
+		.gates = NULL,
+		.amount_gates = 0,
+		.size_gates = 0,
+		.wires = NULL,
+		.amount_wires = 0,
+		.size_wires = 0
+	};
+
+	FUNC_END();
+	return template;
+}
+
+
+generate_template_t *generate_top(generate_t *gen) {
+	return (gen->amount_templates == 0) ? NULL : &gen->templates[gen->amount_templates - 1];
+}
+
+
+// The amount of primitive gates in the top template once it's flattened, without IO gates
+size_t generate_flat_gates(generate_t *gen) {
+	FUNC_START();
+
+	if (gen->amount_templates == 0) {
+		FUNC_END();
+		return 0;
+	}
+
+	// Templates only use templates before them
+	size_t counts[gen->amount_templates];
+
+	for (size_t i = 0; i < gen->amount_templates; i++) {
+		generate_template_t *template = &gen->templates[i];
+		counts[i] = 0;
+
+		for (size_t j = 0; j < template->amount_gates; j++) {
+			GateKind_t kind = gate_get_kind(template->gates[j].type);
+
+			if (kind == GateKind_CUSTOM) {
+				generate_template_t *inner = generate_find(gen, template->gates[j].type);
+				counts[i] += (inner == NULL) ? 0 : counts[inner - gen->templates];
+			}
+			else if (kind != GateKind_IN && kind != GateKind_OUT) {
+				counts[i]++;
+			}
+		}
+	}
+
+	FUNC_END();
+	return counts[gen->amount_templates - 1];
+}
+
+
+
+// NOTE: No benchmarking in the builders, they're called for every gate
+
+
+uint32_t generate_add_gate(generate_template_t *template, char *type, char *port) {
+	if (template->amount_gates == template->size_gates) {
+		template->size_gates = (template->size_gates == 0) ? 16 : 2 * template->size_gates;
+		template->gates = realloc(template->gates, template->size_gates * sizeof(generate_gate_t));
+		assert_not_null(template->gates);
+	}
+
+	template->gates[template->amount_gates] = (generate_gate_t) {
+		.type = type,
+		.port = port
+	};
+
+	return (uint32_t) template->amount_gates++;
+}
+
+
+generate_signal_t generate_input(generate_template_t *template, char *name) {
+	char *port = intern(name);
+	return (generate_signal_t) { .gate = generate_add_gate(template, "IN", port), .port = port };
+}
+
+
+void generate_output(generate_template_t *template, char *name, generate_signal_t signal) {
+	char *port = intern(name);
+	generate_connect(template, signal, generate_add_gate(template, "OUT", port), port);
+}
+
+
+void generate_connect(generate_template_t *template, generate_signal_t from, uint32_t gate, char *port) {
+	assert(from.gate != GENERATE_NONE);
+
+	if (template->amount_wires == template->size_wires) {
+		template->size_wires = (template->size_wires == 0) ? 16 : 2 * template->size_wires;
+		template->wires = realloc(template->wires, template->size_wires * sizeof(generate_wire_t));
+		assert_not_null(template->wires);
+	}
+
+	template->wires[template->amount_wires++] = (generate_wire_t) {
+		.a = from.gate,
+		.a_port = from.port,
+		.b = gate,
+		.b_port = port
+	};
+}
+
+
+// A primitive gate with two inputs
+generate_signal_t generate_op(generate_template_t *template, char *type, generate_signal_t in0, generate_signal_t in1) {
+	uint32_t gate = generate_add_gate(template, type, NULL);
+
+	generate_connect(template, in0, gate, intern("I0"));
+	generate_connect(template, in1, gate, intern("I1"));
+
+	return (generate_signal_t) { .gate = gate, .port = intern("O0") };
+}
+
+
+generate_signal_t generate_not(generate_template_t *template, generate_signal_t in) {
+	uint32_t gate = generate_add_gate(template, "NOT", NULL);
+
+	generate_connect(template, in, gate, intern("I0"));
+
+	return (generate_signal_t) { .gate = gate, .port = intern("O0") };
+}
+
+
+// An input or output numbered like A0, A1, ...
+static char *generate_name(char *prefix, size_t i) {
+	char name[strlen(prefix) + 24];
+	sprintf(name, "%s%lu", prefix, i);
+
+	return intern(name);
+}
+
+
+static generate_signal_t generate_port(uint32_t gate, char *port) {
+	return (generate_signal_t) { .gate = gate, .port = intern(port) };
+}
+
+
+
+// Add the adder cells once
+static void generate_adder_cells(generate_t *gen) {
+	FUNC_START();
+
+	if (generate_find(gen, GENERATE_HALF_ADDER) == NULL) {
+		generate_template_t *half = generate_template(gen, GENERATE_HALF_ADDER);
+
+		generate_signal_t a = generate_input(half, "A");
+		generate_signal_t b = generate_input(half, "B");
+
+		generate_output(half, "S", generate_op(half, "XOR", a, b));
+		generate_output(half, "C", generate_op(half, "AND", a, b));
+	}
+
+	if (generate_find(gen, GENERATE_FULL_ADDER) == NULL) {
+		generate_template_t *full = generate_template(gen, GENERATE_FULL_ADDER);
+
+		generate_signal_t a = generate_input(full, "A");
+		generate_signal_t b = generate_input(full, "B");
+		generate_signal_t ci = generate_input(full, "Ci");
+
+		generate_signal_t p = generate_op(full, "XOR", a, b);
+
+		generate_output(full, "S", generate_op(full, "XOR", p, ci));
+		generate_output(full, "Co", generate_op(full, "OR", generate_op(full, "AND", a, b), generate_op(full, "AND", p, ci)));
+	}
+
+	FUNC_END();
+}
+
+
+// Add up to three signals with a half or full adder, signals can be GENERATE_NONE
+static void generate_add3(generate_template_t *template, generate_signal_t x[3], generate_signal_t *sum, generate_signal_t *carry) {
+	generate_signal_t present[3];
+	size_t amount = 0;
+
+	for (size_t i = 0; i < 3; i++) {
+		if (x[i].gate != GENERATE_NONE) {
+			present[amount++] = x[i];
+		}
+	}
+
+	carry->gate = GENERATE_NONE;
+
+	if (amount == 0) {
+		sum->gate = GENERATE_NONE;
+		return;
+	}
+
+	if (amount == 1) {
+		*sum = present[0];
+		return;
+	}
+
+	uint32_t adder = generate_add_gate(template, (amount == 2) ? GENERATE_HALF_ADDER : GENERATE_FULL_ADDER, NULL);
+
+	generate_connect(template, present[0], adder, intern("A"));
+	generate_connect(template, present[1], adder, intern("B"));
+
+	if (amount == 3) {
+		generate_connect(template, present[2], adder, intern("Ci"));
+	}
+
+	*sum = generate_port(adder, "S");
+	*carry = generate_port(adder, (amount == 2) ? "C" : "Co");
+}
+
+
+// A chain of full adders, with inputs A0.., B0.., Ci and outputs S0.., Co
+bool generate_ripple_adder(generate_t *gen, size_t bits) {
+	FUNC_START();
+
+	if (bits == 0) {
+		warn("Failed to generate ripple adder: it needs at least 1 bit");
+		FUNC_END();
+		return false;
+	}
+
+	generate_adder_cells(gen);
+
+	char name[BUF_SIZE];
+	sprintf(name, "gen_ripple_adder_%lu", bits);
+
+	generate_template_t *template = generate_template(gen, name);
+	generate_signal_t carry = generate_input(template, "Ci");
+
+	for (size_t i = 0; i < bits; i++) {
+		uint32_t adder = generate_add_gate(template, GENERATE_FULL_ADDER, NULL);
+
+		generate_connect(template, generate_input(template, generate_name("A", i)), adder, intern("A"));
+		generate_connect(template, generate_input(template, generate_name("B", i)), adder, intern("B"));
+		generate_connect(template, carry, adder, intern("Ci"));
+
+		generate_output(template, generate_name("S", i), generate_port(adder, "S"));
+		carry = generate_port(adder, "Co");
+	}
+
+	generate_output(template, "Co", carry);
+
+	FUNC_END();
+	return true;
+}
+
+
+// A Kogge-Stone adder of primitive gates, every carry is found in log2(bits) levels.
+// The same inputs and outputs as generate_ripple_adder.
+bool generate_lookahead_adder(generate_t *gen, size_t bits) {
+	FUNC_START();
+
+	if (bits == 0) {
+		warn("Failed to generate lookahead adder: it needs at least 1 bit");
+		FUNC_END();
+		return false;
+	}
+
+	char name[BUF_SIZE];
+	sprintf(name, "gen_lookahead_adder_%lu", bits);
+
+	generate_template_t *template = generate_template(gen, name);
+	generate_signal_t ci = generate_input(template, "Ci");
+
+	generate_signal_t *p = malloc(bits * sizeof(generate_signal_t));
+	generate_signal_t *g = malloc(bits * sizeof(generate_signal_t));
+	generate_signal_t *pp = malloc(bits * sizeof(generate_signal_t));
+	assert_not_null(p);
+	assert_not_null(g);
+	assert_not_null(pp);
+
+	for (size_t i = 0; i < bits; i++) {
+		generate_signal_t a = generate_input(template, generate_name("A", i));
+		generate_signal_t b = generate_input(template, generate_name("B", i));
+
+		p[i] = generate_op(template, "XOR", a, b);
+		g[i] = generate_op(template, "AND", a, b);
+		pp[i] = p[i];
+	}
+
+	// The carry in is part of the first generate
+	g[0] = generate_op(template, "OR", g[0], generate_op(template, "AND", p[0], ci));
+
+
+	// After every level, g[i] is the carry out of the bits up to i, looking back 2 * distance bits
+	for (size_t distance = 1; distance < bits; distance *= 2) {
+		// Going down, so the lower bits are still of the last level
+		for (size_t i = bits - 1; i >= distance; i--) {
+			g[i] = generate_op(template, "OR", g[i], generate_op(template, "AND", pp[i], g[i - distance]));
+
+			// Only bits that look back further on the next level need their propagate
+			if (i >= 2 * distance) {
+				pp[i] = generate_op(template, "AND", pp[i], pp[i - distance]);
+			}
+		}
+	}
+
+
+	generate_output(template, "S0", generate_op(template, "XOR", p[0], ci));
+
+	for (size_t i = 1; i < bits; i++) {
+		generate_output(template, generate_name("S", i), generate_op(template, "XOR", p[i], g[i - 1]));
+	}
+
+	generate_output(template, "Co", g[bits - 1]);
+
+	free(p);
+	free(g);
+	free(pp);
+
+	FUNC_END();
+	return true;
+}
+
+
+// An array multiplier of half and full adders, with inputs A0.., B0.. and outputs P0..
+bool generate_multiplier(generate_t *gen, size_t bits) {
+	FUNC_START();
+
+	if (bits < 2) {
+		warn("Failed to generate multiplier: it needs at least 2 bits");
+		FUNC_END();
+		return false;
+	}
+
+	generate_adder_cells(gen);
+
+	char name[BUF_SIZE];
+	sprintf(name, "gen_multiplier_%lu", bits);
+
+	generate_template_t *template = generate_template(gen, name);
+
+	generate_signal_t a[bits];
+	generate_signal_t b[bits];
+
+	for (size_t i = 0; i < bits; i++) {
+		a[i] = generate_input(template, generate_name("A", i));
+	}
+
+	for (size_t i = 0; i < bits; i++) {
+		b[i] = generate_input(template, generate_name("B", i));
+	}
+
+
+	// The sum of the rows so far, by bit
+	generate_signal_t *sum = malloc(2 * bits * sizeof(generate_signal_t));
+	assert_not_null(sum);
+
+	for (size_t i = 0; i < 2 * bits; i++) {
+		sum[i] = (i < bits) ? generate_op(template, "AND", a[i], b[0]) : (generate_signal_t) { .gate = GENERATE_NONE };
+	}
+
+	// Add every other row, shifted by its bit of B
+	for (size_t row = 1; row < bits; row++) {
+		generate_signal_t carry = { .gate = GENERATE_NONE };
+
+		for (size_t i = 0; i < bits; i++) {
+			generate_signal_t x[3] = { sum[row + i], generate_op(template, "AND", a[i], b[row]), carry };
+			generate_add3(template, x, &sum[row + i], &carry);
+		}
+
+		sum[row + bits] = carry;
+	}
+
+
+	for (size_t i = 0; i < 2 * bits; i++) {
+		assert(sum[i].gate != GENERATE_NONE);
+		generate_output(template, generate_name("P", i), sum[i]);
+	}
+
+	free(sum);
+
+	FUNC_END();
+	return true;
+}
+
+
+// Pick a signal with room for another connection, or any if none has room
+static size_t generate_pick(size_t *fanout, size_t amount, size_t max) {
+	size_t start = (size_t) rand() % amount;
+
+	for (size_t i = 0; i < amount; i++) {
+		size_t candidate = (start + i) % amount;
+
+		if (fanout[candidate] < max) {
+			fanout[candidate]++;
+			return candidate;
+		}
+	}
+
+	fanout[start]++;
+	return start;
+}
+
+
+// Random gates in depth levels, every gate reads the level before it, and no signal is read
+// more than fanout times while there are others left. Inputs I0.., outputs O0.. are the first
+// gates of the last level, as many as there are inputs.
+bool generate_random_dag(generate_t *gen, size_t gates, size_t inputs, size_t depth, size_t fanout, unsigned int seed) {
+	FUNC_START();
+
+	if (gates == 0 || inputs == 0 || depth == 0 || fanout == 0) {
+		warn("Failed to generate random DAG: it needs gates, inputs, depth and fanout");
+		FUNC_END();
+		return false;
+	}
+
+	char name[BUF_SIZE];
+	sprintf(name, "gen_random_dag_%lu_%u", gates, seed);
+
+	generate_template_t *template = generate_template(gen, name);
+	srand(seed);
+
+	char *types[] = { "AND", "OR", "XOR", "NOT" };
+	size_t per_level = (gates + depth - 1) / depth;
+
+
+	generate_signal_t *last = malloc(((per_level > inputs) ? per_level : inputs) * sizeof(generate_signal_t));
+	generate_signal_t *next = malloc(per_level * sizeof(generate_signal_t));
+	size_t *fanouts = malloc(((per_level > inputs) ? per_level : inputs) * sizeof(size_t));
+	assert_not_null(last);
+	assert_not_null(next);
+	assert_not_null(fanouts);
+
+	size_t amount_last = inputs;
+
+	for (size_t i = 0; i < inputs; i++) {
+		last[i] = generate_input(template, generate_name("I", i));
+	}
+
+
+	for (size_t remaining = gates; remaining > 0;) {
+		size_t amount_next = (remaining < per_level) ? remaining : per_level;
+		memset(fanouts, 0, amount_last * sizeof(size_t));
+
+		for (size_t i = 0; i < amount_next; i++) {
+			char *type = types[rand() % 4];
+			generate_signal_t in0 = last[generate_pick(fanouts, amount_last, fanout)];
+
+			if (type[0] == 'N') {
+				next[i] = generate_not(template, in0);
+			}
+			else {
+				next[i] = generate_op(template, type, in0, last[generate_pick(fanouts, amount_last, fanout)]);
+			}
+		}
+
+		generate_signal_t *swap = last;
+		last = next;
+		next = swap;
+
+		amount_last = amount_next;
+		remaining -= amount_next;
+	}
+
+
+	for (size_t i = 0; i < inputs && i < amount_last; i++) {
+		generate_output(template, generate_name("O", i), last[i]);
+	}
+
+	free(last);
+	free(next);
+	free(fanouts);
+
+	FUNC_END();
+	return true;
+}
+
+
+// Nested custom gates, every level chains width gates of the level below. With inputs
+// I0, I1 and output O0 on every level, the cell at the bottom is NOT(I0 XOR I1).
+bool generate_hierarchy(generate_t *gen, size_t depth, size_t width) {
+	FUNC_START();
+
+	if (width == 0) {
+		warn("Failed to generate hierarchy: it needs a width");
+		FUNC_END();
+		return false;
+	}
+
+	char name[BUF_SIZE];
+	char inner[BUF_SIZE];
+
+	for (size_t level = 0; level <= depth; level++) {
+		sprintf(name, "gen_hierarchy_%lu_%lu_%lu", depth, width, level);
+
+		generate_template_t *template = generate_template(gen, name);
+
+		generate_signal_t i0 = generate_input(template, "I0");
+		generate_signal_t i1 = generate_input(template, "I1");
+
+		if (level == 0) {
+			generate_output(template, "O0", generate_not(template, generate_op(template, "XOR", i0, i1)));
+			continue;
+		}
+
+		sprintf(inner, "gen_hierarchy_%lu_%lu_%lu", depth, width, level - 1);
+
+		generate_signal_t signal = i0;
+		char *type = intern(inner);
+
+		for (size_t i = 0; i < width; i++) {
+			uint32_t gate = generate_add_gate(template, type, NULL);
+
+			generate_connect(template, signal, gate, intern("I0"));
+			generate_connect(template, i1, gate, intern("I1"));
+
+			signal = generate_port(gate, "O0");
+		}
+
+		generate_output(template, "O0", signal);
+	}
+
+	FUNC_END();
+	return true;
+}
+
+
+// A ring of NOT gates that's closed by an OR with input I0, so it holds once I0 was set.
+// The ring always has an even length, so it never oscillates. Output O0 is the end of the ring.
+bool generate_feedback_chain(generate_t *gen, size_t length) {
+	FUNC_START();
+
+	if (length == 0) {
+		warn("Failed to generate feedback chain: it needs a length");
+		FUNC_END();
+		return false;
+	}
+
+	length += length % 2;
+
+	char name[BUF_SIZE];
+	sprintf(name, "gen_feedback_chain_%lu", length);
+
+	generate_template_t *template = generate_template(gen, name);
+
+	uint32_t gate = generate_add_gate(template, "OR", NULL);
+	generate_connect(template, generate_input(template, "I0"), gate, intern("I0"));
+
+	generate_signal_t signal = generate_port(gate, "O0");
+
+	for (size_t i = 0; i < length; i++) {
+		signal = generate_not(template, signal);
+	}
+
+	generate_connect(template, signal, gate, intern("I1"));
+	generate_output(template, "O0", signal);
+
+	FUNC_END();
+	return true;
+}
+
+
+
+static void generate_write_text(generate_template_t *template, FILE *file) {
+	FUNC_START();
+
+	fprintf(file, "%s\n\n[gates] %lu\n", template->name, template->amount_gates);
+
+	for (size_t i = 0; i < template->amount_gates; i++) {
+		generate_gate_t *gate = &template->gates[i];
+
+		if (gate->port != NULL) {
+			fprintf(file, "%lu %s #%s\n", i, gate->type, gate->port);
+		}
+		else {
+			fprintf(file, "%lu %s\n", i, gate->type);
+		}
+	}
+
+	fprintf(file, "\n[wires] %lu\n", template->amount_wires);
+
+	for (size_t i = 0; i < template->amount_wires; i++) {
+		generate_wire_t *wire = &template->wires[i];
+		fprintf(file, "%u:%s %u:%s\n", wire->a, wire->a_port, wire->b, wire->b_port);
+	}
+
+	FUNC_END();
+}
+
+
+// The "gates" and "wires" of a circuit, IO gates get their names from the wires
+static void generate_write_json_circuit(generate_template_t *template, FILE *file, char *indent) {
+	FUNC_START();
+
+	fprintf(file, "%s\"gates\": {\n", indent);
+
+	for (size_t i = 0; i < template->amount_gates; i++) {
+		fprintf(file, "%s  \"%lu\": { \"type\": \"%s\" }%s\n", indent, i, template->gates[i].type, (i + 1 < template->amount_gates) ? "," : "");
+	}
+
+	fprintf(file, "%s},\n%s\"wires\": [\n", indent, indent);
+
+	for (size_t i = 0; i < template->amount_wires; i++) {
+		generate_wire_t *wire = &template->wires[i];
+
+		fprintf(file, "%s  { \"a\": \"%u:%s\", \"b\": \"%u:%s\" }%s\n", indent,
+			wire->a, wire->a_port, wire->b, wire->b_port,
+			(i + 1 < template->amount_wires) ? "," : "");
+	}
+
+	fprintf(file, "%s]\n", indent);
+
+	FUNC_END();
+}
+
+
+static void generate_write_json(generate_t *gen, FILE *file) {
+	FUNC_START();
+
+	generate_template_t *top = generate_top(gen);
+
+	fprintf(file, "{\n  \"name\": \"%s\",\n  \"circuit\": {\n", top->name);
+	generate_write_json_circuit(top, file, "    ");
+	fprintf(file, "  },\n  \"customGates\": {\n");
+
+	for (size_t i = 0; i + 1 < gen->amount_templates; i++) {
+		fprintf(file, "    \"%s\": {\n", gen->templates[i].name);
+		generate_write_json_circuit(&gen->templates[i], file, "      ");
+		fprintf(file, "    }%s\n", (i + 2 < gen->amount_templates) ? "," : "");
+	}
+
+	fprintf(file, "  }\n}\n");
+
+	FUNC_END();
+}
+
+
+// Write the design into a directory, where a library can find the top template by its name
+bool generate_write(generate_t *gen, char *dir, GenerateFormat_t format) {
+	FUNC_START();
+
+	assert_not_null(gen);
+	assert_not_null(dir);
+
+	if (gen->amount_templates == 0) {
+		warn("Failed to write design to %s: it has no templates", dir);
+		FUNC_END();
+		return false;
+	}
+
+
+	size_t amount = (format == GenerateFormat_TEXT) ? gen->amount_templates : 1;
+
+	for (size_t i = 0; i < amount; i++) {
+		generate_template_t *template = (format == GenerateFormat_TEXT) ? &gen->templates[i] : generate_top(gen);
+
+		char filename[strlen(dir) + 1 + strlen(template->name) + sizeof(".json")];
+		sprintf(filename, "%s/%s%s", dir, template->name, (format == GenerateFormat_JSON) ? ".json" : "");
+
+		FILE *file = fopen(filename, "w");
+
+		if (file == NULL) {
+			warn("Failed to open %s", filename);
+			FUNC_END();
+			return false;
+		}
+
+		if (format == GenerateFormat_TEXT) {
+			generate_write_text(template, file);
+		}
+		else {
+			generate_write_json(gen, file);
+		}
+
+		fclose(file);
+	}
+
+
+	FUNC_END();
+	return true;
+}
+
+
+// Remove what generate_write wrote into the directory, in either format
+void generate_remove(generate_t *gen, char *dir) {
+	FUNC_START();
+
+	assert_not_null(gen);
+	assert_not_null(dir);
+
+	for (size_t i = 0; i < gen->amount_templates; i++) {
+		char *name = gen->templates[i].name;
+		char filename[strlen(dir) + 1 + strlen(name) + sizeof(".json")];
+
+		sprintf(filename, "%s/%s", dir, name);
+		remove(filename);
+
+		strcat(filename, ".json");
+		remove(filename);
+	}
+
+	FUNC_END();
+}
+
+
+
+void generate_print(generate_t *gen) {
+	FUNC_START();
+
+	for (size_t i = 0; i < gen->amount_templates; i++) {
+		generate_template_t *template = &gen->templates[i];
+		printf("%s: %lu gates, %lu wires\n", template->name, template->amount_gates, template->amount_wires);
+	}
+
+	printf("%lu flat gates\n", generate_flat_gates(gen));
+
+	FUNC_END();
+}
+
+
+void generate_init(generate_t *gen) {
+	FUNC_START();
+
+	gen->templates = NULL;
+	gen->amount_templates = 0;
+	gen->size_templates = 0;
+
+	FUNC_END();
+}
+
+
+void generate_free(generate_t *gen) {
+	FUNC_START();
+
+	for (size_t i = 0; i < gen->amount_templates; i++) {
+		free(gen->templates[i].gates);
+		free(gen->templates[i].wires);
+	}
+
+	free(gen->templates);
+	generate_init(gen);
+
+	FUNC_END();
+}
@@ -0,0 +1,91 @@
+#ifndef GENERATE_H
+#define GENERATE_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+
+typedef enum GenerateFormat {
+	// One file per template, named after the template
+	GenerateFormat_TEXT,
+
+	// One <top>.json, with all other templates as custom gates
+	GenerateFormat_JSON
+} GenerateFormat_t;
+
+
+// Gates are named by their index
+typedef struct generate_gate {
+	char *type;
+
+	// Name of the port of IO gates, NULL otherwise
+	char *port;
+} generate_gate_t;
+
+
+typedef struct generate_wire {
+	uint32_t a;
+	char *a_port;
+	uint32_t b;
+	char *b_port;
+} generate_wire_t;
+
+
+// A port of a gate in a template, which is wired to the ports it drives
+typedef struct generate_signal {
+	uint32_t gate;
+	char *port;
+} generate_signal_t;
+
+
+typedef struct generate_template {
+	char *name;
+
+	generate_gate_t *gates;
+	size_t amount_gates;
+	size_t size_gates;
+
+	generate_wire_t *wires;
+	size_t amount_wires;
+	size_t size_wires;
+} generate_template_t;
+
+
+// A design, templates come after the templates they use, so the last one is the top
+typedef struct generate {
+	generate_template_t *templates;
+	size_t amount_templates;
+	size_t size_templates;
+} generate_t;
+
+
+generate_template_t *generate_template(generate_t *gen, char *name);
+generate_template_t *generate_top(generate_t *gen);
+size_t generate_flat_gates(generate_t *gen);
+
+uint32_t generate_add_gate(generate_template_t *template, char *type, char *port);
+generate_signal_t generate_input(generate_template_t *template, char *name);
+void generate_output(generate_template_t *template, char *name, generate_signal_t signal);
+void generate_connect(generate_template_t *template, generate_signal_t from, uint32_t gate, char *port);
+generate_signal_t generate_op(generate_template_t *template, char *type, generate_signal_t in0, generate_signal_t in1);
+generate_signal_t generate_not(generate_template_t *template, generate_signal_t in);
+
+bool generate_ripple_adder(generate_t *gen, size_t bits);
+bool generate_lookahead_adder(generate_t *gen, size_t bits);
+bool generate_multiplier(generate_t *gen, size_t bits);
+bool generate_random_dag(generate_t *gen, size_t gates, size_t inputs, size_t depth, size_t fanout, unsigned int seed);
+bool generate_hierarchy(generate_t *gen, size_t depth, size_t width);
+bool generate_feedback_chain(generate_t *gen, size_t length);
+
+bool generate_write(generate_t *gen, char *dir, GenerateFormat_t format);
+void generate_remove(generate_t *gen, char *dir);
+
+
+void generate_print(generate_t *gen);
+void generate_init(generate_t *gen);
+void generate_free(generate_t *gen);
+
+
+#endif
@@ -2,333 +2,243 @@
 
 #include "assert.h"
 #include "benchmark.h"
+#include "intern.h"
 
 
-size_t hex_hashmap_get_list_index_for_name(char *name) {
-	FUNC_START();
+// Names are usually interned, so most of the time comparing pointers is enough
+static inline bool hex_hashmap_name_equals(char *a, char *b) {
+	return a == b || strcmp(a, b) == 0;
+}
 
-	assert_not_null(name);
 
-	// Get first character
-	char c = name[0];
+// How far a slot is from where its hash wants it to be
+static inline size_t hex_hashmap_distance(hex_hashmap_t *map, uint64_t hash, size_t i) {
+	return (i - (hash & (map->size - 1))) & (map->size - 1);
+}
 
-	if (c >= '0' && c <= '9') {
-		FUNC_END();
-		return (size_t) (c - '0');
-	}
 
-	if (c >= 'a' && c <= 'f') {
+// Find the slot of an item, returns NULL when it's not in the map
+static hex_hashmap_slot_t *hex_hashmap_find_slot(hex_hashmap_t *map, char *name) {
+	FUNC_START();
+
+	if (map->amount == 0) {
 		FUNC_END();
-		return (size_t) (c - 'a' + 10);
+		return NULL;
 	}
 
+	uint64_t hash = intern_hash(name, strlen(name));
+	size_t mask = map->size - 1;
 
-	warn("Failed to calculate index for name '%s'", name);
+	for (size_t i = hash & mask, distance = 0; ; i = (i + 1) & mask, distance++) {
+		hex_hashmap_slot_t *slot = &map->slots[i];
 
-	FUNC_END();
-	return (size_t) -1;
+		// Robin Hood: the item would have taken this slot if it was in the map
+		if (slot->name == NULL || hex_hashmap_distance(map, slot->hash, i) < distance) {
+			FUNC_END();
+			return NULL;
+		}
+
+		if (slot->hash == hash && hex_hashmap_name_equals(slot->name, name)) {
+			FUNC_END();
+			return slot;
+		}
+	}
 }
 
 
-hex_hashmap_list_t *hex_hashmap_get_list(hex_hashmap_t *map, char *name) {
-	FUNC_START();
+// Put an item in the first slot that's further from home than it is
+static void hex_hashmap_insert(hex_hashmap_t *map, hex_hashmap_slot_t item) {
+	size_t mask = map->size - 1;
+	size_t distance = 0;
 
-	assert_not_null(map);
-	assert_not_null(name);
+	for (size_t i = item.hash & mask; ; i = (i + 1) & mask, distance++) {
+		hex_hashmap_slot_t *slot = &map->slots[i];
 
+		if (slot->name == NULL) {
+			*slot = item;
+			return;
+		}
 
-	hex_hashmap_list_t *list = map->items[hex_hashmap_get_list_index_for_name(name)];
+		// Take the slot, and move the old item further
+		size_t slot_distance = hex_hashmap_distance(map, slot->hash, i);
 
+		if (slot_distance < distance) {
+			hex_hashmap_slot_t tmp = *slot;
+			*slot = item;
+			item = tmp;
 
-	FUNC_END();
-	return list;
+			distance = slot_distance;
+		}
+	}
 }
 
 
-void *hex_hashmap_get_item(hex_hashmap_t *map, char *name) {
+static void hex_hashmap_resize(hex_hashmap_t *map, size_t size) {
 	FUNC_START();
 
-	assert_not_null(map);
-	assert_not_null(name);
+	hex_hashmap_slot_t *old_slots = map->slots;
+	size_t old_size = map->size;
 
+	map->slots = calloc(size, sizeof(hex_hashmap_slot_t));
+	assert_not_null(map->slots);
+	map->size = size;
 
-	hex_hashmap_list_t *list = hex_hashmap_get_list(map, name);
-	void *item = hex_hashmap_list_get_item(list, name);
+	for (size_t i = 0; i < old_size; i++) {
+		if (old_slots[i].name != NULL) {
+			hex_hashmap_insert(map, old_slots[i]);
+		}
+	}
 
+	free(old_slots);
 
 	FUNC_END();
-	return item;
 }
 
 
-bool hex_hashmap_add_item(hex_hashmap_t *map, char *name, void *value) {
+void *hex_hashmap_get_item(hex_hashmap_t *map, char *name) {
 	FUNC_START();
 
 	assert_not_null(map);
 	assert_not_null(name);
-	// NOTE: Not allowing NULL value
-	assert_not_null(value);
-
 
-	hex_hashmap_list_t *list = hex_hashmap_get_list(map, name);
-	assert_not_null(list);
 
+	hex_hashmap_slot_t *slot = hex_hashmap_find_slot(map, name);
 
-	// NOTE: Don't allow duplicates
-	if (hex_hashmap_list_contains_item(list, name)) {
-		panic("Can not add item: already in map");
+	if (slot == NULL) {
+		warn("Failed to find hex_hashmap item for name '%s'", name);
 		FUNC_END();
 		return NULL;
 	}
 
 
-	bool success = hex_hashmap_list_add_item(list, name, value);
-
-
 	FUNC_END();
-	return success;
+	return slot->value;
 }
 
 
-bool hex_hashmap_remove_item(hex_hashmap_t *map, char *name) {
+// Like hex_hashmap_get_item, but a missing item is expected, so it's only NULL
+void *hex_hashmap_find_item(hex_hashmap_t *map, char *name) {
 	FUNC_START();
 
 	assert_not_null(map);
 	assert_not_null(name);
 
-
-	hex_hashmap_list_t *list = hex_hashmap_get_list(map, name);
-	assert_not_null(list);
-
-	bool success = hex_hashmap_list_remove_item(map, list, name);
-
+	hex_hashmap_slot_t *slot = hex_hashmap_find_slot(map, name);
 
 	FUNC_END();
-	return success;
+	return (slot != NULL) ? slot->value : NULL;
 }
 
 
-size_t hex_hashmap_amount(hex_hashmap_t *map) {
+bool hex_hashmap_contains_item(hex_hashmap_t *map, char *name) {
 	FUNC_START();
 
 	assert_not_null(map);
-
-	// TODO: Optimise
-
-	size_t amount = 0;
-
-	HEX_HASHMAP_EACH_VALUE(*map, void *_x) {
-		(void) _x;
-		amount++;
-	}
-
-	FUNC_END();
-	return amount;
-}
-
-
-
-void *hex_hashmap_list_get_item(hex_hashmap_list_t *list, char *name) {
-	FUNC_START();
-
-	assert_not_null(list);
 	assert_not_null(name);
 
-	hex_hashmap_list_t *item = list;
-
-	if (item->name == NULL) {
-		goto fail;
-	}
-
+	bool contains = hex_hashmap_find_slot(map, name) != NULL;
 
-	while (item != NULL) {
-		if (strcmp(item->name, name) == 0) {
-			FUNC_END();
-			return item->value;
-		}
-
-		item = item->next;
-	}
-
-
-	fail:
-	warn("Failed to find hex_hashmap item for name '%s'", name);
 	FUNC_END();
-	return NULL;
+	return contains;
 }
 
 
-bool hex_hashmap_list_remove_item(hex_hashmap_t *map, hex_hashmap_list_t *list, char *name) {
+bool hex_hashmap_add_item(hex_hashmap_t *map, char *name, void *value) {
 	FUNC_START();
 
-	assert_not_null(list);
+	assert_not_null(map);
 	assert_not_null(name);
+	// NOTE: Not allowing NULL value
+	assert_not_null(value);
 
-	hex_hashmap_list_t *item = list;
-
-
-	if (item->name == NULL) {
-		goto notfound;
-	}
-
-
-	// Check if first item
-	if (strcmp(item->name, name) == 0) {
-		if (item->next != NULL) {
-			// Replace the first item with the next
-			map->items[hex_hashmap_get_list_index_for_name(name)] = item->next;
-		}
-		else {
-			// Reset to initial state
-			item->name = NULL;
-			item->value = NULL;
-		}
 
+	// NOTE: Don't allow duplicates
+	if (hex_hashmap_find_slot(map, name) != NULL) {
+		panic("Can not add item: already in map");
 		FUNC_END();
-		return true;
+		return false;
 	}
 
 
-	while (item->next != NULL) {
-		if (strcmp(item->next->name, name) == 0) {
-			item->next = item->next->next;
+	// Keep the map at most 3/4 full
+	if (4 * (map->amount + 1) > 3 * map->size) {
+		hex_hashmap_resize(map, (map->size == 0) ? HEX_HASHMAP_INITIAL_SIZE : 2 * map->size);
+	}
 
-			FUNC_END();
-			return true;
-		}
+	hex_hashmap_slot_t item = {
+		.name = name,
+		.value = value,
+		.hash = intern_hash(name, strlen(name))
+	};
 
-		item = item->next;
-	}
+	hex_hashmap_insert(map, item);
+	map->amount++;
 
 
-	notfound:
-	warn("Failed to remove item %s, since it's not in the hexmap", name);
 	FUNC_END();
-	return false;
+	return true;
 }
 
 
-bool hex_hashmap_list_contains_item(hex_hashmap_list_t *list, char *name) {
+bool hex_hashmap_remove_item(hex_hashmap_t *map, char *name) {
 	FUNC_START();
 
-	assert_not_null(list);
+	assert_not_null(map);
 	assert_not_null(name);
 
-	hex_hashmap_list_t *item = list;
 
+	hex_hashmap_slot_t *slot = hex_hashmap_find_slot(map, name);
 
-	if (item->name == NULL) {
+	if (slot == NULL) {
+		warn("Failed to remove item %s, since it's not in the hexmap", name);
 		FUNC_END();
 		return false;
 	}
 
 
-	while (item != NULL) {
-		if (strcmp(item->name, name) == 0) {
-			FUNC_END();
-			return true;
-		}
-
-		item = item->next;
-	}
-
-
-	FUNC_END();
-	return false;
-}
-
-
-bool hex_hashmap_list_add_item(hex_hashmap_list_t *list, char *name, void *value) {
-	FUNC_START();
-
-	assert_not_null(list);
-	assert_not_null(name);
-	// NOTE: Not allowing NULL value
-	assert_not_null(value);
+	// Shift the following items back, until one is already home
+	size_t mask = map->size - 1;
+	size_t i = (size_t) (slot - map->slots);
 
+	for (;;) {
+		size_t next = (i + 1) & mask;
+		hex_hashmap_slot_t *next_slot = &map->slots[next];
 
-	// First item
-	if (list->name == NULL) {
-		// Replace first item
-		list->name = name;
-		list->value = value;
+		if (next_slot->name == NULL || hex_hashmap_distance(map, next_slot->hash, next) == 0) {
+			break;
+		}
 
-		FUNC_END();
-		return true;
+		map->slots[i] = *next_slot;
+		i = next;
 	}
 
+	map->slots[i].name = NULL;
+	map->slots[i].value = NULL;
+	map->amount--;
 
-	// Create new item
-	hex_hashmap_list_t *item = malloc(sizeof(hex_hashmap_list_t));
-	hex_hashmap_list_init(item);
-
-	item->name = name;
-	item->value = value;
-
-	// Add item to list
-	hex_hashmap_list_t *last = hex_hashmap_list_get_last(list);
-
-
-	last->next = item;
 
 	FUNC_END();
 	return true;
 }
 
 
-hex_hashmap_list_t *hex_hashmap_list_get_last(hex_hashmap_list_t *list) {
-	FUNC_START();
-
-	assert_not_null(list);
-
-	hex_hashmap_list_t *last = list;
-
-
-	if (last == NULL) {
-		warn("Failed to get last item of list: lits doesn't have any items");
-		FUNC_END();
-		return NULL;
-	}
-
-
-	while (last->next != NULL) {
-		last = last->next;
-	}
-
+size_t hex_hashmap_amount(hex_hashmap_t *map) {
+	assert_not_null(map);
 
-	FUNC_END();
-	return last;
+	return map->amount;
 }
 
 
 
 void hex_hashmap_init(hex_hashmap_t *map) {
-	for (size_t i=0; i < 16; i++) {
-		map->items[i] = malloc(sizeof(hex_hashmap_list_t));
-		hex_hashmap_list_init(map->items[i]);
-	}
+	map->slots = NULL;
+	map->size = 0;
+	map->amount = 0;
 }
 
 
 void hex_hashmap_free(hex_hashmap_t *map) {
-	for (size_t i=0; i < 16; i++) {
-		hex_hashmap_list_free(map->items[i]);
-		free(map->items[i]);
-	}
-}
-
-
+	if (map->slots) free(map->slots);
 
-void hex_hashmap_list_init(hex_hashmap_list_t *item) {
-	item->name = NULL;
-	item->value = NULL;
-	item->next = NULL;
-}
-
-
-void hex_hashmap_list_free(hex_hashmap_list_t *item) {
-	if (item->next != NULL) {
-		hex_hashmap_list_free(item->next);
-		free(item->next);
-	}
+	hex_hashmap_init(map);
 }
@@ -77,15 +77,11 @@ test_result_t hhmtest(void) {
 
 
 	// Some basic asserts
-	assert_str_eq(hex_hashmap_get_list(&map, "abb")->name, "aaa");
-	assert_str_eq(hex_hashmap_get_list(&map, "abb")->next->name, "aab");
-	assert_str_eq(hex_hashmap_get_list(&map, "abb")->next->next->name, "aba");
-	assert_str_eq(hex_hashmap_get_list(&map, "abb")->next->next->next->name, "abb");
-
-
-	assert_str_eq(hex_hashmap_get_list(&map, "baa")->name, "baa");
-	assert_str_eq(hex_hashmap_get_list(&map, "bbb")->name, "baa");
-	assert_str_eq(hex_hashmap_get_list(&map, "bba")->next->next->name, "bba");
+	assert_eq(hex_hashmap_amount(&map), 8);
+	assert_true(hex_hashmap_contains_item(&map, "abb"));
+	assert_false(hex_hashmap_contains_item(&map, "abc"));
+	assert_eq(hex_hashmap_find_item(&map, "abc"), NULL);
+	assert_eq(hex_hashmap_find_item(&map, "abb"), hex_hashmap_get_item(&map, "abb"));
 
 	// Test items
 	{
@@ -124,6 +120,53 @@ test_result_t hhmtest(void) {
 	assert_eq(amount, 8);
 
 
+	// Remove items, the others should still be found
+	item_t *removed = hex_hashmap_get_item(&map, "aab");
+
+	assert_true(hex_hashmap_remove_item(&map, "aab"));
+	assert_false(hex_hashmap_contains_item(&map, "aab"));
+	assert_eq(hex_hashmap_amount(&map), 7);
+	free(removed);
+
+	HEX_HASHMAP_EACH_KEY_VALUE_INDEX(map, char *name, item_t *item, i) {
+		assert_eq(hex_hashmap_get_item(&map, name), item);
+		assert_true(i < 7);
+	}
+
+
+	// Grow the map with names that aren't hex
+	static item_t many[1000];
+	char names[1000][16];
+
+	for (size_t i = 0; i < 1000; i++) {
+		sprintf(names[i], "item_%lu", i);
+		many[i].value = (int) i;
+
+		assert_true(hex_hashmap_add_item(&map, names[i], &many[i]));
+	}
+
+	assert_eq(hex_hashmap_amount(&map), 1007);
+
+	for (size_t i = 0; i < 1000; i += 2) {
+		assert_true(hex_hashmap_remove_item(&map, names[i]));
+	}
+
+	size_t found = 0;
+
+	for (size_t i = 0; i < 1000; i++) {
+		found += hex_hashmap_contains_item(&map, names[i]);
+	}
+
+	assert_eq(found, 500);
+	assert_eq(hex_hashmap_amount(&map), 507);
+
+	for (size_t i = 1; i < 1000; i += 2) {
+		item_t *item = hex_hashmap_get_item(&map, names[i]);
+		assert_eq(item, &many[i]);
+		assert_true(hex_hashmap_remove_item(&map, names[i]));
+	}
+
+
 	// Free everything
 	HEX_HASHMAP_EACH_VALUE(map, item_t *item) {
 		free(item);
@@ -134,3 +177,45 @@ test_result_t hhmtest(void) {
 	FUNC_END();
 	TEST_END;
 }
+
+
+// Add and look up as many gates as a large netlist has
+test_result_t bench_hhmtest(void) {
+	FUNC_START();
+	TEST_START;
+
+	const size_t amount = 100000;
+
+	char (*names)[16] = malloc(amount * sizeof(*names));
+	item_t item = { .value = 0 };
+
+	for (size_t i = 0; i < amount; i++) {
+		sprintf(names[i], "%08lx", i * 2654435761ul & 0xffffffff);
+	}
+
+	hex_hashmap_t map;
+	hex_hashmap_init(&map);
+
+	struct timespec start = {0, 0};
+	struct timespec end = {0, 0};
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < amount; i++) {
+		assert_true(hex_hashmap_add_item(&map, names[i], &item));
+	}
+
+	for (size_t i = 0; i < amount; i++) {
+		assert_eq(hex_hashmap_get_item(&map, names[i]), &item);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("%lu adds + gets in %.3f ms\n", amount, (double) (long_time(end) - long_time(start)) / 1e6);
+
+	hex_hashmap_free(&map);
+	free(names);
+
+	FUNC_END();
+	TEST_END;
+}
@@ -13,6 +13,7 @@ typedef struct item {
 
 test_result_t populate_map(hex_hashmap_t *map);
 test_result_t hhmtest(void);
+test_result_t bench_hhmtest(void);
 
 
 #endif
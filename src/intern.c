@@ -0,0 +1,278 @@
+#include "intern.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "assert.h"
+#include "benchmark.h"
+
+
+// Interned strings are stored back to back in blocks of this size
+#define INTERN_BLOCK_SIZE 65536
+
+// The initial amount of slots in the table, always a power of 2
+#define INTERN_INITIAL_SLOTS 1024
+
+
+typedef struct intern_block {
+	struct intern_block *next;
+
+	size_t used;
+	size_t size;
+	char data[];
+} intern_block_t;
+
+
+typedef struct intern_slot {
+	uint64_t hash;
+
+	// Set last, so a reader never sees a string without its hash
+	_Atomic(char *) str;
+} intern_slot_t;
+
+
+typedef struct intern_table {
+	// The table before this one grew, kept for readers that are still using it
+	struct intern_table *retired;
+
+	size_t size;
+	intern_slot_t slots[];
+} intern_table_t;
+
+
+// Strings are found without locking, only adding them takes the lock
+static _Atomic(intern_table_t *) table = NULL;
+static size_t table_amount = 0;
+static size_t table_memory = 0;
+
+static intern_block_t *blocks = NULL;
+static size_t blocks_memory = 0;
+
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+// FNV-1a
+uint64_t intern_hash(const char *str, size_t length) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char) str[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+
+// Find the slot of a string, or the empty slot where it should go
+static intern_slot_t *intern_find_slot(intern_table_t *current, const char *str, size_t length, uint64_t hash) {
+	size_t mask = current->size - 1;
+
+	for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+		intern_slot_t *slot = &current->slots[i];
+		char *found = atomic_load_explicit(&slot->str, memory_order_acquire);
+
+		if (found == NULL) {
+			return slot;
+		}
+
+		if (slot->hash == hash && strncmp(found, str, length) == 0 && found[length] == '\0') {
+			return slot;
+		}
+	}
+}
+
+
+// Find a string without taking the lock. A string that's just added can be
+// missed when the table grows at the same time, so only a hit is certain.
+static char *intern_find(const char *str, size_t length, uint64_t hash) {
+	intern_table_t *current = atomic_load_explicit(&table, memory_order_acquire);
+
+	if (current == NULL) {
+		return NULL;
+	}
+
+	return atomic_load_explicit(&intern_find_slot(current, str, length, hash)->str, memory_order_acquire);
+}
+
+
+// NOTE: Only called with the lock
+static void intern_grow(void) {
+	FUNC_START();
+
+	intern_table_t *old = atomic_load_explicit(&table, memory_order_relaxed);
+	size_t old_size = (old != NULL) ? old->size : 0;
+	size_t size = (old_size == 0) ? INTERN_INITIAL_SLOTS : old_size * 2;
+
+	intern_table_t *grown = calloc(1, sizeof(intern_table_t) + size * sizeof(intern_slot_t));
+	assert_not_null(grown);
+
+	grown->retired = old;
+	grown->size = size;
+
+	// Reinsert all strings
+	for (size_t i = 0; i < old_size; i++) {
+		char *str = atomic_load_explicit(&old->slots[i].str, memory_order_relaxed);
+
+		if (str == NULL) {
+			continue;
+		}
+
+		size_t mask = size - 1;
+		size_t j = old->slots[i].hash & mask;
+
+		while (atomic_load_explicit(&grown->slots[j].str, memory_order_relaxed) != NULL) {
+			j = (j + 1) & mask;
+		}
+
+		grown->slots[j].hash = old->slots[i].hash;
+		atomic_store_explicit(&grown->slots[j].str, str, memory_order_relaxed);
+	}
+
+	table_memory += sizeof(intern_table_t) + size * sizeof(intern_slot_t);
+
+	// Readers only see the new table once it's filled
+	atomic_store_explicit(&table, grown, memory_order_release);
+
+	FUNC_END();
+}
+
+
+// Copy a string into the current block
+// NOTE: Only called with the lock
+static char *intern_store(const char *str, size_t length) {
+	FUNC_START();
+
+	if (blocks == NULL || blocks->size - blocks->used < length + 1) {
+		size_t size = (length + 1 > INTERN_BLOCK_SIZE) ? length + 1 : INTERN_BLOCK_SIZE;
+
+		intern_block_t *block = malloc(sizeof(intern_block_t) + size);
+		assert_not_null(block);
+
+		block->next = blocks;
+		block->used = 0;
+		block->size = size;
+
+		blocks = block;
+		blocks_memory += sizeof(intern_block_t) + size;
+	}
+
+	char *copy = &blocks->data[blocks->used];
+
+	memcpy(copy, str, length);
+	copy[length] = '\0';
+
+	blocks->used += length + 1;
+
+	FUNC_END();
+	return copy;
+}
+
+
+// Get the shared copy of the first length characters of str
+char *intern_n(const char *str, size_t length) {
+	FUNC_START();
+
+	assert_not_null(str);
+
+	uint64_t hash = intern_hash(str, length);
+	char *found = intern_find(str, length, hash);
+
+	if (found != NULL) {
+		FUNC_END();
+		return found;
+	}
+
+
+	pthread_mutex_lock(&intern_lock);
+
+	// Keep at most half of the slots in use
+	intern_table_t *current = atomic_load_explicit(&table, memory_order_relaxed);
+
+	if (current == NULL || 2 * (table_amount + 1) > current->size) {
+		intern_grow();
+		current = atomic_load_explicit(&table, memory_order_relaxed);
+	}
+
+	// Someone else could have added it since it was looked for
+	intern_slot_t *slot = intern_find_slot(current, str, length, hash);
+	found = atomic_load_explicit(&slot->str, memory_order_relaxed);
+
+	if (found == NULL) {
+		found = intern_store(str, length);
+
+		slot->hash = hash;
+		atomic_store_explicit(&slot->str, found, memory_order_release);
+		table_amount++;
+	}
+
+	pthread_mutex_unlock(&intern_lock);
+
+
+	FUNC_END();
+	return found;
+}
+
+
+char *intern(const char *str) {
+	assert_not_null(str);
+
+	return intern_n(str, strlen(str));
+}
+
+
+// Get the shared copy of the first length characters of str without adding it,
+// returns NULL if it was never interned
+char *intern_lookup_n(const char *str, size_t length) {
+	FUNC_START();
+
+	assert_not_null(str);
+
+	uint64_t hash = intern_hash(str, length);
+	char *found = intern_find(str, length, hash);
+
+	// A miss is only certain with the lock
+	if (found == NULL) {
+		pthread_mutex_lock(&intern_lock);
+		found = intern_find(str, length, hash);
+		pthread_mutex_unlock(&intern_lock);
+	}
+
+	FUNC_END();
+	return found;
+}
+
+
+char *intern_lookup(const char *str) {
+	assert_not_null(str);
+
+	return intern_lookup_n(str, strlen(str));
+}
+
+
+size_t intern_amount(void) {
+	pthread_mutex_lock(&intern_lock);
+	size_t amount = table_amount;
+	pthread_mutex_unlock(&intern_lock);
+
+	return amount;
+}
+
+
+// Including the tables that were grown out of
+size_t intern_memory(void) {
+	pthread_mutex_lock(&intern_lock);
+	size_t memory = blocks_memory + table_memory;
+	pthread_mutex_unlock(&intern_lock);
+
+	return memory;
+}
+
+
+void intern_print(void) {
+	printf("%lu interned strings in %lu bytes\n", intern_amount(), intern_memory());
+}
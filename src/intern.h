@@ -0,0 +1,25 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Interned strings are shared by everyone who interns the same string, so
+// they must never be modified or freed. Two interned strings are equal if
+// and only if their pointers are equal. Strings can be interned from any thread.
+
+
+char *intern(const char *str);
+char *intern_n(const char *str, size_t length);
+char *intern_lookup(const char *str);
+char *intern_lookup_n(const char *str, size_t length);
+uint64_t intern_hash(const char *str, size_t length);
+
+size_t intern_amount(void);
+size_t intern_memory(void);
+void intern_print(void);
+
+
+#endif
@@ -0,0 +1,377 @@
+#include "jit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__unix__)
+	#define JIT_X86_64
+
+	#include <sys/mman.h>
+#endif
+
+#include "assert.h"
+#include "benchmark.h"
+#include "pattern_kernels.h"
+
+
+// Bytes of code one op takes at most: a load, the op and a store of 10 bytes each
+#define JIT_OP_SIZE 30
+
+// Bytes of code around the ops
+#define JIT_FRAME_SIZE 48
+
+
+// No net is in the accumulator
+#define JIT_NO_NET UINT32_MAX
+
+
+#ifdef JIT_X86_64
+
+// Code that's being emitted, before it's copied to executable memory
+typedef struct jit_buffer {
+	uint8_t *bytes;
+	size_t amount;
+	size_t size;
+} jit_buffer_t;
+
+
+// How one width of registers is encoded. The accumulator is rax, ymm0 or zmm0, and
+// every op reads its other input from memory, [rdi + disp32].
+typedef struct jit_isa {
+	// Words in the accumulator
+	size_t words;
+
+	// Prefixes of mov and of the ops, their length is prefix_size
+	uint8_t mov_prefix[4];
+	uint8_t op_prefix[4];
+	size_t prefix_size;
+
+	uint8_t load;
+	uint8_t store;
+	uint8_t ops[NETLIST_OP_AMOUNT];
+
+	// Inverts the accumulator
+	uint8_t not[8];
+	size_t not_size;
+
+	// Runs before and after the loop
+	uint8_t setup[8];
+	size_t setup_size;
+	uint8_t cleanup[4];
+	size_t cleanup_size;
+} jit_isa_t;
+
+
+// mov rax, and rax, ..., with REX.W
+static const jit_isa_t jit_isa_word = {
+	.words = 1,
+	.mov_prefix = { 0x48 },
+	.op_prefix = { 0x48 },
+	.prefix_size = 1,
+	.load = 0x8b,
+	.store = 0x89,
+	.ops = { [NetlistOp_AND] = 0x23, [NetlistOp_OR] = 0x0b, [NetlistOp_XOR] = 0x33 },
+
+	// not rax
+	.not = { 0x48, 0xf7, 0xd0 },
+	.not_size = 3
+};
+
+
+// vmovdqu ymm0, vpand ymm0, ymm0, ..., with a two byte VEX
+static const jit_isa_t jit_isa_avx2 = {
+	.words = 4,
+	.mov_prefix = { 0xc5, 0xfe },
+	.op_prefix = { 0xc5, 0xfd },
+	.prefix_size = 2,
+	.load = 0x6f,
+	.store = 0x7f,
+	.ops = { [NetlistOp_AND] = 0xdb, [NetlistOp_OR] = 0xeb, [NetlistOp_XOR] = 0xef },
+
+	// vpxor ymm0, ymm0, ymm1
+	.not = { 0xc5, 0xfd, 0xef, 0xc1 },
+	.not_size = 4,
+
+	// vpcmpeqd ymm1, ymm1, ymm1, so ymm1 is all ones
+	.setup = { 0xc5, 0xf5, 0x76, 0xc9 },
+	.setup_size = 4,
+
+	// vzeroupper
+	.cleanup = { 0xc5, 0xf8, 0x77 },
+	.cleanup_size = 3
+};
+
+
+// vmovdqu64 zmm0, vpandq zmm0, zmm0, ..., with an EVEX
+static const jit_isa_t jit_isa_avx512 = {
+	.words = 8,
+	.mov_prefix = { 0x62, 0xf1, 0xfe, 0x48 },
+	.op_prefix = { 0x62, 0xf1, 0xfd, 0x48 },
+	.prefix_size = 4,
+	.load = 0x6f,
+	.store = 0x7f,
+	.ops = { [NetlistOp_AND] = 0xdb, [NetlistOp_OR] = 0xeb, [NetlistOp_XOR] = 0xef },
+
+	// vpternlogq zmm0, zmm0, zmm0, 0x0f
+	.not = { 0x62, 0xf3, 0xfd, 0x48, 0x25, 0xc0, 0x0f },
+	.not_size = 7,
+
+	// vzeroupper
+	.cleanup = { 0xc5, 0xf8, 0x77 },
+	.cleanup_size = 3
+};
+
+
+static void jit_emit(jit_buffer_t *buffer, const uint8_t *bytes, size_t amount) {
+	assert(buffer->amount + amount <= buffer->size);
+
+	memcpy(&buffer->bytes[buffer->amount], bytes, amount);
+	buffer->amount += amount;
+}
+
+
+static void jit_emit_u32(jit_buffer_t *buffer, uint32_t value) {
+	uint8_t bytes[4] = { (uint8_t) value, (uint8_t) (value >> 8), (uint8_t) (value >> 16), (uint8_t) (value >> 24) };
+	jit_emit(buffer, bytes, 4);
+}
+
+
+// An instruction on the accumulator and the words of a net, [rdi + net * words * 8]
+static void jit_emit_net(jit_buffer_t *buffer, const jit_isa_t *isa, const uint8_t *prefix, uint8_t opcode, uint32_t net, size_t words) {
+	jit_emit(buffer, prefix, isa->prefix_size);
+
+	uint8_t bytes[2] = {
+		opcode,
+		0x87      // ModRM: accumulator, [rdi + disp32]
+	};
+
+	jit_emit(buffer, bytes, 2);
+	jit_emit_u32(buffer, (uint32_t) (net * words * sizeof(uint64_t)));
+}
+
+
+// For every isa->words words: load in0 into the accumulator, apply the op with in1 in
+// memory, and store the accumulator in out. The load is left out when the accumulator
+// still has in0, or in1 of a commutative op.
+static void jit_emit_ops(jit_buffer_t *buffer, const jit_isa_t *isa, netlist_t *netlist, size_t words) {
+	// test rsi, rsi; jz end
+	static const uint8_t prologue[] = { 0x48, 0x85, 0xf6, 0x0f, 0x84 };
+	jit_emit(buffer, prologue, sizeof(prologue));
+
+	size_t skip = buffer->amount;
+	jit_emit_u32(buffer, 0);
+
+	jit_emit(buffer, isa->setup, isa->setup_size);
+
+	size_t loop = buffer->amount;
+	uint32_t cached = JIT_NO_NET;
+
+	for (size_t i = 0; i < netlist->amount_ops; i++) {
+		netlist_op_t *op = &netlist->ops[i];
+
+		if (op->op == NetlistOp_NOT) {
+			if (cached != op->in0) {
+				jit_emit_net(buffer, isa, isa->mov_prefix, isa->load, op->in0, words);
+			}
+
+			jit_emit(buffer, isa->not, isa->not_size);
+		}
+		else {
+			uint32_t other = op->in1;
+
+			if (cached == op->in1) {
+				other = op->in0;
+			}
+			else if (cached != op->in0) {
+				jit_emit_net(buffer, isa, isa->mov_prefix, isa->load, op->in0, words);
+			}
+
+			jit_emit_net(buffer, isa, isa->op_prefix, isa->ops[op->op], other, words);
+		}
+
+		jit_emit_net(buffer, isa, isa->mov_prefix, isa->store, op->out, words);
+		cached = op->out;
+	}
+
+	// add rdi, 8 * isa->words; sub rsi, isa->words; jnz loop
+	uint8_t next[] = { 0x48, 0x83, 0xc7, (uint8_t) (isa->words * sizeof(uint64_t)), 0x48, 0x83, 0xee, (uint8_t) isa->words, 0x0f, 0x85 };
+	jit_emit(buffer, next, sizeof(next));
+	jit_emit_u32(buffer, (uint32_t) ((int32_t) loop - (int32_t) (buffer->amount + 4)));
+
+	jit_emit(buffer, isa->cleanup, isa->cleanup_size);
+
+	// The jump over the loop is relative to the end of its instruction
+	uint32_t end = (uint32_t) (buffer->amount - (skip + 4));
+	memcpy(&buffer->bytes[skip], &end, 4);
+
+	// ret
+	static const uint8_t ret[] = { 0xc3 };
+	jit_emit(buffer, ret, sizeof(ret));
+}
+
+
+// The widest registers of the selected pattern kernels that fit a whole number of
+// times in the words of a net
+static const jit_isa_t *jit_get_isa(size_t words) {
+	size_t kernel_words = pattern_kernels_get()->words;
+
+	if (kernel_words >= jit_isa_avx512.words && words % jit_isa_avx512.words == 0) {
+		return &jit_isa_avx512;
+	}
+
+	if (kernel_words >= jit_isa_avx2.words && words % jit_isa_avx2.words == 0) {
+		return &jit_isa_avx2;
+	}
+
+	return &jit_isa_word;
+}
+
+#endif
+
+
+// Whether this build can place code in executable memory
+bool jit_supported(void) {
+	#ifdef JIT_X86_64
+		return true;
+	#else
+		return false;
+	#endif
+}
+
+
+// Compile the ops of a netlist for patterns of some amount of words. Fails on other
+// architectures, above JIT_MAX_WORDS, when the offsets of the nets don't fit in 32 bits, or the code is bigger
+// than a jump can cross, and then jit_evaluate interprets the netlist.
+bool jit_compile(jit_t *jit, netlist_t *netlist, size_t words) {
+	FUNC_START();
+
+	assert_not_null(jit);
+	assert_not_null(netlist);
+	assert(words > 0);
+
+	jit_free(jit);
+	jit_init(jit);
+
+	jit->netlist = netlist;
+	jit->words = words;
+
+	if (! jit_supported() || words > JIT_MAX_WORDS) {
+		FUNC_END();
+		return false;
+	}
+
+	size_t size = netlist->amount_ops * JIT_OP_SIZE + JIT_FRAME_SIZE;
+
+	if ((uint64_t) netlist->amount_nets * words * sizeof(uint64_t) > INT32_MAX || size > INT32_MAX) {
+		warn("Can't compile %s: %lu nets of %lu words are too big, it will be interpreted", netlist->name, netlist->amount_nets, words);
+		FUNC_END();
+		return false;
+	}
+
+	#ifdef JIT_X86_64
+		jit_buffer_t buffer = {
+			.bytes = malloc(size),
+			.amount = 0,
+			.size = size
+		};
+
+		assert_not_null(buffer.bytes);
+
+		const jit_isa_t *isa = jit_get_isa(words);
+		jit_emit_ops(&buffer, isa, netlist, words);
+
+
+		// Never writable and executable at once
+		void *code = mmap(NULL, buffer.amount, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (code == MAP_FAILED) {
+			warn("Failed to map %lu bytes of code for %s, it will be interpreted", buffer.amount, netlist->name);
+			free(buffer.bytes);
+			FUNC_END();
+			return false;
+		}
+
+		memcpy(code, buffer.bytes, buffer.amount);
+		free(buffer.bytes);
+
+		if (mprotect(code, buffer.amount, PROT_READ | PROT_EXEC) != 0) {
+			warn("Failed to make the code of %s executable, it will be interpreted", netlist->name);
+			munmap(code, buffer.amount);
+			FUNC_END();
+			return false;
+		}
+
+		jit->code = code;
+		jit->code_size = buffer.amount;
+		jit->step = isa->words;
+
+		// Casting an object pointer to a function pointer isn't ISO C, but POSIX allows it
+		memcpy(&jit->function, &code, sizeof(code));
+	#endif
+
+	FUNC_END();
+	return true;
+}
+
+
+// Whether the pattern is evaluated by compiled code, and not interpreted
+bool jit_is_compiled(jit_t *jit, pattern_t *pattern) {
+	return jit->function != NULL && pattern->netlist == jit->netlist && pattern->words == jit->words;
+}
+
+
+void jit_evaluate(jit_t *jit, pattern_t *pattern) {
+	assert_not_null(jit);
+	assert_not_null(pattern);
+
+	if (jit_is_compiled(jit, pattern)) {
+		jit->function(pattern->state, pattern->words);
+	}
+	else {
+		pattern_evaluate(pattern);
+	}
+}
+
+
+void jit_print(jit_t *jit) {
+	FUNC_START();
+
+	if (jit->function == NULL) {
+		printf("jit: interpreted\n");
+	}
+	else {
+		printf("jit %s: %lu ops of %lu words, %lu at once, in %lu bytes of code\n",
+			jit->netlist->name, jit->netlist->amount_ops, jit->words, jit->step, jit->code_size);
+	}
+
+	FUNC_END();
+}
+
+
+void jit_init(jit_t *jit) {
+	FUNC_START();
+
+	jit->netlist = NULL;
+	jit->words = 0;
+
+	jit->code = NULL;
+	jit->code_size = 0;
+	jit->step = 0;
+	jit->function = NULL;
+
+	FUNC_END();
+}
+
+
+void jit_free(jit_t *jit) {
+	FUNC_START();
+
+	#ifdef JIT_X86_64
+		if (jit->code != NULL) {
+			munmap(jit->code, jit->code_size);
+		}
+	#endif
+
+	FUNC_END();
+}
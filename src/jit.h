@@ -0,0 +1,52 @@
+#ifndef JIT_H
+#define JIT_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "netlist.h"
+#include "pattern.h"
+
+
+// Words per net the code is compiled for at most, one pass of the widest registers.
+// With more, every pass streams the state of all nets through the cache, and the
+// kernels of the interpreter win.
+#define JIT_MAX_WORDS 8
+
+
+// Evaluates every op of a netlist for the words of a pattern state, like pattern_evaluate
+typedef void (*jit_function_t)(uint64_t *state, size_t words);
+
+
+// A netlist compiled to straight-line x86-64 code for one amount of words per net, on
+// registers as wide as the selected pattern kernels. When it can't be compiled,
+// jit_evaluate falls back to pattern_evaluate.
+typedef struct jit {
+	netlist_t *netlist;
+	size_t words;
+
+	// Executable memory of the code, NULL if it isn't compiled
+	void *code;
+	size_t code_size;
+
+	// Words of every net that one pass of the loop evaluates
+	size_t step;
+
+	jit_function_t function;
+} jit_t;
+
+
+bool jit_supported(void);
+bool jit_compile(jit_t *jit, netlist_t *netlist, size_t words);
+bool jit_is_compiled(jit_t *jit, pattern_t *pattern);
+void jit_evaluate(jit_t *jit, pattern_t *pattern);
+
+
+void jit_print(jit_t *jit);
+void jit_init(jit_t *jit);
+void jit_free(jit_t *jit);
+
+
+#endif
@@ -0,0 +1,318 @@
+#include "library.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "intern.h"
+#include "read_json.h"
+#include "read_template.h"
+
+
+// Find the file of a template in the search paths, returns NULL if there is none
+char *library_find_path(library_t *library, char *name) {
+	FUNC_START();
+
+	assert_not_null(library);
+	assert_not_null(name);
+
+	VEC_EACH(library->paths, char *dir) {
+		char path[strlen(dir) + 1 + strlen(name) + sizeof(LIBRARY_JSON_EXTENSION)];
+		sprintf(path, "%s/%s", dir, name);
+
+		if (access(path, R_OK) != 0) {
+			strcat(path, LIBRARY_JSON_EXTENSION);
+		}
+
+		if (access(path, R_OK) == 0) {
+			FUNC_END();
+			return intern(path);
+		}
+	}
+
+	FUNC_END();
+	return NULL;
+}
+
+
+bool library_is_json(char *path) {
+	assert_not_null(path);
+
+	size_t length = strlen(path);
+	size_t extension = strlen(LIBRARY_JSON_EXTENSION);
+
+	return length >= extension && strcmp(&path[length - extension], LIBRARY_JSON_EXTENSION) == 0;
+}
+
+
+// Read the file of a template, custom gates in it are looked up in the library
+bool library_read(library_t *library, char *name, char *path, circuit_t *circ) {
+	FUNC_START();
+
+	assert_not_null(path);
+
+	bool success = library_is_json(path) ? read_json(path, circ, library) : read_template(path, circ, library);
+
+	if (success && circ->name != name) {
+		warn("%s: expected template %s, but found %s", path, name, circ->name);
+		success = false;
+	}
+
+	FUNC_END();
+	return success;
+}
+
+
+// Add an entry for a template that's about to be read, so a template containing itself is found
+library_entry_t *library_add_loading(library_t *library, char *name) {
+	FUNC_START();
+
+	assert_not_null(library);
+	assert_not_null(name);
+
+	library_entry_t *entry = malloc(sizeof(library_entry_t));
+	assert_not_null(entry);
+
+	entry->circ = malloc(sizeof(circuit_t));
+	entry->state = LibraryState_LOADING;
+	entry->owned = true;
+	entry->flat = NULL;
+
+	assert_not_null(entry->circ);
+	circuit_init(entry->circ);
+
+	assert(hex_hashmap_add_item(&library->entries, name, entry));
+
+	FUNC_END();
+	return entry;
+}
+
+
+void library_set_loaded(library_entry_t *entry, bool success) {
+	FUNC_START();
+
+	assert_not_null(entry);
+
+	if (success) {
+		entry->state = LibraryState_LOADED;
+	}
+	else {
+		// Remembered, so it isn't read again for every instance
+		circuit_free(entry->circ);
+		free(entry->circ);
+
+		entry->circ = NULL;
+		entry->state = LibraryState_FAILED;
+	}
+
+	FUNC_END();
+}
+
+
+// Make the flattened copy of a loaded template, once
+bool library_flatten_entry(library_entry_t *entry) {
+	FUNC_START();
+
+	assert_not_null(entry);
+	assert_not_null(entry->circ);
+
+	if (entry->flat != NULL) {
+		FUNC_END();
+		return true;
+	}
+
+	circuit_t *flat = circuit_copy(entry->circ);
+
+	if (! circuit_flatten(flat)) {
+		warn("Failed to flatten template %s", entry->circ->name);
+		circuit_free(flat);
+		free(flat);
+
+		FUNC_END();
+		return false;
+	}
+
+	entry->flat = flat;
+
+	FUNC_END();
+	return true;
+}
+
+
+bool library_add_path(library_t *library, char *path) {
+	FUNC_START();
+
+	assert_not_null(library);
+	assert_not_null(path);
+
+	bool success = vector_push(&library->paths, intern(path));
+
+	FUNC_END();
+	return success;
+}
+
+
+// Add a circuit that's already read, its name has to be unique
+bool library_add(library_t *library, circuit_t *circ, bool owned) {
+	FUNC_START();
+
+	assert_not_null(library);
+	assert_not_null(circ);
+	assert_not_null(circ->name);
+
+	if (hex_hashmap_contains_item(&library->entries, circ->name)) {
+		warn("Template %s is already in the library", circ->name);
+		FUNC_END();
+		return false;
+	}
+
+	library_entry_t *entry = malloc(sizeof(library_entry_t));
+	assert_not_null(entry);
+
+	entry->circ = circ;
+	entry->state = LibraryState_LOADED;
+	entry->owned = owned;
+	entry->flat = NULL;
+
+	bool success = hex_hashmap_add_item(&library->entries, circ->name, entry);
+
+	FUNC_END();
+	return success;
+}
+
+
+// Whether the template is known, without loading it
+bool library_contains(library_t *library, char *name) {
+	FUNC_START();
+
+	assert_not_null(library);
+	assert_not_null(name);
+
+	char *interned = intern_lookup(name);
+	bool contains = interned != NULL && hex_hashmap_contains_item(&library->entries, interned);
+
+	FUNC_END();
+	return contains;
+}
+
+
+// Get a template, reading it from the search paths the first time
+circuit_t *library_get(library_t *library, char *name) {
+	FUNC_START();
+
+	assert_not_null(library);
+	assert_not_null(name);
+
+	name = intern(name);
+
+
+	library_entry_t *entry = hex_hashmap_find_item(&library->entries, name);
+
+	if (entry != NULL) {
+		if (entry->state == LibraryState_LOADING) {
+			warn("Template %s contains itself", name);
+			FUNC_END();
+			return NULL;
+		}
+
+		FUNC_END();
+		return entry->circ;
+	}
+
+
+	entry = library_add_loading(library, name);
+	char *path = library_find_path(library, name);
+
+	if (path == NULL) {
+		warn("Failed to find template %s", name);
+	}
+
+	library_set_loaded(entry, path != NULL && library_read(library, name, path, entry->circ));
+
+
+	FUNC_END();
+	return entry->circ;
+}
+
+
+// Get a template with all custom gates inlined, which is only made once
+circuit_t *library_get_flat(library_t *library, char *name) {
+	FUNC_START();
+
+	circuit_t *circ = library_get(library, name);
+
+	if (circ == NULL) {
+		FUNC_END();
+		return NULL;
+	}
+
+	library_entry_t *entry = hex_hashmap_get_item(&library->entries, circ->name);
+
+	if (! library_flatten_entry(entry)) {
+		FUNC_END();
+		return NULL;
+	}
+
+	FUNC_END();
+	return entry->flat;
+}
+
+
+// Amount of templates, including the ones that failed to load
+size_t library_amount(library_t *library) {
+	assert_not_null(library);
+
+	return hex_hashmap_amount(&library->entries);
+}
+
+
+
+void library_print(library_t *library) {
+	assert_not_null(library);
+
+	static const char *states[] = { "loading", "loaded", "failed" };
+
+	printf("library: %lu templates\n", library_amount(library));
+
+	VEC_EACH(library->paths, char *path) {
+		printf("\tpath %s\n", path);
+	}
+
+	HEX_HASHMAP_EACH_KEY_VALUE(library->entries, char *name, library_entry_t *entry) {
+		size_t gates = (entry->circ != NULL) ? hex_hashmap_amount(&entry->circ->gates) : 0;
+
+		printf("\t%-16s %-8s %lu gates%s\n", name, states[entry->state], gates, (entry->flat != NULL) ? ", flattened" : "");
+	}
+}
+
+
+void library_init(library_t *library) {
+	assert_not_null(library);
+
+	vector_init(&library->paths, 0);
+	hex_hashmap_init(&library->entries);
+}
+
+
+void library_free(library_t *library) {
+	assert_not_null(library);
+
+	HEX_HASHMAP_EACH_VALUE(library->entries, library_entry_t *entry) {
+		if (entry->owned && entry->circ != NULL) {
+			circuit_free(entry->circ);
+			free(entry->circ);
+		}
+
+		if (entry->flat != NULL) {
+			circuit_free(entry->flat);
+			free(entry->flat);
+		}
+
+		free(entry);
+	}
+
+	hex_hashmap_free(&library->entries);
+	vector_free(&library->paths);
+}
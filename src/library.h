@@ -0,0 +1,62 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+
+#include "circuit.h"
+
+
+// Templates are searched as <path>/<name> first, then as <path>/<name>.json
+#define LIBRARY_JSON_EXTENSION ".json"
+
+
+typedef enum LibraryState {
+	LibraryState_LOADING,
+	LibraryState_LOADED,
+	LibraryState_FAILED
+} LibraryState_t;
+
+
+typedef struct library_entry {
+	circuit_t *circ;
+	LibraryState_t state;
+
+	// Whether the library frees the circuit
+	bool owned;
+
+	// Copy with all custom gates inlined, only made when asked for
+	circuit_t *flat;
+} library_entry_t;
+
+
+// All templates by name, loaded from the search paths when first used
+// NOTE: Threads may only get templates while nothing is added, see loader.c
+typedef struct library {
+	// Directories to search, in order
+	vector_t paths;
+
+	// library_entry_t by interned name
+	hex_hashmap_t entries;
+} library_t;
+
+
+char *library_find_path(library_t *library, char *name);
+bool library_is_json(char *path);
+bool library_read(library_t *library, char *name, char *path, circuit_t *circ);
+library_entry_t *library_add_loading(library_t *library, char *name);
+void library_set_loaded(library_entry_t *entry, bool success);
+bool library_flatten_entry(library_entry_t *entry);
+
+bool library_add_path(library_t *library, char *path);
+bool library_add(library_t *library, circuit_t *circ, bool owned);
+bool library_contains(library_t *library, char *name);
+circuit_t *library_get(library_t *library, char *name);
+circuit_t *library_get_flat(library_t *library, char *name);
+size_t library_amount(library_t *library);
+
+
+void library_print(library_t *library);
+void library_init(library_t *library);
+void library_free(library_t *library);
+
+
+#endif
@@ -0,0 +1,246 @@
+#include "loader.h"
+
+#include "assert.h"
+#include "benchmark.h"
+#include "intern.h"
+#include "read_template.h"
+
+
+// Find a template and everything it uses that still has to be read. Templates
+// that don't have to be read have no node, so found is set to NULL for them.
+static bool loader_discover(loader_t *loader, char *name, loader_node_t **found) {
+	FUNC_START();
+
+	library_t *library = loader->library;
+	*found = NULL;
+
+
+	loader_node_t *node = hex_hashmap_find_item(&loader->nodes, name);
+
+	if (node != NULL) {
+		if (node->discovering) {
+			warn("Template %s contains itself", name);
+			FUNC_END();
+			return false;
+		}
+
+		*found = node;
+		FUNC_END();
+		return true;
+	}
+
+	// Already read before
+	if (library_contains(library, name)) {
+		bool loaded = ((library_entry_t *) hex_hashmap_get_item(&library->entries, name))->state == LibraryState_LOADED;
+
+		FUNC_END();
+		return loaded;
+	}
+
+
+	char *path = library_find_path(library, name);
+
+	if (path == NULL) {
+		warn("Failed to find template %s", name);
+		FUNC_END();
+		return false;
+	}
+
+	// The dependencies of JSON templates are in the same file, so they're read right away
+	if (library_is_json(path)) {
+		bool loaded = library_get(library, name) != NULL;
+
+		FUNC_END();
+		return loaded;
+	}
+
+
+	node = malloc(sizeof(loader_node_t));
+	assert_not_null(node);
+
+	node->name = name;
+	node->path = path;
+	node->entry = NULL;
+	node->waiting = 0;
+	node->discovering = true;
+	node->loader = loader;
+
+	vector_init(&node->dependents, 0);
+
+	assert(hex_hashmap_add_item(&loader->nodes, name, node));
+
+
+	hex_hashmap_t types;
+	hex_hashmap_init(&types);
+
+	bool success = read_template_dependencies(path, &types);
+
+	HEX_HASHMAP_EACH_KEY(types, char *type) {
+		loader_node_t *dependency;
+
+		if (! success || ! loader_discover(loader, type, &dependency)) {
+			success = false;
+			continue;
+		}
+
+		if (dependency != NULL) {
+			assert(vector_push(&dependency->dependents, node));
+			node->waiting++;
+		}
+	}
+
+	hex_hashmap_free(&types);
+
+	node->discovering = false;
+	*found = node;
+
+
+	FUNC_END();
+	return success;
+}
+
+
+// NOTE: Runs on a thread of the pool
+static void loader_read(void *arg) {
+	FUNC_START();
+
+	loader_node_t *node = arg;
+	loader_t *loader = node->loader;
+
+	bool success = library_read(loader->library, node->name, node->path, node->entry->circ);
+	library_set_loaded(node->entry, success);
+
+
+	pthread_mutex_lock(&loader->lock);
+
+	loader->success &= success;
+
+	// Failed templates are still released, reading their dependents fails on its own
+	VEC_EACH(node->dependents, loader_node_t *dependent) {
+		if (--dependent->waiting == 0) {
+			thread_pool_push(&loader->pool, loader_read, dependent);
+		}
+	}
+
+	pthread_mutex_unlock(&loader->lock);
+
+	FUNC_END();
+}
+
+
+// NOTE: Runs on a thread of the pool
+static void loader_flatten_entry(void *arg) {
+	FUNC_START();
+
+	library_flatten_entry(arg);
+
+	FUNC_END();
+}
+
+
+// Read templates, and all templates they use, reading templates that don't depend
+// on each other at the same time. 0 threads uses all cores.
+bool loader_load(library_t *library, char **names, size_t amount, size_t threads) {
+	FUNC_START();
+
+	assert_not_null(library);
+	assert_not_null(names);
+
+	loader_t loader = {
+		.library = library,
+		.success = true
+	};
+
+	hex_hashmap_init(&loader.nodes);
+
+
+	// Build the graph of templates that have to be read first
+	for (size_t i = 0; i < amount; i++) {
+		loader_node_t *node;
+		loader.success &= loader_discover(&loader, intern(names[i]), &node);
+	}
+
+
+	if (loader.success && hex_hashmap_amount(&loader.nodes) > 0) {
+		// All entries exist before any thread starts, so the library isn't changed while it's read
+		HEX_HASHMAP_EACH_VALUE(loader.nodes, loader_node_t *node) {
+			node->entry = library_add_loading(library, node->name);
+		}
+
+		pthread_mutex_init(&loader.lock, NULL);
+		thread_pool_init(&loader.pool, threads);
+
+		// Start with the templates that only use primitive gates
+		pthread_mutex_lock(&loader.lock);
+
+		HEX_HASHMAP_EACH_VALUE(loader.nodes, loader_node_t *node) {
+			if (node->waiting == 0) {
+				thread_pool_push(&loader.pool, loader_read, node);
+			}
+		}
+
+		pthread_mutex_unlock(&loader.lock);
+
+		thread_pool_wait(&loader.pool);
+		thread_pool_free(&loader.pool);
+		pthread_mutex_destroy(&loader.lock);
+	}
+
+
+	HEX_HASHMAP_EACH_VALUE(loader.nodes, loader_node_t *node) {
+		vector_free(&node->dependents);
+		free(node);
+	}
+
+	hex_hashmap_free(&loader.nodes);
+
+
+	FUNC_END();
+	return loader.success;
+}
+
+
+// Read templates like loader_load, then make their flattened copies at the same time
+bool loader_flatten(library_t *library, char **names, size_t amount, size_t threads) {
+	FUNC_START();
+
+	if (! loader_load(library, names, amount, threads)) {
+		FUNC_END();
+		return false;
+	}
+
+
+	thread_pool_t pool;
+	thread_pool_init(&pool, threads);
+
+	// Every template is only flattened once, even if it's asked for twice
+	hex_hashmap_t entries;
+	hex_hashmap_init(&entries);
+
+	for (size_t i = 0; i < amount; i++) {
+		char *name = intern(names[i]);
+
+		if (! hex_hashmap_contains_item(&entries, name)) {
+			library_entry_t *entry = hex_hashmap_get_item(&library->entries, name);
+
+			assert(hex_hashmap_add_item(&entries, name, entry));
+			thread_pool_push(&pool, loader_flatten_entry, entry);
+		}
+	}
+
+	thread_pool_wait(&pool);
+	thread_pool_free(&pool);
+
+
+	bool success = true;
+
+	HEX_HASHMAP_EACH_VALUE(entries, library_entry_t *entry) {
+		success &= entry->flat != NULL;
+	}
+
+	hex_hashmap_free(&entries);
+
+
+	FUNC_END();
+	return success;
+}
@@ -0,0 +1,47 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+
+#include <pthread.h>
+
+#include "library.h"
+#include "thread_pool.h"
+
+
+// A template that has to be read, and the templates waiting for it
+typedef struct loader_node {
+	char *name;
+	char *path;
+	library_entry_t *entry;
+
+	// Nodes using this template, which can be read once all their dependencies are
+	vector_t dependents;
+	size_t waiting;
+
+	// Whether its dependencies are still being found, to find templates containing themselves
+	bool discovering;
+
+	struct loader *loader;
+} loader_node_t;
+
+
+// Reads the templates of a library on a thread pool, every template as soon as
+// all templates it uses are read
+typedef struct loader {
+	library_t *library;
+	thread_pool_t pool;
+
+	// loader_node_t by interned name
+	hex_hashmap_t nodes;
+
+	// Protects the waiting counters and success
+	pthread_mutex_t lock;
+	bool success;
+} loader_t;
+
+
+bool loader_load(library_t *library, char **names, size_t amount, size_t threads);
+bool loader_flatten(library_t *library, char **names, size_t amount, size_t threads);
+
+
+#endif
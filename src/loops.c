@@ -0,0 +1,419 @@
+#include "loops.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "intern.h"
+#include "netlist.h"
+
+
+// Parent of the gates of the top circuit, and gates not in a component yet
+#define LOOPS_NONE UINT32_MAX
+
+// Names of a loop in the warning of loops_check, the rest are left out
+#define LOOPS_REPORT_GATES 8
+
+
+static const char *loop_kind_names[] = {
+	[LoopKind_LATCHING] = "latching",
+	[LoopKind_OSCILLATING] = "oscillating"
+};
+
+
+const char *loop_kind_name(LoopKind_t kind) {
+	return loop_kind_names[kind];
+}
+
+
+static size_t loops_count_gates(circuit_t *circ) {
+	size_t amount = 0;
+
+	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
+		amount++;
+
+		if (gate->inner_circuit != NULL) {
+			amount += loops_count_gates(gate->inner_circuit);
+		}
+	}
+
+	return amount;
+}
+
+
+// Put all gates in the array, with the index of the custom gate they're in
+static size_t loops_collect_gates(circuit_t *circ, uint32_t parent, gate_t **gates, uint32_t *parents, size_t amount) {
+	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
+		uint32_t self = (uint32_t) amount;
+
+		gates[amount] = gate;
+		parents[amount] = parent;
+		amount++;
+
+		if (gate->inner_circuit != NULL) {
+			amount = loops_collect_gates(gate->inner_circuit, self, gates, parents, amount);
+		}
+	}
+
+	return amount;
+}
+
+
+// Only built for the gates that are reported
+static char *loops_gate_name(gate_t **gates, uint32_t *parents, uint32_t gate) {
+	if (parents[gate] == LOOPS_NONE) {
+		return gates[gate]->name;
+	}
+
+	char *prefix = loops_gate_name(gates, parents, parents[gate]);
+	char buf[strlen(prefix) + 1 + strlen(gates[gate]->name) + 1];
+	sprintf(buf, "%s%c%s", prefix, CIRCUIT_PATH_SEPARATOR, gates[gate]->name);
+
+	return intern(buf);
+}
+
+
+static bool loops_is_primitive(gate_t *gate) {
+	return gate->kind == GateKind_AND || gate->kind == GateKind_OR || gate->kind == GateKind_XOR || gate->kind == GateKind_NOT;
+}
+
+
+static void loops_add(loops_t *loops, LoopKind_t kind, char **gates, size_t amount_gates) {
+	if (loops->amount_loops == loops->size_loops) {
+		loops->size_loops = (loops->size_loops == 0) ? 4 : 2 * loops->size_loops;
+		loops->loops = realloc(loops->loops, loops->size_loops * sizeof(loop_t));
+		assert_not_null(loops->loops);
+	}
+
+	loops->loops[loops->amount_loops++] = (loop_t) {
+		.kind = kind,
+		.gates = gates,
+		.amount_gates = amount_gates
+	};
+}
+
+
+// Find every combinational loop with Tarjan's algorithm on the primitive gates, where
+// a gate leads to the gates reading its output. Returns false if any loop oscillates.
+// NOTE: Uses the net of every port, like netlist_compile
+bool loops_find(loops_t *loops, circuit_t *circ) {
+	FUNC_START();
+
+	assert_not_null(loops);
+	assert_not_null(circ);
+
+	size_t amount_gates = loops_count_gates(circ);
+	gate_t **gates = malloc((amount_gates + 1) * sizeof(gate_t *));
+	uint32_t *parents = malloc((amount_gates + 1) * sizeof(uint32_t));
+	loops_collect_gates(circ, LOOPS_NONE, gates, parents, 0);
+
+	size_t amount_ports = 0;
+
+	for (size_t i = 0; i < amount_gates; i++) {
+		VEC_EACH(gates[i]->ports, port_t *port) {
+			port->net = NETLIST_NO_NET;
+			amount_ports++;
+		}
+	}
+
+
+	// Connected ports are one net, through the nodes of custom gates as well
+	port_t **stack = malloc((amount_ports + 1) * sizeof(port_t *));
+	uint32_t amount_nets = 0;
+
+	for (size_t i = 0; i < amount_gates; i++) {
+		VEC_EACH(gates[i]->ports, port_t *port) {
+			if (port->net != NETLIST_NO_NET) {
+				continue;
+			}
+
+			size_t amount_stack = 0;
+			port->net = amount_nets++;
+			stack[amount_stack++] = port;
+
+			while (amount_stack > 0) {
+				port_t *current = stack[--amount_stack];
+
+				VEC_EACH(current->connections, port_t *connection) {
+					if (connection->net == NETLIST_NO_NET) {
+						connection->net = port->net;
+						stack[amount_stack++] = connection;
+					}
+				}
+			}
+		}
+	}
+
+	free(stack);
+
+
+	// The primitive gates reading net i are sinks[sink_start[i]] up to sinks[sink_start[i + 1]]
+	uint32_t *outputs = malloc((amount_gates + 1) * sizeof(uint32_t));
+	uint32_t *sink_start = calloc(amount_nets + 2, sizeof(uint32_t));
+	size_t amount_sinks = 0;
+
+	for (size_t i = 0; i < amount_gates; i++) {
+		outputs[i] = NETLIST_NO_NET;
+
+		if (! loops_is_primitive(gates[i])) {
+			continue;
+		}
+
+		VEC_EACH(gates[i]->ports, port_t *port) {
+			if (port->type == PortType_OUTPUT) {
+				outputs[i] = port->net;
+			}
+			else if (port->type == PortType_INPUT) {
+				sink_start[port->net + 2]++;
+				amount_sinks++;
+			}
+		}
+	}
+
+	for (size_t i = 2; i < amount_nets + 2; i++) {
+		sink_start[i] += sink_start[i - 1];
+	}
+
+	uint32_t *sinks = malloc((amount_sinks + 1) * sizeof(uint32_t));
+
+	for (size_t i = 0; i < amount_gates; i++) {
+		if (! loops_is_primitive(gates[i])) {
+			continue;
+		}
+
+		VEC_EACH(gates[i]->ports, port_t *port) {
+			if (port->type == PortType_INPUT) {
+				sinks[sink_start[port->net + 1]++] = (uint32_t) i;
+			}
+		}
+	}
+
+
+	// Iterative, so deep designs don't overflow the stack
+	uint32_t *index = malloc((amount_gates + 1) * sizeof(uint32_t));
+	uint32_t *low = malloc((amount_gates + 1) * sizeof(uint32_t));
+	uint32_t *next = malloc((amount_gates + 1) * sizeof(uint32_t));
+	uint32_t *component = malloc((amount_gates + 1) * sizeof(uint32_t));
+	uint32_t *members = malloc((amount_gates + 1) * sizeof(uint32_t));
+	uint32_t *calls = malloc((amount_gates + 1) * sizeof(uint32_t));
+	uint32_t *queue = malloc((amount_gates + 1) * sizeof(uint32_t));
+	int8_t *parity = malloc((amount_gates + 1) * sizeof(int8_t));
+
+	for (size_t i = 0; i < amount_gates; i++) {
+		index[i] = LOOPS_NONE;
+		component[i] = LOOPS_NONE;
+		parity[i] = -1;
+	}
+
+	uint32_t amount_index = 0;
+	uint32_t amount_components = 0;
+	size_t amount_members = 0;
+	bool success = true;
+
+	for (uint32_t root = 0; root < amount_gates; root++) {
+		if (outputs[root] == NETLIST_NO_NET || index[root] != LOOPS_NONE) {
+			continue;
+		}
+
+		size_t amount_calls = 0;
+		calls[amount_calls++] = root;
+		index[root] = low[root] = amount_index++;
+		next[root] = sink_start[outputs[root]];
+		members[amount_members++] = root;
+
+		while (amount_calls > 0) {
+			uint32_t gate = calls[amount_calls - 1];
+
+			if (next[gate] < sink_start[outputs[gate] + 1]) {
+				uint32_t sink = sinks[next[gate]++];
+
+				if (index[sink] == LOOPS_NONE) {
+					calls[amount_calls++] = sink;
+					index[sink] = low[sink] = amount_index++;
+					next[sink] = sink_start[outputs[sink]];
+					members[amount_members++] = sink;
+				}
+				else if (component[sink] == LOOPS_NONE && index[sink] < low[gate]) {
+					// Still on the stack of members
+					low[gate] = index[sink];
+				}
+
+				continue;
+			}
+
+			amount_calls--;
+
+			if (amount_calls > 0 && low[gate] < low[calls[amount_calls - 1]]) {
+				low[calls[amount_calls - 1]] = low[gate];
+			}
+
+			if (low[gate] != index[gate]) {
+				continue;
+			}
+
+
+			// The gate is the root of a component, its members are on top of it
+			size_t first = amount_members;
+
+			do {
+				first--;
+				component[members[first]] = amount_components;
+			} while (members[first] != gate);
+
+			size_t amount = amount_members - first;
+			bool feedback = amount > 1;
+
+			for (uint32_t i = sink_start[outputs[gate]]; ! feedback && i < sink_start[outputs[gate] + 1]; i++) {
+				feedback = sinks[i] == gate;
+			}
+
+			if (feedback) {
+				LoopKind_t kind = LoopKind_LATCHING;
+
+				for (size_t i = first; i < amount_members; i++) {
+					if (gates[members[i]]->kind == GateKind_XOR) {
+						kind = LoopKind_OSCILLATING;
+					}
+				}
+
+				// Every path between two gates of a latching loop has the same amount of
+				// inversions, so they can be given a parity without contradicting
+				size_t head = 0, tail = 0;
+				parity[gate] = 0;
+				queue[tail++] = gate;
+
+				while (kind == LoopKind_LATCHING && head < tail) {
+					uint32_t current = queue[head++];
+
+					for (uint32_t i = sink_start[outputs[current]]; i < sink_start[outputs[current] + 1]; i++) {
+						uint32_t sink = sinks[i];
+
+						if (component[sink] != amount_components) {
+							continue;
+						}
+
+						int8_t expected = parity[current] ^ (gates[sink]->kind == GateKind_NOT);
+
+						if (parity[sink] < 0) {
+							parity[sink] = expected;
+							queue[tail++] = sink;
+						}
+						else if (parity[sink] != expected) {
+							kind = LoopKind_OSCILLATING;
+							break;
+						}
+					}
+				}
+
+				char **names = malloc(amount * sizeof(char *));
+
+				for (size_t i = 0; i < amount; i++) {
+					names[i] = loops_gate_name(gates, parents, members[first + i]);
+				}
+
+				loops_add(loops, kind, names, amount);
+				success &= kind != LoopKind_OSCILLATING;
+			}
+
+			amount_members = first;
+			amount_components++;
+		}
+	}
+
+	free(index);
+	free(low);
+	free(next);
+	free(component);
+	free(members);
+	free(calls);
+	free(queue);
+	free(parity);
+
+	free(sinks);
+	free(sink_start);
+	free(outputs);
+	free(parents);
+	free(gates);
+
+	FUNC_END();
+	return success;
+}
+
+
+// Warn about every oscillating loop, which would never settle
+bool loops_check(circuit_t *circ) {
+	FUNC_START();
+
+	loops_t loops;
+	loops_init(&loops);
+
+	bool success = loops_find(&loops, circ);
+
+	for (size_t i = 0; i < loops.amount_loops; i++) {
+		loop_t *loop = &loops.loops[i];
+
+		if (loop->kind != LoopKind_OSCILLATING) {
+			continue;
+		}
+
+		char names[LOOPS_REPORT_GATES * BUF_SIZE] = "";
+
+		for (size_t j = 0; j < loop->amount_gates && j < LOOPS_REPORT_GATES; j++) {
+			strncat(names, " ", sizeof(names) - strlen(names) - 1);
+			strncat(names, loop->gates[j], sizeof(names) - strlen(names) - 1);
+		}
+
+		warn("%s: oscillating loop through %lu gates:%s%s", circ->name, loop->amount_gates, names,
+			(loop->amount_gates > LOOPS_REPORT_GATES) ? " ..." : "");
+	}
+
+	loops_free(&loops);
+
+	FUNC_END();
+	return success;
+}
+
+
+void loops_print(loops_t *loops) {
+	FUNC_START();
+
+	for (size_t i = 0; i < loops->amount_loops; i++) {
+		loop_t *loop = &loops->loops[i];
+
+		printf("%s loop through %lu gates:", loop_kind_name(loop->kind), loop->amount_gates);
+
+		for (size_t j = 0; j < loop->amount_gates; j++) {
+			printf(" %s", loop->gates[j]);
+		}
+
+		printf("\n");
+	}
+
+	FUNC_END();
+}
+
+
+void loops_init(loops_t *loops) {
+	FUNC_START();
+
+	loops->loops = NULL;
+	loops->amount_loops = 0;
+	loops->size_loops = 0;
+
+	FUNC_END();
+}
+
+
+void loops_free(loops_t *loops) {
+	FUNC_START();
+
+	for (size_t i = 0; i < loops->amount_loops; i++) {
+		free(loops->loops[i].gates);
+	}
+
+	free(loops->loops);
+
+	FUNC_END();
+}
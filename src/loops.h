@@ -0,0 +1,45 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+
+#include "circuit.h"
+
+
+typedef enum LoopKind {
+	// An even amount of inversions, it settles on whatever it holds
+	LoopKind_LATCHING,
+
+	// An odd amount of inversions, or an XOR that may add one, so it can toggle forever
+	LoopKind_OSCILLATING
+} LoopKind_t;
+
+
+// Primitive gates that feed back into each other, one strongly connected component
+typedef struct loop {
+	LoopKind_t kind;
+
+	// Hierarchical names of the gates
+	char **gates;
+	size_t amount_gates;
+} loop_t;
+
+
+typedef struct loops {
+	loop_t *loops;
+	size_t amount_loops;
+	size_t size_loops;
+} loops_t;
+
+
+bool loops_find(loops_t *loops, circuit_t *circ);
+bool loops_check(circuit_t *circ);
+
+const char *loop_kind_name(LoopKind_t kind);
+
+
+void loops_print(loops_t *loops);
+void loops_init(loops_t *loops);
+void loops_free(loops_t *loops);
+
+
+#endif
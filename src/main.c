@@ -1,6 +1,9 @@
 #include "test.h"
 
+#include <string.h>
+
 #include "benchmark.h"
+#include "runner.h"
 #ifdef BENCH
 	#include <stdlib.h>
 #endif
@@ -15,15 +18,22 @@ int main(int argc, char *argv[]) {
 	FUNC_START();
 
 	#ifdef TEST
+		// Stream vectors through a template instead of running tests
+		if (argc > 1 && strcmp(argv[1], "run") == 0) {
+			int status = runner_main(argc - 1, argv + 1);
+
+			FUNC_END();
+			return status;
+		}
+
 		int failed_tests = (int) test_all(argc, argv);
 
 		FUNC_END();
 		return failed_tests;
 	#else
-
-		// Actual code here
+		int status = runner_main(argc, argv);
 
 		FUNC_END();
-		return EXIT_SUCCESS;
+		return status;
 	#endif
 }
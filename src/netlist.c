@@ -0,0 +1,603 @@
+#include "netlist.h"
+
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "intern.h"
+
+
+// Driver of nets that are set from the outside
+#define NETLIST_INPUT (NETLIST_NO_NET - 1)
+
+
+// Count all gates, including the gates of inner circuits
+static size_t netlist_count_gates(circuit_t *circ) {
+	FUNC_START();
+
+	size_t amount = 0;
+
+	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
+		amount++;
+
+		if (gate->inner_circuit != NULL) {
+			amount += netlist_count_gates(gate->inner_circuit);
+		}
+	}
+
+	FUNC_END();
+	return amount;
+}
+
+
+// Put all gates, including the gates of inner circuits, in the given array.
+// Their hierarchical names are put in the names array.
+static size_t netlist_collect_gates(circuit_t *circ, char *prefix, gate_t **gates, char **names, size_t amount) {
+	FUNC_START();
+
+	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
+		char *name = gate->name;
+
+		if (prefix != NULL) {
+			char buf[strlen(prefix) + 1 + strlen(gate->name) + 1];
+			sprintf(buf, "%s%c%s", prefix, CIRCUIT_PATH_SEPARATOR, gate->name);
+
+			name = intern(buf);
+		}
+
+		gates[amount] = gate;
+		names[amount] = name;
+		amount++;
+
+		if (gate->inner_circuit != NULL) {
+			amount = netlist_collect_gates(gate->inner_circuit, name, gates, names, amount);
+		}
+	}
+
+	FUNC_END();
+	return amount;
+}
+
+
+// Get the op for a primitive gate, returns false if it isn't one
+static bool netlist_get_op(GateKind_t kind, NetlistOp_t *op) {
+	switch (kind) {
+		case GateKind_AND: *op = NetlistOp_AND; return true;
+		case GateKind_OR:  *op = NetlistOp_OR;  return true;
+		case GateKind_XOR: *op = NetlistOp_XOR; return true;
+		case GateKind_NOT: *op = NetlistOp_NOT; return true;
+
+		case GateKind_UNKNOWN:
+		case GateKind_IN:
+		case GateKind_OUT:
+		case GateKind_CUSTOM:
+			break;
+	}
+
+	return false;
+}
+
+
+static uint8_t netlist_op_table(NetlistOp_t op) {
+	switch (op) {
+		// in0 in1: 11 10 01 00
+		case NetlistOp_AND: return 0x8; // 1  0  0  0
+		case NetlistOp_OR:  return 0xe; // 1  1  1  0
+		case NetlistOp_XOR: return 0x6; // 0  1  1  0
+
+		// NOT reads in0 twice, so only 11 and 00 are used
+		case NetlistOp_NOT: return 0x1; // 0  -  -  1
+	}
+
+	return 0;
+}
+
+
+static int netlist_io_compare(const void *a, const void *b) {
+	const netlist_io_t *io_a = a;
+	const netlist_io_t *io_b = b;
+
+	return strcmp(io_a->name, io_b->name);
+}
+
+
+static void netlist_add_io(netlist_io_t *list, size_t *amount, port_t *port) {
+	FUNC_START();
+
+	netlist_io_t *io = &list[(*amount)++];
+
+	io->name = port->name;
+
+	io->net = port->net;
+
+	FUNC_END();
+}
+
+
+// Find the ops reading each net
+static void netlist_build_fanout(netlist_t *netlist) {
+	FUNC_START();
+
+	netlist->fanout_start = calloc(netlist->amount_nets + 2, sizeof(uint32_t));
+	netlist->fanout = malloc((2 * netlist->amount_ops + 1) * sizeof(uint32_t));
+
+	// Count the sinks of every net, a NOT only reads its net once
+	for (size_t i = 0; i < netlist->amount_ops; i++) {
+		netlist_op_t *op = &netlist->ops[i];
+
+		netlist->fanout_start[op->in0 + 2]++;
+
+		if (op->in1 != op->in0) {
+			netlist->fanout_start[op->in1 + 2]++;
+		}
+	}
+
+	for (size_t i = 2; i < netlist->amount_nets + 2; i++) {
+		netlist->fanout_start[i] += netlist->fanout_start[i - 1];
+	}
+
+	for (uint32_t i = 0; i < netlist->amount_ops; i++) {
+		netlist_op_t *op = &netlist->ops[i];
+
+		netlist->fanout[netlist->fanout_start[op->in0 + 1]++] = i;
+
+		if (op->in1 != op->in0) {
+			netlist->fanout[netlist->fanout_start[op->in1 + 1]++] = i;
+		}
+	}
+
+	FUNC_END();
+}
+
+
+bool netlist_compile(netlist_t *netlist, circuit_t *circ) {
+	FUNC_START();
+
+	assert_not_null(netlist);
+	assert_not_null(circ);
+	assert(netlist->ops == NULL);
+
+
+	// Flatten the hierarchy into one array of gates
+	size_t amount_gates = netlist_count_gates(circ);
+	gate_t **gates = malloc((amount_gates + 1) * sizeof(gate_t *));
+	char **names = malloc((amount_gates + 1) * sizeof(char *));
+	netlist_collect_gates(circ, NULL, gates, names, 0);
+
+	size_t amount_ports = 0;
+
+	for (size_t i = 0; i < amount_gates; i++) {
+		VEC_EACH(gates[i]->ports, port_t *port) {
+			port->net = NETLIST_NO_NET;
+			amount_ports++;
+		}
+	}
+
+
+	// Every group of connected ports is a net. Nodes of custom gates simply join
+	// the outer and inner ports into the same net.
+	port_t **stack = malloc((amount_ports + 1) * sizeof(port_t *));
+	bool *state = malloc((amount_ports + 1) * sizeof(bool));
+	uint32_t amount_nets = 0;
+
+	for (size_t i = 0; i < amount_gates; i++) {
+		VEC_EACH(gates[i]->ports, port_t *port) {
+			if (port->net != NETLIST_NO_NET) {
+				continue;
+			}
+
+			uint32_t net = amount_nets++;
+			state[net] = port->state;
+
+			size_t amount_stack = 0;
+			port->net = net;
+			stack[amount_stack++] = port;
+
+			while (amount_stack > 0) {
+				port_t *current = stack[--amount_stack];
+
+				VEC_EACH(current->connections, port_t *connection) {
+					if (connection->net == NETLIST_NO_NET) {
+						connection->net = net;
+						stack[amount_stack++] = connection;
+					}
+				}
+			}
+		}
+	}
+
+	free(stack);
+
+	state = realloc(state, (amount_nets + 1) * sizeof(bool));
+
+
+	// Create an op for every primitive gate, and find the IO
+	netlist->name = circ->name;
+
+	netlist_op_t *ops = malloc((amount_gates + 1) * sizeof(netlist_op_t));
+	char **op_names = malloc((amount_gates + 1) * sizeof(char *));
+	size_t amount_ops = 0;
+
+	netlist->inputs = malloc((amount_gates + 1) * sizeof(netlist_io_t));
+	netlist->outputs = malloc((amount_gates + 1) * sizeof(netlist_io_t));
+
+	// Which op drives a net
+	uint32_t *driver = malloc((amount_nets + 1) * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < amount_nets; i++) {
+		driver[i] = NETLIST_NO_NET;
+	}
+
+	bool success = true;
+
+	for (size_t i = 0; i < amount_gates; i++) {
+		gate_t *gate = gates[i];
+
+		port_t *output;
+		uint32_t self;
+
+		NetlistOp_t op;
+
+		if (netlist_get_op(gate->kind, &op)) {
+			port_t *i0 = gate->ports.items[0];
+			port_t *i1 = gate->ports.items[(op == NetlistOp_NOT) ? 0 : 1];
+			output = gate->ports.items[(op == NetlistOp_NOT) ? 1 : 2];
+
+			netlist_op_t *new_op = &ops[amount_ops];
+
+			new_op->op = op;
+			new_op->table = netlist_op_table(op);
+			new_op->in0 = i0->net;
+			new_op->in1 = i1->net;
+			new_op->out = output->net;
+
+			// Keep the name for debugging
+			op_names[amount_ops] = names[i];
+
+			self = (uint32_t) amount_ops++;
+		}
+
+		else if (gate->kind == GateKind_IN) {
+			output = gate->ports.items[0];
+			self = NETLIST_INPUT;
+
+			netlist_add_io(netlist->inputs, &netlist->amount_inputs, output);
+		}
+
+		else if (gate->kind == GateKind_OUT) {
+			netlist_add_io(netlist->outputs, &netlist->amount_outputs, gate->ports.items[0]);
+			continue;
+		}
+
+		else if (gate->kind == GateKind_CUSTOM) {
+			// Custom gates only consist of nodes, which are already part of the nets
+			continue;
+		}
+
+		else {
+			warn("Can't compile gate %s of unknown type %s", gate->name, gate->type);
+			success = false;
+			continue;
+		}
+
+
+		// Make sure a net isn't driven by two outputs
+		if (driver[output->net] != NETLIST_NO_NET) {
+			warn("Net of %s:%s has more than one driver", gate->name, output->name);
+			success = false;
+			continue;
+		}
+
+		driver[output->net] = self;
+	}
+
+	free(gates);
+	free(names);
+
+	netlist->ops = ops;
+	netlist->op_names = op_names;
+	netlist->amount_ops = amount_ops;
+	netlist->state = state;
+	netlist->amount_nets = amount_nets;
+
+	qsort(netlist->inputs, netlist->amount_inputs, sizeof(netlist_io_t), netlist_io_compare);
+	qsort(netlist->outputs, netlist->amount_outputs, sizeof(netlist_io_t), netlist_io_compare);
+
+
+	// Levelize using Kahn's algorithm, starting with the ops that only depend on inputs
+	netlist_build_fanout(netlist);
+
+	uint32_t *fanout_start = netlist->fanout_start;
+	uint32_t *fanout = netlist->fanout;
+	uint32_t *pending = calloc(amount_ops + 1, sizeof(uint32_t));
+	uint32_t *level = calloc(amount_ops + 1, sizeof(uint32_t));
+	uint32_t *ready = malloc((amount_ops + 1) * sizeof(uint32_t));
+
+	for (size_t i = 0; i < amount_ops; i++) {
+		pending[i] += driver[ops[i].in0] < amount_ops;
+
+		if (ops[i].in1 != ops[i].in0) {
+			pending[i] += driver[ops[i].in1] < amount_ops;
+		}
+	}
+
+
+	size_t amount_ready = 0;
+	size_t amount_done = 0;
+	uint32_t amount_levels = 0;
+
+	for (uint32_t i = 0; i < amount_ops; i++) {
+		if (pending[i] == 0) {
+			ready[amount_ready++] = i;
+		}
+	}
+
+	while (amount_done < amount_ready) {
+		uint32_t current = ready[amount_done++];
+		uint32_t net = ops[current].out;
+
+		if (level[current] + 1 > amount_levels) {
+			amount_levels = level[current] + 1;
+		}
+
+		// Only the first driver counts, the other ones are already reported
+		if (driver[net] != current) {
+			continue;
+		}
+
+		for (size_t j = fanout_start[net]; j < fanout_start[net + 1]; j++) {
+			uint32_t sink = fanout[j];
+
+			if (level[sink] < level[current] + 1) {
+				level[sink] = level[current] + 1;
+			}
+
+			if (--pending[sink] == 0) {
+				ready[amount_ready++] = sink;
+			}
+		}
+	}
+
+	if (amount_done < amount_ops) {
+		warn("Can't levelize %s: %lu gates are part of a combinational loop", circ->name, amount_ops - amount_done);
+		success = false;
+	}
+
+
+	// Sort the ops by level
+	if (success) {
+		netlist->amount_levels = amount_levels;
+		netlist->level_start = calloc(amount_levels + 2, sizeof(size_t));
+
+		for (size_t i = 0; i < amount_ops; i++) {
+			netlist->level_start[level[i] + 2]++;
+		}
+
+		for (size_t i = 2; i < amount_levels + 2; i++) {
+			netlist->level_start[i] += netlist->level_start[i - 1];
+		}
+
+		netlist_op_t *sorted = malloc((amount_ops + 1) * sizeof(netlist_op_t));
+		char **sorted_names = malloc((amount_ops + 1) * sizeof(char *));
+
+		// Where every op ends up, ready isn't needed anymore
+		uint32_t *position = ready;
+
+		for (size_t i = 0; i < amount_ops; i++) {
+			size_t index = netlist->level_start[level[i] + 1]++;
+
+			sorted[index] = ops[i];
+			sorted_names[index] = op_names[i];
+			position[i] = (uint32_t) index;
+		}
+
+		free(netlist->ops);
+		free(netlist->op_names);
+		netlist->ops = sorted;
+		netlist->op_names = sorted_names;
+
+		for (size_t i = 0; i < fanout_start[amount_nets]; i++) {
+			fanout[i] = position[fanout[i]];
+		}
+	}
+
+	free(pending);
+	free(level);
+	free(ready);
+	free(driver);
+
+
+	if (! success) {
+		netlist_free(netlist);
+		netlist_init(netlist);
+
+		FUNC_END();
+		return false;
+	}
+
+
+	// Make sure all nets are in the right state
+	netlist_evaluate(netlist);
+
+
+	FUNC_END();
+	return true;
+}
+
+
+// NOTE: No benchmarking in the evaluation functions, they are the innermost loop
+
+
+void netlist_evaluate(netlist_t *netlist) {
+	bool *state = netlist->state;
+	netlist_op_t *op = netlist->ops;
+	netlist_op_t *end = op + netlist->amount_ops;
+
+	// Since the ops are sorted by level, all inputs are known before they are read
+	for (; op < end; op++) {
+		unsigned int index = (unsigned int) state[op->in0] << 1 | (unsigned int) state[op->in1];
+
+		state[op->out] = (op->table >> index) & 1;
+	}
+}
+
+
+void netlist_apply(netlist_t *netlist, const bool *inputs, bool *outputs) {
+	assert_not_null(netlist);
+
+	for (size_t i = 0; i < netlist->amount_inputs; i++) {
+		netlist->state[netlist->inputs[i].net] = inputs[i];
+	}
+
+	netlist_evaluate(netlist);
+
+	for (size_t i = 0; i < netlist->amount_outputs; i++) {
+		outputs[i] = netlist->state[netlist->outputs[i].net];
+	}
+}
+
+
+static netlist_io_t *netlist_find_io(netlist_io_t *list, size_t amount, char *name) {
+	FUNC_START();
+
+	netlist_io_t key = { .name = name, .net = 0 };
+	netlist_io_t *io = bsearch(&key, list, amount, sizeof(netlist_io_t), netlist_io_compare);
+
+	FUNC_END();
+	return io;
+}
+
+
+netlist_io_t *netlist_get_input_by_name(netlist_t *netlist, char *name) {
+	FUNC_START();
+
+	assert_not_null(netlist);
+	assert_not_null(name);
+
+	netlist_io_t *io = netlist_find_io(netlist->inputs, netlist->amount_inputs, name);
+
+	if (io == NULL) {
+		warn("Failed to find input %s in netlist %s", name, netlist->name);
+	}
+
+	FUNC_END();
+	return io;
+}
+
+
+netlist_io_t *netlist_get_output_by_name(netlist_t *netlist, char *name) {
+	FUNC_START();
+
+	assert_not_null(netlist);
+	assert_not_null(name);
+
+	netlist_io_t *io = netlist_find_io(netlist->outputs, netlist->amount_outputs, name);
+
+	if (io == NULL) {
+		warn("Failed to find output %s in netlist %s", name, netlist->name);
+	}
+
+	FUNC_END();
+	return io;
+}
+
+
+// Find an op by the hierarchical name of its gate, for debugging
+netlist_op_t *netlist_get_op_by_name(netlist_t *netlist, char *name) {
+	FUNC_START();
+
+	assert_not_null(netlist);
+	assert_not_null(name);
+
+	char *interned = intern_lookup(name);
+
+	for (size_t i = 0; interned != NULL && i < netlist->amount_ops; i++) {
+		if (netlist->op_names[i] == interned) {
+			FUNC_END();
+			return &netlist->ops[i];
+		}
+	}
+
+	warn("Failed to find op %s in netlist %s", name, netlist->name);
+
+	FUNC_END();
+	return NULL;
+}
+
+
+void netlist_print(netlist_t *netlist) {
+	assert_not_null(netlist);
+
+	static const char *op_types[] = { "AND", "OR", "XOR", "NOT" };
+
+	printf("netlist %s: %lu nets, %lu ops, %lu levels\n",
+		netlist->name, netlist->amount_nets, netlist->amount_ops, netlist->amount_levels);
+
+	for (size_t i = 0; i < netlist->amount_inputs; i++) {
+		printf("\tIN  %s = %u\n", netlist->inputs[i].name, netlist->inputs[i].net);
+	}
+
+	for (size_t i = 0; i < netlist->amount_levels; i++) {
+		for (size_t j = netlist->level_start[i]; j < netlist->level_start[i + 1]; j++) {
+			netlist_op_t *op = &netlist->ops[j];
+
+			printf("\t[%lu] %u = %s %u %u\t%s\n", i, op->out, op_types[op->op], op->in0, op->in1, netlist->op_names[j]);
+		}
+	}
+
+	for (size_t i = 0; i < netlist->amount_outputs; i++) {
+		printf("\tOUT %s = %u\n", netlist->outputs[i].name, netlist->outputs[i].net);
+	}
+}
+
+
+void netlist_init(netlist_t *netlist) {
+	assert_not_null(netlist);
+
+	netlist->name = NULL;
+
+	netlist->ops = NULL;
+	netlist->op_names = NULL;
+	netlist->amount_ops = 0;
+
+	netlist->fanout_start = NULL;
+	netlist->fanout = NULL;
+
+	netlist->level_start = NULL;
+	netlist->amount_levels = 0;
+
+	netlist->inputs = NULL;
+	netlist->amount_inputs = 0;
+	netlist->outputs = NULL;
+	netlist->amount_outputs = 0;
+
+	netlist->state = NULL;
+	netlist->amount_nets = 0;
+
+	netlist->mapping = NULL;
+	netlist->mapping_size = 0;
+}
+
+
+void netlist_free(netlist_t *netlist) {
+	assert_not_null(netlist);
+
+	// All names are interned
+	if (netlist->inputs) free(netlist->inputs);
+	if (netlist->outputs) free(netlist->outputs);
+
+	if (netlist->op_names) free(netlist->op_names);
+
+	// The other arrays are part of the mapped file
+	if (netlist->mapping != NULL) {
+		munmap(netlist->mapping, netlist->mapping_size);
+		return;
+	}
+
+	if (netlist->ops) free(netlist->ops);
+	if (netlist->fanout_start) free(netlist->fanout_start);
+	if (netlist->fanout) free(netlist->fanout);
+	if (netlist->level_start) free(netlist->level_start);
+	if (netlist->state) free(netlist->state);
+}
@@ -0,0 +1,90 @@
+#ifndef NETLIST_H
+#define NETLIST_H
+
+
+#include <stdint.h>
+
+#include "circuit.h"
+
+
+// Net index of a port that hasn't been assigned to a net yet
+#define NETLIST_NO_NET UINT32_MAX
+
+
+typedef enum NetlistOp {
+	NetlistOp_AND,
+	NetlistOp_OR,
+	NetlistOp_XOR,
+	NetlistOp_NOT
+} NetlistOp_t;
+
+#define NETLIST_OP_AMOUNT 4
+
+
+// A single primitive gate, reading and writing nets by index
+typedef struct netlist_op {
+	NetlistOp_t op;
+
+	// Truth table of the op, indexed by (in0 << 1 | in1)
+	uint8_t table;
+
+	uint32_t in0;
+	uint32_t in1;
+	uint32_t out;
+} netlist_op_t;
+
+
+// A named input or output of the netlist
+typedef struct netlist_io {
+	char *name;
+	uint32_t net;
+} netlist_io_t;
+
+
+typedef struct netlist {
+	char *name;
+
+	// Ops, sorted by level, and the hierarchical names of their gates
+	netlist_op_t *ops;
+	char **op_names;
+	size_t amount_ops;
+
+	// The ops reading net i are fanout[fanout_start[i]] up to fanout[fanout_start[i + 1]]
+	uint32_t *fanout_start;
+	uint32_t *fanout;
+
+	// Ops of level i are ops[level_start[i]] up to ops[level_start[i + 1]]
+	size_t *level_start;
+	size_t amount_levels;
+
+	// Inputs and outputs, sorted by name
+	netlist_io_t *inputs;
+	size_t amount_inputs;
+	netlist_io_t *outputs;
+	size_t amount_outputs;
+
+	// State of every net
+	bool *state;
+	size_t amount_nets;
+
+	// File the arrays point into when opened with netlist_file_open, NULL otherwise
+	void *mapping;
+	size_t mapping_size;
+} netlist_t;
+
+
+bool netlist_compile(netlist_t *netlist, circuit_t *circ);
+void netlist_evaluate(netlist_t *netlist);
+void netlist_apply(netlist_t *netlist, const bool *inputs, bool *outputs);
+
+netlist_io_t *netlist_get_input_by_name(netlist_t *netlist, char *name);
+netlist_io_t *netlist_get_output_by_name(netlist_t *netlist, char *name);
+netlist_op_t *netlist_get_op_by_name(netlist_t *netlist, char *name);
+
+
+void netlist_print(netlist_t *netlist);
+void netlist_init(netlist_t *netlist);
+void netlist_free(netlist_t *netlist);
+
+
+#endif
@@ -0,0 +1,379 @@
+#include "netlist_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "intern.h"
+
+
+// The level starts are mapped directly
+_Static_assert(sizeof(size_t) == sizeof(uint64_t), "size_t has to be 64 bits");
+
+
+#define NETLIST_FILE_ALIGN(x) (((x) + 7) & ~(uint64_t) 7)
+
+
+// Give every section its offset, returns the size of the file
+static uint64_t netlist_file_layout(netlist_file_header_t *header) {
+	FUNC_START();
+
+	uint64_t offset = NETLIST_FILE_ALIGN(sizeof(netlist_file_header_t));
+
+	#define NETLIST_FILE_SECTION(section, size) \
+		header->section = offset; \
+		offset = NETLIST_FILE_ALIGN(offset + (size));
+
+	NETLIST_FILE_SECTION(ops, header->amount_ops * sizeof(netlist_op_t));
+	NETLIST_FILE_SECTION(op_names, header->amount_ops * sizeof(uint32_t));
+	NETLIST_FILE_SECTION(fanout_start, (header->amount_nets + 1) * sizeof(uint32_t));
+	NETLIST_FILE_SECTION(fanout, header->amount_fanout * sizeof(uint32_t));
+	NETLIST_FILE_SECTION(level_start, (header->amount_levels + 1) * sizeof(uint64_t));
+	NETLIST_FILE_SECTION(inputs, header->amount_inputs * sizeof(netlist_file_io_t));
+	NETLIST_FILE_SECTION(outputs, header->amount_outputs * sizeof(netlist_file_io_t));
+	NETLIST_FILE_SECTION(state, header->amount_nets * sizeof(bool));
+	NETLIST_FILE_SECTION(strings, header->strings_size);
+
+	#undef NETLIST_FILE_SECTION
+
+	FUNC_END();
+	return offset;
+}
+
+
+// Copy a name into the strings, returns its offset
+static uint32_t netlist_file_add_string(char *strings, uint64_t *strings_size, char *name) {
+	uint32_t offset = (uint32_t) *strings_size;
+	size_t length = strlen(name) + 1;
+
+	memcpy(&strings[offset], name, length);
+	*strings_size += length;
+
+	return offset;
+}
+
+
+bool netlist_file_save(netlist_t *netlist, char *filename) {
+	FUNC_START();
+
+	assert_not_null(netlist);
+	assert_not_null(filename);
+	assert_not_null(netlist->fanout_start);
+	assert_not_null(netlist->level_start);
+
+
+	netlist_file_header_t header;
+	memset(&header, 0, sizeof(header));
+
+	header.magic = NETLIST_FILE_MAGIC;
+	header.version = NETLIST_FILE_VERSION;
+	header.op_size = sizeof(netlist_op_t);
+	header.io_size = sizeof(netlist_file_io_t);
+
+	header.amount_ops = netlist->amount_ops;
+	header.amount_nets = netlist->amount_nets;
+	header.amount_levels = netlist->amount_levels;
+	header.amount_inputs = netlist->amount_inputs;
+	header.amount_outputs = netlist->amount_outputs;
+	header.amount_fanout = netlist->fanout_start[netlist->amount_nets];
+
+	// Count the names
+	header.strings_size = strlen(netlist->name) + 1;
+
+	for (size_t i = 0; i < netlist->amount_ops; i++) {
+		header.strings_size += strlen(netlist->op_names[i]) + 1;
+	}
+
+	for (size_t i = 0; i < netlist->amount_inputs; i++) {
+		header.strings_size += strlen(netlist->inputs[i].name) + 1;
+	}
+
+	for (size_t i = 0; i < netlist->amount_outputs; i++) {
+		header.strings_size += strlen(netlist->outputs[i].name) + 1;
+	}
+
+	if (header.strings_size > UINT32_MAX) {
+		warn("Can't save netlist %s: its names don't fit in the file", netlist->name);
+		FUNC_END();
+		return false;
+	}
+
+	header.size = netlist_file_layout(&header);
+
+
+	// Build the whole file in memory, so it can be written at once
+	char *data = calloc(header.size, 1);
+	assert_not_null(data);
+
+	char *strings = &data[header.strings];
+	uint64_t strings_size = 0;
+
+	header.name = netlist_file_add_string(strings, &strings_size, netlist->name);
+
+	memcpy(&data[header.ops], netlist->ops, header.amount_ops * sizeof(netlist_op_t));
+	memcpy(&data[header.fanout_start], netlist->fanout_start, (header.amount_nets + 1) * sizeof(uint32_t));
+	memcpy(&data[header.fanout], netlist->fanout, header.amount_fanout * sizeof(uint32_t));
+	memcpy(&data[header.level_start], netlist->level_start, (header.amount_levels + 1) * sizeof(uint64_t));
+	memcpy(&data[header.state], netlist->state, header.amount_nets * sizeof(bool));
+
+	uint32_t *op_names = (uint32_t *) &data[header.op_names];
+
+	for (size_t i = 0; i < netlist->amount_ops; i++) {
+		op_names[i] = netlist_file_add_string(strings, &strings_size, netlist->op_names[i]);
+	}
+
+	netlist_file_io_t *inputs = (netlist_file_io_t *) &data[header.inputs];
+
+	for (size_t i = 0; i < netlist->amount_inputs; i++) {
+		inputs[i].name = netlist_file_add_string(strings, &strings_size, netlist->inputs[i].name);
+		inputs[i].net = netlist->inputs[i].net;
+	}
+
+	netlist_file_io_t *outputs = (netlist_file_io_t *) &data[header.outputs];
+
+	for (size_t i = 0; i < netlist->amount_outputs; i++) {
+		outputs[i].name = netlist_file_add_string(strings, &strings_size, netlist->outputs[i].name);
+		outputs[i].net = netlist->outputs[i].net;
+	}
+
+	memcpy(data, &header, sizeof(header));
+
+
+	// Write file
+	FILE *file = fopen(filename, "wb");
+
+	if (file == NULL) {
+		warn("Failed to open %s for writing", filename);
+		free(data);
+		FUNC_END();
+		return false;
+	}
+
+	bool success = fwrite(data, 1, header.size, file) == header.size;
+	success &= fclose(file) == 0;
+
+	free(data);
+
+	if (! success) {
+		warn("Failed to write netlist %s to %s", netlist->name, filename);
+	}
+
+
+	FUNC_END();
+	return success;
+}
+
+
+// Check a section lies within the file
+static bool netlist_file_check_section(netlist_file_header_t *header, uint64_t offset, uint64_t amount, uint64_t size) {
+	return offset % 8 == 0 && offset <= header->size && amount <= (header->size - offset) / size;
+}
+
+
+// Check a name is a string in the strings
+static bool netlist_file_check_name(netlist_file_header_t *header, char *strings, uint32_t name) {
+	return name < header->strings_size && memchr(&strings[name], '\0', header->strings_size - name) != NULL;
+}
+
+
+// Check all sizes, offsets and indices, so a corrupt file can't make anything read outside of it
+static bool netlist_file_check(netlist_file_header_t *header, char *data, uint64_t size) {
+	FUNC_START();
+
+	bool valid = true;
+
+	valid &= header->magic == NETLIST_FILE_MAGIC;
+	valid &= header->version == NETLIST_FILE_VERSION;
+	valid &= header->op_size == sizeof(netlist_op_t);
+	valid &= header->io_size == sizeof(netlist_file_io_t);
+	valid &= header->size == size;
+	valid &= header->amount_nets < NETLIST_NO_NET;
+
+	// Every level has an op, so the level starts can be counted without wrapping around
+	valid &= header->amount_levels <= header->amount_ops && header->amount_ops <= size;
+
+	if (! valid) {
+		FUNC_END();
+		return false;
+	}
+
+	valid &= netlist_file_check_section(header, header->ops, header->amount_ops, sizeof(netlist_op_t));
+	valid &= netlist_file_check_section(header, header->op_names, header->amount_ops, sizeof(uint32_t));
+	valid &= netlist_file_check_section(header, header->fanout_start, header->amount_nets + 1, sizeof(uint32_t));
+	valid &= netlist_file_check_section(header, header->fanout, header->amount_fanout, sizeof(uint32_t));
+	valid &= netlist_file_check_section(header, header->level_start, header->amount_levels + 1, sizeof(uint64_t));
+	valid &= netlist_file_check_section(header, header->inputs, header->amount_inputs, sizeof(netlist_file_io_t));
+	valid &= netlist_file_check_section(header, header->outputs, header->amount_outputs, sizeof(netlist_file_io_t));
+	valid &= netlist_file_check_section(header, header->state, header->amount_nets, sizeof(bool));
+	valid &= netlist_file_check_section(header, header->strings, header->strings_size, 1);
+
+	if (! valid) {
+		FUNC_END();
+		return false;
+	}
+
+
+	char *strings = &data[header->strings];
+	valid &= netlist_file_check_name(header, strings, (uint32_t) header->name);
+	valid &= header->name <= UINT32_MAX;
+
+	// Ops only read and write existing nets
+	netlist_op_t *ops = (netlist_op_t *) &data[header->ops];
+	uint32_t *op_names = (uint32_t *) &data[header->op_names];
+
+	for (size_t i = 0; i < header->amount_ops; i++) {
+		valid &= ops[i].op < NETLIST_OP_AMOUNT;
+		valid &= ops[i].in0 < header->amount_nets && ops[i].in1 < header->amount_nets && ops[i].out < header->amount_nets;
+		valid &= netlist_file_check_name(header, strings, op_names[i]);
+	}
+
+	// The fanout and level starts only go up, and end at the amount of fanout and ops
+	uint32_t *fanout_start = (uint32_t *) &data[header->fanout_start];
+	uint32_t *fanout = (uint32_t *) &data[header->fanout];
+	uint64_t *level_start = (uint64_t *) &data[header->level_start];
+
+	for (size_t i = 0; i < header->amount_nets; i++) {
+		valid &= fanout_start[i] <= fanout_start[i + 1];
+	}
+
+	valid &= fanout_start[header->amount_nets] == header->amount_fanout;
+
+	for (size_t i = 0; i < header->amount_fanout; i++) {
+		valid &= fanout[i] < header->amount_ops;
+	}
+
+	for (size_t i = 0; i < header->amount_levels; i++) {
+		valid &= level_start[i] <= level_start[i + 1];
+	}
+
+	valid &= level_start[header->amount_levels] == header->amount_ops;
+
+	// Inputs and outputs
+	netlist_file_io_t *ios[2] = {
+		(netlist_file_io_t *) &data[header->inputs],
+		(netlist_file_io_t *) &data[header->outputs]
+	};
+	uint64_t amounts[2] = { header->amount_inputs, header->amount_outputs };
+
+	for (size_t j = 0; j < 2; j++) {
+		for (size_t i = 0; i < amounts[j]; i++) {
+			valid &= ios[j][i].net < header->amount_nets;
+			valid &= netlist_file_check_name(header, strings, ios[j][i].name);
+		}
+	}
+
+
+	FUNC_END();
+	return valid;
+}
+
+
+static netlist_io_t *netlist_file_read_io(netlist_file_io_t *list, uint64_t amount, char *strings) {
+	FUNC_START();
+
+	netlist_io_t *ios = malloc((amount + 1) * sizeof(netlist_io_t));
+	assert_not_null(ios);
+
+	for (size_t i = 0; i < amount; i++) {
+		ios[i].name = intern(&strings[list[i].name]);
+		ios[i].net = list[i].net;
+	}
+
+	FUNC_END();
+	return ios;
+}
+
+
+// Map a compiled netlist into memory. The ops, fanout, levels and state are used
+// directly from the mapping, only the names are interned.
+bool netlist_file_open(netlist_t *netlist, char *filename) {
+	FUNC_START();
+
+	assert_not_null(netlist);
+	assert_not_null(filename);
+	assert(netlist->ops == NULL);
+
+
+	int fd = open(filename, O_RDONLY);
+
+	if (fd == -1) {
+		warn("Failed to open netlist file %s", filename);
+		FUNC_END();
+		return false;
+	}
+
+	struct stat stats;
+
+	if (fstat(fd, &stats) == -1 || (size_t) stats.st_size < sizeof(netlist_file_header_t)) {
+		warn("Netlist file %s is too small", filename);
+		close(fd);
+		FUNC_END();
+		return false;
+	}
+
+	size_t size = (size_t) stats.st_size;
+
+	// Private, so the state can be written without changing the file
+	char *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		warn("Failed to map netlist file %s", filename);
+		FUNC_END();
+		return false;
+	}
+
+
+	netlist_file_header_t *header = (netlist_file_header_t *) data;
+
+	if (! netlist_file_check(header, data, size)) {
+		warn("Netlist file %s is invalid", filename);
+		munmap(data, size);
+		FUNC_END();
+		return false;
+	}
+
+
+	char *strings = &data[header->strings];
+
+	netlist->name = intern(&strings[header->name]);
+
+	netlist->ops = (netlist_op_t *) &data[header->ops];
+	netlist->amount_ops = header->amount_ops;
+
+	netlist->op_names = malloc((header->amount_ops + 1) * sizeof(char *));
+	assert_not_null(netlist->op_names);
+
+	uint32_t *op_names = (uint32_t *) &data[header->op_names];
+
+	for (size_t i = 0; i < header->amount_ops; i++) {
+		netlist->op_names[i] = intern(&strings[op_names[i]]);
+	}
+
+	netlist->fanout_start = (uint32_t *) &data[header->fanout_start];
+	netlist->fanout = (uint32_t *) &data[header->fanout];
+
+	netlist->level_start = (size_t *) &data[header->level_start];
+	netlist->amount_levels = header->amount_levels;
+
+	netlist->inputs = netlist_file_read_io((netlist_file_io_t *) &data[header->inputs], header->amount_inputs, strings);
+	netlist->amount_inputs = header->amount_inputs;
+	netlist->outputs = netlist_file_read_io((netlist_file_io_t *) &data[header->outputs], header->amount_outputs, strings);
+	netlist->amount_outputs = header->amount_outputs;
+
+	netlist->state = (bool *) &data[header->state];
+	netlist->amount_nets = header->amount_nets;
+
+	netlist->mapping = data;
+	netlist->mapping_size = size;
+
+
+	FUNC_END();
+	return true;
+}
@@ -0,0 +1,70 @@
+#ifndef NETLIST_FILE_H
+#define NETLIST_FILE_H
+
+
+#include <stdint.h>
+
+#include "netlist.h"
+
+
+// "LNET" when read as a little endian uint32_t
+#define NETLIST_FILE_MAGIC 0x54454e4c
+#define NETLIST_FILE_VERSION 1
+
+
+// A compiled netlist, written as one block so it can be mapped straight into memory.
+// Every section starts at an offset from the start of the file, aligned to 8 bytes.
+typedef struct netlist_file_header {
+	uint32_t magic;
+	uint32_t version;
+
+	// Sizes of the structs, so files written by an incompatible build are rejected
+	uint32_t op_size;
+	uint32_t io_size;
+
+	// Offset of the netlist name in the strings
+	uint64_t name;
+
+	uint64_t amount_ops;
+	uint64_t amount_nets;
+	uint64_t amount_levels;
+	uint64_t amount_inputs;
+	uint64_t amount_outputs;
+	uint64_t amount_fanout;
+	uint64_t strings_size;
+
+	// netlist_op_t[amount_ops]
+	uint64_t ops;
+	// uint32_t[amount_ops], offsets in the strings
+	uint64_t op_names;
+	// uint32_t[amount_nets + 1]
+	uint64_t fanout_start;
+	// uint32_t[amount_fanout]
+	uint64_t fanout;
+	// uint64_t[amount_levels + 1]
+	uint64_t level_start;
+	// netlist_file_io_t[amount_inputs], sorted by name
+	uint64_t inputs;
+	// netlist_file_io_t[amount_outputs], sorted by name
+	uint64_t outputs;
+	// bool[amount_nets]
+	uint64_t state;
+	// All names, each terminated by '\0'
+	uint64_t strings;
+
+	uint64_t size;
+} netlist_file_header_t;
+
+
+typedef struct netlist_file_io {
+	// Offset of the name in the strings
+	uint32_t name;
+	uint32_t net;
+} netlist_file_io_t;
+
+
+bool netlist_file_save(netlist_t *netlist, char *filename);
+bool netlist_file_open(netlist_t *netlist, char *filename);
+
+
+#endif
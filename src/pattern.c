@@ -0,0 +1,182 @@
+#include "pattern.h"
+
+#include <stdlib.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "pattern_kernels.h"
+
+
+// NOTE: No benchmarking in the evaluation functions, they are the innermost loop
+
+
+void pattern_evaluate(pattern_t *pattern) {
+	uint64_t *state = pattern->state;
+	size_t words = pattern->words;
+
+	// Look the kernels up once, not once per op
+	const pattern_kernel_t *kernels = pattern_kernels_get()->ops;
+
+	netlist_op_t *op = pattern->netlist->ops;
+	netlist_op_t *end = op + pattern->netlist->amount_ops;
+
+	for (; op < end; op++) {
+		kernels[op->op](&state[op->out * words], &state[op->in0 * words], &state[op->in1 * words], words);
+	}
+}
+
+
+uint64_t *pattern_get_net(pattern_t *pattern, uint32_t net) {
+	assert_not_null(pattern);
+	assert(net < pattern->netlist->amount_nets);
+
+	return &pattern->state[net * pattern->words];
+}
+
+
+bool pattern_set_input(pattern_t *pattern, char *name, const uint64_t *words) {
+	FUNC_START();
+
+	assert_not_null(pattern);
+	assert_not_null(words);
+
+	netlist_io_t *io = netlist_get_input_by_name(pattern->netlist, name);
+
+	if (io == NULL) {
+		FUNC_END();
+		return false;
+	}
+
+	memcpy(pattern_get_net(pattern, io->net), words, pattern->words * sizeof(uint64_t));
+
+	FUNC_END();
+	return true;
+}
+
+
+bool pattern_get_output(pattern_t *pattern, char *name, uint64_t *words) {
+	FUNC_START();
+
+	assert_not_null(pattern);
+	assert_not_null(words);
+
+	netlist_io_t *io = netlist_get_output_by_name(pattern->netlist, name);
+
+	if (io == NULL) {
+		FUNC_END();
+		return false;
+	}
+
+	memcpy(words, pattern_get_net(pattern, io->net), pattern->words * sizeof(uint64_t));
+
+	FUNC_END();
+	return true;
+}
+
+
+// Set the inputs of a single vector, in the order of netlist->inputs
+void pattern_set_vector(pattern_t *pattern, size_t vector, const bool *inputs) {
+	assert_not_null(pattern);
+	assert(vector < pattern->words * PATTERN_WORD_BITS);
+
+	size_t word = vector / PATTERN_WORD_BITS;
+	uint64_t bit = 1ull << (vector % PATTERN_WORD_BITS);
+
+	for (size_t i = 0; i < pattern->netlist->amount_inputs; i++) {
+		uint64_t *words = pattern_get_net(pattern, pattern->netlist->inputs[i].net);
+
+		if (inputs[i]) {
+			words[word] |= bit;
+		}
+		else {
+			words[word] &= ~bit;
+		}
+	}
+}
+
+
+// Get the outputs of a single vector, in the order of netlist->outputs
+void pattern_get_vector(pattern_t *pattern, size_t vector, bool *outputs) {
+	assert_not_null(pattern);
+	assert(vector < pattern->words * PATTERN_WORD_BITS);
+
+	size_t word = vector / PATTERN_WORD_BITS;
+	unsigned int bit = vector % PATTERN_WORD_BITS;
+
+	for (size_t i = 0; i < pattern->netlist->amount_outputs; i++) {
+		uint64_t *words = pattern_get_net(pattern, pattern->netlist->outputs[i].net);
+
+		outputs[i] = (words[word] >> bit) & 1;
+	}
+}
+
+
+// Load the input combinations first, first + 1, ..., where input i is bit i of the combination.
+// A combination has 64 bits, so inputs after the 64th are always 0.
+void pattern_set_exhaustive(pattern_t *pattern, uint64_t first) {
+	FUNC_START();
+
+	assert_not_null(pattern);
+	assert((first & (PATTERN_WORD_BITS - 1)) == 0);
+
+	// Within a word, the lowest 6 bits of the combination count up
+	static const uint64_t low_bits[6] = {
+		0xaaaaaaaaaaaaaaaaull,
+		0xccccccccccccccccull,
+		0xf0f0f0f0f0f0f0f0ull,
+		0xff00ff00ff00ff00ull,
+		0xffff0000ffff0000ull,
+		0xffffffff00000000ull,
+	};
+
+	for (size_t i = 0; i < pattern->netlist->amount_inputs; i++) {
+		uint64_t *words = pattern_get_net(pattern, pattern->netlist->inputs[i].net);
+
+		for (size_t w = 0; w < pattern->words; w++) {
+			if (i < 6) {
+				words[w] = low_bits[i];
+			}
+			else if (i >= PATTERN_WORD_BITS) {
+				words[w] = 0;
+			}
+			else {
+				// The higher bits are the same for all vectors in a word
+				uint64_t combination = first + w * PATTERN_WORD_BITS;
+
+				words[w] = ((combination >> i) & 1) ? ~0ull : 0;
+			}
+		}
+	}
+
+	FUNC_END();
+}
+
+
+// Create a pattern state for at least the given amount of vectors
+void pattern_init(pattern_t *pattern, netlist_t *netlist, size_t vectors) {
+	assert_not_null(pattern);
+	assert_not_null(netlist);
+
+	pattern->netlist = netlist;
+	pattern->words = (vectors + PATTERN_WORD_BITS - 1) / PATTERN_WORD_BITS;
+
+	if (pattern->words == 0) {
+		pattern->words = 1;
+	}
+
+	pattern->state = calloc(netlist->amount_nets * pattern->words + 1, sizeof(uint64_t));
+
+	// Start every vector in the current state of the netlist
+	for (uint32_t net = 0; net < netlist->amount_nets; net++) {
+		if (netlist->state[net]) {
+			memset(pattern_get_net(pattern, net), 0xff, pattern->words * sizeof(uint64_t));
+		}
+	}
+}
+
+
+void pattern_free(pattern_t *pattern) {
+	assert_not_null(pattern);
+
+	free(pattern->state);
+}
@@ -0,0 +1,41 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+
+#include <stdint.h>
+
+#include "netlist.h"
+
+
+// The amount of vectors in one word
+#define PATTERN_WORD_BITS 64
+
+
+// State of a netlist for many input vectors at once, one bit per vector
+typedef struct pattern {
+	netlist_t *netlist;
+
+	// Words per net
+	size_t words;
+
+	// The words of net i are state[i * words] up to state[(i + 1) * words]
+	uint64_t *state;
+} pattern_t;
+
+
+void pattern_evaluate(pattern_t *pattern);
+uint64_t *pattern_get_net(pattern_t *pattern, uint32_t net);
+
+bool pattern_set_input(pattern_t *pattern, char *name, const uint64_t *words);
+bool pattern_get_output(pattern_t *pattern, char *name, uint64_t *words);
+
+void pattern_set_vector(pattern_t *pattern, size_t vector, const bool *inputs);
+void pattern_get_vector(pattern_t *pattern, size_t vector, bool *outputs);
+void pattern_set_exhaustive(pattern_t *pattern, uint64_t first);
+
+
+void pattern_init(pattern_t *pattern, netlist_t *netlist, size_t vectors);
+void pattern_free(pattern_t *pattern);
+
+
+#endif
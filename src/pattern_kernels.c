@@ -0,0 +1,213 @@
+#include "pattern_kernels.h"
+
+#include <stdatomic.h>
+
+#include "assert.h"
+#include "benchmark.h"
+
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	#define PATTERN_KERNELS_X86
+
+	#include <immintrin.h>
+#endif
+
+
+// NOTE: No benchmarking in the kernels, they are the innermost loop
+
+
+static void word_and(uint64_t *out, const uint64_t *in0, const uint64_t *in1, size_t words) {
+	for (size_t w = 0; w < words; w++) out[w] = in0[w] & in1[w];
+}
+
+static void word_or(uint64_t *out, const uint64_t *in0, const uint64_t *in1, size_t words) {
+	for (size_t w = 0; w < words; w++) out[w] = in0[w] | in1[w];
+}
+
+static void word_xor(uint64_t *out, const uint64_t *in0, const uint64_t *in1, size_t words) {
+	for (size_t w = 0; w < words; w++) out[w] = in0[w] ^ in1[w];
+}
+
+static void word_not(uint64_t *out, const uint64_t *in0, const uint64_t *in1, size_t words) {
+	(void) in1;
+	for (size_t w = 0; w < words; w++) out[w] = ~in0[w];
+}
+
+
+static const pattern_kernels_t word_kernels = {
+	.name = "64-bit",
+	.words = 1,
+	.ops = {
+		[NetlistOp_AND] = word_and,
+		[NetlistOp_OR] = word_or,
+		[NetlistOp_XOR] = word_xor,
+		[NetlistOp_NOT] = word_not,
+	},
+};
+
+
+#ifdef PATTERN_KERNELS_X86
+
+// Process 4 words per instruction, then finish the tail with plain words
+#define AVX2_KERNEL(name, expr, tail) \
+	__attribute__((target("avx2"))) \
+	static void name(uint64_t *out, const uint64_t *in0, const uint64_t *in1, size_t words) { \
+		size_t w = 0; \
+		\
+		for (; w + 4 <= words; w += 4) { \
+			__m256i a = _mm256_loadu_si256((const __m256i *) &in0[w]); \
+			__m256i b = _mm256_loadu_si256((const __m256i *) &in1[w]); \
+			(void) b; \
+			_mm256_storeu_si256((__m256i *) &out[w], (expr)); \
+		} \
+		\
+		tail(&out[w], &in0[w], &in1[w], words - w); \
+	}
+
+AVX2_KERNEL(avx2_and, _mm256_and_si256(a, b), word_and)
+AVX2_KERNEL(avx2_or, _mm256_or_si256(a, b), word_or)
+AVX2_KERNEL(avx2_xor, _mm256_xor_si256(a, b), word_xor)
+AVX2_KERNEL(avx2_not, _mm256_xor_si256(a, _mm256_set1_epi64x(-1)), word_not)
+
+
+// Process 8 words per instruction, then finish the tail with plain words
+#define AVX512_KERNEL(name, expr, tail) \
+	__attribute__((target("avx512f"))) \
+	static void name(uint64_t *out, const uint64_t *in0, const uint64_t *in1, size_t words) { \
+		size_t w = 0; \
+		\
+		for (; w + 8 <= words; w += 8) { \
+			__m512i a = _mm512_loadu_si512((const void *) &in0[w]); \
+			__m512i b = _mm512_loadu_si512((const void *) &in1[w]); \
+			(void) b; \
+			_mm512_storeu_si512((void *) &out[w], (expr)); \
+		} \
+		\
+		tail(&out[w], &in0[w], &in1[w], words - w); \
+	}
+
+AVX512_KERNEL(avx512_and, _mm512_and_si512(a, b), word_and)
+AVX512_KERNEL(avx512_or, _mm512_or_si512(a, b), word_or)
+AVX512_KERNEL(avx512_xor, _mm512_xor_si512(a, b), word_xor)
+AVX512_KERNEL(avx512_not, _mm512_xor_si512(a, _mm512_set1_epi64(-1)), word_not)
+
+
+static const pattern_kernels_t avx2_kernels = {
+	.name = "AVX2",
+	.words = 4,
+	.ops = {
+		[NetlistOp_AND] = avx2_and,
+		[NetlistOp_OR] = avx2_or,
+		[NetlistOp_XOR] = avx2_xor,
+		[NetlistOp_NOT] = avx2_not,
+	},
+};
+
+
+static const pattern_kernels_t avx512_kernels = {
+	.name = "AVX-512",
+	.words = 8,
+	.ops = {
+		[NetlistOp_AND] = avx512_and,
+		[NetlistOp_OR] = avx512_or,
+		[NetlistOp_XOR] = avx512_xor,
+		[NetlistOp_NOT] = avx512_not,
+	},
+};
+
+#endif
+
+
+// The kernels used by pattern_evaluate, picked on first use. Threads of a pool can
+// evaluate at once, so the first use may race, but every racer picks the same kernels.
+static const pattern_kernels_t *_Atomic current_kernels = NULL;
+
+
+bool pattern_kernels_supported(PatternKernels_t kernels) {
+	FUNC_START();
+
+	bool supported = false;
+
+	switch (kernels) {
+		case PatternKernels_WORD:
+			supported = true;
+			break;
+
+		case PatternKernels_AVX2:
+			#ifdef PATTERN_KERNELS_X86
+				supported = __builtin_cpu_supports("avx2");
+			#endif
+			break;
+
+		case PatternKernels_AVX512:
+			#ifdef PATTERN_KERNELS_X86
+				supported = __builtin_cpu_supports("avx512f");
+			#endif
+			break;
+	}
+
+	FUNC_END();
+	return supported;
+}
+
+
+bool pattern_kernels_select(PatternKernels_t kernels) {
+	FUNC_START();
+
+	if (! pattern_kernels_supported(kernels)) {
+		warn("Pattern kernels %i aren't supported by this CPU", kernels);
+		FUNC_END();
+		return false;
+	}
+
+	switch (kernels) {
+		case PatternKernels_WORD:
+			atomic_store_explicit(&current_kernels, &word_kernels, memory_order_release);
+			break;
+
+		#ifdef PATTERN_KERNELS_X86
+			case PatternKernels_AVX2:
+				atomic_store_explicit(&current_kernels, &avx2_kernels, memory_order_release);
+				break;
+
+			case PatternKernels_AVX512:
+				atomic_store_explicit(&current_kernels, &avx512_kernels, memory_order_release);
+				break;
+		#else
+			default:
+				break;
+		#endif
+	}
+
+	FUNC_END();
+	return true;
+}
+
+
+PatternKernels_t pattern_kernels_best(void) {
+	FUNC_START();
+
+	PatternKernels_t best = PatternKernels_WORD;
+
+	if (pattern_kernels_supported(PatternKernels_AVX512)) {
+		best = PatternKernels_AVX512;
+	}
+	else if (pattern_kernels_supported(PatternKernels_AVX2)) {
+		best = PatternKernels_AVX2;
+	}
+
+	FUNC_END();
+	return best;
+}
+
+
+const pattern_kernels_t *pattern_kernels_get(void) {
+	const pattern_kernels_t *kernels = atomic_load_explicit(&current_kernels, memory_order_acquire);
+
+	if (kernels == NULL) {
+		pattern_kernels_select(pattern_kernels_best());
+		kernels = atomic_load_explicit(&current_kernels, memory_order_acquire);
+	}
+
+	return kernels;
+}
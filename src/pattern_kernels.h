@@ -0,0 +1,45 @@
+#ifndef PATTERN_KERNELS_H
+#define PATTERN_KERNELS_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "netlist.h"
+
+
+// Apply an op to a whole net at once, NOT ignores in1
+typedef void (*pattern_kernel_t)(uint64_t *out, const uint64_t *in0, const uint64_t *in1, size_t words);
+
+
+typedef enum PatternKernels {
+	// Plain 64-bit words
+	PatternKernels_WORD,
+
+	// 256-bit words, if the CPU supports AVX2
+	PatternKernels_AVX2,
+
+	// 512-bit words, if the CPU supports AVX-512
+	PatternKernels_AVX512
+} PatternKernels_t;
+
+
+typedef struct pattern_kernels {
+	const char *name;
+
+	// Words one instruction of the kernels works on
+	size_t words;
+
+	// Indexed by NetlistOp_t
+	pattern_kernel_t ops[NETLIST_OP_AMOUNT];
+} pattern_kernels_t;
+
+
+bool pattern_kernels_supported(PatternKernels_t kernels);
+bool pattern_kernels_select(PatternKernels_t kernels);
+PatternKernels_t pattern_kernels_best(void);
+const pattern_kernels_t *pattern_kernels_get(void);
+
+
+#endif
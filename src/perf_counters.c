@@ -0,0 +1,147 @@
+#include "perf_counters.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+	#include <linux/perf_event.h>
+	#include <sys/syscall.h>
+#endif
+
+#include "assert.h"
+
+
+// NOTE: No benchmarking, the profiler reads counters for every call
+
+
+static const char *perf_counter_names[PerfCounter_AMOUNT] = {
+	[PerfCounter_CYCLES] = "cycles",
+	[PerfCounter_INSTRUCTIONS] = "instructions",
+	[PerfCounter_CACHE_MISSES] = "cache-misses",
+	[PerfCounter_BRANCH_MISSES] = "branch-misses"
+};
+
+
+const char *perf_counter_name(PerfCounter_t counter) {
+	assert(counter < PerfCounter_AMOUNT);
+	return perf_counter_names[counter];
+}
+
+
+bool perf_counters_available(perf_counters_t *counters, PerfCounter_t counter) {
+	assert(counter < PerfCounter_AMOUNT);
+	return counters->index[counter] >= 0;
+}
+
+
+// Counts since the counters were opened, counters that aren't available stay 0
+void perf_counters_read(perf_counters_t *counters, perf_values_t *values) {
+	memset(values, 0, sizeof(perf_values_t));
+
+	if (counters->amount == 0) {
+		return;
+	}
+
+	// The amount of counters, then their values in the order they were opened
+	uint64_t group[1 + PerfCounter_AMOUNT];
+	ssize_t size = read(counters->fds[0], group, sizeof(group));
+
+	if (size < (ssize_t) sizeof(uint64_t) || group[0] != counters->amount) {
+		return;
+	}
+
+	for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+		if (counters->index[i] >= 0) {
+			values->values[i] = group[1 + counters->index[i]];
+		}
+	}
+}
+
+
+void perf_values_add(perf_values_t *dest, perf_values_t *a, perf_values_t *b) {
+	for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+		dest->values[i] = a->values[i] + b->values[i];
+	}
+}
+
+
+void perf_values_sub(perf_values_t *dest, perf_values_t *a, perf_values_t *b) {
+	for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+		dest->values[i] = a->values[i] - b->values[i];
+	}
+}
+
+
+// Every counter divided by per, with the instructions per cycle if both are there
+void perf_values_print(perf_counters_t *counters, perf_values_t *values, double per) {
+	for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+		if (perf_counters_available(counters, i)) {
+			printf("%12.1f %s  ", (double) values->values[i] / per, perf_counter_names[i]);
+		}
+		else {
+			printf("%12s %s  ", "-", perf_counter_names[i]);
+		}
+	}
+
+	if (perf_counters_available(counters, PerfCounter_CYCLES) && perf_counters_available(counters, PerfCounter_INSTRUCTIONS) && values->values[PerfCounter_CYCLES] > 0) {
+		printf("%5.2f IPC", (double) values->values[PerfCounter_INSTRUCTIONS] / (double) values->values[PerfCounter_CYCLES]);
+	}
+
+	printf("\n");
+}
+
+
+
+// Open the counters for the calling thread, only counting user space.
+// Returns false if none of them are supported, like in most VMs.
+bool perf_counters_init(perf_counters_t *counters) {
+	counters->amount = 0;
+
+	for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+		counters->fds[i] = -1;
+		counters->index[i] = -1;
+	}
+
+#ifdef __linux__
+	static const uint64_t configs[PerfCounter_AMOUNT] = {
+		[PerfCounter_CYCLES] = PERF_COUNT_HW_CPU_CYCLES,
+		[PerfCounter_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+		[PerfCounter_CACHE_MISSES] = PERF_COUNT_HW_CACHE_MISSES,
+		[PerfCounter_BRANCH_MISSES] = PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = configs[i];
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		// The first counter that opens leads the group, which is read at once
+		int leader = (counters->amount == 0) ? -1 : counters->fds[0];
+		int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+
+		if (fd >= 0) {
+			counters->fds[counters->amount] = fd;
+			counters->index[i] = (int) counters->amount;
+			counters->amount++;
+		}
+	}
+#endif
+
+	return counters->amount > 0;
+}
+
+
+void perf_counters_free(perf_counters_t *counters) {
+	for (size_t i = 0; i < counters->amount; i++) {
+		close(counters->fds[i]);
+	}
+
+	counters->amount = 0;
+}
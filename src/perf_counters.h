@@ -0,0 +1,49 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+
+typedef enum PerfCounter {
+	PerfCounter_CYCLES,
+	PerfCounter_INSTRUCTIONS,
+	PerfCounter_CACHE_MISSES,
+	PerfCounter_BRANCH_MISSES,
+
+	PerfCounter_AMOUNT
+} PerfCounter_t;
+
+
+typedef struct perf_values {
+	uint64_t values[PerfCounter_AMOUNT];
+} perf_values_t;
+
+
+// Hardware counters of the thread that opened them, read together as one group
+typedef struct perf_counters {
+	// In the order they were opened, the first one leads the group
+	int fds[PerfCounter_AMOUNT];
+
+	// Position of every counter in the group, -1 if it couldn't be opened
+	int index[PerfCounter_AMOUNT];
+	size_t amount;
+} perf_counters_t;
+
+
+const char *perf_counter_name(PerfCounter_t counter);
+bool perf_counters_available(perf_counters_t *counters, PerfCounter_t counter);
+
+void perf_counters_read(perf_counters_t *counters, perf_values_t *values);
+void perf_values_add(perf_values_t *dest, perf_values_t *a, perf_values_t *b);
+void perf_values_sub(perf_values_t *dest, perf_values_t *a, perf_values_t *b);
+void perf_values_print(perf_counters_t *counters, perf_values_t *values, double per);
+
+
+bool perf_counters_init(perf_counters_t *counters);
+void perf_counters_free(perf_counters_t *counters);
+
+
+#endif
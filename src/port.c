@@ -4,6 +4,7 @@
 #include "gate.h"
 #include "assert.h"
 #include "benchmark.h"
+#include "event_queue.h"
 
 
 bool port_update_state(port_t *port) {
@@ -47,7 +48,61 @@ bool port_set_state(port_t *port, bool state) {
 
 	port->state = state;
 
-	bool success = port_update_state(port);
+	bool success;
+
+	if (sim_get_engine() != SimEngine_RECURSIVE) {
+		event_queue_t *queue = sim_get_queue();
+
+		success = event_queue_propagate(queue, port);
+		success &= sim_run_queue(queue);
+	}
+	else {
+		success = port_update_state(port);
+	}
+
+	FUNC_END();
+	return success;
+}
+
+
+// Connect two ports in both directions, unless they already are
+bool port_connect(port_t *a, port_t *b) {
+	FUNC_START();
+
+	assert_not_null(a);
+	assert_not_null(b);
+
+	bool success = true;
+
+	if (! vector_contains(&a->connections, b)) {
+		success &= vector_push(&a->connections, b);
+	}
+
+	if (! vector_contains(&b->connections, a)) {
+		success &= vector_push(&b->connections, a);
+	}
+
+	FUNC_END();
+	return success;
+}
+
+
+// Remove all connections between two ports
+bool port_disconnect(port_t *a, port_t *b) {
+	FUNC_START();
+
+	assert_not_null(a);
+	assert_not_null(b);
+
+	bool success = vector_contains(&a->connections, b) || vector_contains(&b->connections, a);
+
+	while (vector_contains(&a->connections, b)) {
+		vector_remove(&a->connections, b);
+	}
+
+	while (vector_contains(&b->connections, a)) {
+		vector_remove(&b->connections, a);
+	}
 
 	FUNC_END();
 	return success;
@@ -61,8 +116,7 @@ port_t *port_copy(port_t *src) {
 	port_t *dest = malloc(sizeof(port_t));
 	port_init(dest);
 
-	dest->name = malloc(strlen(src->name) + 1);
-	strcpy(dest->name, src->name);
+	dest->name = src->name;
 
 	dest->state = src->state;
 	dest->type = src->type;
@@ -112,13 +166,12 @@ void port_init(port_t *port) {
 	// Defaults
 	port->state = false;
 	port->type = PortType_NODE;
+	port->net = UINT32_MAX;
 
-	vector_init(&port->connections, BUF_SIZE);
+	vector_init(&port->connections, 0);
 }
 
 
 void port_free(port_t *port) {
-	if (port->name) free(port->name);
-
 	vector_free(&port->connections);
 }
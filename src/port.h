@@ -2,6 +2,7 @@
 #define PORT_H
 
 
+#include <stdint.h>
 #include <stdbool.h>
 
 #include "defines.h"
@@ -26,11 +27,16 @@ typedef struct port {
 
 	PortType_t type;
 	vector_t connections;
+
+	// Index of the net this port is part of, set by netlist_compile and loops_find
+	uint32_t net;
 } port_t;
 
 
 bool port_update_state(port_t *port);
 bool port_set_state(port_t *port, bool state);
+bool port_connect(port_t *a, port_t *b);
+bool port_disconnect(port_t *a, port_t *b);
 
 
 port_t *port_copy(port_t *src);
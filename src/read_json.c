@@ -0,0 +1,739 @@
+#include "read_json.h"
+
+#include "assert.h"
+#include "benchmark.h"
+#include "intern.h"
+#include "loops.h"
+#include "tokenizer.h"
+
+
+// Where a custom gate is in the file, and whether it's built yet
+typedef enum JsonCustomState {
+	JsonCustomState_UNBUILT,
+	JsonCustomState_BUILDING,
+	JsonCustomState_BUILT
+} JsonCustomState_t;
+
+
+typedef struct json_custom {
+	string_view_t name;
+	size_t position;
+
+	JsonCustomState_t state;
+} json_custom_t;
+
+
+typedef struct json_reader {
+	char *filename;
+
+	const char *data;
+	size_t size;
+	size_t position;
+
+	// Custom gates, in the order of the file
+	json_custom_t *customs;
+	size_t amount_customs;
+
+	// The first custom gate with every interned name
+	hex_hashmap_t customs_by_name;
+
+	// Built custom gates, so gate_set_ports can find them
+	library_t *library;
+} json_reader_t;
+
+
+// A gate and its type, as found in the "gates" object
+typedef struct json_gate {
+	string_view_t name;
+	string_view_t type;
+} json_gate_t;
+
+
+// Both ends of a wire, as "gate:port"
+typedef struct json_wire {
+	string_view_t a[2];
+	string_view_t b[2];
+} json_wire_t;
+
+
+// NOTE: No benchmarking in the lexer, it's called for every character
+
+
+static void json_error(json_reader_t *reader, char *expected) {
+	size_t line = 1;
+
+	for (size_t i = 0; i < reader->position && i < reader->size; i++) {
+		line += reader->data[i] == '\n';
+	}
+
+	warn("%s:%lu: expected %s", reader->filename, line, expected);
+}
+
+
+static char json_peek(json_reader_t *reader) {
+	while (reader->position < reader->size) {
+		char c = reader->data[reader->position];
+
+		if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+			return c;
+		}
+
+		reader->position++;
+	}
+
+	return '\0';
+}
+
+
+static bool json_expect(json_reader_t *reader, char c) {
+	if (json_peek(reader) != c) {
+		char expected[] = { '\'', c, '\'', '\0' };
+		json_error(reader, expected);
+		return false;
+	}
+
+	reader->position++;
+	return true;
+}
+
+
+// Read a string, without its quotes. Escapes are kept as they are.
+static bool json_string(json_reader_t *reader, string_view_t *view) {
+	if (! json_expect(reader, '"')) {
+		return false;
+	}
+
+	size_t start = reader->position;
+
+	while (reader->position < reader->size && reader->data[reader->position] != '"') {
+		reader->position += (reader->data[reader->position] == '\\') ? 2 : 1;
+	}
+
+	if (reader->position >= reader->size) {
+		json_error(reader, "the end of a string");
+		return false;
+	}
+
+	view->start = &reader->data[start];
+	view->length = reader->position - start;
+
+	reader->position++;
+	return true;
+}
+
+
+// Start reading an object or array
+static bool json_open(json_reader_t *reader, char open, char close, bool *empty) {
+	if (! json_expect(reader, open)) {
+		return false;
+	}
+
+	*empty = json_peek(reader) == close;
+
+	if (*empty) {
+		reader->position++;
+	}
+
+	return true;
+}
+
+
+// After an item of an object or array, returns whether another one follows
+static bool json_next(json_reader_t *reader, char close, bool *more) {
+	char c = json_peek(reader);
+
+	if (c == ',') {
+		reader->position++;
+		*more = true;
+		return true;
+	}
+
+	if (c == close) {
+		reader->position++;
+		*more = false;
+		return true;
+	}
+
+	json_error(reader, (close == '}') ? "',' or '}'" : "',' or ']'");
+	return false;
+}
+
+
+// Read the key of the next member of an object
+static bool json_key(json_reader_t *reader, string_view_t *key) {
+	return json_string(reader, key) && json_expect(reader, ':');
+}
+
+
+// Skip a number, true, false or null
+static bool json_skip_literal(json_reader_t *reader) {
+	size_t start = reader->position;
+
+	while (reader->position < reader->size) {
+		char c = reader->data[reader->position];
+
+		if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+			break;
+		}
+
+		reader->position++;
+	}
+
+	if (reader->position == start) {
+		json_error(reader, "a value");
+		return false;
+	}
+
+	return true;
+}
+
+
+// Skip a value. The objects and arrays it's nested in are kept on a stack of the
+// characters closing them, so deep nesting can't overflow the call stack.
+static bool json_skip(json_reader_t *reader) {
+	char *closes = NULL;
+	size_t depth = 0;
+	size_t size = 0;
+
+	bool valid = true;
+	string_view_t view;
+
+	while (valid) {
+		char c = json_peek(reader);
+
+		if (c == '{' || c == '[') {
+			char close = (c == '{') ? '}' : ']';
+			bool empty;
+
+			valid = json_open(reader, c, close, &empty);
+
+			// Go into the first member, objects have a key before it
+			if (valid && ! empty) {
+				if (depth == size) {
+					size = (size == 0) ? 16 : 2 * size;
+					closes = realloc(closes, size);
+					assert_not_null(closes);
+				}
+
+				closes[depth++] = close;
+				valid = (close == ']') || json_key(reader, &view);
+				continue;
+			}
+		}
+		else if (c == '"') {
+			valid = json_string(reader, &view);
+		}
+		else {
+			valid = json_skip_literal(reader);
+		}
+
+		// After a value, close everything that ends with it
+		bool more = false;
+
+		while (valid && depth > 0 && ! more) {
+			valid = json_next(reader, closes[depth - 1], &more);
+			depth -= valid && ! more;
+		}
+
+		if (! valid || depth == 0) {
+			break;
+		}
+
+		if (closes[depth - 1] == '}') {
+			valid = json_key(reader, &view);
+		}
+	}
+
+	free(closes);
+
+	return valid;
+}
+
+
+
+static bool read_json_custom(json_reader_t *reader, json_custom_t *custom);
+
+
+// Read the gates and wires of a circuit at the current position
+static bool read_json_lists(json_reader_t *reader, json_gate_t **gates, size_t *amount_gates, json_wire_t **wires, size_t *amount_wires) {
+	FUNC_START();
+
+	size_t gates_size = 0;
+	size_t wires_size = 0;
+
+	bool more;
+
+	if (! json_open(reader, '{', '}', &more)) {
+		FUNC_END();
+		return false;
+	}
+
+	for (more = ! more; more;) {
+		string_view_t key;
+
+		if (! json_key(reader, &key)) {
+			FUNC_END();
+			return false;
+		}
+
+
+		// example:  "gates": { "a5987c34": { "type": "IN" }, ... }
+		if (string_view_equals(key, "gates")) {
+			bool more_gates;
+
+			if (! json_open(reader, '{', '}', &more_gates)) {
+				FUNC_END();
+				return false;
+			}
+
+			for (more_gates = ! more_gates; more_gates;) {
+				if (*amount_gates == gates_size) {
+					gates_size = (gates_size == 0) ? 16 : 2 * gates_size;
+					*gates = realloc(*gates, gates_size * sizeof(json_gate_t));
+					assert_not_null(*gates);
+				}
+
+				json_gate_t *gate = &(*gates)[(*amount_gates)++];
+				gate->type.start = NULL;
+
+				bool more_fields;
+
+				if (! json_key(reader, &gate->name) || ! json_open(reader, '{', '}', &more_fields)) {
+					FUNC_END();
+					return false;
+				}
+
+				for (more_fields = ! more_fields; more_fields;) {
+					string_view_t field;
+
+					if (! json_key(reader, &field)) {
+						FUNC_END();
+						return false;
+					}
+
+					bool valid = string_view_equals(field, "type") ? json_string(reader, &gate->type) : json_skip(reader);
+
+					if (! valid || ! json_next(reader, '}', &more_fields)) {
+						FUNC_END();
+						return false;
+					}
+				}
+
+				if (gate->type.start == NULL) {
+					json_error(reader, "a type for every gate");
+					FUNC_END();
+					return false;
+				}
+
+				if (! json_next(reader, '}', &more_gates)) {
+					FUNC_END();
+					return false;
+				}
+			}
+		}
+
+
+		// example:  "wires": [ { "a": "a5987c34:I0", "b": "18286b9b:I1" }, ... ]
+		else if (string_view_equals(key, "wires")) {
+			bool more_wires;
+
+			if (! json_open(reader, '[', ']', &more_wires)) {
+				FUNC_END();
+				return false;
+			}
+
+			for (more_wires = ! more_wires; more_wires;) {
+				if (*amount_wires == wires_size) {
+					wires_size = (wires_size == 0) ? 16 : 2 * wires_size;
+					*wires = realloc(*wires, wires_size * sizeof(json_wire_t));
+					assert_not_null(*wires);
+				}
+
+				json_wire_t *wire = &(*wires)[(*amount_wires)++];
+				bool found[2] = { false, false };
+
+				bool more_fields;
+
+				if (! json_open(reader, '{', '}', &more_fields)) {
+					FUNC_END();
+					return false;
+				}
+
+				for (more_fields = ! more_fields; more_fields;) {
+					string_view_t field;
+					string_view_t end;
+
+					if (! json_key(reader, &field)) {
+						FUNC_END();
+						return false;
+					}
+
+					bool is_a = string_view_equals(field, "a");
+					bool is_b = string_view_equals(field, "b");
+					bool valid;
+
+					if (is_a || is_b) {
+						string_view_t *side = is_a ? wire->a : wire->b;
+
+						valid = json_string(reader, &end);
+						found[is_b] = true;
+
+						if (valid && ! string_view_split(end, ':', &side[0], &side[1])) {
+							json_error(reader, "\"gate:port\"");
+							valid = false;
+						}
+					}
+					else {
+						valid = json_skip(reader);
+					}
+
+					if (! valid || ! json_next(reader, '}', &more_fields)) {
+						FUNC_END();
+						return false;
+					}
+				}
+
+				if (! found[0] || ! found[1]) {
+					json_error(reader, "both ends of every wire");
+					FUNC_END();
+					return false;
+				}
+
+				if (! json_next(reader, ']', &more_wires)) {
+					FUNC_END();
+					return false;
+				}
+			}
+		}
+
+		else if (! json_skip(reader)) {
+			FUNC_END();
+			return false;
+		}
+
+
+		if (! json_next(reader, '}', &more)) {
+			FUNC_END();
+			return false;
+		}
+	}
+
+	FUNC_END();
+	return true;
+}
+
+
+// Build the circuit at the given position, building the custom gates it uses first
+static bool read_json_circuit(json_reader_t *reader, size_t position, circuit_t *circ) {
+	FUNC_START();
+
+	json_gate_t *gates = NULL;
+	size_t amount_gates = 0;
+	json_wire_t *wires = NULL;
+	size_t amount_wires = 0;
+
+	reader->position = position;
+
+	bool success = read_json_lists(reader, &gates, &amount_gates, &wires, &amount_wires);
+
+
+	// Custom gates can be used before they're defined
+	for (size_t i = 0; success && i < amount_gates; i++) {
+		char *type = intern_n(gates[i].type.start, gates[i].type.length);
+
+		if (gate_get_kind(type) != GateKind_CUSTOM) {
+			continue;
+		}
+
+		json_custom_t *custom = hex_hashmap_find_item(&reader->customs_by_name, type);
+
+		if (custom != NULL) {
+			success &= read_json_custom(reader, custom);
+		}
+	}
+
+
+	// Create all gates, IO gates get their ports once their name is known
+	for (size_t i = 0; success && i < amount_gates; i++) {
+		gate_t *g = malloc(sizeof(gate_t));
+		gate_init(g);
+
+		g->name = intern_n(gates[i].name.start, gates[i].name.length);
+		g->type = intern_n(gates[i].type.start, gates[i].type.length);
+
+		GateKind_t kind = gate_get_kind(g->type);
+
+		if (kind != GateKind_IN && kind != GateKind_OUT) {
+			success &= gate_set_ports(g, NULL, reader->library);
+		}
+
+		if (hex_hashmap_contains_item(&circ->gates, g->name)) {
+			warn("%s: gate %s is defined twice", reader->filename, g->name);
+			gate_free(g);
+			free(g);
+			success = false;
+			break;
+		}
+
+		success &= hex_hashmap_add_item(&circ->gates, g->name, g);
+	}
+
+
+	// The name of an IO port is only found in the wires connected to it
+	for (size_t i = 0; success && i < amount_wires; i++) {
+		string_view_t *ends[2] = { wires[i].a, wires[i].b };
+
+		for (size_t j = 0; j < 2; j++) {
+			char *name = intern_lookup_n(ends[j][0].start, ends[j][0].length);
+			gate_t *g = (name != NULL) ? hex_hashmap_find_item(&circ->gates, name) : NULL;
+
+			if (g != NULL && g->ports.amount == 0) {
+				success &= gate_set_ports(g, intern_n(ends[j][1].start, ends[j][1].length), NULL);
+			}
+		}
+	}
+
+	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *g) {
+		if (success && g->ports.amount == 0) {
+			success &= gate_set_ports(g, NULL, NULL);
+		}
+	}
+
+
+	for (size_t i = 0; success && i < amount_wires; i++) {
+		wire_t w = {
+			.leftuuid = intern_n(wires[i].a[0].start, wires[i].a[0].length),
+			.leftport = intern_n(wires[i].a[1].start, wires[i].a[1].length),
+			.rightuuid = intern_n(wires[i].b[0].start, wires[i].b[0].length),
+			.rightport = intern_n(wires[i].b[1].start, wires[i].b[1].length)
+		};
+
+		success &= circuit_apply_wire(circ, &w);
+	}
+
+	if (success) {
+		success &= loops_check(circ) && circuit_update_state(circ);
+	}
+
+
+	free(gates);
+	free(wires);
+
+	FUNC_END();
+	return success;
+}
+
+
+static bool read_json_custom(json_reader_t *reader, json_custom_t *custom) {
+	FUNC_START();
+
+	if (custom->state == JsonCustomState_BUILT) {
+		FUNC_END();
+		return true;
+	}
+
+	if (custom->state == JsonCustomState_BUILDING) {
+		warn("%s: custom gate %.*s contains itself", reader->filename, (int) custom->name.length, custom->name.start);
+		FUNC_END();
+		return false;
+	}
+
+	char *name = intern_n(custom->name.start, custom->name.length);
+
+	// Exports repeat the custom gates they use, the first one read is kept
+	if (library_contains(reader->library, name)) {
+		custom->state = JsonCustomState_BUILT;
+		FUNC_END();
+		return true;
+	}
+
+	custom->state = JsonCustomState_BUILDING;
+
+	circuit_t *circ = malloc(sizeof(circuit_t));
+	circuit_init(circ);
+	circ->name = name;
+
+	size_t position = reader->position;
+	bool success = read_json_circuit(reader, custom->position, circ);
+	reader->position = position;
+
+	if (success) {
+		assert(library_add(reader->library, circ, true));
+	}
+	else {
+		circuit_free(circ);
+		free(circ);
+	}
+
+	custom->state = JsonCustomState_BUILT;
+
+	FUNC_END();
+	return success;
+}
+
+
+// Find the circuit and all custom gates in the file, without building anything yet
+static bool read_json_index(json_reader_t *reader, string_view_t *name, size_t *circuit) {
+	FUNC_START();
+
+	size_t customs_size = 0;
+	bool more;
+
+	if (! json_open(reader, '{', '}', &more)) {
+		FUNC_END();
+		return false;
+	}
+
+	for (more = ! more; more;) {
+		string_view_t key;
+
+		if (! json_key(reader, &key)) {
+			FUNC_END();
+			return false;
+		}
+
+		bool valid = true;
+
+		if (string_view_equals(key, "name")) {
+			valid = json_string(reader, name);
+		}
+
+		else if (string_view_equals(key, "circuit")) {
+			json_peek(reader);
+			*circuit = reader->position;
+			valid = json_skip(reader);
+		}
+
+		// example:  "customGates": { "XOR": { "gates": ..., "wires": ... }, ... }
+		else if (string_view_equals(key, "customGates")) {
+			bool more_customs;
+			valid = json_open(reader, '{', '}', &more_customs);
+
+			for (more_customs = ! more_customs; valid && more_customs;) {
+				if (reader->amount_customs == customs_size) {
+					customs_size = (customs_size == 0) ? 16 : 2 * customs_size;
+					reader->customs = realloc(reader->customs, customs_size * sizeof(json_custom_t));
+					assert_not_null(reader->customs);
+				}
+
+				json_custom_t *custom = &reader->customs[reader->amount_customs++];
+
+				custom->state = JsonCustomState_UNBUILT;
+
+				valid = json_key(reader, &custom->name);
+
+				if (valid) {
+					json_peek(reader);
+					custom->position = reader->position;
+					valid = json_skip(reader) && json_next(reader, '}', &more_customs);
+				}
+			}
+		}
+
+		else {
+			valid = json_skip(reader);
+		}
+
+		if (! valid || ! json_next(reader, '}', &more)) {
+			FUNC_END();
+			return false;
+		}
+	}
+
+	FUNC_END();
+	return true;
+}
+
+
+// Read a circuit exported by the editor. The custom gates it defines are added to
+// the library when given, and other custom gates are looked up in it.
+bool read_json(char *filename, circuit_t *circ, library_t *library) {
+	FUNC_START();
+
+	assert_not_null(filename);
+	assert_not_null(circ);
+
+	tokenizer_t file;
+
+	if (! tokenizer_open(&file, filename)) {
+		FUNC_END();
+		return false;
+	}
+
+	// Without a library, the custom gates are only kept while reading
+	library_t local;
+
+	if (library == NULL) {
+		library_init(&local);
+		library = &local;
+	}
+
+	json_reader_t reader = {
+		.filename = filename,
+		.data = file.data,
+		.size = file.size,
+		.position = 0,
+		.customs = NULL,
+		.amount_customs = 0,
+		.library = library
+	};
+
+
+	string_view_t name = { .start = NULL, .length = 0 };
+	size_t position = (size_t) -1;
+
+	hex_hashmap_init(&reader.customs_by_name);
+
+	bool success = read_json_index(&reader, &name, &position);
+
+	// Gates find their custom gate by name, the first one with a name is used
+	for (size_t i = 0; success && i < reader.amount_customs; i++) {
+		char *custom_name = intern_n(reader.customs[i].name.start, reader.customs[i].name.length);
+
+		if (hex_hashmap_find_item(&reader.customs_by_name, custom_name) == NULL) {
+			assert(hex_hashmap_add_item(&reader.customs_by_name, custom_name, &reader.customs[i]));
+		}
+	}
+
+	if (success && position == (size_t) -1) {
+		warn("%s: no circuit", filename);
+		success = false;
+	}
+
+
+	if (success) {
+		// Older exports don't have a name, so use the name of the file
+		if (name.start == NULL) {
+			char *base = strrchr(filename, '/');
+			name.start = (base != NULL) ? base + 1 : filename;
+
+			char *extension = strchr(name.start, '.');
+			name.length = (extension != NULL) ? (size_t) (extension - name.start) : strlen(name.start);
+		}
+
+		circ->name = intern_n(name.start, name.length);
+
+		// Also build the custom gates that aren't used, so the whole library is loaded
+		for (size_t i = 0; success && i < reader.amount_customs; i++) {
+			success &= read_json_custom(&reader, &reader.customs[i]);
+		}
+
+		if (success) {
+			success &= read_json_circuit(&reader, position, circ);
+		}
+	}
+
+
+	free(reader.customs);
+	hex_hashmap_free(&reader.customs_by_name);
+
+	if (library == &local) {
+		library_free(&local);
+	}
+
+	tokenizer_close(&file);
+
+
+	FUNC_END();
+	return success;
+}
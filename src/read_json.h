@@ -0,0 +1,11 @@
+#ifndef READ_JSON_H
+#define READ_JSON_H
+
+
+#include "library.h"
+
+
+bool read_json(char *filename, circuit_t *circ, library_t *library);
+
+
+#endif
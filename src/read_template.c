@@ -2,74 +2,96 @@
 
 #include "assert.h"
 #include "benchmark.h"
+#include "intern.h"
+#include "loops.h"
+#include "tokenizer.h"
 
 
-bool read_template(char *filename, circuit_t *circ, vector_t *dependencies) {
+// Read the "[section] amount" line starting a section
+static bool read_template_section(tokenizer_t *tokenizer, char *section, size_t *amount) {
 	FUNC_START();
 
-	assert_not_null(filename);
-	assert_not_null(circ);
+	string_view_t tokens[2];
+
+	if (tokenizer_next_line(tokenizer, tokens, 2) != 2 || ! string_view_equals(tokens[0], section) || ! string_view_to_size(tokens[1], amount)) {
+		warn("%s:%lu: expected '%s <amount>'", tokenizer->filename, tokenizer->line, section);
+		FUNC_END();
+		return false;
+	}
+
+	FUNC_END();
+	return true;
+}
+
+
+// Parse a template, and build it into the circuit. Without a circuit, it's only parsed,
+// and the custom gate types are collected in types when given.
+static bool read_template_tokens(tokenizer_t *tokenizer, circuit_t *circ, library_t *library, hex_hashmap_t *types) {
+	FUNC_START();
 
-	// Temporary buffer
-	char buf[BUF_SIZE];
+	string_view_t tokens[3];
 
 	bool success = true;
 
-	// Open file
-	FILE *file = fopen(filename, "r");
-	assert_not_null(file);
 
 	// Get name, which is always the first thing in a file
 	// example: NAND
-	circ->name = malloc(BUF_SIZE);
-	fscanf(file, "%s\n", circ->name);
+	if (tokenizer_next_line(tokenizer, tokens, 3) != 1) {
+		warn("%s:%lu: expected the name of the template", tokenizer->filename, tokenizer->line);
+		FUNC_END();
+		return false;
+	}
+
+	if (circ != NULL) {
+		circ->name = intern_n(tokens[0].start, tokens[0].length);
+	}
 
 
 	// Get gates, which are always second
 	// example:  [gates] 16
 	size_t amount_gates;
 
-	fscanf(file, "%s %lu\n", buf, &amount_gates);
-
-	if (strcmp(buf, "[gates]") != 0) {
-		panic("no [gates]?? %s unexpected", buf);
+	if (! read_template_section(tokenizer, "[gates]", &amount_gates)) {
 		FUNC_END();
 		return false;
 	}
 
 
 	for (size_t i = 0; i < amount_gates; i++) {
-		char *name = malloc(BUF_SIZE);
-		char *type = malloc(BUF_SIZE);
-		char *portname = malloc(BUF_SIZE);
-
-		// Get data
+		// Get data, only IO gates have a portname
 		// example:  5cf6cdaa IN #I0
-		int read_arguments = fscanf(file, "%s %s #%s\n", name, type, portname);
-
-		// If no portname is read, free it
 		// example:  6306ee7f NOT
-		if (read_arguments == 2) {
-			free(portname);
-			portname = NULL;
-		}
+		size_t amount = tokenizer_next_line(tokenizer, tokens, 3);
 
-		if (read_arguments == -1) {
-			// Unexpected end of file
-			panic("EOF??");
+		if (amount < 2 || amount > 3 || (amount == 3 && (tokens[2].length < 2 || tokens[2].start[0] != '#'))) {
+			warn("%s:%lu: expected gate %lu of %lu", tokenizer->filename, tokenizer->line, i + 1, amount_gates);
 			FUNC_END();
 			return false;
 		}
 
+		if (circ == NULL) {
+			if (types != NULL) {
+				char *type = intern_n(tokens[1].start, tokens[1].length);
+
+				if (gate_get_kind(type) == GateKind_CUSTOM && ! hex_hashmap_contains_item(types, type)) {
+					assert(hex_hashmap_add_item(types, type, type));
+				}
+			}
+
+			continue;
+		}
+
 		// New gate
 		gate_t *g = malloc(sizeof(gate_t));
 		gate_init(g);
 
-		g->name = name;
-		g->type = type;
+		g->name = intern_n(tokens[0].start, tokens[0].length);
+		g->type = intern_n(tokens[1].start, tokens[1].length);
+
+		char *portname = (amount == 3) ? intern_n(tokens[2].start + 1, tokens[2].length - 1) : NULL;
 
 		// Set the correct ports
-		success &= gate_set_ports(g, portname, dependencies);
+		success &= gate_set_ports(g, portname, library);
 
 		// Add gate to circuit
 		assert(hex_hashmap_add_item(&circ->gates, g->name, g));
@@ -80,61 +102,146 @@ bool read_template(char *filename, circuit_t *circ, vector_t *dependencies) {
 	// example:  [wires] 20
 	size_t amount_wires;
 
-	fscanf(file, "%s %lu\n", buf, &amount_wires);
-
-	if (strcmp(buf, "[wires]") != 0) {
-		panic("no [wires]?? %s unexpected", buf);
+	if (! read_template_section(tokenizer, "[wires]", &amount_wires)) {
 		FUNC_END();
 		return false;
 	}
 
 
-	// Create new wire
-	wire_t *w = malloc(sizeof(wire_t));
-	wire_init(w);
-
-	char *leftuuid = malloc(BUF_SIZE);
-	char *leftport = malloc(BUF_SIZE);
-	char *rightuuid = malloc(BUF_SIZE);
-	char *rightport = malloc(BUF_SIZE);
-
-
 	for (size_t i = 0; i < amount_wires; i++) {
 		// example:  da2ecd25:O0 eec2fc01:I0
-		int x = fscanf(file, "%[a-f0-9]:%s %[a-f0-9]:%s\n", leftuuid, leftport, rightuuid, rightport);
-
-		if (x == -1) {
-			// Unexpected end of file
-			panic("EOF??");
+		string_view_t left[2];
+		string_view_t right[2];
+
+		if (
+			tokenizer_next_line(tokenizer, tokens, 3) != 2 ||
+			! string_view_split(tokens[0], ':', &left[0], &left[1]) ||
+			! string_view_split(tokens[1], ':', &right[0], &right[1])
+		) {
+			warn("%s:%lu: expected wire %lu of %lu", tokenizer->filename, tokenizer->line, i + 1, amount_wires);
 			FUNC_END();
 			return false;
 		}
 
-		w->leftuuid = leftuuid;
-		w->leftport = leftport;
-		w->rightuuid = rightuuid;
-		w->rightport = rightport;
+		if (circ == NULL) {
+			continue;
+		}
+
+		// The names are already interned when the gates exist
+		wire_t w = {
+			.leftuuid = intern_n(left[0].start, left[0].length),
+			.leftport = intern_n(left[1].start, left[1].length),
+			.rightuuid = intern_n(right[0].start, right[0].length),
+			.rightport = intern_n(right[1].start, right[1].length)
+		};
 
 		// Apply wire to circuit
-		success &= circuit_apply_wire(circ, w);
+		success &= circuit_apply_wire(circ, &w);
+	}
+
+
+	// Nothing may follow the wires
+	if (tokenizer_next_line(tokenizer, tokens, 3) != 0) {
+		warn("%s:%lu: expected the end of the file after %lu wires", tokenizer->filename, tokenizer->line, amount_wires);
+		success = false;
+	}
+
+
+	FUNC_END();
+	return success;
+}
+
+
+bool read_template(char *filename, circuit_t *circ, library_t *library) {
+	FUNC_START();
+
+	assert_not_null(filename);
+	assert_not_null(circ);
+
+	tokenizer_t tokenizer;
+
+	if (! tokenizer_open(&tokenizer, filename)) {
+		FUNC_END();
+		return false;
 	}
 
-	// Free wire
-	wire_free(w);
-	free(w);
+	bool success = read_template_tokens(&tokenizer, circ, library, NULL);
 
-	// Close template file
-	fclose(file);
+	tokenizer_close(&tokenizer);
 
 
 	// circuit_print(circ, 0);
 
 
-	// Make sure all gates are in the right state
-	// NOTE: This will crash if a contradicting loop occurs in the program
+	// Make sure all gates are in the right state, oscillating loops would never settle
 	//   example: NOT:I0 <---> NOT:O0
-	success &= circuit_update_state(circ);
+	if (loops_check(circ)) {
+		success &= circuit_update_state(circ);
+	}
+	else {
+		success = false;
+	}
+
+
+	FUNC_END();
+	return success;
+}
+
+
+// Only check whether a template is valid, without building it
+bool read_template_parse(char *filename) {
+	FUNC_START();
+
+	assert_not_null(filename);
+
+	tokenizer_t tokenizer;
+
+	if (! tokenizer_open(&tokenizer, filename)) {
+		FUNC_END();
+		return false;
+	}
+
+	bool success = read_template_tokens(&tokenizer, NULL, NULL, NULL);
+
+	tokenizer_close(&tokenizer);
+
+	FUNC_END();
+	return success;
+}
+
+
+// Find the custom gate types a template uses, without building it
+bool read_template_dependencies(char *filename, hex_hashmap_t *types) {
+	FUNC_START();
+
+	assert_not_null(filename);
+	assert_not_null(types);
+
+	tokenizer_t tokenizer;
+
+	if (! tokenizer_open(&tokenizer, filename)) {
+		FUNC_END();
+		return false;
+	}
+
+	bool success = read_template_tokens(&tokenizer, NULL, NULL, types);
+
+	tokenizer_close(&tokenizer);
+
+	FUNC_END();
+	return success;
+}
+
+
+// Read a template, and inline all of its custom gates
+bool read_template_flat(char *filename, circuit_t *circ, library_t *library) {
+	FUNC_START();
+
+	bool success = read_template(filename, circ, library);
 
+	if (success) {
+		success &= circuit_flatten(circ);
+	}
 
 	FUNC_END();
 	return success;
@@ -2,10 +2,13 @@
 #define READ_TEMPLATE_H
 
 
-#include "circuit.h"
+#include "library.h"
 
 
-bool read_template(char *filename, circuit_t *circ, vector_t *dependencies);
+bool read_template(char *filename, circuit_t *circ, library_t *library);
+bool read_template_flat(char *filename, circuit_t *circ, library_t *library);
+bool read_template_parse(char *filename);
+bool read_template_dependencies(char *filename, hex_hashmap_t *types);
 
 
 #endif
@@ -0,0 +1,715 @@
+#include "runner.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "jit.h"
+#include "loader.h"
+#include "read_json.h"
+#include "read_template.h"
+#include "thread_pool.h"
+
+
+// Where the text parser is in the input, kept between batches
+typedef struct runner_reader {
+	char buf[RUNNER_IO_SIZE];
+	size_t position;
+	size_t amount;
+	size_t line;
+} runner_reader_t;
+
+
+static void runner_queue_push(runner_queue_t *queue, runner_batch_t *batch) {
+	pthread_mutex_lock(&queue->lock);
+
+	// There are never more batches than fit in a queue
+	assert(queue->amount < RUNNER_BATCHES);
+
+	queue->batches[(queue->start + queue->amount) % RUNNER_BATCHES] = batch;
+	queue->amount++;
+
+	pthread_cond_signal(&queue->changed);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+
+static runner_batch_t *runner_queue_pop(runner_queue_t *queue) {
+	pthread_mutex_lock(&queue->lock);
+
+	while (queue->amount == 0) {
+		pthread_cond_wait(&queue->changed, &queue->lock);
+	}
+
+	runner_batch_t *batch = queue->batches[queue->start];
+
+	queue->start = (queue->start + 1) % RUNNER_BATCHES;
+	queue->amount--;
+
+	pthread_mutex_unlock(&queue->lock);
+
+	return batch;
+}
+
+
+static void runner_queue_init(runner_queue_t *queue) {
+	queue->start = 0;
+	queue->amount = 0;
+
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->changed, NULL);
+}
+
+
+static void runner_queue_free(runner_queue_t *queue) {
+	pthread_mutex_destroy(&queue->lock);
+	pthread_cond_destroy(&queue->changed);
+}
+
+
+// A vector ends at a newline or at the end of the input, where empty lines are skipped
+static bool runner_end_vector(runner_t *runner, runner_reader_t *reader, size_t *vector, size_t *column) {
+	if (*column == 0) {
+		return true;
+	}
+
+	if (*column != runner->netlist.amount_inputs) {
+		warn("Line %lu of %s has %lu inputs instead of %lu", reader->line, runner->input_name, *column, runner->netlist.amount_inputs);
+		return false;
+	}
+
+	(*vector)++;
+	*column = 0;
+
+	return true;
+}
+
+
+// Fill a batch from text, a vector never spans two batches
+static void runner_parse_text(runner_t *runner, runner_reader_t *reader, runner_batch_t *batch) {
+	size_t words = runner->words;
+	size_t amount_inputs = runner->netlist.amount_inputs;
+
+	size_t vector = 0;
+	size_t column = 0;
+	bool comment = false;
+
+	while (vector < runner->batch_size) {
+		if (reader->position == reader->amount) {
+			reader->amount = fread(reader->buf, 1, RUNNER_IO_SIZE, runner->input);
+			reader->position = 0;
+
+			if (reader->amount == 0) {
+				runner->parse_success &= runner_end_vector(runner, reader, &vector, &column);
+				batch->last = true;
+				break;
+			}
+		}
+
+		char c = reader->buf[reader->position++];
+
+		if (comment && c != '\n') {
+			continue;
+		}
+
+		switch (c) {
+			case '0':
+			case '1':
+				if (column == amount_inputs) {
+					warn("Line %lu of %s has more than %lu inputs", reader->line, runner->input_name, amount_inputs);
+					runner->parse_success = false;
+					break;
+				}
+
+				batch->inputs[column * words + vector / PATTERN_WORD_BITS] |= (uint64_t) (c - '0') << (vector % PATTERN_WORD_BITS);
+				column++;
+				continue;
+
+			case '\n':
+				comment = false;
+
+				if (! runner_end_vector(runner, reader, &vector, &column)) {
+					runner->parse_success = false;
+					break;
+				}
+
+				reader->line++;
+				continue;
+
+			case '#':
+				comment = true;
+				continue;
+
+			case ' ':
+			case '\t':
+			case '\r':
+			case '_':
+				continue;
+
+			default:
+				warn("Line %lu of %s has an unexpected character 0x%02x", reader->line, runner->input_name, (unsigned char) c);
+				runner->parse_success = false;
+				break;
+		}
+
+		// Only errors get here
+		batch->last = true;
+		break;
+	}
+
+	batch->amount = vector;
+}
+
+
+static void runner_parse_binary(runner_t *runner, runner_batch_t *batch) {
+	size_t words = runner->words;
+	size_t bytes = runner->input_bytes;
+
+	// Without inputs there is nothing to read
+	if (bytes == 0) {
+		batch->amount = 0;
+		batch->last = true;
+		return;
+	}
+
+	size_t amount = fread(batch->buffer, 1, runner->batch_size * bytes, runner->input);
+
+	if (amount < runner->batch_size * bytes) {
+		batch->last = true;
+
+		if (amount % bytes != 0) {
+			warn("%s ends in the middle of a vector", runner->input_name);
+			runner->parse_success = false;
+		}
+	}
+
+	batch->amount = amount / bytes;
+
+	for (size_t vector = 0; vector < batch->amount; vector++) {
+		uint8_t *packed = &batch->buffer[vector * bytes];
+		size_t word = vector / PATTERN_WORD_BITS;
+		unsigned int bit = vector % PATTERN_WORD_BITS;
+
+		for (size_t i = 0; i < runner->netlist.amount_inputs; i++) {
+			batch->inputs[i * words + word] |= (uint64_t) ((packed[i / 8] >> (i % 8)) & 1) << bit;
+		}
+	}
+}
+
+
+static void *runner_parse(void *arg) {
+	runner_t *runner = arg;
+
+	runner_reader_t *reader = malloc(sizeof(runner_reader_t));
+	assert_not_null(reader);
+
+	reader->position = 0;
+	reader->amount = 0;
+	reader->line = 1;
+
+	bool last = false;
+
+	while (! last) {
+		runner_batch_t *batch = runner_queue_pop(&runner->empty);
+
+		memset(batch->inputs, 0, runner->netlist.amount_inputs * runner->words * sizeof(uint64_t));
+		batch->last = false;
+
+		if (runner->format == RunnerFormat_TEXT) {
+			runner_parse_text(runner, reader, batch);
+		}
+		else {
+			runner_parse_binary(runner, batch);
+		}
+
+		if (ferror(runner->input)) {
+			warn("Failed to read %s", runner->input_name);
+			runner->parse_success = false;
+			batch->last = true;
+		}
+
+		last = batch->last;
+		runner_queue_push(&runner->parsed, batch);
+	}
+
+	free(reader);
+
+	return NULL;
+}
+
+
+static void runner_write_batch(runner_t *runner, runner_batch_t *batch) {
+	size_t words = runner->words;
+	size_t amount_outputs = runner->netlist.amount_outputs;
+	size_t size = 0;
+
+	for (size_t vector = 0; vector < batch->amount; vector++) {
+		size_t word = vector / PATTERN_WORD_BITS;
+		unsigned int bit = vector % PATTERN_WORD_BITS;
+
+		if (runner->format == RunnerFormat_TEXT) {
+			for (size_t i = 0; i < amount_outputs; i++) {
+				batch->buffer[size++] = (uint8_t) ('0' + ((batch->outputs[i * words + word] >> bit) & 1));
+			}
+
+			batch->buffer[size++] = '\n';
+		}
+		else {
+			uint8_t *packed = &batch->buffer[size];
+			memset(packed, 0, runner->output_bytes);
+
+			for (size_t i = 0; i < amount_outputs; i++) {
+				packed[i / 8] |= (uint8_t) (((batch->outputs[i * words + word] >> bit) & 1) << (i % 8));
+			}
+
+			size += runner->output_bytes;
+		}
+	}
+
+	if (size > 0 && fwrite(batch->buffer, 1, size, runner->output) != size) {
+		runner->write_success = false;
+	}
+}
+
+
+static void *runner_write(void *arg) {
+	runner_t *runner = arg;
+
+	while (true) {
+		runner_batch_t *batch = runner_queue_pop(&runner->simulated);
+
+		// After a failed write the batches are only passed on
+		if (runner->write_success) {
+			runner_write_batch(runner, batch);
+		}
+
+		runner->amount_vectors += batch->amount;
+		runner->amount_batches++;
+
+		if (batch->last) {
+			break;
+		}
+
+		runner_queue_push(&runner->empty, batch);
+	}
+
+	if (fflush(runner->output) != 0 || ! runner->write_success) {
+		warn("Failed to write %s", runner->output_name);
+		runner->write_success = false;
+	}
+
+	return NULL;
+}
+
+
+// The arguments after the name of the program, see runner_usage
+bool runner_parse_args(runner_t *runner, int argc, char *argv[]) {
+	FUNC_START();
+
+	assert_not_null(runner);
+
+	for (int i = 1; i < argc; i++) {
+		char *arg = argv[i];
+
+		// Every option but -b has a value
+		if (arg[0] == '-' && strcmp(arg, "-b") != 0 && i + 1 == argc) {
+			warn("Missing the value of %s", arg);
+			FUNC_END();
+			return false;
+		}
+
+		switch_str(arg) {
+			case_str("-L") {
+				library_add_path(&runner->library, argv[++i]);
+			}
+			else case_str("-i") {
+				runner->input_name = argv[++i];
+			}
+			else case_str("-o") {
+				runner->output_name = argv[++i];
+			}
+			else case_str("-b") {
+				runner->format = RunnerFormat_BINARY;
+			}
+			else case_str("-n") {
+				char *end;
+				runner->batch_size = strtoul(argv[++i], &end, 10);
+
+				if (*end != '\0' || runner->batch_size == 0) {
+					warn("Invalid batch size %s", argv[i]);
+					FUNC_END();
+					return false;
+				}
+
+				// Whole words, so the pattern has no vectors that aren't in the batch
+				runner->batch_size = (runner->batch_size + PATTERN_WORD_BITS - 1) / PATTERN_WORD_BITS * PATTERN_WORD_BITS;
+			}
+			else if (arg[0] == '-') {
+				warn("Unknown option %s", arg);
+				FUNC_END();
+				return false;
+			}
+			else if (runner->template != NULL) {
+				warn("More than one template: %s and %s", runner->template, arg);
+				FUNC_END();
+				return false;
+			}
+			else {
+				runner->template = arg;
+			}
+		}
+	}
+
+	if (runner->template == NULL) {
+		warn("Missing the template");
+		FUNC_END();
+		return false;
+	}
+
+	FUNC_END();
+	return true;
+}
+
+
+// Read the template file into circuit, after loading the templates it uses on the pool
+static bool runner_read_template(runner_t *runner) {
+	FUNC_START();
+
+	char *filename = runner->template;
+
+	// JSON files contain the templates they use
+	if (library_is_json(filename)) {
+		bool success = read_json(filename, &runner->circuit, &runner->library);
+
+		FUNC_END();
+		return success;
+	}
+
+	hex_hashmap_t types;
+	hex_hashmap_init(&types);
+
+	bool success = read_template_dependencies(filename, &types);
+
+	char *names[hex_hashmap_amount(&types) + 1];
+
+	HEX_HASHMAP_EACH_KEY_INDEX(types, char *type, i) {
+		names[i] = type;
+	}
+
+	success = success && loader_load(&runner->library, names, hex_hashmap_amount(&types), thread_pool_cores());
+	success = success && read_template(filename, &runner->circuit, &runner->library);
+
+	hex_hashmap_free(&types);
+
+	FUNC_END();
+	return success;
+}
+
+
+// Read the template and everything it uses, compile it, and open the files
+bool runner_load(runner_t *runner) {
+	FUNC_START();
+
+	assert_not_null(runner);
+	assert_not_null(runner->template);
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+
+	// The directory of the template is searched after the paths of -L
+	char path[strlen(runner->template) + 1];
+	strcpy(path, runner->template);
+
+	char *name = strrchr(path, '/');
+
+	if (name == NULL) {
+		name = path;
+		library_add_path(&runner->library, ".");
+	}
+	else {
+		*name++ = '\0';
+		library_add_path(&runner->library, (path[0] == '\0') ? "/" : path);
+	}
+
+	size_t length = strlen(name);
+	size_t extension = strlen(LIBRARY_JSON_EXTENSION);
+
+	if (length > extension && strcmp(name + length - extension, LIBRARY_JSON_EXTENSION) == 0) {
+		name[length - extension] = '\0';
+	}
+
+	circuit_t *circ;
+
+	// A file is read from its path under the name it declares, which isn't always its
+	// filename. Anything else is the name of a template in the library.
+	if (access(runner->template, R_OK) == 0) {
+		circ = runner_read_template(runner) ? &runner->circuit : NULL;
+	}
+	else {
+		circ = loader_load(&runner->library, &name, 1, thread_pool_cores()) ? library_get(&runner->library, name) : NULL;
+	}
+
+	if (circ == NULL || ! netlist_compile(&runner->netlist, circ)) {
+		FUNC_END();
+		return false;
+	}
+
+
+	if (runner->input_name == NULL) {
+		runner->input_name = "stdin";
+		runner->input = stdin;
+	}
+	else if ((runner->input = fopen(runner->input_name, "rb")) == NULL) {
+		warn("Failed to open %s", runner->input_name);
+		FUNC_END();
+		return false;
+	}
+
+	if (runner->output_name == NULL) {
+		runner->output_name = "stdout";
+		runner->output = stdout;
+	}
+	else if ((runner->output = fopen(runner->output_name, "wb")) == NULL) {
+		warn("Failed to open %s", runner->output_name);
+		FUNC_END();
+		return false;
+	}
+
+	// Batches are written at once, so a bigger buffer only saves a copy
+	setvbuf(runner->output, NULL, _IOFBF, RUNNER_IO_SIZE);
+
+
+	runner->words = runner->batch_size / PATTERN_WORD_BITS;
+	runner->input_bytes = (runner->netlist.amount_inputs + 7) / 8;
+	runner->output_bytes = (runner->netlist.amount_outputs + 7) / 8;
+
+	size_t vector_bytes = runner->netlist.amount_outputs + 1;
+
+	if (runner->input_bytes > vector_bytes) {
+		vector_bytes = runner->input_bytes;
+	}
+
+	for (size_t i = 0; i < RUNNER_BATCHES; i++) {
+		runner_batch_t *batch = &runner->batches[i];
+
+		batch->amount = 0;
+		batch->inputs = calloc(runner->netlist.amount_inputs * runner->words + 1, sizeof(uint64_t));
+		batch->outputs = calloc(runner->netlist.amount_outputs * runner->words + 1, sizeof(uint64_t));
+		batch->buffer = malloc(runner->batch_size * vector_bytes);
+		batch->last = false;
+
+		assert_not_null(batch->inputs);
+		assert_not_null(batch->outputs);
+		assert_not_null(batch->buffer);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	runner->time_load = long_time(end) - long_time(start);
+
+	FUNC_END();
+	return true;
+}
+
+
+// Stream all vectors, this thread simulates while the others parse and write
+bool runner_run(runner_t *runner) {
+	FUNC_START();
+
+	assert_not_null(runner);
+	assert_not_null(runner->input);
+	assert_not_null(runner->output);
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < RUNNER_BATCHES; i++) {
+		runner_queue_push(&runner->empty, &runner->batches[i]);
+	}
+
+	pthread_t parser, writer;
+	pthread_create(&parser, NULL, runner_parse, runner);
+	pthread_create(&writer, NULL, runner_write, runner);
+
+
+	netlist_t *netlist = &runner->netlist;
+	size_t words = runner->words;
+
+	// Batches are evaluated a few words at a time by compiled code, which beats the
+	// interpreter as long as the state of every net stays in cache
+	size_t chunk = (words < JIT_MAX_WORDS) ? words : JIT_MAX_WORDS;
+
+	pattern_t pattern;
+	pattern_init(&pattern, netlist, chunk * PATTERN_WORD_BITS);
+
+	jit_t jit;
+	jit_init(&jit);
+	jit_compile(&jit, netlist, chunk);
+
+	bool last = false;
+
+	while (! last) {
+		runner_batch_t *batch = runner_queue_pop(&runner->parsed);
+		size_t batch_words = (batch->amount + PATTERN_WORD_BITS - 1) / PATTERN_WORD_BITS;
+
+		// The last chunk may be partly used, its other words are never copied out
+		for (size_t first = 0; first < batch_words; first += chunk) {
+			size_t amount = (batch_words - first < chunk) ? batch_words - first : chunk;
+
+			for (size_t i = 0; i < netlist->amount_inputs; i++) {
+				memcpy(pattern_get_net(&pattern, netlist->inputs[i].net), &batch->inputs[i * words + first], amount * sizeof(uint64_t));
+			}
+
+			jit_evaluate(&jit, &pattern);
+
+			for (size_t i = 0; i < netlist->amount_outputs; i++) {
+				memcpy(&batch->outputs[i * words + first], pattern_get_net(&pattern, netlist->outputs[i].net), amount * sizeof(uint64_t));
+			}
+		}
+
+		last = batch->last;
+		runner_queue_push(&runner->simulated, batch);
+	}
+
+	jit_free(&jit);
+	pattern_free(&pattern);
+
+	pthread_join(parser, NULL);
+	pthread_join(writer, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	runner->time_run = long_time(end) - long_time(start);
+
+	FUNC_END();
+	return runner->parse_success && runner->write_success;
+}
+
+
+// Run the streaming mode of the executable, returns the exit code
+int runner_main(int argc, char *argv[]) {
+	FUNC_START();
+
+	runner_t runner;
+	runner_init(&runner);
+
+	if (! runner_parse_args(&runner, argc, argv)) {
+		runner_usage(argv[0]);
+		runner_free(&runner);
+
+		FUNC_END();
+		return EXIT_FAILURE;
+	}
+
+	bool success = runner_load(&runner) && runner_run(&runner);
+
+	if (success) {
+		runner_print(&runner);
+	}
+
+	runner_free(&runner);
+
+	FUNC_END();
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+void runner_usage(char *program) {
+	fprintf(stderr, "usage: %s [-L dir]... [-i input] [-o output] [-b] [-n vectors] template\n", program);
+	fprintf(stderr, "  -L dir      search templates in dir, before the directory of the template\n");
+	fprintf(stderr, "  -i input    read vectors from input instead of stdin\n");
+	fprintf(stderr, "  -o output   write vectors to output instead of stdout\n");
+	fprintf(stderr, "  -b          read and write packed binary vectors instead of text\n");
+	fprintf(stderr, "  -n vectors  vectors per batch, %d by default\n", RUNNER_BATCH);
+}
+
+
+// On stderr, since stdout may be the output
+void runner_print(runner_t *runner) {
+	FUNC_START();
+
+	double load_ms = (double) runner->time_load / 1e6;
+	double run_ms = (double) runner->time_run / 1e6;
+	double rate = (runner->time_run > 0) ? (double) runner->amount_vectors / ((double) runner->time_run / 1e9) : 0;
+
+	fprintf(stderr, "%s: %lu inputs, %lu outputs, %lu ops\n", runner->netlist.name,
+		runner->netlist.amount_inputs, runner->netlist.amount_outputs, runner->netlist.amount_ops);
+	fprintf(stderr, "Loaded in %.2f ms, ran %lu vectors in %lu batches in %.2f ms, %.0f vectors/s\n",
+		load_ms, runner->amount_vectors, runner->amount_batches, run_ms, rate);
+
+	FUNC_END();
+}
+
+
+void runner_init(runner_t *runner) {
+	FUNC_START();
+
+	library_init(&runner->library);
+	netlist_init(&runner->netlist);
+	circuit_init(&runner->circuit);
+
+	runner->template = NULL;
+	runner->input_name = NULL;
+	runner->output_name = NULL;
+	runner->format = RunnerFormat_TEXT;
+	runner->batch_size = RUNNER_BATCH;
+
+	runner->input = NULL;
+	runner->output = NULL;
+
+	runner->words = 0;
+	runner->input_bytes = 0;
+	runner->output_bytes = 0;
+
+	for (size_t i = 0; i < RUNNER_BATCHES; i++) {
+		runner->batches[i] = (runner_batch_t) { 0 };
+	}
+
+	runner_queue_init(&runner->empty);
+	runner_queue_init(&runner->parsed);
+	runner_queue_init(&runner->simulated);
+
+	runner->parse_success = true;
+	runner->write_success = true;
+
+	runner->amount_vectors = 0;
+	runner->amount_batches = 0;
+	runner->time_load = 0;
+	runner->time_run = 0;
+
+	FUNC_END();
+}
+
+
+void runner_free(runner_t *runner) {
+	FUNC_START();
+
+	if (runner->input != NULL && runner->input != stdin) {
+		fclose(runner->input);
+	}
+
+	if (runner->output != NULL && runner->output != stdout) {
+		fclose(runner->output);
+	}
+	else if (runner->output == stdout) {
+		fflush(stdout);
+	}
+
+	for (size_t i = 0; i < RUNNER_BATCHES; i++) {
+		free(runner->batches[i].inputs);
+		free(runner->batches[i].outputs);
+		free(runner->batches[i].buffer);
+	}
+
+	runner_queue_free(&runner->empty);
+	runner_queue_free(&runner->parsed);
+	runner_queue_free(&runner->simulated);
+
+	netlist_free(&runner->netlist);
+	circuit_free(&runner->circuit);
+	library_free(&runner->library);
+
+	FUNC_END();
+}
@@ -0,0 +1,111 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "netlist.h"
+#include "pattern.h"
+#include "library.h"
+
+
+// Vectors in one batch when -n isn't given, always a multiple of PATTERN_WORD_BITS
+#define RUNNER_BATCH 4096
+
+// Batches passed between the threads, so parsing, simulating and writing overlap
+#define RUNNER_BATCHES 4
+
+// Bytes read or written at once
+#define RUNNER_IO_SIZE 65536
+
+
+typedef enum RunnerFormat {
+	// One vector per line of 0 and 1, in the order of the netlist, sorted by name.
+	// Spaces and underscores are skipped, and # starts a comment.
+	RunnerFormat_TEXT,
+
+	// Every vector is packed in whole bytes, where IO i is bit i % 8 of byte i / 8
+	RunnerFormat_BINARY
+} RunnerFormat_t;
+
+
+// Input and output words of a batch of vectors, one bit per vector like pattern_t
+typedef struct runner_batch {
+	size_t amount;
+
+	// The words of input i are inputs[i * words] up to inputs[(i + 1) * words]
+	uint64_t *inputs;
+	uint64_t *outputs;
+
+	// Raw binary input, and the formatted output
+	uint8_t *buffer;
+
+	// Nothing comes after this batch
+	bool last;
+} runner_batch_t;
+
+
+// A blocking queue of batches between two threads
+typedef struct runner_queue {
+	runner_batch_t *batches[RUNNER_BATCHES];
+	size_t start;
+	size_t amount;
+
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} runner_queue_t;
+
+
+// Streams vectors from a file through a compiled template to another file, where one
+// thread parses, one simulates and one writes
+typedef struct runner {
+	library_t library;
+	netlist_t netlist;
+
+	// The template when it's read from a file, the templates it uses are in library
+	circuit_t circuit;
+
+	char *template;
+	char *input_name;
+	char *output_name;
+	RunnerFormat_t format;
+	size_t batch_size;
+
+	FILE *input;
+	FILE *output;
+
+	size_t words;
+	size_t input_bytes;
+	size_t output_bytes;
+
+	runner_batch_t batches[RUNNER_BATCHES];
+	runner_queue_t empty;
+	runner_queue_t parsed;
+	runner_queue_t simulated;
+
+	// Set when parsing or writing fails, the other threads keep going until the last batch
+	bool parse_success;
+	bool write_success;
+
+	size_t amount_vectors;
+	size_t amount_batches;
+	long time_load;
+	long time_run;
+} runner_t;
+
+
+bool runner_parse_args(runner_t *runner, int argc, char *argv[]);
+bool runner_load(runner_t *runner);
+bool runner_run(runner_t *runner);
+int runner_main(int argc, char *argv[]);
+
+
+void runner_usage(char *program);
+void runner_print(runner_t *runner);
+void runner_init(runner_t *runner);
+void runner_free(runner_t *runner);
+
+
+#endif
@@ -0,0 +1,479 @@
+#include "suite.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "defines.h"
+#include "event_queue.h"
+#include "generate.h"
+#include "intern.h"
+#include "library.h"
+#include "netlist.h"
+#include "pattern.h"
+
+
+// The design that's loaded, settled and toggled
+#define SUITE_DAG_GATES 10000
+#define SUITE_DAG_INPUTS 32
+#define SUITE_DAG_DEPTH 32
+#define SUITE_DAG_FANOUT 4
+#define SUITE_SEED 1
+
+// Samples per run, the single ones are too short to measure once
+#define SUITE_SETTLES 16
+#define SUITE_TOGGLES 64
+
+// The truth table of a multiplier, with 2 * bits inputs, a chunk of vectors at a time
+#define SUITE_TRUTH_BITS 9
+#define SUITE_TRUTH_VECTORS 16384
+
+// Where the designs are written while the suite runs
+#define SUITE_DIR "build"
+
+
+suite_result_t *suite_add(suite_t *suite, char *name, char *unit, bool higher_better) {
+	FUNC_START();
+
+	assert_not_null(suite);
+	assert_not_null(name);
+	assert_not_null(unit);
+
+	if (suite->amount_results == suite->size_results) {
+		suite->size_results = (suite->size_results == 0) ? 8 : 2 * suite->size_results;
+		suite->results = realloc(suite->results, suite->size_results * sizeof(suite_result_t));
+		assert_not_null(suite->results);
+	}
+
+	suite_result_t *result = &suite->results[suite->amount_results++];
+
+	*result = (suite_result_t) {
+		.name = intern(name),
+		.unit = intern(unit),
+		.higher_better = higher_better,
+		.samples = NULL,
+		.amount_samples = 0,
+		.size_samples = 0,
+		.median = 0,
+		.p99 = 0
+	};
+
+	FUNC_END();
+	return result;
+}
+
+
+// NULL if the suite has no workload with that name
+suite_result_t *suite_get(suite_t *suite, char *name) {
+	FUNC_START();
+
+	for (size_t i = 0; i < suite->amount_results; i++) {
+		if (strcmp(suite->results[i].name, name) == 0) {
+			FUNC_END();
+			return &suite->results[i];
+		}
+	}
+
+	FUNC_END();
+	return NULL;
+}
+
+
+void suite_add_sample(suite_result_t *result, double sample) {
+	FUNC_START();
+
+	if (result->amount_samples == result->size_samples) {
+		result->size_samples = (result->size_samples == 0) ? 16 : 2 * result->size_samples;
+		result->samples = realloc(result->samples, result->size_samples * sizeof(double));
+		assert_not_null(result->samples);
+	}
+
+	result->samples[result->amount_samples++] = sample;
+
+	FUNC_END();
+}
+
+
+static int suite_compare_doubles(const void *a, const void *b) {
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+
+// Interpolated between the two closest samples, 0 without samples
+double suite_percentile(suite_result_t *result, double percentile) {
+	FUNC_START();
+
+	assert(percentile >= 0 && percentile <= 100);
+
+	if (result->amount_samples == 0) {
+		FUNC_END();
+		return 0;
+	}
+
+	double sorted[result->amount_samples];
+	memcpy(sorted, result->samples, result->amount_samples * sizeof(double));
+	qsort(sorted, result->amount_samples, sizeof(double), suite_compare_doubles);
+
+	double position = percentile / 100 * (double) (result->amount_samples - 1);
+	size_t below = (size_t) position;
+
+	if (below + 1 >= result->amount_samples) {
+		FUNC_END();
+		return sorted[result->amount_samples - 1];
+	}
+
+	double fraction = position - (double) below;
+
+	FUNC_END();
+	return sorted[below] + fraction * (sorted[below + 1] - sorted[below]);
+}
+
+
+// The p99 of a rate is the slow end, so the 1st percentile
+void suite_summarize(suite_t *suite) {
+	FUNC_START();
+
+	for (size_t i = 0; i < suite->amount_results; i++) {
+		suite_result_t *result = &suite->results[i];
+
+		result->median = suite_percentile(result, 50);
+		result->p99 = suite_percentile(result, result->higher_better ? 1 : 99);
+	}
+
+	FUNC_END();
+}
+
+
+static double suite_elapsed(struct timespec start) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (double) (long_time(end) - long_time(start));
+}
+
+
+// Load the design, then apply whole vectors and toggle single inputs
+static bool suite_run_simulation(suite_t *suite, generate_t *gen) {
+	suite_result_t *load = suite_add(suite, "load", "ms", false);
+	suite_result_t *settle = suite_add(suite, "settle", "us", false);
+	suite_result_t *toggle = suite_add(suite, "toggle", "us", false);
+
+	char name[BUF_SIZE];
+	port_t *inputs[SUITE_DAG_INPUTS];
+	struct timespec start;
+
+	srand(SUITE_SEED);
+
+	for (size_t run = 0; run < suite->runs; run++) {
+		library_t library;
+		library_init(&library);
+		library_add_path(&library, SUITE_DIR);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		circuit_t *circ = library_get(&library, generate_top(gen)->name);
+		suite_add_sample(load, suite_elapsed(start) / 1e6);
+
+		if (circ == NULL) {
+			library_free(&library);
+			return false;
+		}
+
+		for (size_t i = 0; i < SUITE_DAG_INPUTS; i++) {
+			sprintf(name, "I%lu", i);
+			inputs[i] = circuit_get_io_port_by_name(circ, name);
+			assert_not_null(inputs[i]);
+		}
+
+
+		// Every input gets a new state, the queue settles after each of them
+		for (size_t i = 0; i < SUITE_SETTLES; i++) {
+			bool vector[SUITE_DAG_INPUTS];
+
+			for (size_t j = 0; j < SUITE_DAG_INPUTS; j++) {
+				vector[j] = rand() & 1;
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+			for (size_t j = 0; j < SUITE_DAG_INPUTS; j++) {
+				port_set_state(inputs[j], vector[j]);
+			}
+
+			suite_add_sample(settle, suite_elapsed(start) / 1e3);
+		}
+
+
+		for (size_t i = 0; i < SUITE_TOGGLES; i++) {
+			port_t *port = inputs[(size_t) rand() % SUITE_DAG_INPUTS];
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			port_set_state(port, ! port->state);
+			suite_add_sample(toggle, suite_elapsed(start) / 1e3);
+		}
+
+		library_free(&library);
+	}
+
+	return true;
+}
+
+
+// All input combinations of the multiplier, in vectors per second
+static bool suite_run_truth_table(suite_t *suite, generate_t *gen) {
+	suite_result_t *truth_table = suite_add(suite, "truth_table", "Mvectors/s", true);
+
+	library_t library;
+	library_init(&library);
+	library_add_path(&library, SUITE_DIR);
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+
+	circuit_t *circ = library_get(&library, generate_top(gen)->name);
+
+	if (circ == NULL || ! netlist_compile(&netlist, circ)) {
+		netlist_free(&netlist);
+		library_free(&library);
+		return false;
+	}
+
+	library_free(&library);
+
+
+	pattern_t pattern;
+	pattern_init(&pattern, &netlist, SUITE_TRUTH_VECTORS);
+
+	uint64_t vectors = (uint64_t) 1 << (2 * SUITE_TRUTH_BITS);
+	struct timespec start;
+
+	for (size_t run = 0; run < suite->runs; run++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for (uint64_t first = 0; first < vectors; first += SUITE_TRUTH_VECTORS) {
+			pattern_set_exhaustive(&pattern, first);
+			pattern_evaluate(&pattern);
+		}
+
+		suite_add_sample(truth_table, (double) vectors / suite_elapsed(start) * 1e3);
+	}
+
+	pattern_free(&pattern);
+	netlist_free(&netlist);
+
+	return true;
+}
+
+
+// Every workload, runs times, on designs written to SUITE_DIR
+bool suite_run(suite_t *suite, size_t runs) {
+	FUNC_START();
+
+	assert_not_null(suite);
+	assert(runs > 0);
+
+	suite->runs = runs;
+
+	// Deep designs settle in one pass on the queue
+	SimEngine_t old_engine = sim_get_engine();
+	sim_set_engine(SimEngine_QUEUE);
+
+	generate_t dag, multiplier;
+	generate_init(&dag);
+	generate_init(&multiplier);
+
+	bool success = generate_random_dag(&dag, SUITE_DAG_GATES, SUITE_DAG_INPUTS, SUITE_DAG_DEPTH, SUITE_DAG_FANOUT, SUITE_SEED)
+		&& generate_multiplier(&multiplier, SUITE_TRUTH_BITS)
+		&& generate_write(&dag, SUITE_DIR, GenerateFormat_TEXT)
+		&& generate_write(&multiplier, SUITE_DIR, GenerateFormat_TEXT)
+		&& suite_run_simulation(suite, &dag)
+		&& suite_run_truth_table(suite, &multiplier);
+
+	if (! success) {
+		warn("Failed to run the benchmark suite");
+	}
+
+	generate_remove(&dag, SUITE_DIR);
+	generate_remove(&multiplier, SUITE_DIR);
+
+	generate_free(&dag);
+	generate_free(&multiplier);
+
+	sim_set_engine(old_engine);
+	suite_summarize(suite);
+
+	FUNC_END();
+	return success;
+}
+
+
+// One result per line, so suite_read_json doesn't need a full parser
+bool suite_write_json(suite_t *suite, char *filename) {
+	FUNC_START();
+
+	FILE *file = fopen(filename, "w");
+
+	if (file == NULL) {
+		warn("Failed to open \"%s\"", filename);
+		FUNC_END();
+		return false;
+	}
+
+	fprintf(file, "{\n\t\"runs\": %lu,\n\t\"results\": [\n", suite->runs);
+
+	for (size_t i = 0; i < suite->amount_results; i++) {
+		suite_result_t *result = &suite->results[i];
+
+		fprintf(file, "\t\t{\"name\": \"%s\", \"unit\": \"%s\", \"higher_better\": %s, \"samples\": %lu, \"median\": %.6g, \"p99\": %.6g}%s\n",
+			result->name, result->unit, result->higher_better ? "true" : "false",
+			result->amount_samples, result->median, result->p99,
+			(i + 1 < suite->amount_results) ? "," : "");
+	}
+
+	fprintf(file, "\t]\n}\n");
+
+	bool success = ferror(file) == 0;
+
+	if (fclose(file) != 0 || ! success) {
+		warn("Failed to write \"%s\"", filename);
+		FUNC_END();
+		return false;
+	}
+
+	FUNC_END();
+	return true;
+}
+
+
+// Results as written by suite_write_json, without their samples
+bool suite_read_json(suite_t *suite, char *filename) {
+	FUNC_START();
+
+	FILE *file = fopen(filename, "r");
+
+	if (file == NULL) {
+		warn("Failed to open \"%s\"", filename);
+		FUNC_END();
+		return false;
+	}
+
+	char line[BUF_SIZE];
+	char name[BUF_SIZE];
+	char unit[BUF_SIZE];
+	char higher_better[8];
+	size_t samples;
+	double median, p99;
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (sscanf(line, " \"runs\": %lu", &suite->runs) == 1) {
+			continue;
+		}
+
+		int amount = sscanf(line, " {\"name\": \"%255[^\"]\", \"unit\": \"%255[^\"]\", \"higher_better\": %7[a-z], \"samples\": %lu, \"median\": %lf, \"p99\": %lf}",
+			name, unit, higher_better, &samples, &median, &p99);
+
+		if (amount == 0 || amount == EOF) {
+			continue;
+		}
+
+		if (amount != 6) {
+			warn("Failed to read a result of \"%s\": %s", filename, line);
+			fclose(file);
+			FUNC_END();
+			return false;
+		}
+
+		suite_result_t *result = suite_add(suite, name, unit, strcmp(higher_better, "true") == 0);
+		result->median = median;
+		result->p99 = p99;
+	}
+
+	fclose(file);
+
+	FUNC_END();
+	return true;
+}
+
+
+// Print the medians next to the baseline, the amount of regressions beyond threshold
+size_t suite_compare(suite_t *suite, suite_t *baseline, double threshold) {
+	FUNC_START();
+
+	size_t regressions = 0;
+
+	printf("%-16s %14s %14s %9s\n", "workload", "baseline", "median", "change");
+
+	for (size_t i = 0; i < baseline->amount_results; i++) {
+		suite_result_t *base = &baseline->results[i];
+		suite_result_t *result = suite_get(suite, base->name);
+
+		if (result == NULL) {
+			printf("%-16s %14.4g %14s\n", base->name, base->median, "missing");
+			regressions++;
+			continue;
+		}
+
+		double change = (base->median == 0) ? 0 : (result->median - base->median) / base->median;
+
+		// Positive when it got worse
+		double worse = result->higher_better ? -change : change;
+		char *verdict = "";
+
+		if (worse > threshold) {
+			verdict = "REGRESSION";
+			regressions++;
+		}
+		else if (worse < -threshold) {
+			verdict = "improved";
+		}
+
+		printf("%-16s %14.4g %14.4g %+8.1f%%  %s %s\n", base->name, base->median, result->median, change * 100, result->unit, verdict);
+	}
+
+	FUNC_END();
+	return regressions;
+}
+
+
+void suite_print(suite_t *suite) {
+	FUNC_START();
+
+	printf("%-16s %8s %14s %14s\n", "workload", "samples", "median", "p99");
+
+	for (size_t i = 0; i < suite->amount_results; i++) {
+		suite_result_t *result = &suite->results[i];
+		printf("%-16s %8lu %14.4g %14.4g  %s\n", result->name, result->amount_samples, result->median, result->p99, result->unit);
+	}
+
+	FUNC_END();
+}
+
+
+void suite_init(suite_t *suite) {
+	FUNC_START();
+
+	suite->results = NULL;
+	suite->amount_results = 0;
+	suite->size_results = 0;
+	suite->runs = 0;
+
+	FUNC_END();
+}
+
+
+void suite_free(suite_t *suite) {
+	FUNC_START();
+
+	for (size_t i = 0; i < suite->amount_results; i++) {
+		free(suite->results[i].samples);
+	}
+
+	free(suite->results);
+
+	FUNC_END();
+}
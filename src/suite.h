@@ -0,0 +1,62 @@
+#ifndef SUITE_H
+#define SUITE_H
+
+
+#include <stddef.h>
+#include <stdbool.h>
+
+
+// Runs of every workload when BENCH_RUNS isn't set
+#define SUITE_RUNS 11
+
+// Relative change of a median before it counts as a regression, when BENCH_THRESHOLD isn't set
+#define SUITE_THRESHOLD 0.05
+
+
+// All samples of one workload, in the order they were measured
+typedef struct suite_result {
+	char *name;
+	char *unit;
+
+	// Rates are better when higher, times when lower
+	bool higher_better;
+
+	double *samples;
+	size_t amount_samples;
+	size_t size_samples;
+
+	// Set by suite_summarize, or read from a baseline without samples
+	double median;
+	double p99;
+} suite_result_t;
+
+
+typedef struct suite {
+	suite_result_t *results;
+	size_t amount_results;
+	size_t size_results;
+
+	size_t runs;
+} suite_t;
+
+
+suite_result_t *suite_add(suite_t *suite, char *name, char *unit, bool higher_better);
+suite_result_t *suite_get(suite_t *suite, char *name);
+void suite_add_sample(suite_result_t *result, double sample);
+
+double suite_percentile(suite_result_t *result, double percentile);
+void suite_summarize(suite_t *suite);
+
+bool suite_run(suite_t *suite, size_t runs);
+
+bool suite_write_json(suite_t *suite, char *filename);
+bool suite_read_json(suite_t *suite, char *filename);
+size_t suite_compare(suite_t *suite, suite_t *baseline, double threshold);
+
+
+void suite_print(suite_t *suite);
+void suite_init(suite_t *suite);
+void suite_free(suite_t *suite);
+
+
+#endif
@@ -1,13 +1,30 @@
 #include "test.h"
 
+#include <stdlib.h>
+
 #include "benchmark.h"
 #include "hhmtest.h"
 
 
+perf_counters_t *test_counters = NULL;
+
+
 unsigned int test_all(int argc, char *argv[]) {
 	FUNC_START();
 	TESTS_START;
 
+	// Hardware counters of every test, without the threads it starts
+	perf_counters_t counters;
+
+	if (getenv("BENCH_COUNTERS") != NULL) {
+		if (perf_counters_init(&counters)) {
+			test_counters = &counters;
+		}
+		else {
+			fprintf(stderr, "Failed to open hardware counters\n");
+		}
+	}
+
 
 	// If no tests specified, run some default tests
 	if (argc == 1) {
@@ -19,9 +36,33 @@ unsigned int test_all(int argc, char *argv[]) {
 		TEST(test_xor);
 
 		TEST(test_nested);
+		TEST(test_gate_kinds);
+		TEST(test_not_loop);
 
 		TEST(test_half_adder);
 		TEST(test_full_adder);
+
+		TEST(test_event_queue);
+		TEST(test_settle);
+		TEST(test_netlist);
+		TEST(test_pattern);
+		TEST(test_pattern_kernels);
+		TEST(test_flatten);
+		TEST(test_intern);
+		TEST(test_vector);
+		TEST(test_netlist_file);
+		TEST(test_tokenizer);
+		TEST(test_read_json);
+		TEST(test_library);
+		TEST(test_loader);
+		TEST(test_benchmark);
+		TEST(test_perf_counters);
+		TEST(test_generate);
+		TEST(test_truth_table);
+		TEST(test_runner);
+		TEST(test_timing);
+		TEST(test_jit);
+		TEST(test_suite);
 	}
 
 
@@ -44,10 +85,13 @@ unsigned int test_all(int argc, char *argv[]) {
 			}
 
 			else case_str("not_loop") {
-				printf("\nNOTE: This should crash with a stack-overflow\n");
 				TEST(test_not_loop);
 			}
 
+			else case_str("gate_kinds") {
+				TEST(test_gate_kinds);
+			}
+
 			else case_str("xand") {
 				TEST(test_xand);
 			}
@@ -55,11 +99,177 @@ unsigned int test_all(int argc, char *argv[]) {
 			else case_str("xor") {
 				TEST(test_xor);
 			}
+
+			else case_str("event_queue") {
+				TEST(test_event_queue);
+			}
+
+			else case_str("bench_event_queue") {
+				TEST(bench_event_queue);
+			}
+
+			else case_str("settle") {
+				TEST(test_settle);
+			}
+
+			else case_str("netlist") {
+				TEST(test_netlist);
+			}
+
+			else case_str("bench_netlist") {
+				TEST(bench_netlist);
+			}
+
+			else case_str("pattern") {
+				TEST(test_pattern);
+			}
+
+			else case_str("bench_pattern") {
+				TEST(bench_pattern);
+			}
+
+			else case_str("pattern_kernels") {
+				TEST(test_pattern_kernels);
+			}
+
+			else case_str("bench_pattern_kernels") {
+				TEST(bench_pattern_kernels);
+			}
+
+			else case_str("flatten") {
+				TEST(test_flatten);
+			}
+
+			else case_str("intern") {
+				TEST(test_intern);
+			}
+
+			else case_str("bench_intern") {
+				TEST(bench_intern);
+			}
+
+			else case_str("vector") {
+				TEST(test_vector);
+			}
+
+			else case_str("netlist_file") {
+				TEST(test_netlist_file);
+			}
+
+			else case_str("bench_netlist_file") {
+				TEST(bench_netlist_file);
+			}
+
+			else case_str("tokenizer") {
+				TEST(test_tokenizer);
+			}
+
+			else case_str("bench_tokenizer") {
+				TEST(bench_tokenizer);
+			}
+
+			else case_str("read_json") {
+				TEST(test_read_json);
+			}
+
+			else case_str("bench_read_json") {
+				TEST(bench_read_json);
+			}
+
+			else case_str("library") {
+				TEST(test_library);
+			}
+
+			else case_str("bench_library") {
+				TEST(bench_library);
+			}
+
+			else case_str("loader") {
+				TEST(test_loader);
+			}
+
+			else case_str("bench_loader") {
+				TEST(bench_loader);
+			}
+
+			else case_str("benchmark") {
+				TEST(test_benchmark);
+			}
+
+			else case_str("bench_benchmark") {
+				TEST(bench_benchmark);
+			}
+
+			else case_str("perf_counters") {
+				TEST(test_perf_counters);
+			}
+
+			else case_str("generate") {
+				TEST(test_generate);
+			}
+
+			else case_str("bench_generate") {
+				TEST(bench_generate);
+			}
+
+			else case_str("truth_table") {
+				TEST(test_truth_table);
+			}
+
+			else case_str("bench_truth_table") {
+				TEST(bench_truth_table);
+			}
+
+			else case_str("runner") {
+				TEST(test_runner);
+			}
+
+			else case_str("bench_runner") {
+				TEST(bench_runner);
+			}
+
+			else case_str("timing") {
+				TEST(test_timing);
+			}
+
+			else case_str("bench_timing") {
+				TEST(bench_timing);
+			}
+
+			else case_str("jit") {
+				TEST(test_jit);
+			}
+
+			else case_str("bench_jit") {
+				TEST(bench_jit);
+			}
+
+			else case_str("suite") {
+				TEST(test_suite);
+			}
+
+			else case_str("bench_suite") {
+				TEST(bench_suite);
+			}
+
+			else case_str("hhmtest") {
+				TEST(hhmtest);
+			}
+
+			else case_str("bench_hhmtest") {
+				TEST(bench_hhmtest);
+			}
 		}
 	}
 
 
 	TESTS_RESULT;
+
+	if (test_counters != NULL) {
+		perf_counters_free(test_counters);
+		test_counters = NULL;
+	}
+
 	FUNC_END();
 	return __failed_tests;
 }
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 
 #include "color.h"
+#include "perf_counters.h"
 
 
 typedef struct test_result {
@@ -62,6 +63,12 @@ typedef struct test_result {
 
 
 #define TEST(func) { \
+	perf_values_t __counters_start, __counters; \
+	\
+	if (test_counters != NULL) { \
+		perf_counters_read(test_counters, &__counters_start); \
+	} \
+	\
 	test_result_t __result = func(); \
 	__failed_tests += __result.fails; \
 	__tests += __result.total; \
@@ -69,6 +76,13 @@ typedef struct test_result {
 	if (__result.fails == 0) { \
 		printf(C_GREEN "[ OK ] " #func "\n" C_RESET_FG); \
 	} \
+	\
+	if (test_counters != NULL) { \
+		perf_counters_read(test_counters, &__counters); \
+		perf_values_sub(&__counters, &__counters, &__counters_start); \
+		printf("       "); \
+		perf_values_print(test_counters, &__counters, 1.0); \
+	} \
 }
 
 
@@ -82,6 +96,10 @@ typedef struct test_result {
 
 
 
+// Counters of the thread running the tests, set with BENCH_COUNTERS
+extern perf_counters_t *test_counters;
+
+
 unsigned int test_all(int argc, char *argv[]);
 
 
@@ -95,6 +113,64 @@ test_result_t test_full_adder(void);
 
 test_result_t test_not_loop(void);
 test_result_t test_nested(void);
+test_result_t test_gate_kinds(void);
+
+test_result_t test_event_queue(void);
+test_result_t bench_event_queue(void);
+test_result_t test_settle(void);
+
+test_result_t test_netlist(void);
+test_result_t bench_netlist(void);
+
+test_result_t test_pattern(void);
+test_result_t bench_pattern(void);
+test_result_t test_pattern_kernels(void);
+test_result_t bench_pattern_kernels(void);
+
+test_result_t test_flatten(void);
+
+test_result_t test_intern(void);
+test_result_t bench_intern(void);
+
+test_result_t test_vector(void);
+
+test_result_t test_netlist_file(void);
+test_result_t bench_netlist_file(void);
+
+test_result_t test_tokenizer(void);
+test_result_t bench_tokenizer(void);
+
+test_result_t test_read_json(void);
+test_result_t bench_read_json(void);
+
+test_result_t test_library(void);
+test_result_t bench_library(void);
+
+test_result_t test_loader(void);
+test_result_t bench_loader(void);
+
+test_result_t test_benchmark(void);
+test_result_t bench_benchmark(void);
+
+test_result_t test_perf_counters(void);
+
+test_result_t test_generate(void);
+test_result_t bench_generate(void);
+
+test_result_t test_truth_table(void);
+test_result_t bench_truth_table(void);
+
+test_result_t test_runner(void);
+test_result_t bench_runner(void);
+
+test_result_t test_timing(void);
+test_result_t bench_timing(void);
+
+test_result_t test_jit(void);
+test_result_t bench_jit(void);
+
+test_result_t test_suite(void);
+test_result_t bench_suite(void);
 
 
 #endif
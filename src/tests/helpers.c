@@ -0,0 +1,71 @@
+#include "helpers.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../defines.h"
+
+
+// Write a design to build, and get its top template from library, which reads build
+circuit_t *helpers_load_design(generate_t *gen, GenerateFormat_t format, library_t *library) {
+	library_init(library);
+
+	if (! generate_write(gen, "build", format)) {
+		return NULL;
+	}
+
+	library_add_path(library, "build");
+
+	return library_get(library, generate_top(gen)->name);
+}
+
+
+// Compile the top template of a design into netlist, without leaving its files in build
+bool helpers_compile_design(generate_t *gen, GenerateFormat_t format, netlist_t *netlist) {
+	library_t library;
+	circuit_t *circ = helpers_load_design(gen, format, &library);
+
+	bool success = circ != NULL && netlist_compile(netlist, circ);
+
+	library_free(&library);
+	generate_remove(gen, "build");
+
+	return success;
+}
+
+
+// Set a numbered bus of inputs, like A0, A1, ..., one input at a time
+void helpers_set_bus(char *prefix, size_t bits, uint64_t value, helpers_set_input_t set_input, void *context) {
+	char name[BUF_SIZE];
+
+	for (size_t i = 0; i < bits; i++) {
+		sprintf(name, "%s%lu", prefix, i);
+		set_input(context, name, (value >> i) & 1);
+	}
+}
+
+
+// Read a numbered bus of outputs from the state of every net of netlist
+uint64_t helpers_get_bus(netlist_t *netlist, bool *state, char *prefix, size_t bits) {
+	char name[BUF_SIZE];
+	uint64_t value = 0;
+
+	for (size_t i = 0; i < bits; i++) {
+		sprintf(name, "%s%lu", prefix, i);
+		value |= (uint64_t) state[netlist_get_output_by_name(netlist, name)->net] << i;
+	}
+
+	return value;
+}
+
+
+void helpers_write_file(char *filename, const void *contents, size_t size) {
+	FILE *file = fopen(filename, "wb");
+	fwrite(contents, 1, size, file);
+	fclose(file);
+}
+
+
+void helpers_write_string(char *filename, char *contents) {
+	helpers_write_file(filename, contents, strlen(contents));
+}
@@ -0,0 +1,28 @@
+#ifndef TESTS_HELPERS_H
+#define TESTS_HELPERS_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "../generate.h"
+#include "../library.h"
+#include "../netlist.h"
+
+
+// Sets one input by name, for helpers_set_bus
+typedef void (*helpers_set_input_t)(void *context, char *name, bool state);
+
+
+circuit_t *helpers_load_design(generate_t *gen, GenerateFormat_t format, library_t *library);
+bool helpers_compile_design(generate_t *gen, GenerateFormat_t format, netlist_t *netlist);
+
+void helpers_set_bus(char *prefix, size_t bits, uint64_t value, helpers_set_input_t set_input, void *context);
+uint64_t helpers_get_bus(netlist_t *netlist, bool *state, char *prefix, size_t bits);
+
+void helpers_write_file(char *filename, const void *contents, size_t size);
+void helpers_write_string(char *filename, char *contents);
+
+
+#endif
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../thread_pool.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+#define BENCHMARK_THREAD_CALLS 1000
+
+
+static bench_site_t outer_site = { .name = "test_benchmark_outer", .id = 0 };
+static bench_site_t inner_site = { .name = "test_benchmark_inner", .id = 0 };
+static bench_site_t thread_site = { .name = "test_benchmark_thread", .id = 0 };
+
+
+// The stats of a site since the last time it was asked for
+static bench_stats_t site_stats(bench_site_t *site, bench_stats_t *before) {
+	size_t amount;
+	bench_stats_t *all = bench_collect(&amount);
+
+	uint32_t id = atomic_load(&site->id);
+	bench_stats_t now = (id < amount) ? all[id] : (bench_stats_t) { 0 };
+
+	bench_stats_t delta = {
+		.calls = now.calls - before->calls,
+		.self = now.self - before->self,
+		.total = now.total - before->total,
+		.depth = now.depth
+	};
+
+	*before = now;
+	free(all);
+
+	return delta;
+}
+
+
+// The whole file, which has to be freed
+static char *read_file(const char *filename) {
+	FILE *file = fopen(filename, "r");
+
+	if (file == NULL) {
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char *contents = malloc((size_t) size + 1);
+	contents[fread(contents, 1, (size_t) size, file)] = '\0';
+
+	fclose(file);
+	return contents;
+}
+
+
+static void record_calls(void *arg) {
+	(void) arg;
+
+	for (size_t i = 0; i < BENCHMARK_THREAD_CALLS; i++) {
+		bench_record(&thread_site, BenchEvent_ENTER);
+		bench_record(&thread_site, BenchEvent_EXIT);
+	}
+}
+
+
+test_result_t test_benchmark(void) {
+	FUNC_START();
+	TEST_START;
+
+	bench_stats_t outer_before = { 0 };
+	bench_stats_t inner_before = { 0 };
+	bench_stats_t thread_before = { 0 };
+
+	site_stats(&outer_site, &outer_before);
+	site_stats(&inner_site, &inner_before);
+	site_stats(&thread_site, &thread_before);
+
+
+	// Nested and recursive calls
+	bench_record(&outer_site, BenchEvent_ENTER);
+
+	for (size_t i = 0; i < 2; i++) {
+		bench_record(&inner_site, BenchEvent_ENTER);
+		bench_record(&inner_site, BenchEvent_EXIT);
+	}
+
+	bench_record(&outer_site, BenchEvent_ENTER);
+	bench_record(&outer_site, BenchEvent_EXIT);
+
+	bench_record(&outer_site, BenchEvent_EXIT);
+
+	bench_stats_t outer = site_stats(&outer_site, &outer_before);
+	bench_stats_t inner = site_stats(&inner_site, &inner_before);
+
+	assert_eq(outer.calls, 2);
+	assert_eq(inner.calls, 2);
+	assert_eq(outer.depth, 0);
+
+	// All time in the outer call is spent in one of the sites, counting the recursion once
+	assert_eq(outer.total, outer.self + inner.self);
+	assert_eq(inner.total, inner.self);
+
+
+	// More calls than fit in the ring
+	for (size_t i = 0; i < BENCH_RING_SIZE; i++) {
+		bench_record(&inner_site, BenchEvent_ENTER);
+		bench_record(&inner_site, BenchEvent_EXIT);
+	}
+
+	inner = site_stats(&inner_site, &inner_before);
+	assert_eq(inner.calls, BENCH_RING_SIZE);
+
+
+	// Every thread has its own ring, which is kept after the thread stops
+	thread_pool_t pool;
+	thread_pool_init(&pool, 4);
+
+	for (size_t i = 0; i < 4; i++) {
+		thread_pool_push(&pool, record_calls, NULL);
+	}
+
+	thread_pool_free(&pool);
+
+	bench_stats_t threaded = site_stats(&thread_site, &thread_before);
+	assert_eq(threaded.calls, 4 * BENCHMARK_THREAD_CALLS);
+
+
+	// Every call that ends while a trace is open is in it, unless a trace was opened for the whole run
+	if (! bench_tracing()) {
+		assert_true(bench_trace_open("build/test_benchmark.json"));
+		assert_true(bench_tracing());
+		assert_false(bench_trace_open("build/test_benchmark.json"));
+
+		bench_record(&outer_site, BenchEvent_ENTER);
+		bench_record(&inner_site, BenchEvent_ENTER);
+		bench_record(&inner_site, BenchEvent_EXIT);
+		bench_record(&outer_site, BenchEvent_EXIT);
+
+		bench_trace_close();
+		assert_false(bench_tracing());
+
+		char *trace = read_file("build/test_benchmark.json");
+		assert_not_null(trace);
+
+		assert_eq(trace[0], '[');
+		assert_not_null(strstr(trace, "{\"name\":\"test_benchmark_outer\",\"ph\":\"X\",\"pid\":1,"));
+		assert_not_null(strstr(trace, "{\"name\":\"test_benchmark_inner\",\"ph\":\"X\",\"pid\":1,"));
+		assert_eq(strstr(trace, "test_benchmark_thread"), NULL);
+		assert_str_eq(trace + strlen(trace) - 3, "\n]\n");
+
+		free(trace);
+		remove("build/test_benchmark.json");
+	}
+
+
+	// Folded stacks keep the path a site was called from
+	assert_true(bench_write_folded("build/test_benchmark.folded"));
+
+	char *folded = read_file("build/test_benchmark.folded");
+	assert_not_null(folded);
+
+	assert_not_null(strstr(folded, "test_benchmark_outer;test_benchmark_inner "));
+	assert_not_null(strstr(folded, "test_benchmark_outer;test_benchmark_outer "));
+	assert_not_null(strstr(folded, "test_benchmark_thread "));
+
+	free(folded);
+	remove("build/test_benchmark.folded");
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// The cost of instrumenting a function
+test_result_t bench_benchmark(void) {
+	FUNC_START();
+	TEST_START;
+
+	size_t calls = 10000000;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < calls; i++) {
+		bench_record(&inner_site, BenchEvent_ENTER);
+		bench_record(&inner_site, BenchEvent_EXIT);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("FUNC_START + FUNC_END %8.2f ns\n", (double) (long_time(end) - long_time(start)) / (double) calls);
+
+	FUNC_END();
+	TEST_END;
+}
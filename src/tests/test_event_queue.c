@@ -0,0 +1,418 @@
+#include "../read_template.h"
+#include "../event_queue.h"
+#include "../intern.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+// Build IN -> NOT -> NOT -> ... -> OUT, which is far too deep to recurse through
+static circuit_t *build_not_chain(size_t length) {
+	FUNC_START();
+
+	circuit_t *circ = malloc(sizeof(circuit_t));
+	circuit_init(circ);
+
+	char buf[BUF_SIZE];
+
+	sprintf(buf, "not_chain_%lu", length);
+	circ->name = intern(buf);
+
+	port_t *last = NULL;
+
+	for (size_t i = 0; i < length + 2; i++) {
+		gate_t *g = malloc(sizeof(gate_t));
+		gate_init(g);
+
+		sprintf(buf, "%08lx", i);
+		g->name = intern(buf);
+
+		char *portname = NULL;
+
+		if (i == 0) {
+			g->type = intern("IN");
+			portname = intern("I0");
+		}
+		else if (i == length + 1) {
+			g->type = intern("OUT");
+			portname = intern("O0");
+		}
+		else {
+			g->type = intern("NOT");
+		}
+
+		gate_set_ports(g, portname, NULL);
+		hex_hashmap_add_item(&circ->gates, g->name, g);
+
+		// Wire the previous output to the first port, which is always the input
+		port_t *first = g->ports.items[0];
+
+		if (last != NULL) {
+			vector_push(&last->connections, first);
+			vector_push(&first->connections, last);
+		}
+
+		last = g->ports.items[g->ports.amount - 1];
+	}
+
+	circuit_update_state(circ);
+
+	FUNC_END();
+	return circ;
+}
+
+
+// Set all inputs of the full adder for the given combination, then check its outputs
+static bool check_full_adder(circuit_t *circ, unsigned int combination) {
+	FUNC_START();
+
+	port_t *i0 = circuit_get_io_port_by_name(circ, "I0");
+	port_t *i1 = circuit_get_io_port_by_name(circ, "I1");
+	port_t *ici = circuit_get_io_port_by_name(circ, "Ci");
+	port_t *os = circuit_get_io_port_by_name(circ, "S");
+	port_t *oco = circuit_get_io_port_by_name(circ, "Co");
+
+	bool a = combination & 1;
+	bool b = (combination >> 1) & 1;
+	bool c = (combination >> 2) & 1;
+
+	port_set_state(i0, a);
+	port_set_state(i1, b);
+	port_set_state(ici, c);
+
+	unsigned int sum = (unsigned int) a + (unsigned int) b + (unsigned int) c;
+
+	bool correct = os->state == (bool) (sum & 1) && oco->state == (bool) (sum >> 1);
+
+	FUNC_END();
+	return correct;
+}
+
+
+test_result_t test_event_queue(void) {
+	FUNC_START();
+	TEST_START;
+
+	SimEngine_t old_engine = sim_get_engine();
+	sim_set_engine(SimEngine_QUEUE);
+
+
+	// Hierarchical circuits should behave just like with the recursive engine
+	circuit_t ha_circ;
+	circuit_init(&ha_circ);
+	circuit_t fa_circ;
+	circuit_init(&fa_circ);
+
+	library_t library;
+	library_init(&library);
+
+	assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+	assert_true(library_add(&library, &ha_circ, false));
+	assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+	// Walk the inputs in Gray code order as well as counting order
+	for (unsigned int i = 0; i < 8; i++) {
+		assert_true(check_full_adder(&fa_circ, i));
+		assert_true(check_full_adder(&fa_circ, i ^ (i >> 1)));
+	}
+
+	circuit_free(&fa_circ);
+	circuit_free(&ha_circ);
+	library_free(&library);
+
+
+	// Custom gates pass on the outputs their inner circuit settled on when it was read,
+	// notor is always on, so notor2 is as well
+	SimEngine_t engines[] = { SimEngine_RECURSIVE, SimEngine_QUEUE };
+
+	for (size_t e = 0; e < 2; e++) {
+		sim_set_engine(engines[e]);
+
+		circuit_t notor;
+		circuit_init(&notor);
+		circuit_t notor2;
+		circuit_init(&notor2);
+
+		library_init(&library);
+
+		assert_true(read_template("tests/notor", &notor, NULL));
+		assert_true(library_add(&library, &notor, false));
+		assert_true(read_template("tests/notor2", &notor2, &library));
+
+		assert_true(circuit_get_io_port_by_name(&notor2, "O0")->state);
+
+		circuit_free(&notor2);
+		circuit_free(&notor);
+		library_free(&library);
+	}
+
+	sim_set_engine(SimEngine_QUEUE);
+
+
+	// A deep chain settles without recursion
+	circuit_t *chain = build_not_chain(1000);
+
+	port_t *in = circuit_get_io_port_by_name(chain, "I0");
+	port_t *out = circuit_get_io_port_by_name(chain, "O0");
+
+	// An even amount of inversions
+	assert_eq(out->state, false);
+
+	port_set_state(in, true);
+	assert_eq(out->state, true);
+
+	port_set_state(in, false);
+	assert_eq(out->state, false);
+
+	// Nothing should be left behind
+	assert_eq(sim_get_queue()->amount, 0);
+
+	circuit_free(chain);
+	free(chain);
+
+
+	sim_set_engine(old_engine);
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+static gate_t *add_gate(circuit_t *circ, char *type, char *portname) {
+	gate_t *g = malloc(sizeof(gate_t));
+	gate_init(g);
+
+	char buf[BUF_SIZE];
+	sprintf(buf, "%08lx", hex_hashmap_amount(&circ->gates));
+
+	g->name = intern(buf);
+	g->type = intern(type);
+
+	gate_set_ports(g, (portname == NULL) ? NULL : intern(portname), NULL);
+	hex_hashmap_add_item(&circ->gates, g->name, g);
+
+	return g;
+}
+
+
+// Build I0 -> XOR -> NOT -> ... -> NOT -> XOR:I1, with the XOR at O0. It holds its state
+// when the inversions add up to an even number, and oscillates otherwise.
+static circuit_t *build_xor_ring(size_t length) {
+	FUNC_START();
+
+	circuit_t *circ = malloc(sizeof(circuit_t));
+	circuit_init(circ);
+	circ->name = intern("xor_ring");
+
+	gate_t *in = add_gate(circ, "IN", "I0");
+	gate_t *out = add_gate(circ, "OUT", "O0");
+	gate_t *xor = add_gate(circ, "XOR", NULL);
+
+	port_connect(in->ports.items[0], gate_get_port_by_name(xor, "I0"));
+	port_connect(gate_get_port_by_name(xor, "O0"), out->ports.items[0]);
+
+	port_t *last = gate_get_port_by_name(xor, "O0");
+
+	for (size_t i = 0; i < length; i++) {
+		gate_t *not = add_gate(circ, "NOT", NULL);
+
+		port_connect(last, not->ports.items[0]);
+		last = not->ports.items[1];
+	}
+
+	port_connect(last, gate_get_port_by_name(xor, "I1"));
+
+	FUNC_END();
+	return circ;
+}
+
+
+test_result_t test_settle(void) {
+	FUNC_START();
+	TEST_START;
+
+	SimEngine_t old_engine = sim_get_engine();
+	event_queue_t *queue = sim_get_queue();
+
+
+	// An XOR feeding itself holds 0, behind a NOT it takes turns with the NOT
+	for (size_t length = 0; length < 2; length++) {
+		circuit_t *ring = build_xor_ring(length);
+		settle_result_t result = circuit_settle(ring, 1000);
+
+		assert_eq(result.status, ((length == 0) ? SettleStatus_SETTLED : SettleStatus_OSCILLATING));
+		assert_eq(result.period, ((length == 0) ? 0 : 4));
+		assert_true(result.deltas < 10);
+		assert_eq(queue->amount, 0);
+
+		circuit_free(ring);
+		free(ring);
+	}
+
+
+	// Both NOTs of a latch flip at once when it starts out of balance
+	circuit_t *ring = build_xor_ring(2);
+
+	settle_result_t result = circuit_settle(ring, 1000);
+	assert_eq(result.status, SettleStatus_OSCILLATING);
+	assert_eq(result.period, 3);
+	assert_eq(result.changes, 2);
+
+	circuit_free(ring);
+	free(ring);
+
+
+	// Setting the XOR to invert turns it into an oscillator, until it's set back
+	sim_set_engine(SimEngine_DELTA);
+
+	ring = build_xor_ring(0);
+	assert_true(circuit_update_state(ring));
+
+	port_t *in = circuit_get_io_port_by_name(ring, "I0");
+
+	assert_false(port_set_state(in, true));
+	assert_eq(queue->settle.status, SettleStatus_OSCILLATING);
+	assert_eq(queue->settle.period, 2);
+	assert_eq(queue->amount, 0);
+
+	assert_true(port_set_state(in, false));
+	assert_eq(queue->settle.status, SettleStatus_SETTLED);
+
+	circuit_free(ring);
+	free(ring);
+
+
+	// Every NOT of a chain takes a delta cycle, and so does the OUT
+	sim_set_engine(SimEngine_QUEUE);
+	circuit_t *chain = build_not_chain(100);
+	sim_set_engine(SimEngine_DELTA);
+
+	in = circuit_get_io_port_by_name(chain, "I0");
+	port_t *out = circuit_get_io_port_by_name(chain, "O0");
+
+	sim_set_budget(10);
+	assert_false(port_set_state(in, ! in->state));
+	assert_eq(queue->settle.status, SettleStatus_BUDGET_EXCEEDED);
+	assert_eq(queue->settle.deltas, 10);
+	assert_eq(queue->settle.changes, 1);
+	assert_eq(queue->amount, 0);
+
+	sim_set_budget(SIM_DEFAULT_BUDGET);
+	assert_true(circuit_update_state(chain));
+	assert_eq(out->state, in->state);
+
+	for (unsigned int i = 0; i < 10; i++) {
+		assert_true(port_set_state(in, ! in->state));
+		assert_eq(queue->settle.deltas, 101);
+		assert_eq(out->state, in->state);
+	}
+
+	circuit_free(chain);
+	free(chain);
+
+
+	// A gate of an unknown type can't be evaluated, so nothing settled
+	circuit_t *unknown = malloc(sizeof(circuit_t));
+	circuit_init(unknown);
+	unknown->name = intern("unknown");
+	add_gate(unknown, "does_not_exist", NULL);
+
+	result = circuit_settle(unknown, 1000);
+	assert_eq(result.status, SettleStatus_FAILED);
+	assert_str_eq(settle_status_name(result.status), "failed");
+	assert_eq(queue->amount, 0);
+
+	circuit_free(unknown);
+	free(unknown);
+
+
+	sim_set_engine(old_engine);
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Compare the engines on the same circuits
+test_result_t bench_event_queue(void) {
+	FUNC_START();
+	TEST_START;
+
+	SimEngine_t old_engine = sim_get_engine();
+	event_queue_t *queue = sim_get_queue();
+
+	const char *engine_names[] = { "recursive", "queue", "delta" };
+	SimEngine_t engines[] = { SimEngine_RECURSIVE, SimEngine_QUEUE, SimEngine_DELTA };
+
+
+	for (size_t e = 0; e < 3; e++) {
+		sim_set_engine(engines[e]);
+
+		circuit_t ha_circ;
+		circuit_init(&ha_circ);
+		circuit_t fa_circ;
+		circuit_init(&fa_circ);
+
+		library_t library;
+		library_init(&library);
+
+		assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+		assert_true(library_add(&library, &ha_circ, false));
+		assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+
+		struct timespec start = {0, 0};
+		struct timespec end = {0, 0};
+
+		event_queue_reset_stats(queue);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for (unsigned int i = 0; i < 100000; i++) {
+			assert_true(check_full_adder(&fa_circ, i & 7));
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		printf("full_adder %-9s %8.3f ms\t", engine_names[e], (double) (long_time(end) - long_time(start)) / 1e6);
+
+		if (engines[e] != SimEngine_RECURSIVE) {
+			event_queue_print(queue);
+		}
+		else {
+			printf("\n");
+		}
+
+		circuit_free(&fa_circ);
+		circuit_free(&ha_circ);
+		library_free(&library);
+	}
+
+
+	// The recursive engine can't handle this, so only run the queues
+	for (size_t e = 1; e < 3; e++) {
+		sim_set_engine(engines[e]);
+
+		circuit_t *chain = build_not_chain(10000);
+
+		port_t *in = circuit_get_io_port_by_name(chain, "I0");
+		port_t *out = circuit_get_io_port_by_name(chain, "O0");
+
+		event_queue_reset_stats(queue);
+
+		for (unsigned int i = 0; i < 100; i++) {
+			port_set_state(in, ! in->state);
+			assert_eq(out->state, in->state);
+		}
+
+		printf("not_chain_10000 %-9s\t", engine_names[e]);
+		event_queue_print(queue);
+
+		circuit_free(chain);
+		free(chain);
+	}
+
+
+	sim_set_engine(old_engine);
+
+	FUNC_END();
+	TEST_END;
+}
@@ -0,0 +1,127 @@
+#include "../read_template.h"
+#include "../event_queue.h"
+#include "../netlist.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+// How often item is in vec
+static size_t count_item(vector_t *vec, void *item) {
+	size_t amount = 0;
+
+	VEC_EACH(*vec, void *other) {
+		amount += other == item;
+	}
+
+	return amount;
+}
+
+
+test_result_t test_flatten(void) {
+	FUNC_START();
+	TEST_START;
+
+	// Create circuits
+	circuit_t notor;
+	circuit_init(&notor);
+	circuit_t nested;
+	circuit_init(&nested);
+	circuit_t flat;
+	circuit_init(&flat);
+
+	library_t library;
+	library_init(&library);
+
+	// Read templates
+	assert_true(read_template("tests/notor", &notor, NULL));
+	assert_true(library_add(&library, &notor, false));
+
+	assert_true(read_template("tests/notor2", &nested, &library));
+	assert_true(read_template_flat("tests/notor2", &flat, &library));
+
+
+	// 3 IO gates, an OR, and 2 times a NOT and an OR
+	assert_eq(hex_hashmap_amount(&flat.gates), 8);
+
+	HEX_HASHMAP_EACH_VALUE(flat.gates, gate_t *gate) {
+		assert_eq(gate->inner_circuit, NULL);
+
+		VEC_EACH(gate->ports, port_t *port) {
+			assert_neq(port->type, PortType_NODE);
+
+			// Connections go both ways, once
+			VEC_EACH(port->connections, port_t *connection) {
+				assert_eq(count_item(&port->connections, connection), 1);
+				assert_eq(count_item(&connection->connections, port), 1);
+			}
+		}
+	}
+
+	// Inner gates keep their hierarchical name
+	gate_t *inner_not = circuit_get_gate_by_name(&flat, "a0055d19/867350cd");
+	assert_not_null(inner_not);
+	assert_str_eq(inner_not->type, "NOT");
+
+
+	// Both circuits should behave the same, with both engines
+	SimEngine_t old_engine = sim_get_engine();
+	SimEngine_t engines[] = { SimEngine_RECURSIVE, SimEngine_QUEUE };
+
+	port_t *nested_i0 = circuit_get_io_port_by_name(&nested, "I0");
+	port_t *nested_i1 = circuit_get_io_port_by_name(&nested, "I1");
+	port_t *nested_o0 = circuit_get_io_port_by_name(&nested, "O0");
+
+	port_t *flat_i0 = circuit_get_io_port_by_name(&flat, "I0");
+	port_t *flat_i1 = circuit_get_io_port_by_name(&flat, "I1");
+	port_t *flat_o0 = circuit_get_io_port_by_name(&flat, "O0");
+
+	for (size_t e = 0; e < 2; e++) {
+		sim_set_engine(engines[e]);
+
+		for (unsigned int i = 0; i < 4; i++) {
+			port_set_state(nested_i0, i & 1);
+			port_set_state(nested_i1, (i >> 1) & 1);
+
+			port_set_state(flat_i0, i & 1);
+			port_set_state(flat_i1, (i >> 1) & 1);
+
+			assert_eq(flat_o0->state, nested_o0->state);
+		}
+	}
+
+	sim_set_engine(old_engine);
+
+
+	// The netlist maps ops back to their hierarchical name, flattened or not
+	netlist_t nested_netlist;
+	netlist_init(&nested_netlist);
+	netlist_t flat_netlist;
+	netlist_init(&flat_netlist);
+
+	assert_true(netlist_compile(&nested_netlist, &nested));
+	assert_true(netlist_compile(&flat_netlist, &flat));
+
+	assert_eq(nested_netlist.amount_ops, flat_netlist.amount_ops);
+	assert_eq(flat_netlist.amount_levels, 3);
+
+	netlist_op_t *nested_op = netlist_get_op_by_name(&nested_netlist, "8a8bda59/fbfc7585");
+	netlist_op_t *flat_op = netlist_get_op_by_name(&flat_netlist, "8a8bda59/fbfc7585");
+
+	assert_not_null(nested_op);
+	assert_not_null(flat_op);
+	assert_eq(nested_op->op, NetlistOp_OR);
+	assert_eq(flat_op->op, NetlistOp_OR);
+
+
+	// Free everything
+	netlist_free(&flat_netlist);
+	netlist_free(&nested_netlist);
+	circuit_free(&flat);
+	circuit_free(&nested);
+	circuit_free(&notor);
+	library_free(&library);
+
+
+	FUNC_END();
+	TEST_END;
+}
@@ -30,14 +30,14 @@ test_result_t test_full_adder(void) {
 	circuit_t fa_circ;
 	circuit_init(&fa_circ);
 
-	vector_t deps;
-	vector_init(&deps, 4);
+	library_t library;
+	library_init(&library);
 
 	// Read templates
 	assert_true(read_template("tests/half_adder", &ha_circ, NULL));
-	assert_true(vector_push(&deps, &ha_circ));
+	assert_true(library_add(&library, &ha_circ, false));
 
-	assert_true(read_template("tests/full_adder", &fa_circ, &deps));
+	assert_true(read_template("tests/full_adder", &fa_circ, &library));
 
 
 	// ... Do fun things
@@ -149,7 +149,7 @@ test_result_t test_full_adder(void) {
 	// Free everything
 	circuit_free(&fa_circ);
 	circuit_free(&ha_circ);
-	vector_free(&deps);
+	library_free(&library);
 
 
 	FUNC_END();
@@ -0,0 +1,56 @@
+#include "../gate.h"
+#include "../library.h"
+#include "../read_template.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+test_result_t test_gate_kinds(void) {
+	FUNC_START();
+	TEST_START;
+
+	// Builtin types get their own kind, everything else is a template
+	assert_eq(gate_get_kind("AND"), GateKind_AND);
+	assert_eq(gate_get_kind("OR"), GateKind_OR);
+	assert_eq(gate_get_kind("XOR"), GateKind_XOR);
+	assert_eq(gate_get_kind("NOT"), GateKind_NOT);
+	assert_eq(gate_get_kind("IN"), GateKind_IN);
+	assert_eq(gate_get_kind("OUT"), GateKind_OUT);
+	assert_eq(gate_get_kind("notor"), GateKind_CUSTOM);
+	assert_eq(gate_get_kind("and"), GateKind_CUSTOM);
+
+
+	// Create circuit
+	circuit_t notor2;
+	circuit_init(&notor2);
+
+	library_t library;
+	library_init(&library);
+	assert_true(library_add_path(&library, "tests"));
+
+	// Read template
+	assert_true(read_template("tests/notor2", &notor2, &library));
+
+	// Check the resolved gate kinds
+	assert_eq(circuit_get_gate_by_name(&notor2, "243a080a")->kind, GateKind_IN);
+	assert_eq(circuit_get_gate_by_name(&notor2, "8edeefd9")->kind, GateKind_OUT);
+	assert_eq(circuit_get_gate_by_name(&notor2, "751a7396")->kind, GateKind_OR);
+	assert_eq(circuit_get_gate_by_name(&notor2, "a0055d19")->kind, GateKind_CUSTOM);
+
+	// And the ones inside the custom gate
+	circuit_t *notor = library_get(&library, "notor");
+	assert_not_null(notor);
+	assert_eq(circuit_get_gate_by_name(notor, "7f68caf5")->kind, GateKind_IN);
+	assert_eq(circuit_get_gate_by_name(notor, "3b109a18")->kind, GateKind_OUT);
+	assert_eq(circuit_get_gate_by_name(notor, "867350cd")->kind, GateKind_NOT);
+	assert_eq(circuit_get_gate_by_name(notor, "fbfc7585")->kind, GateKind_OR);
+
+
+	// Free everything
+	circuit_free(&notor2);
+	library_free(&library);
+
+
+	FUNC_END();
+	TEST_END;
+}
@@ -0,0 +1,405 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malloc.h>
+
+#include "../generate.h"
+#include "../library.h"
+#include "../netlist.h"
+#include "../pattern.h"
+#include "../event_queue.h"
+#include "helpers.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+#define GENERATE_BENCH_MIN_GATES 1000
+#define GENERATE_BENCH_MAX_GATES 1000000
+#define GENERATE_BENCH_VECTORS 1024
+#define GENERATE_BENCH_TOGGLES 64
+
+
+static void set_input(void *netlist, char *name, bool state) {
+	((netlist_t *) netlist)->state[netlist_get_input_by_name(netlist, name)->net] = state;
+}
+
+
+// Check an adder with inputs A, B, Ci against all additions
+static bool check_adder(netlist_t *netlist, size_t bits) {
+	for (uint64_t a = 0; a < (1u << bits); a++) {
+		for (uint64_t b = 0; b < (1u << bits); b++) {
+			for (uint64_t ci = 0; ci < 2; ci++) {
+				helpers_set_bus("A", bits, a, set_input, netlist);
+				helpers_set_bus("B", bits, b, set_input, netlist);
+				netlist->state[netlist_get_input_by_name(netlist, "Ci")->net] = ci;
+
+				netlist_evaluate(netlist);
+
+				uint64_t sum = helpers_get_bus(netlist, netlist->state, "S", bits) | (uint64_t) netlist->state[netlist_get_output_by_name(netlist, "Co")->net] << bits;
+
+				if (sum != a + b + ci) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
+test_result_t test_generate(void) {
+	FUNC_START();
+	TEST_START;
+
+
+	// Adders, in both formats
+	for (size_t lookahead = 0; lookahead < 2; lookahead++) {
+		for (size_t json = 0; json < 2; json++) {
+			size_t bits = 5;
+
+			generate_t gen;
+			generate_init(&gen);
+
+			assert_true(lookahead ? generate_lookahead_adder(&gen, bits) : generate_ripple_adder(&gen, bits));
+
+			if (! lookahead) {
+				assert_eq(generate_flat_gates(&gen), 5 * bits);
+			}
+
+			netlist_t netlist;
+			netlist_init(&netlist);
+
+			assert_true(helpers_compile_design(&gen, json ? GenerateFormat_JSON : GenerateFormat_TEXT, &netlist));
+			assert_eq(netlist.amount_ops, generate_flat_gates(&gen));
+			assert_true(check_adder(&netlist, bits));
+
+			netlist_free(&netlist);
+			generate_free(&gen);
+		}
+	}
+
+
+	// Multiplier
+	{
+		size_t bits = 4;
+
+		generate_t gen;
+		generate_init(&gen);
+
+		assert_false(generate_multiplier(&gen, 1));
+		assert_true(generate_multiplier(&gen, bits));
+
+		netlist_t netlist;
+		netlist_init(&netlist);
+
+		assert_true(helpers_compile_design(&gen, GenerateFormat_JSON, &netlist));
+
+		size_t correct = 0;
+
+		for (uint64_t a = 0; a < (1u << bits); a++) {
+			for (uint64_t b = 0; b < (1u << bits); b++) {
+				helpers_set_bus("A", bits, a, set_input, &netlist);
+				helpers_set_bus("B", bits, b, set_input, &netlist);
+				netlist_evaluate(&netlist);
+
+				correct += helpers_get_bus(&netlist, netlist.state, "P", 2 * bits) == a * b;
+			}
+		}
+
+		assert_eq(correct, 1u << (2 * bits));
+
+		netlist_free(&netlist);
+		generate_free(&gen);
+	}
+
+
+	// Random DAGs have exactly their depth, and are the same in both formats
+	{
+		generate_t gen;
+		generate_init(&gen);
+
+		assert_true(generate_random_dag(&gen, 1000, 16, 10, 4, 7));
+		assert_eq(generate_flat_gates(&gen), 1000);
+
+		netlist_t text;
+		netlist_init(&text);
+		netlist_t json;
+		netlist_init(&json);
+
+		assert_true(helpers_compile_design(&gen, GenerateFormat_TEXT, &text));
+		assert_true(helpers_compile_design(&gen, GenerateFormat_JSON, &json));
+
+		assert_eq(text.amount_levels, 10);
+		assert_eq(text.amount_outputs, 16);
+
+		pattern_t a, b;
+		pattern_init(&a, &text, 256);
+		pattern_init(&b, &json, 256);
+
+		pattern_set_exhaustive(&a, 0);
+		pattern_set_exhaustive(&b, 0);
+		pattern_evaluate(&a);
+		pattern_evaluate(&b);
+
+		uint64_t words_a[4], words_b[4];
+
+		for (size_t i = 0; i < text.amount_outputs; i++) {
+			assert_true(pattern_get_output(&a, text.outputs[i].name, words_a));
+			assert_true(pattern_get_output(&b, text.outputs[i].name, words_b));
+			assert_eq(memcmp(words_a, words_b, sizeof(words_a)), 0);
+		}
+
+		pattern_free(&a);
+		pattern_free(&b);
+		netlist_free(&text);
+		netlist_free(&json);
+		generate_free(&gen);
+	}
+
+
+	// Every level of a hierarchy inverts I0 once when I1 is 0, or passes it on when I1 is 1.
+	// The cells start at 1, which has to reach the levels above when they're read.
+	{
+		generate_t gen;
+		generate_init(&gen);
+
+		assert_true(generate_hierarchy(&gen, 3, 3));
+		assert_eq(gen.amount_templates, 4);
+		assert_eq(generate_flat_gates(&gen), 2 * 27);
+		assert_true(generate_write(&gen, "build", GenerateFormat_TEXT));
+
+		SimEngine_t old_engine = sim_get_engine();
+		SimEngine_t engines[] = { SimEngine_RECURSIVE, SimEngine_QUEUE };
+
+		for (size_t e = 0; e < 2; e++) {
+			sim_set_engine(engines[e]);
+
+			library_t library;
+			library_init(&library);
+			assert_true(library_add_path(&library, "build"));
+
+			circuit_t *circs[] = {
+				library_get(&library, generate_top(&gen)->name),
+				library_get_flat(&library, generate_top(&gen)->name)
+			};
+
+			for (size_t flat = 0; flat < 2; flat++) {
+				circuit_t *circ = circs[flat];
+				assert_not_null(circ);
+
+				for (unsigned int combination = 0; combination < 4; combination++) {
+					bool i0 = combination & 1;
+					bool i1 = combination >> 1;
+
+					port_set_state(circuit_get_io_port_by_name(circ, "I0"), i0);
+					port_set_state(circuit_get_io_port_by_name(circ, "I1"), i1);
+
+					assert_eq(circuit_get_io_port_by_name(circ, "O0")->state, (i1 ? i0 : ! i0));
+				}
+			}
+
+			library_free(&library);
+		}
+
+		sim_set_engine(old_engine);
+		generate_remove(&gen, "build");
+		generate_free(&gen);
+	}
+
+
+	// A feedback chain can't be levelized, but it holds its state
+	{
+		generate_t gen;
+		generate_init(&gen);
+
+		assert_true(generate_feedback_chain(&gen, 99));
+		assert_eq(generate_flat_gates(&gen), 101);
+
+		library_t library;
+		circuit_t *circ = helpers_load_design(&gen, GenerateFormat_JSON, &library);
+		assert_not_null(circ);
+
+		netlist_t netlist;
+		netlist_init(&netlist);
+		assert_false(netlist_compile(&netlist, circ));
+		netlist_free(&netlist);
+
+		port_t *in = circuit_get_io_port_by_name(circ, "I0");
+		port_t *out = circuit_get_io_port_by_name(circ, "O0");
+
+		assert_false(out->state);
+		port_set_state(in, true);
+		assert_true(out->state);
+		port_set_state(in, false);
+		assert_true(out->state);
+
+		library_free(&library);
+		generate_remove(&gen, "build");
+		generate_free(&gen);
+	}
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+
+// Heap memory in use in bytes, or the resident memory of the process without glibc
+static size_t used_memory(void) {
+#ifdef __GLIBC__
+	return mallinfo2().uordblks;
+#else
+	FILE *file = fopen("/proc/self/statm", "r");
+	size_t pages = 0, resident = 0;
+
+	if (file != NULL) {
+		if (fscanf(file, "%lu %lu", &pages, &resident) != 2) {
+			resident = 0;
+		}
+
+		fclose(file);
+	}
+
+	return resident * (size_t) sysconf(_SC_PAGESIZE);
+#endif
+}
+
+
+static double elapsed_ms(struct timespec start) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (double) (long_time(end) - long_time(start)) / 1e6;
+}
+
+
+// Load, memory and simulation speed of one design
+static bool bench_design(generate_t *gen, GenerateFormat_t format) {
+	struct timespec start;
+	size_t gates = generate_flat_gates(gen);
+	char *name = generate_top(gen)->name;
+
+	if (! generate_write(gen, "build", format)) {
+		return false;
+	}
+
+
+	// Reading builds the whole hierarchy, compiling flattens it. The queue settles
+	// deep designs in one pass, where recursing follows every glitch.
+	SimEngine_t old_engine = sim_get_engine();
+	sim_set_engine(SimEngine_QUEUE);
+
+	library_t library;
+	library_init(&library);
+	library_add_path(&library, "build");
+
+	size_t memory = used_memory();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	circuit_t *circ = library_get(&library, name);
+
+	double load = elapsed_ms(start);
+	memory = used_memory() - memory;
+
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (circ == NULL || ! netlist_compile(&netlist, circ)) {
+		sim_set_engine(old_engine);
+		netlist_free(&netlist);
+		library_free(&library);
+		generate_remove(gen, "build");
+		return false;
+	}
+
+	double compile = elapsed_ms(start);
+
+
+	// Every op evaluates all vectors
+	pattern_t pattern;
+	pattern_init(&pattern, &netlist, GENERATE_BENCH_VECTORS);
+	pattern_set_exhaustive(&pattern, 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pattern_evaluate(&pattern);
+	double evaluate = elapsed_ms(start);
+
+	pattern_free(&pattern);
+
+
+	// Events of the circuit itself, toggling one input at a time
+	event_queue_t *queue = sim_get_queue();
+	event_queue_reset_stats(queue);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < GENERATE_BENCH_TOGGLES; i++) {
+		port_t *port = circuit_get_io_port_by_name(circ, netlist.inputs[i % netlist.amount_inputs].name);
+		port_set_state(port, ! port->state);
+	}
+
+	double events = elapsed_ms(start);
+	sim_set_engine(old_engine);
+
+
+	printf("%-32s %8lu gates %-4s load %9.2f ms %8.1f MiB   compile %9.2f ms   pattern %8.2f Mevals/s   events %8.2f Mevents/s\n",
+		name, gates, (format == GenerateFormat_JSON) ? "json" : "text",
+		load, (double) memory / (1 << 20), compile,
+		(double) netlist.amount_ops * GENERATE_BENCH_VECTORS / evaluate / 1e3,
+		(double) queue->events / events / 1e3);
+
+	netlist_free(&netlist);
+	library_free(&library);
+	generate_remove(gen, "build");
+
+	return true;
+}
+
+
+// Random DAGs and multipliers from 1k gates up, to 1M gates or BENCH_MAX_GATES
+test_result_t bench_generate(void) {
+	FUNC_START();
+	TEST_START;
+
+	size_t max_gates = GENERATE_BENCH_MAX_GATES;
+
+	if (getenv("BENCH_MAX_GATES") != NULL) {
+		max_gates = (size_t) strtoul(getenv("BENCH_MAX_GATES"), NULL, 10);
+	}
+
+	for (size_t gates = GENERATE_BENCH_MIN_GATES; gates <= max_gates; gates *= 10) {
+		for (size_t format = 0; format < 2; format++) {
+			generate_t gen;
+			generate_init(&gen);
+
+			assert_true(generate_random_dag(&gen, gates, 64, 64, 4, 1));
+			assert_true(bench_design(&gen, (GenerateFormat_t) format));
+
+			generate_free(&gen);
+		}
+
+		// About 6 gates per bit squared
+		size_t bits = 2;
+
+		while (6 * (bits + 1) * (bits + 1) <= gates) {
+			bits++;
+		}
+
+		generate_t gen;
+		generate_init(&gen);
+
+		assert_true(generate_multiplier(&gen, bits));
+		assert_true(bench_design(&gen, GenerateFormat_TEXT));
+
+		generate_free(&gen);
+	}
+
+	FUNC_END();
+	TEST_END;
+}
@@ -0,0 +1,124 @@
+#include "../read_template.h"
+#include "../intern.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+test_result_t test_intern(void) {
+	FUNC_START();
+	TEST_START;
+
+	// Equal strings share one copy
+	char buf[BUF_SIZE];
+	strcpy(buf, "I0");
+
+	char *a = intern("I0");
+	char *b = intern(buf);
+
+	assert_eq(a, b);
+	assert_neq(a, buf);
+	assert_str_eq(a, "I0");
+
+	// Only the given length is interned
+	assert_eq(intern_n("I0 and more", 2), a);
+	assert_neq(intern("I1"), a);
+
+	// Looking up never adds a string
+	size_t amount = intern_amount();
+
+	assert_eq(intern_lookup("I0"), a);
+	assert_eq(intern_lookup("never interned"), NULL);
+	assert_eq(intern_amount(), amount);
+
+
+	// Growing the table keeps all strings
+	char *strings[4096];
+
+	for (size_t i = 0; i < 4096; i++) {
+		sprintf(buf, "intern_test_%lu", i);
+		strings[i] = intern(buf);
+	}
+
+	for (size_t i = 0; i < 4096; i++) {
+		sprintf(buf, "intern_test_%lu", i);
+		assert_eq(intern_lookup(buf), strings[i]);
+	}
+
+	assert_eq(intern_lookup("I0"), a);
+
+
+	// Every instance of a template shares the names of its gates
+	circuit_t ha_circ;
+	circuit_init(&ha_circ);
+	circuit_t fa_circ;
+	circuit_init(&fa_circ);
+
+	library_t library;
+	library_init(&library);
+
+	assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+	assert_true(library_add(&library, &ha_circ, false));
+	assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+	size_t customs = 0;
+
+	HEX_HASHMAP_EACH_VALUE(fa_circ.gates, gate_t *gate) {
+		if (gate->inner_circuit == NULL) {
+			continue;
+		}
+
+		assert_eq(gate->type, ha_circ.name);
+		assert_eq(gate->inner_circuit->name, ha_circ.name);
+		customs++;
+	}
+
+	assert_eq(customs, 2);
+
+	circuit_free(&fa_circ);
+	circuit_free(&ha_circ);
+	library_free(&library);
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Load the same templates many times, which shouldn't intern any new strings
+test_result_t bench_intern(void) {
+	FUNC_START();
+	TEST_START;
+
+	struct timespec start = {0, 0};
+	struct timespec end = {0, 0};
+
+	const size_t loads = 1000;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < loads; i++) {
+		circuit_t ha_circ;
+		circuit_init(&ha_circ);
+		circuit_t fa_circ;
+		circuit_init(&fa_circ);
+
+		library_t library;
+		library_init(&library);
+
+		assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+		assert_true(library_add(&library, &ha_circ, false));
+		assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+		circuit_free(&fa_circ);
+		circuit_free(&ha_circ);
+		library_free(&library);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("full_adder loads %12.0f loads/s\n", (double) loads * 1e9 / (double) (long_time(end) - long_time(start)));
+	intern_print();
+
+	FUNC_END();
+	TEST_END;
+}
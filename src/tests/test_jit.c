@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../jit.h"
+#include "../pattern_kernels.h"
+#include "../generate.h"
+#include "../test.h"
+#include "../benchmark.h"
+#include "helpers.h"
+
+
+// Multipliers in bench_jit, from JIT_BENCH_MIN_BITS up to JIT_BENCH_MAX_BITS
+#define JIT_BENCH_MIN_BITS 8
+#define JIT_BENCH_MAX_BITS 64
+
+// Op evaluations each benchmark runs at least
+#define JIT_BENCH_OPS 200000000
+
+
+static void set_random_inputs(pattern_t *pattern) {
+	for (size_t i = 0; i < pattern->netlist->amount_inputs; i++) {
+		uint64_t *words = pattern_get_net(pattern, pattern->netlist->inputs[i].net);
+
+		for (size_t w = 0; w < pattern->words; w++) {
+			words[w] = (uint64_t) rand() << 32 ^ (uint64_t) rand() << 16 ^ (uint64_t) rand();
+		}
+	}
+}
+
+
+// Whether the compiled code gives every net the same words as the interpreter
+static bool check_jit(netlist_t *netlist, size_t words, bool compiled) {
+	jit_t jit;
+	jit_init(&jit);
+
+	bool success = jit_compile(&jit, netlist, words) == compiled;
+
+	pattern_t interpreted, jitted;
+	pattern_init(&interpreted, netlist, words * PATTERN_WORD_BITS);
+	pattern_init(&jitted, netlist, words * PATTERN_WORD_BITS);
+
+	success &= jit_is_compiled(&jit, &jitted) == compiled;
+	success &= ! compiled || (jit.step <= pattern_kernels_get()->words && words % jit.step == 0);
+
+	for (size_t i = 0; i < 4; i++) {
+		set_random_inputs(&interpreted);
+		memcpy(jitted.state, interpreted.state, netlist->amount_nets * words * sizeof(uint64_t));
+
+		pattern_evaluate(&interpreted);
+		jit_evaluate(&jit, &jitted);
+
+		success &= memcmp(jitted.state, interpreted.state, netlist->amount_nets * words * sizeof(uint64_t)) == 0;
+	}
+
+	pattern_free(&interpreted);
+	pattern_free(&jitted);
+	jit_free(&jit);
+
+	return success;
+}
+
+
+test_result_t test_jit(void) {
+	FUNC_START();
+	TEST_START;
+
+	PatternKernels_t all_kernels[] = { PatternKernels_WORD, PatternKernels_AVX2, PatternKernels_AVX512 };
+
+	srand(42);
+
+	generate_t gens[3];
+	generate_init(&gens[0]);
+	assert_true(generate_random_dag(&gens[0], 2000, 32, 16, 4, 3));
+	generate_init(&gens[1]);
+	assert_true(generate_multiplier(&gens[1], 8));
+	generate_init(&gens[2]);
+	assert_true(generate_lookahead_adder(&gens[2], 32));
+
+	for (size_t i = 0; i < 3; i++) {
+		netlist_t netlist;
+		netlist_init(&netlist);
+		assert_true(helpers_compile_design(&gens[i], GenerateFormat_JSON, &netlist));
+
+		// Every width of registers, and amounts of words that only narrower ones fit
+		for (size_t k = 0; k < sizeof(all_kernels) / sizeof(*all_kernels); k++) {
+			if (! pattern_kernels_select(all_kernels[k])) {
+				continue;
+			}
+
+			for (size_t words = 1; words <= JIT_MAX_WORDS + 1; words++) {
+				assert_true(check_jit(&netlist, words, jit_supported() && words <= JIT_MAX_WORDS));
+			}
+		}
+
+		pattern_kernels_select(pattern_kernels_best());
+
+		// Patterns of another size are interpreted
+		jit_t jit;
+		jit_init(&jit);
+		jit_compile(&jit, &netlist, 2);
+
+		pattern_t pattern;
+		pattern_init(&pattern, &netlist, PATTERN_WORD_BITS);
+		assert_false(jit_is_compiled(&jit, &pattern));
+
+		set_random_inputs(&pattern);
+		jit_evaluate(&jit, &pattern);
+
+		pattern_free(&pattern);
+		jit_free(&jit);
+
+		netlist_free(&netlist);
+		generate_free(&gens[i]);
+	}
+
+
+	// Without any ops the code only returns
+	generate_t gen;
+	generate_init(&gen);
+
+	generate_template_t *template = generate_template(&gen, "jit_wire");
+	generate_output(template, "O0", generate_input(template, "I0"));
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+	assert_true(helpers_compile_design(&gen, GenerateFormat_JSON, &netlist));
+	assert_eq(netlist.amount_ops, 0);
+	assert_true(check_jit(&netlist, 1, jit_supported()));
+
+	netlist_free(&netlist);
+	generate_free(&gen);
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+static double time_evaluate(jit_t *jit, pattern_t *pattern, bool compiled, size_t iterations) {
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < iterations; i++) {
+		if (compiled) {
+			jit_evaluate(jit, pattern);
+		}
+		else {
+			pattern_evaluate(pattern);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (double) (long_time(end) - long_time(start)) / 1e9;
+}
+
+
+// Gates per second of the interpreter and the compiled code, on multipliers, both with
+// the best kernels of this CPU. Above JIT_MAX_WORDS the compiled column falls back to
+// the interpreter.
+test_result_t bench_jit(void) {
+	FUNC_START();
+	TEST_START;
+
+	printf("%-24s %8s %6s %10s %14s %14s %8s\n", "design", "ops", "words", "compile", "interpreted", "compiled", "speedup");
+
+	for (size_t bits = JIT_BENCH_MIN_BITS; bits <= JIT_BENCH_MAX_BITS; bits *= 2) {
+		generate_t gen;
+		generate_init(&gen);
+		assert_true(generate_multiplier(&gen, bits));
+
+		netlist_t netlist;
+		netlist_init(&netlist);
+		assert_true(helpers_compile_design(&gen, GenerateFormat_JSON, &netlist));
+
+		for (size_t words = 1; words <= 2 * JIT_MAX_WORDS; words *= 2) {
+			jit_t jit;
+			jit_init(&jit);
+
+			struct timespec start, end;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			assert_eq(jit_compile(&jit, &netlist, words), jit_supported() && words <= JIT_MAX_WORDS);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			pattern_t pattern;
+			pattern_init(&pattern, &netlist, words * PATTERN_WORD_BITS);
+			set_random_inputs(&pattern);
+
+			// Every op evaluates 64 gates per word
+			size_t iterations = JIT_BENCH_OPS / (netlist.amount_ops * words) + 1;
+			double gates = (double) iterations * (double) netlist.amount_ops * (double) (words * PATTERN_WORD_BITS);
+
+			double interpreted = gates / time_evaluate(&jit, &pattern, false, iterations);
+			double compiled = gates / time_evaluate(&jit, &pattern, true, iterations);
+
+			printf("%-24s %8lu %6lu %8.2fms %10.2e/s %12.2e/s %7.2fx\n", generate_top(&gen)->name, netlist.amount_ops, words,
+				(double) (long_time(end) - long_time(start)) / 1e6, interpreted, compiled, compiled / interpreted);
+
+			pattern_free(&pattern);
+			jit_free(&jit);
+		}
+
+		netlist_free(&netlist);
+		generate_free(&gen);
+	}
+
+	FUNC_END();
+	TEST_END;
+}
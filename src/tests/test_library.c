@@ -0,0 +1,223 @@
+#include <stdio.h>
+
+#include "../library.h"
+#include "../read_json.h"
+#include "../test.h"
+#include "../benchmark.h"
+#include "helpers.h"
+
+
+#define LIBRARY_BENCH_CELLS 256
+#define LIBRARY_BENCH_INSTANCES 16
+
+
+static size_t count_custom_gates(circuit_t *circ) {
+	size_t amount = 0;
+
+	HEX_HASHMAP_EACH_VALUE(circ->gates, gate_t *gate) {
+		amount += gate->kind == GateKind_CUSTOM;
+	}
+
+	return amount;
+}
+
+
+test_result_t test_library(void) {
+	FUNC_START();
+	TEST_START;
+
+
+	// Dependencies are loaded when they're first used
+	{
+		library_t library;
+		library_init(&library);
+
+		assert_true(library_add_path(&library, "tests"));
+		assert_false(library_contains(&library, "half_adder"));
+
+		circuit_t *fa = library_get(&library, "full_adder");
+
+		assert_not_null(fa);
+		assert_str_eq(fa->name, "full_adder");
+		assert_eq(count_custom_gates(fa), 2);
+
+		assert_true(library_contains(&library, "half_adder"));
+		assert_eq(library_amount(&library), 2);
+
+		// Only read once
+		assert_eq(library_get(&library, "full_adder"), fa);
+		assert_eq(library_amount(&library), 2);
+
+
+		// The flattened form is made once, and leaves the nested one alone
+		circuit_t *flat = library_get_flat(&library, "notor2");
+
+		assert_not_null(flat);
+		assert_eq(count_custom_gates(flat), 0);
+		assert_eq(library_get_flat(&library, "notor2"), flat);
+		assert_eq(count_custom_gates(library_get(&library, "notor2")), 2);
+
+		port_t *i0 = circuit_get_io_port_by_name(flat, "I0");
+		port_t *i1 = circuit_get_io_port_by_name(flat, "I1");
+		port_t *o0 = circuit_get_io_port_by_name(flat, "O0");
+
+		assert_not_null(i0);
+		assert_not_null(i1);
+		assert_not_null(o0);
+
+		// notor is always on, so is the OR of two
+		port_set_state(i0, false);
+		port_set_state(i1, true);
+		assert_true(o0->state);
+
+
+		// Missing templates are remembered
+		assert_eq(library_get(&library, "missing"), NULL);
+		assert_eq(library_get(&library, "missing"), NULL);
+		assert_true(library_contains(&library, "missing"));
+
+		library_free(&library);
+	}
+
+
+	// Templates that contain each other
+	{
+		helpers_write_string("build/library_cycle_a", "library_cycle_a\n[gates] 1\n0 library_cycle_b\n[wires] 0\n");
+		helpers_write_string("build/library_cycle_b", "library_cycle_b\n[gates] 1\n0 library_cycle_a\n[wires] 0\n");
+
+		library_t library;
+		library_init(&library);
+
+		assert_true(library_add_path(&library, "build"));
+		assert_eq(library_get(&library, "library_cycle_a"), NULL);
+		assert_eq(library_get(&library, "library_cycle_b"), NULL);
+
+		library_free(&library);
+
+		remove("build/library_cycle_a");
+		remove("build/library_cycle_b");
+	}
+
+
+	// JSON templates, using a text template that isn't in the file
+	{
+		helpers_write_string("build/library_json.json",
+			"{ \"name\": \"library_json\", \"circuit\": { \"gates\": {"
+			" \"0\": { \"type\": \"IN\" }, \"1\": { \"type\": \"notor\" }, \"2\": { \"type\": \"OUT\" } },"
+			" \"wires\": [ { \"a\": \"0:I0\", \"b\": \"1:I0\" }, { \"a\": \"1:O0\", \"b\": \"2:O0\" } ] } }"
+		);
+
+		library_t library;
+		library_init(&library);
+
+		assert_true(library_add_path(&library, "build"));
+		assert_true(library_add_path(&library, "tests"));
+
+		circuit_t *circ = library_get(&library, "library_json");
+
+		assert_not_null(circ);
+		assert_true(library_contains(&library, "notor"));
+
+		port_set_state(circuit_get_io_port_by_name(circ, "I0"), true);
+		assert_true(circuit_get_io_port_by_name(circ, "O0")->state);
+
+		library_free(&library);
+
+		remove("build/library_json.json");
+	}
+
+
+	// The custom gates of an export are shared with later ones
+	{
+		library_t library;
+		library_init(&library);
+
+		circuit_t a;
+		circuit_init(&a);
+		circuit_t b;
+		circuit_init(&b);
+
+		assert_true(read_json("tests/notor2.json", &a, &library));
+		circuit_t *notor = library_get(&library, "notor");
+
+		assert_true(read_json("tests/notor2.json", &b, &library));
+		assert_eq(library_get(&library, "notor"), notor);
+		assert_eq(library_amount(&library), 1);
+
+		// Circuits that are added aren't freed by the library
+		assert_true(library_add(&library, &a, false));
+		assert_false(library_add(&library, &b, false));
+
+		library_free(&library);
+		circuit_free(&b);
+		circuit_free(&a);
+	}
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// A top level circuit using many cells, each a few times
+test_result_t bench_library(void) {
+	FUNC_START();
+	TEST_START;
+
+	char filename[BUF_SIZE];
+
+	for (size_t i = 0; i < LIBRARY_BENCH_CELLS; i++) {
+		sprintf(filename, "build/library_cell_%lu", i);
+
+		FILE *file = fopen(filename, "w");
+		fprintf(file, "library_cell_%lu\n[gates] 3\n0 IN #I0\n1 NOT\n2 OUT #O0\n[wires] 2\n0:I0 1:I0\n1:O0 2:O0\n", i);
+		fclose(file);
+	}
+
+	FILE *file = fopen("build/library_top", "w");
+	fprintf(file, "library_top\n[gates] %d\n", LIBRARY_BENCH_CELLS * LIBRARY_BENCH_INSTANCES);
+
+	for (size_t i = 0; i < LIBRARY_BENCH_CELLS * LIBRARY_BENCH_INSTANCES; i++) {
+		fprintf(file, "%lu library_cell_%lu\n", i, i % LIBRARY_BENCH_CELLS);
+	}
+
+	fprintf(file, "[wires] 0\n");
+	fclose(file);
+
+
+	struct timespec start, end;
+	size_t loads = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (; loads < 20; loads++) {
+		library_t library;
+		library_init(&library);
+
+		assert_true(library_add_path(&library, "build"));
+		assert_not_null(library_get(&library, "library_top"));
+		assert_eq(library_amount(&library), LIBRARY_BENCH_CELLS + 1);
+
+		library_free(&library);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double seconds = (double) (long_time(end) - long_time(start)) / 1e9;
+
+	printf("library_top %d cells, %d instances: %8.3f ms per load, %12.0f instances/s\n",
+		LIBRARY_BENCH_CELLS, LIBRARY_BENCH_CELLS * LIBRARY_BENCH_INSTANCES,
+		seconds * 1e3 / (double) loads,
+		(double) (loads * LIBRARY_BENCH_CELLS * LIBRARY_BENCH_INSTANCES) / seconds);
+
+
+	for (size_t i = 0; i < LIBRARY_BENCH_CELLS; i++) {
+		sprintf(filename, "build/library_cell_%lu", i);
+		remove(filename);
+	}
+
+	remove("build/library_top");
+
+	FUNC_END();
+	TEST_END;
+}
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "../loader.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+#define LOADER_BLOCKS 32
+#define LOADER_CELLS_PER_BLOCK 64
+#define LOADER_BLOCKS_PER_TOP 8
+
+
+static _Atomic size_t loader_test_jobs = 0;
+
+
+static void count_job(void *arg) {
+	thread_pool_t *pool = arg;
+
+	// Every tenth job pushes another one
+	if (atomic_fetch_add(&loader_test_jobs, 1) % 10 == 0) {
+		thread_pool_push(pool, count_job, pool);
+	}
+}
+
+
+// A chain of cells between an input and an output, every gate named by its index
+static void write_chain(char *name, char *cell, size_t length) {
+	char filename[sizeof("build/") + strlen(name)];
+	sprintf(filename, "build/%s", name);
+
+	FILE *file = fopen(filename, "w");
+
+	fprintf(file, "%s\n[gates] %lu\n0 IN #I0\n1 OUT #O0\n", name, length + 2);
+
+	for (size_t i = 0; i < length; i++) {
+		fprintf(file, "%lu %s\n", i + 2, cell);
+	}
+
+	fprintf(file, "[wires] %lu\n", length + 1);
+
+	for (size_t i = 0; i <= length; i++) {
+		fprintf(file, "%lu:%s %lu:%s\n", (i == 0) ? 0 : i + 1, (i == 0) ? "I0" : "O0", (i == length) ? 1 : i + 2, (i == length) ? "O0" : "I0");
+	}
+
+	fclose(file);
+}
+
+
+// Cells of NOT gates, blocks of cells, and a top level of blocks
+static void write_hierarchy(void) {
+	char name[BUF_SIZE];
+	char cell[BUF_SIZE];
+
+	for (size_t i = 0; i < LOADER_BLOCKS; i++) {
+		sprintf(name, "loader_cell_%lu", i);
+		write_chain(name, "NOT", 4);
+	}
+
+	for (size_t i = 0; i < LOADER_BLOCKS; i++) {
+		sprintf(name, "loader_block_%lu", i);
+
+		// Every block uses a different cell, so they're all read
+		sprintf(cell, "loader_cell_%lu", i);
+		write_chain(name, cell, LOADER_CELLS_PER_BLOCK);
+	}
+
+	// The top level has to wait for all blocks, which are independent
+	FILE *file = fopen("build/loader_top", "w");
+
+	fprintf(file, "loader_top\n[gates] %d\n", LOADER_BLOCKS * LOADER_BLOCKS_PER_TOP);
+
+	for (size_t i = 0; i < LOADER_BLOCKS * LOADER_BLOCKS_PER_TOP; i++) {
+		fprintf(file, "%lu loader_block_%lu\n", i, i % LOADER_BLOCKS);
+	}
+
+	fprintf(file, "[wires] 0\n");
+	fclose(file);
+}
+
+
+static void remove_hierarchy(void) {
+	char filename[BUF_SIZE];
+
+	for (size_t i = 0; i < LOADER_BLOCKS; i++) {
+		sprintf(filename, "build/loader_cell_%lu", i);
+		remove(filename);
+	}
+
+	for (size_t i = 0; i < LOADER_BLOCKS; i++) {
+		sprintf(filename, "build/loader_block_%lu", i);
+		remove(filename);
+	}
+
+	remove("build/loader_top");
+}
+
+
+test_result_t test_loader(void) {
+	FUNC_START();
+	TEST_START;
+
+
+	// Jobs can push more jobs, which are waited for too
+	{
+		thread_pool_t pool;
+		thread_pool_init(&pool, 4);
+
+		for (size_t i = 0; i < 1000; i++) {
+			thread_pool_push(&pool, count_job, &pool);
+		}
+
+		thread_pool_wait(&pool);
+
+		// 1000 jobs, and one more for every tenth of all jobs
+		assert_eq(atomic_load(&loader_test_jobs), 1112);
+
+		thread_pool_free(&pool);
+	}
+
+
+	// Read on threads, then the same as reading lazily
+	{
+		library_t parallel;
+		library_init(&parallel);
+		assert_true(library_add_path(&parallel, "tests"));
+
+		library_t serial;
+		library_init(&serial);
+		assert_true(library_add_path(&serial, "tests"));
+
+		char *names[] = { "full_adder", "notor2", "full_adder" };
+
+		assert_true(loader_flatten(&parallel, names, 3, 4));
+		assert_eq(library_amount(&parallel), 4);
+		assert_true(library_contains(&parallel, "half_adder"));
+		assert_true(library_contains(&parallel, "notor"));
+
+		circuit_t *a = library_get_flat(&parallel, "full_adder");
+		circuit_t *b = library_get_flat(&serial, "full_adder");
+
+		assert_not_null(a);
+		assert_not_null(b);
+		assert_eq(hex_hashmap_amount(&a->gates), hex_hashmap_amount(&b->gates));
+
+		char *inputs[] = { "I0", "I1", "Ci" };
+		char *outputs[] = { "S", "Co" };
+
+		for (unsigned int combination = 0; combination < 8; combination++) {
+			for (size_t i = 0; i < 3; i++) {
+				port_set_state(circuit_get_io_port_by_name(a, inputs[i]), (combination >> i) & 1);
+				port_set_state(circuit_get_io_port_by_name(b, inputs[i]), (combination >> i) & 1);
+			}
+
+			for (size_t i = 0; i < 2; i++) {
+				assert_eq(circuit_get_io_port_by_name(a, outputs[i])->state, circuit_get_io_port_by_name(b, outputs[i])->state);
+			}
+		}
+
+		// Everything is read already
+		assert_true(loader_load(&parallel, names, 3, 4));
+		assert_eq(library_amount(&parallel), 4);
+
+		library_free(&serial);
+		library_free(&parallel);
+	}
+
+
+	// A deeper hierarchy
+	{
+		write_hierarchy();
+
+		library_t library;
+		library_init(&library);
+		assert_true(library_add_path(&library, "build"));
+
+		char *names[] = { "loader_top" };
+
+		assert_true(loader_load(&library, names, 1, 4));
+		assert_eq(library_amount(&library), LOADER_BLOCKS + LOADER_BLOCKS + 1);
+
+		library_free(&library);
+		remove_hierarchy();
+	}
+
+
+	// Templates that can't be read
+	{
+		FILE *file = fopen("build/loader_cycle_a", "w");
+		fputs("loader_cycle_a\n[gates] 1\n0 loader_cycle_b\n[wires] 0\n", file);
+		fclose(file);
+
+		file = fopen("build/loader_cycle_b", "w");
+		fputs("loader_cycle_b\n[gates] 1\n0 loader_cycle_a\n[wires] 0\n", file);
+		fclose(file);
+
+		library_t library;
+		library_init(&library);
+		assert_true(library_add_path(&library, "build"));
+
+		char *cycle[] = { "loader_cycle_a" };
+		char *missing[] = { "loader_missing" };
+
+		assert_false(loader_load(&library, cycle, 1, 4));
+		assert_false(loader_load(&library, missing, 1, 4));
+		assert_eq(library_amount(&library), 0);
+
+		library_free(&library);
+
+		remove("build/loader_cycle_a");
+		remove("build/loader_cycle_b");
+	}
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+test_result_t bench_loader(void) {
+	FUNC_START();
+	TEST_START;
+
+	write_hierarchy();
+
+	char *names[] = { "loader_top" };
+	size_t threads = thread_pool_cores();
+
+	for (size_t parallel = 0; parallel < 2; parallel++) {
+		struct timespec start, end;
+
+		library_t library;
+		library_init(&library);
+		assert_true(library_add_path(&library, "build"));
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		if (parallel) {
+			assert_true(loader_flatten(&library, names, 1, threads));
+		}
+		else {
+			assert_not_null(library_get_flat(&library, "loader_top"));
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		printf("loader_top %s %2lu threads: %8.3f ms, %lu flat gates\n",
+			parallel ? "loader_flatten  " : "library_get_flat", parallel ? threads : 1,
+			(double) (long_time(end) - long_time(start)) / 1e6,
+			hex_hashmap_amount(&library_get_flat(&library, "loader_top")->gates));
+
+		library_free(&library);
+	}
+
+	remove_hierarchy();
+
+	FUNC_END();
+	TEST_END;
+}
@@ -22,19 +22,16 @@ test_result_t test_nested(void) {
 	TEST_START;
 
 	// Create circuit
-	circuit_t notor;
-	circuit_init(&notor);
 	circuit_t notor2;
 	circuit_init(&notor2);
 
-	vector_t deps;
-	vector_init(&deps, 4);
+	// notor is read from the library when it's first used
+	library_t library;
+	library_init(&library);
+	assert_true(library_add_path(&library, "tests"));
 
-	// Read templates
-	assert_true(read_template("tests/notor", &notor, NULL));
-	assert_true(vector_push(&deps, &notor));
-
-	assert_true(read_template("tests/notor2", &notor2, &deps));
+	// Read template
+	assert_true(read_template("tests/notor2", &notor2, &library));
 
 
 	// ... Do fun things
@@ -93,8 +90,7 @@ test_result_t test_nested(void) {
 
 	// Free everything
 	circuit_free(&notor2);
-	circuit_free(&notor);
-	vector_free(&deps);
+	library_free(&library);
 
 
 	FUNC_END();
@@ -0,0 +1,259 @@
+#include "../read_template.h"
+#include "../netlist.h"
+#include "../intern.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+// Run every input combination through both the circuit and its netlist, and compare the outputs
+static bool netlist_matches_circuit(netlist_t *netlist, circuit_t *circ) {
+	FUNC_START();
+
+	bool matches = true;
+
+	bool inputs[BUF_SIZE];
+	bool outputs[BUF_SIZE];
+
+	for (unsigned long combination = 0; combination < (1ul << netlist->amount_inputs); combination++) {
+		for (size_t i = 0; i < netlist->amount_inputs; i++) {
+			inputs[i] = (combination >> i) & 1;
+
+			port_set_state(circuit_get_io_port_by_name(circ, netlist->inputs[i].name), inputs[i]);
+		}
+
+		netlist_apply(netlist, inputs, outputs);
+
+		for (size_t i = 0; i < netlist->amount_outputs; i++) {
+			port_t *port = circuit_get_io_port_by_name(circ, netlist->outputs[i].name);
+
+			matches &= port->state == outputs[i];
+		}
+	}
+
+	FUNC_END();
+	return matches;
+}
+
+
+// Whether the fanout of every net has exactly the ops that read it, once
+static bool netlist_fanout_matches(netlist_t *netlist) {
+	size_t amount = 0;
+
+	for (uint32_t i = 0; i < netlist->amount_ops; i++) {
+		netlist_op_t *op = &netlist->ops[i];
+		uint32_t nets[2] = { op->in0, op->in1 };
+
+		for (size_t j = 0; j < ((nets[0] == nets[1]) ? 1 : 2); j++) {
+			size_t found = 0;
+
+			for (uint32_t k = netlist->fanout_start[nets[j]]; k < netlist->fanout_start[nets[j] + 1]; k++) {
+				found += netlist->fanout[k] == i;
+			}
+
+			if (found != 1) {
+				return false;
+			}
+
+			amount++;
+		}
+	}
+
+	return netlist->fanout_start[netlist->amount_nets] == amount;
+}
+
+
+test_result_t test_netlist(void) {
+	FUNC_START();
+	TEST_START;
+
+
+	// Flat circuit
+	{
+		circuit_t circ;
+		circuit_init(&circ);
+
+		assert_true(read_template("tests/xor", &circ, NULL));
+
+		netlist_t netlist;
+		netlist_init(&netlist);
+
+		assert_true(netlist_compile(&netlist, &circ));
+
+		// NOT(AND) -> AND(_, OR)
+		assert_eq(netlist.amount_ops, 4);
+		assert_eq(netlist.amount_levels, 3);
+		assert_eq(netlist.amount_inputs, 2);
+		assert_eq(netlist.amount_outputs, 1);
+
+		assert_true(netlist_matches_circuit(&netlist, &circ));
+		assert_true(netlist_fanout_matches(&netlist));
+
+		netlist_free(&netlist);
+		circuit_free(&circ);
+	}
+
+
+	// Nested custom gates
+	{
+		circuit_t ha_circ;
+		circuit_init(&ha_circ);
+		circuit_t fa_circ;
+		circuit_init(&fa_circ);
+
+		library_t library;
+		library_init(&library);
+
+		assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+		assert_true(library_add(&library, &ha_circ, false));
+		assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+		netlist_t netlist;
+		netlist_init(&netlist);
+
+		assert_true(netlist_compile(&netlist, &fa_circ));
+
+		// 2 half adders of 2 gates, and an OR
+		assert_eq(netlist.amount_ops, 5);
+		assert_eq(netlist.amount_inputs, 3);
+		assert_eq(netlist.amount_outputs, 2);
+
+		// Inputs are sorted by name
+		assert_str_eq(netlist.inputs[0].name, "Ci");
+		assert_not_null(netlist_get_output_by_name(&netlist, "Co"));
+
+		assert_true(netlist_matches_circuit(&netlist, &fa_circ));
+		assert_true(netlist_fanout_matches(&netlist));
+
+		netlist_free(&netlist);
+		circuit_free(&fa_circ);
+		circuit_free(&ha_circ);
+		library_free(&library);
+	}
+
+
+	// Loops can't be levelized
+	{
+		circuit_t circ;
+		circuit_init(&circ);
+
+		circ.name = intern("loop");
+
+		port_t *ports[2][2];
+
+		for (size_t i = 0; i < 2; i++) {
+			gate_t *g = malloc(sizeof(gate_t));
+			gate_init(g);
+
+			char name[BUF_SIZE];
+			sprintf(name, "%lu", i);
+
+			g->name = intern(name);
+			g->type = intern("NOT");
+
+			gate_set_ports(g, NULL, NULL);
+			hex_hashmap_add_item(&circ.gates, g->name, g);
+
+			ports[i][0] = g->ports.items[0];
+			ports[i][1] = g->ports.items[1];
+		}
+
+		// Cross-couple the inverters
+		for (size_t i = 0; i < 2; i++) {
+			vector_push(&ports[i][1]->connections, ports[1 - i][0]);
+			vector_push(&ports[1 - i][0]->connections, ports[i][1]);
+		}
+
+		netlist_t netlist;
+		netlist_init(&netlist);
+
+		assert_false(netlist_compile(&netlist, &circ));
+		assert_eq(netlist.ops, NULL);
+
+		netlist_free(&netlist);
+		circuit_free(&circ);
+	}
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Compare the recursive engine with the levelized netlist
+test_result_t bench_netlist(void) {
+	FUNC_START();
+	TEST_START;
+
+	circuit_t ha_circ;
+	circuit_init(&ha_circ);
+	circuit_t fa_circ;
+	circuit_init(&fa_circ);
+
+	library_t library;
+	library_init(&library);
+
+	assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+	assert_true(library_add(&library, &ha_circ, false));
+	assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+
+	assert_true(netlist_compile(&netlist, &fa_circ));
+
+
+	const unsigned long vectors = 1000000;
+
+	struct timespec start = {0, 0};
+	struct timespec end = {0, 0};
+
+
+	port_t *ports[3] = {
+		circuit_get_io_port_by_name(&fa_circ, "Ci"),
+		circuit_get_io_port_by_name(&fa_circ, "I0"),
+		circuit_get_io_port_by_name(&fa_circ, "I1"),
+	};
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long v = 0; v < vectors; v++) {
+		for (size_t i = 0; i < 3; i++) {
+			port_set_state(ports[i], (v >> i) & 1);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double recursive_time = (double) (long_time(end) - long_time(start)) / 1e9;
+
+
+	bool inputs[3];
+	bool outputs[2];
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long v = 0; v < vectors; v++) {
+		for (size_t i = 0; i < 3; i++) {
+			inputs[i] = (v >> i) & 1;
+		}
+
+		netlist_apply(&netlist, inputs, outputs);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double levelized_time = (double) (long_time(end) - long_time(start)) / 1e9;
+
+
+	printf("full_adder recursive  %.0f vectors/s\n", (double) vectors / recursive_time);
+	printf("full_adder levelized  %.0f vectors/s\n", (double) vectors / levelized_time);
+
+
+	netlist_free(&netlist);
+	circuit_free(&fa_circ);
+	circuit_free(&ha_circ);
+	library_free(&library);
+
+	FUNC_END();
+	TEST_END;
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+
+#include "../read_template.h"
+#include "../netlist_file.h"
+#include "../intern.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+#define NETLIST_FILE_TEST_PATH "build/test_netlist_file.net"
+
+
+static bool load_full_adder(netlist_t *netlist) {
+	FUNC_START();
+
+	circuit_t ha_circ;
+	circuit_init(&ha_circ);
+	circuit_t fa_circ;
+	circuit_init(&fa_circ);
+
+	library_t library;
+	library_init(&library);
+
+	bool success = read_template("tests/half_adder", &ha_circ, NULL);
+	success &= library_add(&library, &ha_circ, false);
+	success &= read_template("tests/full_adder", &fa_circ, &library);
+	success &= netlist_compile(netlist, &fa_circ);
+
+	circuit_free(&fa_circ);
+	circuit_free(&ha_circ);
+	library_free(&library);
+
+	FUNC_END();
+	return success;
+}
+
+
+test_result_t test_netlist_file(void) {
+	FUNC_START();
+	TEST_START;
+
+	netlist_t compiled;
+	netlist_init(&compiled);
+
+	assert_true(load_full_adder(&compiled));
+	assert_true(netlist_file_save(&compiled, NETLIST_FILE_TEST_PATH));
+
+	bool saved_state[BUF_SIZE];
+	memcpy(saved_state, compiled.state, compiled.amount_nets * sizeof(bool));
+
+
+	// Round trip
+	netlist_t opened;
+	netlist_init(&opened);
+
+	assert_true(netlist_file_open(&opened, NETLIST_FILE_TEST_PATH));
+	assert_not_null(opened.mapping);
+
+	assert_eq(opened.name, compiled.name);
+	assert_eq(opened.amount_ops, compiled.amount_ops);
+	assert_eq(opened.amount_nets, compiled.amount_nets);
+	assert_eq(opened.amount_levels, compiled.amount_levels);
+	assert_eq(opened.amount_inputs, compiled.amount_inputs);
+	assert_eq(opened.amount_outputs, compiled.amount_outputs);
+
+	assert_eq(memcmp(opened.ops, compiled.ops, compiled.amount_ops * sizeof(netlist_op_t)), 0);
+	assert_eq(memcmp(opened.fanout_start, compiled.fanout_start, (compiled.amount_nets + 1) * sizeof(uint32_t)), 0);
+	assert_eq(memcmp(opened.level_start, compiled.level_start, (compiled.amount_levels + 1) * sizeof(size_t)), 0);
+
+	// Names are interned again
+	for (size_t i = 0; i < compiled.amount_ops; i++) {
+		assert_eq(opened.op_names[i], compiled.op_names[i]);
+	}
+
+	for (size_t i = 0; i < compiled.amount_inputs; i++) {
+		assert_eq(opened.inputs[i].name, compiled.inputs[i].name);
+		assert_eq(opened.inputs[i].net, compiled.inputs[i].net);
+	}
+
+	assert_eq(netlist_get_output_by_name(&opened, "Co")->net, netlist_get_output_by_name(&compiled, "Co")->net);
+
+
+	// Both evaluate the same
+	bool inputs[3];
+	bool expected[2];
+	bool actual[2];
+	size_t matches = 0;
+
+	for (unsigned int v = 0; v < 8; v++) {
+		for (size_t i = 0; i < 3; i++) {
+			inputs[i] = (v >> i) & 1;
+		}
+
+		netlist_apply(&compiled, inputs, expected);
+		netlist_apply(&opened, inputs, actual);
+
+		matches += expected[0] == actual[0] && expected[1] == actual[1];
+	}
+
+	assert_eq(matches, 8);
+
+	netlist_free(&opened);
+
+
+	// Evaluating doesn't change the file
+	netlist_init(&opened);
+	assert_true(netlist_file_open(&opened, NETLIST_FILE_TEST_PATH));
+	assert_eq(memcmp(opened.state, saved_state, compiled.amount_nets * sizeof(bool)), 0);
+	netlist_free(&opened);
+
+
+	// Corrupt files are rejected, also when an amount wraps around once it's counted up
+	FILE *file = fopen(NETLIST_FILE_TEST_PATH, "r+b");
+	assert_not_null(file);
+
+	netlist_file_header_t header;
+	assert_eq(fread(&header, sizeof(header), 1, file), 1);
+
+	netlist_file_header_t corrupt[2] = { header, header };
+	corrupt[0].amount_nets = 1ul << 40;
+	corrupt[1].amount_levels = UINT64_MAX;
+
+	for (size_t i = 0; i < 2; i++) {
+		fseek(file, 0, SEEK_SET);
+		assert_eq(fwrite(&corrupt[i], sizeof(header), 1, file), 1);
+		fflush(file);
+
+		netlist_init(&opened);
+		assert_false(netlist_file_open(&opened, NETLIST_FILE_TEST_PATH));
+		assert_eq(opened.ops, NULL);
+	}
+
+	fclose(file);
+
+	assert_false(netlist_file_open(&opened, "build/does_not_exist.net"));
+
+	remove(NETLIST_FILE_TEST_PATH);
+
+
+	netlist_free(&compiled);
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Compare starting from the text templates with opening a compiled netlist
+test_result_t bench_netlist_file(void) {
+	FUNC_START();
+	TEST_START;
+
+	const size_t loads = 1000;
+
+	struct timespec start = {0, 0};
+	struct timespec end = {0, 0};
+
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < loads; i++) {
+		netlist_t netlist;
+		netlist_init(&netlist);
+
+		assert_true(load_full_adder(&netlist));
+
+		if (i == 0) {
+			assert_true(netlist_file_save(&netlist, NETLIST_FILE_TEST_PATH));
+		}
+
+		netlist_free(&netlist);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double template_time = (double) (long_time(end) - long_time(start)) / (double) loads;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < loads; i++) {
+		netlist_t netlist;
+		netlist_init(&netlist);
+
+		assert_true(netlist_file_open(&netlist, NETLIST_FILE_TEST_PATH));
+
+		netlist_free(&netlist);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double file_time = (double) (long_time(end) - long_time(start)) / (double) loads;
+
+	remove(NETLIST_FILE_TEST_PATH);
+
+
+	printf("full_adder read_template + compile  %10.0f ns\n", template_time);
+	printf("full_adder netlist_file_open        %10.0f ns\n", file_time);
+
+	FUNC_END();
+	TEST_END;
+}
@@ -1,6 +1,50 @@
+#include <string.h>
+
 #include "../read_template.h"
+#include "../generate.h"
+#include "../intern.h"
+#include "../loops.h"
 #include "../test.h"
 #include "../benchmark.h"
+#include "helpers.h"
+
+
+// A ring of inverters, which are custom gates when inverter isn't NULL
+static void generate_ring(generate_t *gen, char *name, size_t length, char *inverter) {
+	generate_template_t *template = generate_template(gen, name);
+
+	uint32_t gate = generate_add_gate(template, "OR", NULL);
+	generate_connect(template, generate_input(template, "I0"), gate, intern("I0"));
+
+	generate_signal_t signal = { .gate = gate, .port = intern("O0") };
+
+	for (size_t i = 0; i < length; i++) {
+		if (inverter == NULL) {
+			signal = generate_not(template, signal);
+			continue;
+		}
+
+		uint32_t custom = generate_add_gate(template, inverter, NULL);
+		generate_connect(template, signal, custom, intern("I0"));
+		signal = (generate_signal_t) { .gate = custom, .port = intern("O0") };
+	}
+
+	generate_connect(template, signal, gate, intern("I1"));
+	generate_output(template, "O0", signal);
+}
+
+
+// Read the top of a design from build, and find its loops
+static bool read_design(generate_t *gen, GenerateFormat_t format, loops_t *loops) {
+	library_t library;
+	circuit_t *circ = helpers_load_design(gen, format, &library);
+	bool success = circ != NULL && loops_find(loops, circ);
+
+	library_free(&library);
+	generate_remove(gen, "build");
+
+	return success;
+}
 
 
 test_result_t test_not_loop(void) {
@@ -12,7 +56,7 @@ test_result_t test_not_loop(void) {
 	circuit_t *circ = malloc(sizeof(circuit_t));
 	circuit_init(circ);
 
-	// Read template
+	// Read template, the NOT feeding itself is found before it's simulated
 	assert_false(read_template("tests/not_loop", circ, NULL));
 
 	// Free everything
@@ -20,6 +64,95 @@ test_result_t test_not_loop(void) {
 	free(circ);
 
 
+	// No loops in a plain template
+	circ = malloc(sizeof(circuit_t));
+	circuit_init(circ);
+	assert_true(read_template("tests/notor", circ, NULL));
+
+	loops_t loops;
+	loops_init(&loops);
+	assert_true(loops_find(&loops, circ));
+	assert_eq(loops.amount_loops, 0);
+	loops_free(&loops);
+
+	circuit_free(circ);
+	free(circ);
+
+
+	for (size_t json = 0; json < 2; json++) {
+		GenerateFormat_t format = json ? GenerateFormat_JSON : GenerateFormat_TEXT;
+
+		// An even ring holds its state
+		generate_t gen;
+		generate_init(&gen);
+		generate_ring(&gen, "loop_even", 4, NULL);
+
+		loops_init(&loops);
+		assert_true(read_design(&gen, format, &loops));
+		assert_eq(loops.amount_loops, 1);
+		assert_eq(loops.loops[0].kind, LoopKind_LATCHING);
+		assert_eq(loops.loops[0].amount_gates, 5);
+		loops_free(&loops);
+		generate_free(&gen);
+
+		// An odd one can't be read
+		generate_init(&gen);
+		generate_ring(&gen, "loop_odd", 3, NULL);
+
+		loops_init(&loops);
+		assert_false(read_design(&gen, format, &loops));
+		assert_eq(loops.amount_loops, 0);
+		loops_free(&loops);
+		generate_free(&gen);
+
+		// Through custom gates, with the names of the gates inside them
+		generate_init(&gen);
+		generate_template_t *inverter = generate_template(&gen, "loop_inverter");
+		generate_output(inverter, "O0", generate_not(inverter, generate_input(inverter, "I0")));
+		generate_ring(&gen, "loop_nested_even", 2, "loop_inverter");
+
+		loops_init(&loops);
+		assert_true(read_design(&gen, format, &loops));
+		assert_eq(loops.amount_loops, 1);
+		assert_eq(loops.loops[0].kind, LoopKind_LATCHING);
+		assert_eq(loops.loops[0].amount_gates, 3);
+
+		size_t nested = 0;
+
+		for (size_t i = 0; i < loops.loops[0].amount_gates; i++) {
+			nested += strchr(loops.loops[0].gates[i], '/') != NULL;
+		}
+
+		assert_eq(nested, 2);
+		loops_free(&loops);
+		generate_free(&gen);
+
+		generate_init(&gen);
+		inverter = generate_template(&gen, "loop_inverter");
+		generate_output(inverter, "O0", generate_not(inverter, generate_input(inverter, "I0")));
+		generate_ring(&gen, "loop_nested_odd", 3, "loop_inverter");
+
+		loops_init(&loops);
+		assert_false(read_design(&gen, format, &loops));
+		loops_free(&loops);
+		generate_free(&gen);
+
+		// An XOR may invert, depending on its other input
+		generate_init(&gen);
+		generate_template_t *template = generate_template(&gen, "loop_xor");
+		generate_signal_t in = generate_input(template, "I0");
+		uint32_t xor = generate_add_gate(template, "XOR", NULL);
+		generate_connect(template, in, xor, intern("I0"));
+		generate_connect(template, (generate_signal_t) { .gate = xor, .port = intern("O0") }, xor, intern("I1"));
+		generate_output(template, "O0", (generate_signal_t) { .gate = xor, .port = intern("O0") });
+
+		loops_init(&loops);
+		assert_false(read_design(&gen, format, &loops));
+		loops_free(&loops);
+		generate_free(&gen);
+	}
+
+
 	FUNC_END();
 	TEST_END;
 }
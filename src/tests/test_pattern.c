@@ -0,0 +1,393 @@
+#include "../read_template.h"
+#include "../pattern.h"
+#include "../pattern_kernels.h"
+#include "../intern.h"
+#include "../test.h"
+#include "../benchmark.h"
+#include "helpers.h"
+
+
+// Compare every vector of the pattern with a scalar evaluation of the netlist
+static bool pattern_matches_netlist(pattern_t *pattern, size_t vectors, bool inputs[][BUF_SIZE]) {
+	FUNC_START();
+
+	netlist_t *netlist = pattern->netlist;
+	bool matches = true;
+
+	bool expected[BUF_SIZE];
+	bool actual[BUF_SIZE];
+
+	for (size_t v = 0; v < vectors; v++) {
+		netlist_apply(netlist, inputs[v], expected);
+		pattern_get_vector(pattern, v, actual);
+
+		for (size_t i = 0; i < netlist->amount_outputs; i++) {
+			matches &= expected[i] == actual[i];
+		}
+	}
+
+	FUNC_END();
+	return matches;
+}
+
+
+// Create a netlist of random ops, each reading earlier nets, so it's already levelized
+static void build_random_netlist(netlist_t *netlist, size_t amount_inputs, size_t amount_ops, unsigned int seed) {
+	FUNC_START();
+
+	srand(seed);
+
+	char buf[BUF_SIZE];
+
+	sprintf(buf, "random_%lu_%lu", amount_inputs, amount_ops);
+	netlist->name = intern(buf);
+
+	netlist->amount_nets = amount_inputs + amount_ops;
+	netlist->state = calloc(netlist->amount_nets, sizeof(bool));
+
+	netlist->amount_inputs = amount_inputs;
+	netlist->inputs = malloc(amount_inputs * sizeof(netlist_io_t));
+
+	for (size_t i = 0; i < amount_inputs; i++) {
+		sprintf(buf, "I%lu", i);
+		netlist->inputs[i].name = intern(buf);
+		netlist->inputs[i].net = (uint32_t) i;
+	}
+
+	netlist->amount_ops = amount_ops;
+	netlist->ops = malloc(amount_ops * sizeof(netlist_op_t));
+
+	for (size_t i = 0; i < amount_ops; i++) {
+		netlist_op_t *op = &netlist->ops[i];
+		size_t available = amount_inputs + i;
+
+		op->op = (NetlistOp_t) (rand() % NETLIST_OP_AMOUNT);
+		op->in0 = (uint32_t) ((size_t) rand() % available);
+		op->in1 = (op->op == NetlistOp_NOT) ? op->in0 : (uint32_t) ((size_t) rand() % available);
+		op->out = (uint32_t) available;
+	}
+
+	// The last nets are the outputs
+	netlist->amount_outputs = 8;
+	netlist->outputs = malloc(8 * sizeof(netlist_io_t));
+
+	for (size_t i = 0; i < 8; i++) {
+		sprintf(buf, "O%lu", i);
+		netlist->outputs[i].name = intern(buf);
+		netlist->outputs[i].net = (uint32_t) (netlist->amount_nets - 8 + i);
+	}
+
+	FUNC_END();
+}
+
+
+test_result_t test_pattern(void) {
+	FUNC_START();
+	TEST_START;
+
+	circuit_t ha_circ;
+	circuit_init(&ha_circ);
+	circuit_t fa_circ;
+	circuit_init(&fa_circ);
+
+	library_t library;
+	library_init(&library);
+
+	assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+	assert_true(library_add(&library, &ha_circ, false));
+	assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+
+	assert_true(netlist_compile(&netlist, &fa_circ));
+
+
+	// Exhaustive: all 8 combinations fit in one word
+	{
+		pattern_t pattern;
+		pattern_init(&pattern, &netlist, 8);
+
+		assert_eq(pattern.words, 1);
+
+		pattern_set_exhaustive(&pattern, 0);
+		pattern_evaluate(&pattern);
+
+		uint64_t sum;
+		uint64_t carry;
+
+		assert_true(pattern_get_output(&pattern, "S", &sum));
+		assert_true(pattern_get_output(&pattern, "Co", &carry));
+
+		// Ci I0 I1 are bits 0 1 2, S is set when an odd amount of them is set
+		assert_eq(sum & 0xff, 0x96);
+		assert_eq(carry & 0xff, 0xe8);
+
+		pattern_free(&pattern);
+	}
+
+
+	// Random vectors over multiple words
+	{
+		static bool inputs[200][BUF_SIZE];
+
+		pattern_t pattern;
+		pattern_init(&pattern, &netlist, 200);
+
+		assert_eq(pattern.words, 4);
+
+		srand(42);
+
+		for (size_t v = 0; v < 200; v++) {
+			for (size_t i = 0; i < netlist.amount_inputs; i++) {
+				inputs[v][i] = rand() & 1;
+			}
+
+			pattern_set_vector(&pattern, v, inputs[v]);
+		}
+
+		pattern_evaluate(&pattern);
+
+		assert_true(pattern_matches_netlist(&pattern, 200, inputs));
+
+		pattern_free(&pattern);
+	}
+
+
+	netlist_free(&netlist);
+	circuit_free(&fa_circ);
+	circuit_free(&ha_circ);
+	library_free(&library);
+
+
+	// Exhaustive over more inputs than a combination has bits, the ones after the 64th stay 0
+	{
+		generate_t gen;
+		generate_init(&gen);
+		assert_true(generate_ripple_adder(&gen, 64));
+
+		netlist_init(&netlist);
+		assert_true(helpers_compile_design(&gen, GenerateFormat_JSON, &netlist));
+		assert_eq(netlist.amount_inputs, 129);
+
+		pattern_t pattern;
+		pattern_init(&pattern, &netlist, 2 * PATTERN_WORD_BITS);
+
+		// The first word has every higher bit set
+		pattern_set_exhaustive(&pattern, ~0ull << 6);
+
+		size_t wrong = 0;
+
+		for (size_t i = 6; i < netlist.amount_inputs; i++) {
+			uint64_t *words = pattern_get_net(&pattern, netlist.inputs[i].net);
+
+			wrong += words[0] != ((i < PATTERN_WORD_BITS) ? ~0ull : 0);
+			wrong += words[1] != 0;
+		}
+
+		assert_eq(wrong, 0);
+
+		pattern_free(&pattern);
+		netlist_free(&netlist);
+		generate_free(&gen);
+	}
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Compare scalar levelized evaluation with bit-parallel evaluation
+test_result_t bench_pattern(void) {
+	FUNC_START();
+	TEST_START;
+
+	circuit_t ha_circ;
+	circuit_init(&ha_circ);
+	circuit_t fa_circ;
+	circuit_init(&fa_circ);
+
+	library_t library;
+	library_init(&library);
+
+	assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+	assert_true(library_add(&library, &ha_circ, false));
+	assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+
+	assert_true(netlist_compile(&netlist, &fa_circ));
+
+
+	const size_t vectors = 1 << 24;
+
+	struct timespec start = {0, 0};
+	struct timespec end = {0, 0};
+
+
+	bool inputs[3];
+	bool outputs[2];
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t v = 0; v < vectors / 16; v++) {
+		for (size_t i = 0; i < 3; i++) {
+			inputs[i] = (v >> i) & 1;
+		}
+
+		netlist_apply(&netlist, inputs, outputs);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("full_adder scalar    %12.0f vectors/s\n", (double) (vectors / 16) * 1e9 / (double) (long_time(end) - long_time(start)));
+
+
+	// Evaluate in blocks of 4096 vectors
+	pattern_t pattern;
+	pattern_init(&pattern, &netlist, 4096);
+	pattern_set_exhaustive(&pattern, 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t v = 0; v < vectors; v += 4096) {
+		pattern_evaluate(&pattern);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	printf("full_adder parallel  %12.0f vectors/s\n", (double) vectors * 1e9 / (double) (long_time(end) - long_time(start)));
+
+	pattern_free(&pattern);
+
+
+	netlist_free(&netlist);
+	circuit_free(&fa_circ);
+	circuit_free(&ha_circ);
+	library_free(&library);
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+test_result_t test_pattern_kernels(void) {
+	FUNC_START();
+	TEST_START;
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+	build_random_netlist(&netlist, 16, 1000, 1);
+
+	// An odd amount of words, so the kernels have to handle a tail
+	pattern_t reference;
+	pattern_init(&reference, &netlist, 37 * PATTERN_WORD_BITS);
+
+	srand(2);
+
+	for (size_t i = 0; i < netlist.amount_inputs; i++) {
+		uint64_t *words = pattern_get_net(&reference, netlist.inputs[i].net);
+
+		for (size_t w = 0; w < reference.words; w++) {
+			words[w] = (uint64_t) rand() << 32 ^ (uint64_t) rand();
+		}
+	}
+
+	assert_true(pattern_kernels_select(PatternKernels_WORD));
+	pattern_evaluate(&reference);
+
+
+	PatternKernels_t all_kernels[] = { PatternKernels_AVX2, PatternKernels_AVX512 };
+
+	for (size_t k = 0; k < 2; k++) {
+		if (! pattern_kernels_supported(all_kernels[k])) {
+			continue;
+		}
+
+		pattern_t pattern;
+		pattern_init(&pattern, &netlist, 37 * PATTERN_WORD_BITS);
+
+		// Only copy the inputs, the rest is computed
+		for (size_t i = 0; i < netlist.amount_inputs; i++) {
+			uint32_t net = netlist.inputs[i].net;
+			memcpy(pattern_get_net(&pattern, net), pattern_get_net(&reference, net), pattern.words * sizeof(uint64_t));
+		}
+
+		assert_true(pattern_kernels_select(all_kernels[k]));
+		pattern_evaluate(&pattern);
+
+		size_t total_words = netlist.amount_nets * pattern.words;
+		assert_eq(memcmp(pattern.state, reference.state, total_words * sizeof(uint64_t)), 0);
+
+		pattern_free(&pattern);
+	}
+
+	pattern_kernels_select(pattern_kernels_best());
+
+	pattern_free(&reference);
+	netlist_free(&netlist);
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Compare all ways of evaluating a large netlist
+test_result_t bench_pattern_kernels(void) {
+	FUNC_START();
+	TEST_START;
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+	build_random_netlist(&netlist, 64, 100000, 3);
+
+	struct timespec start = {0, 0};
+	struct timespec end = {0, 0};
+
+
+	// One bool per net
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < 64; i++) {
+		netlist_evaluate(&netlist);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double gate_evaluations = 64.0 * (double) netlist.amount_ops;
+	printf("%-8s %14.0f gate evaluations/s\n", "scalar", gate_evaluations * 1e9 / (double) (long_time(end) - long_time(start)));
+
+
+	// 4096 vectors per net
+	pattern_t pattern;
+	pattern_init(&pattern, &netlist, 4096);
+	pattern_set_exhaustive(&pattern, 0);
+
+	PatternKernels_t all_kernels[] = { PatternKernels_WORD, PatternKernels_AVX2, PatternKernels_AVX512 };
+
+	for (size_t k = 0; k < 3; k++) {
+		if (! pattern_kernels_select(all_kernels[k])) {
+			continue;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for (size_t i = 0; i < 16; i++) {
+			pattern_evaluate(&pattern);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		gate_evaluations = 16.0 * 4096.0 * (double) netlist.amount_ops;
+		printf("%-8s %14.0f gate evaluations/s\n", pattern_kernels_get()->name, gate_evaluations * 1e9 / (double) (long_time(end) - long_time(start)));
+	}
+
+	pattern_kernels_select(pattern_kernels_best());
+
+	pattern_free(&pattern);
+	netlist_free(&netlist);
+
+	FUNC_END();
+	TEST_END;
+}
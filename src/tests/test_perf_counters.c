@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../perf_counters.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+#define PERF_COUNTERS_LOOP 1000000
+
+
+test_result_t test_perf_counters(void) {
+	FUNC_START();
+	TEST_START;
+
+	assert_str_eq(perf_counter_name(PerfCounter_CYCLES), "cycles");
+	assert_str_eq(perf_counter_name(PerfCounter_BRANCH_MISSES), "branch-misses");
+
+
+	// Counters can't be opened in most VMs, then they're all 0
+	perf_counters_t counters;
+	bool available = perf_counters_init(&counters);
+
+	assert_eq(available, counters.amount > 0);
+
+	perf_values_t start, end, delta, sum;
+	perf_counters_read(&counters, &start);
+
+	volatile size_t sink = 0;
+
+	for (size_t i = 0; i < PERF_COUNTERS_LOOP; i++) {
+		sink += i;
+	}
+
+	perf_counters_read(&counters, &end);
+	perf_values_sub(&delta, &end, &start);
+	perf_values_add(&sum, &start, &delta);
+
+	for (size_t i = 0; i < PerfCounter_AMOUNT; i++) {
+		assert_eq(sum.values[i], end.values[i]);
+
+		if (! perf_counters_available(&counters, i)) {
+			assert_eq(end.values[i], 0);
+		}
+	}
+
+	// Every iteration is at least an add and a branch
+	if (perf_counters_available(&counters, PerfCounter_INSTRUCTIONS)) {
+		assert_true(delta.values[PerfCounter_INSTRUCTIONS] >= 2 * PERF_COUNTERS_LOOP);
+	}
+
+	if (perf_counters_available(&counters, PerfCounter_CYCLES)) {
+		assert_true(delta.values[PerfCounter_CYCLES] > 0);
+	}
+
+	perf_counters_free(&counters);
+	assert_eq(counters.amount, 0);
+
+
+	FUNC_END();
+	TEST_END;
+}
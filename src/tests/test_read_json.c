@@ -0,0 +1,225 @@
+#include <stdio.h>
+
+#include "../read_template.h"
+#include "../read_json.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+#define READ_JSON_TEST_PATH "build/test_read_json.json"
+
+// Nesting of a skipped value, far deeper than skipping could recurse
+#define READ_JSON_TEST_DEPTH (1 << 21)
+
+
+// Compare the outputs of two circuits with the same IO for every input combination
+static bool circuits_match(circuit_t *a, circuit_t *b, char **inputs, size_t amount_inputs, char **outputs, size_t amount_outputs) {
+	FUNC_START();
+
+	bool matches = true;
+
+	for (unsigned int combination = 0; combination < (1u << amount_inputs); combination++) {
+		for (size_t i = 0; i < amount_inputs; i++) {
+			port_set_state(circuit_get_io_port_by_name(a, inputs[i]), (combination >> i) & 1);
+			port_set_state(circuit_get_io_port_by_name(b, inputs[i]), (combination >> i) & 1);
+		}
+
+		for (size_t i = 0; i < amount_outputs; i++) {
+			matches &= circuit_get_io_port_by_name(a, outputs[i])->state == circuit_get_io_port_by_name(b, outputs[i])->state;
+		}
+	}
+
+	FUNC_END();
+	return matches;
+}
+
+
+test_result_t test_read_json(void) {
+	FUNC_START();
+	TEST_START;
+
+
+	// The custom gates come after the circuit using them
+	{
+		circuit_t json;
+		circuit_init(&json);
+
+		library_t customs;
+		library_init(&customs);
+
+		assert_true(read_json("tests/notor2.json", &json, &customs));
+		assert_str_eq(json.name, "notor2");
+		assert_eq(hex_hashmap_amount(&json.gates), 6);
+
+		assert_eq(library_amount(&customs), 1);
+		assert_true(library_contains(&customs, "notor"));
+
+		circuit_t notor;
+		circuit_init(&notor);
+		circuit_t notor2;
+		circuit_init(&notor2);
+
+		library_t library;
+		library_init(&library);
+
+		assert_true(read_template("tests/notor", &notor, NULL));
+		assert_true(library_add(&library, &notor, false));
+		assert_true(read_template("tests/notor2", &notor2, &library));
+
+		char *inputs[] = { "I0", "I1" };
+		char *outputs[] = { "O0" };
+
+		assert_true(circuits_match(&json, &notor2, inputs, 2, outputs, 1));
+
+		circuit_free(&notor2);
+		circuit_free(&notor);
+		library_free(&library);
+
+		library_free(&customs);
+		circuit_free(&json);
+	}
+
+
+	// The names of the IO ports are only in the wires
+	{
+		circuit_t json;
+		circuit_init(&json);
+		circuit_t text;
+		circuit_init(&text);
+
+		assert_true(read_json("tests/half_adder.json", &json, NULL));
+		assert_true(read_template("tests/half_adder", &text, NULL));
+
+		char *inputs[] = { "I0", "I1" };
+		char *outputs[] = { "S", "C" };
+
+		assert_true(circuits_match(&json, &text, inputs, 2, outputs, 2));
+
+		circuit_free(&text);
+		circuit_free(&json);
+	}
+
+
+	// Broken files
+	char *invalid[] = {
+		// Not JSON
+		"{ \"circuit\": { \"gates\": {}, \"wires\": [] }",
+		"{ \"circuit\": { \"gates\": { \"0\": { } }, \"wires\": [] } }",
+		"{ \"circuit\": { \"gates\": {}, \"wires\": [ { \"a\": \"0\", \"b\": \"1:I0\" } ] } }",
+
+		// Unknown custom gate
+		"{ \"circuit\": { \"gates\": { \"0\": { \"type\": \"missing\" } }, \"wires\": [] } }",
+
+		// Custom gates containing each other
+		"{ \"circuit\": { \"gates\": { \"0\": { \"type\": \"a\" } }, \"wires\": [] }, \"customGates\": {"
+		" \"a\": { \"gates\": { \"0\": { \"type\": \"b\" } }, \"wires\": [] },"
+		" \"b\": { \"gates\": { \"0\": { \"type\": \"a\" } }, \"wires\": [] } } }",
+
+		// No circuit
+		"{ \"name\": \"empty\" }"
+	};
+
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		FILE *file = fopen(READ_JSON_TEST_PATH, "w");
+		fputs(invalid[i], file);
+		fclose(file);
+
+		circuit_t circ;
+		circuit_init(&circ);
+
+		assert_false(read_json(READ_JSON_TEST_PATH, &circ, NULL));
+
+		circuit_free(&circ);
+	}
+
+
+	// Unknown keys are skipped however deep they're nested, whole or cut off
+	for (size_t closed = 0; closed < 2; closed++) {
+		FILE *file = fopen(READ_JSON_TEST_PATH, "w");
+		fputs("{ \"skipped\": ", file);
+
+		for (size_t i = 0; i < READ_JSON_TEST_DEPTH; i++) {
+			fputs("{\"a\":[", file);
+		}
+
+		for (size_t i = 0; closed && i < READ_JSON_TEST_DEPTH; i++) {
+			fputs("]}", file);
+		}
+
+		fputs(", \"circuit\": { \"gates\": {}, \"wires\": [] } }", file);
+		fclose(file);
+
+		circuit_t circ;
+		circuit_init(&circ);
+
+		assert_eq(read_json(READ_JSON_TEST_PATH, &circ, NULL), closed);
+
+		circuit_free(&circ);
+	}
+
+	remove(READ_JSON_TEST_PATH);
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Compare loading a circuit and its custom gate from one JSON file with loading both templates
+test_result_t bench_read_json(void) {
+	FUNC_START();
+	TEST_START;
+
+	const size_t loads = 1000;
+
+	struct timespec start = {0, 0};
+	struct timespec end = {0, 0};
+
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < loads; i++) {
+		circuit_t circ;
+		circuit_init(&circ);
+
+		assert_true(read_json("tests/notor2.json", &circ, NULL));
+
+		circuit_free(&circ);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double json_time = (double) (long_time(end) - long_time(start)) / (double) loads;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < loads; i++) {
+		circuit_t notor;
+		circuit_init(&notor);
+		circuit_t notor2;
+		circuit_init(&notor2);
+
+		library_t library;
+		library_init(&library);
+
+		assert_true(read_template("tests/notor", &notor, NULL));
+		assert_true(library_add(&library, &notor, false));
+		assert_true(read_template("tests/notor2", &notor2, &library));
+
+		circuit_free(&notor2);
+		circuit_free(&notor);
+		library_free(&library);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double template_time = (double) (long_time(end) - long_time(start)) / (double) loads;
+
+
+	printf("notor2 read_json      %10.0f ns\n", json_time);
+	printf("notor2 read_template  %10.0f ns\n", template_time);
+
+	FUNC_END();
+	TEST_END;
+}
@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../runner.h"
+#include "../generate.h"
+#include "../test.h"
+#include "../benchmark.h"
+#include "helpers.h"
+
+
+// Vectors in test_runner, more than a few batches of 64
+#define RUNNER_TEST_VECTORS 300
+
+// Bits of the multiplier in bench_runner, and the vectors it streams
+#define RUNNER_BENCH_BITS 16
+#define RUNNER_BENCH_VECTORS (1 << 20)
+
+
+// Load and run a template like the command line would, with the files in build
+static bool run_args(int argc, char *argv[], runner_t *runner) {
+	runner_init(runner);
+
+	return runner_parse_args(runner, argc, argv) && runner_load(runner) && runner_run(runner);
+}
+
+
+// Whether a file has exactly the given contents
+static bool check_file(char *filename, const void *expected, size_t size) {
+	FILE *file = fopen(filename, "rb");
+
+	if (file == NULL) {
+		return false;
+	}
+
+	char contents[size + 1];
+	size_t amount = fread(contents, 1, size + 1, file);
+	fclose(file);
+
+	return amount == size && memcmp(contents, expected, size) == 0;
+}
+
+
+test_result_t test_runner(void) {
+	FUNC_START();
+	TEST_START;
+
+	// The inputs of a full adder are Ci, I0 and I1, its outputs Co and S
+	char input[RUNNER_TEST_VECTORS * 16];
+	char expected[RUNNER_TEST_VECTORS * 3 + 1];
+	uint8_t packed_input[RUNNER_TEST_VECTORS];
+	uint8_t packed_expected[RUNNER_TEST_VECTORS];
+
+	size_t size = (size_t) sprintf(input, "# Ci I0 I1\n\n");
+	size_t expected_size = 0;
+
+	srand(42);
+
+	for (size_t i = 0; i < RUNNER_TEST_VECTORS; i++) {
+		unsigned int vector = (unsigned int) rand() % 8;
+		unsigned int ones = (vector & 1) + ((vector >> 1) & 1) + (vector >> 2);
+
+		size += (size_t) sprintf(&input[size], "%u %u_%u%s\n", vector & 1, (vector >> 1) & 1, vector >> 2, (i % 7 == 0) ? " # comment" : "");
+		expected_size += (size_t) sprintf(&expected[expected_size], "%u%u\n", ones >= 2, ones & 1);
+
+		packed_input[i] = (uint8_t) vector;
+		packed_expected[i] = (uint8_t) ((ones >= 2) | (ones & 1) << 1);
+	}
+
+	helpers_write_file("build/runner_input", input, size);
+	helpers_write_file("build/runner_input.bin", packed_input, RUNNER_TEST_VECTORS);
+
+
+	// Text, over several batches
+	runner_t runner;
+	char *text_args[] = { "run", "-i", "build/runner_input", "-o", "build/runner_output", "-n", "1", "tests/full_adder" };
+
+	assert_true(run_args(8, text_args, &runner));
+	assert_eq(runner.batch_size, 64);
+	assert_eq(runner.amount_vectors, RUNNER_TEST_VECTORS);
+	assert_eq(runner.amount_batches, (RUNNER_TEST_VECTORS + 63) / 64);
+	runner_free(&runner);
+
+	assert_true(check_file("build/runner_output", expected, expected_size));
+
+	// Binary, in a single batch, found through -L
+	char *binary_args[] = { "run", "-L", "tests", "-b", "-i", "build/runner_input.bin", "-o", "build/runner_output", "full_adder" };
+
+	assert_true(run_args(9, binary_args, &runner));
+	assert_eq(runner.amount_vectors, RUNNER_TEST_VECTORS);
+	assert_eq(runner.amount_batches, 1);
+	runner_free(&runner);
+
+	assert_true(check_file("build/runner_output", packed_expected, RUNNER_TEST_VECTORS));
+
+	// A JSON template, with its extension. It's read from the file, not from a text
+	// template of the same name.
+	char *json_args[] = { "run", "-i", "build/runner_input", "-o", "build/runner_output", "tests/half_adder.json" };
+
+	helpers_write_string("build/runner_input", "00\n01\n10\n11\n");
+	assert_true(run_args(6, json_args, &runner));
+	runner_free(&runner);
+
+	assert_true(check_file("build/runner_output", "00\n01\n01\n10\n", 12));
+
+	// A file that declares another name than its filename, XOR
+	char *xor_args[] = { "run", "-L", "tests", "-i", "build/runner_input", "-o", "build/runner_output", "tests/xor" };
+
+	assert_true(run_args(8, xor_args, &runner));
+	runner_free(&runner);
+
+	assert_true(check_file("build/runner_output", "0\n1\n1\n0\n", 8));
+
+
+	// The vectors before a bad line are still written
+	char *bad_lines[] = { "000\n011\n01\n", "000\n011\n0111\n", "000\n011\n012\n" };
+
+	for (size_t i = 0; i < 3; i++) {
+		helpers_write_file("build/runner_input", bad_lines[i], strlen(bad_lines[i]));
+
+		assert_false(run_args(8, text_args, &runner));
+		assert_eq(runner.amount_vectors, 2);
+		runner_free(&runner);
+
+		assert_true(check_file("build/runner_output", "00\n10\n", 6));
+	}
+
+	// A trailing vector without a newline still counts
+	helpers_write_file("build/runner_input", "111", 3);
+	assert_true(run_args(8, text_args, &runner));
+	runner_free(&runner);
+	assert_true(check_file("build/runner_output", "11\n", 3));
+
+	// Binary that ends in the middle of a vector, of two bytes for the 10 inputs
+	generate_t gen;
+	generate_init(&gen);
+	generate_multiplier(&gen, 5);
+	assert_true(generate_write(&gen, "build", GenerateFormat_JSON));
+
+	char template[BUF_SIZE];
+	sprintf(template, "build/%s.json", generate_top(&gen)->name);
+
+	char *multiplier_args[] = { "run", "-b", "-i", "build/runner_input", "-o", "build/runner_output", template };
+
+	helpers_write_file("build/runner_input", "\x03\x01\x02\x00\x07", 5);
+	assert_false(run_args(7, multiplier_args, &runner));
+	assert_eq(runner.amount_vectors, 2);
+	runner_free(&runner);
+
+	remove(template);
+	generate_free(&gen);
+
+
+	// Arguments that don't make sense
+	char *missing_template[] = { "run", "-b" };
+	char *missing_value[] = { "run", "tests/full_adder", "-i" };
+	char *unknown_option[] = { "run", "-x", "tests/full_adder" };
+	char *zero_batch[] = { "run", "-n", "0", "tests/full_adder" };
+	char *two_templates[] = { "run", "tests/full_adder", "tests/half_adder" };
+	char *no_template[] = { "run", "-o", "build/runner_output", "tests/does_not_exist" };
+
+	assert_false(run_args(2, missing_template, &runner));
+	runner_free(&runner);
+	assert_false(run_args(3, missing_value, &runner));
+	runner_free(&runner);
+	assert_false(run_args(3, unknown_option, &runner));
+	runner_free(&runner);
+	assert_false(run_args(4, zero_batch, &runner));
+	runner_free(&runner);
+	assert_false(run_args(3, two_templates, &runner));
+	runner_free(&runner);
+	assert_false(run_args(4, no_template, &runner));
+	runner_free(&runner);
+
+	remove("build/runner_input");
+	remove("build/runner_input.bin");
+	remove("build/runner_output");
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Random vectors through a multiplier, in both formats
+test_result_t bench_runner(void) {
+	FUNC_START();
+	TEST_START;
+
+	generate_t gen;
+	generate_init(&gen);
+	generate_multiplier(&gen, RUNNER_BENCH_BITS);
+	assert_true(generate_write(&gen, "build", GenerateFormat_JSON));
+
+	char template[BUF_SIZE];
+	sprintf(template, "build/%s", generate_top(&gen)->name);
+
+	size_t bytes = 2 * RUNNER_BENCH_BITS / 8;
+	uint8_t *packed = malloc(RUNNER_BENCH_VECTORS * bytes);
+	char *text = malloc(RUNNER_BENCH_VECTORS * (2 * RUNNER_BENCH_BITS + 1));
+
+	srand(42);
+
+	for (size_t i = 0; i < RUNNER_BENCH_VECTORS * bytes; i++) {
+		packed[i] = (uint8_t) rand();
+	}
+
+	for (size_t i = 0; i < RUNNER_BENCH_VECTORS; i++) {
+		for (size_t j = 0; j < 2 * RUNNER_BENCH_BITS; j++) {
+			text[i * (2 * RUNNER_BENCH_BITS + 1) + j] = (char) ('0' + ((packed[i * bytes + j / 8] >> (j % 8)) & 1));
+		}
+
+		text[i * (2 * RUNNER_BENCH_BITS + 1) + 2 * RUNNER_BENCH_BITS] = '\n';
+	}
+
+	helpers_write_file("build/runner_input.bin", packed, RUNNER_BENCH_VECTORS * bytes);
+	helpers_write_file("build/runner_input", text, RUNNER_BENCH_VECTORS * (2 * RUNNER_BENCH_BITS + 1));
+
+	free(packed);
+	free(text);
+
+
+	char *formats[] = { "text", "binary" };
+	char *inputs[] = { "build/runner_input", "build/runner_input.bin" };
+
+	for (size_t binary = 0; binary < 2; binary++) {
+		char *args[] = { "run", "-i", inputs[binary], "-o", "/dev/null", template, "-b" };
+
+		runner_t runner;
+		assert_true(run_args(binary ? 7 : 6, args, &runner));
+		assert_eq(runner.amount_vectors, RUNNER_BENCH_VECTORS);
+
+		printf("%-24s %-6s %8lu vectors %10.2f ms %12.0f vectors/s\n", generate_top(&gen)->name, formats[binary],
+			runner.amount_vectors, (double) runner.time_run / 1e6, (double) runner.amount_vectors / ((double) runner.time_run / 1e9));
+
+		runner_free(&runner);
+	}
+
+	remove("build/runner_input");
+	remove("build/runner_input.bin");
+	strcat(template, ".json");
+	remove(template);
+	generate_free(&gen);
+
+	FUNC_END();
+	TEST_END;
+}
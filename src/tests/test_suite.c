@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../suite.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+#define SUITE_TEST_FILE "build/test_suite.json"
+
+
+static bool close_to(double a, double b) {
+	return a - b < 1e-9 && b - a < 1e-9;
+}
+
+
+// A suite with a time and a rate, as if it ran
+static void fill_suite(suite_t *suite, double time, double rate) {
+	suite_result_t *result = suite_add(suite, "time", "ms", false);
+	suite_add_sample(result, time);
+
+	result = suite_add(suite, "rate", "Mvectors/s", true);
+	suite_add_sample(result, rate);
+
+	suite->runs = 1;
+	suite_summarize(suite);
+}
+
+
+test_result_t test_suite(void) {
+	FUNC_START();
+	TEST_START;
+
+	suite_t suite;
+	suite_init(&suite);
+
+	// Percentiles of 1 up to 100, in a shuffled order
+	suite_result_t *time = suite_add(&suite, "time", "ms", false);
+	assert_eq(suite_percentile(time, 50), 0);
+
+	for (size_t i = 0; i < 100; i++) {
+		suite_add_sample(time, (double) ((i * 37) % 100 + 1));
+	}
+
+	assert_eq(time->amount_samples, 100);
+	assert_true(close_to(suite_percentile(time, 0), 1));
+	assert_true(close_to(suite_percentile(time, 50), 50.5));
+	assert_true(close_to(suite_percentile(time, 99), 99.01));
+	assert_true(close_to(suite_percentile(time, 100), 100));
+
+	// The tail of a rate is its lowest samples
+	suite_result_t *rate = suite_add(&suite, "rate", "Mvectors/s", true);
+
+	for (size_t i = 0; i < 100; i++) {
+		suite_add_sample(rate, (double) (i + 1));
+	}
+
+	suite_summarize(&suite);
+	assert_true(close_to(time->median, 50.5));
+	assert_true(close_to(time->p99, 99.01));
+	assert_true(close_to(rate->p99, 1.99));
+
+	assert_true(suite_get(&suite, "rate") == rate);
+	assert_true(suite_get(&suite, "none") == NULL);
+
+
+	// Write and read back, without the samples
+	suite.runs = 100;
+	assert_true(suite_write_json(&suite, SUITE_TEST_FILE));
+
+	suite_t read;
+	suite_init(&read);
+	assert_true(suite_read_json(&read, SUITE_TEST_FILE));
+
+	assert_eq(read.runs, 100);
+	assert_eq(read.amount_results, 2);
+	assert_str_eq(read.results[0].name, "time");
+	assert_str_eq(read.results[0].unit, "ms");
+	assert_false(read.results[0].higher_better);
+	assert_true(close_to(read.results[0].median, 50.5));
+	assert_true(close_to(read.results[0].p99, 99.01));
+	assert_true(read.results[1].higher_better);
+	assert_eq(read.results[1].amount_samples, 0);
+
+	remove(SUITE_TEST_FILE);
+	suite_free(&read);
+	suite_free(&suite);
+
+	assert_false(suite_read_json(&suite, SUITE_TEST_FILE));
+
+
+	// Regressions are a slower time or a lower rate beyond the threshold
+	suite_t baseline, current;
+	suite_init(&baseline);
+	fill_suite(&baseline, 100, 100);
+
+	suite_init(&current);
+	fill_suite(&current, 110, 100);
+	assert_eq(suite_compare(&current, &baseline, 0.05), 1);
+	assert_eq(suite_compare(&current, &baseline, 0.2), 0);
+	suite_free(&current);
+
+	suite_init(&current);
+	fill_suite(&current, 90, 50);
+	assert_eq(suite_compare(&current, &baseline, 0.05), 1);
+	suite_free(&current);
+
+	suite_init(&current);
+	fill_suite(&current, 100, 150);
+	assert_eq(suite_compare(&current, &baseline, 0.05), 0);
+	suite_free(&current);
+
+	// Workloads missing from the suite count as regressions
+	suite_init(&current);
+	suite_add_sample(suite_add(&current, "time", "ms", false), 100);
+	suite_summarize(&current);
+	assert_eq(suite_compare(&current, &baseline, 0.05), 1);
+	suite_free(&current);
+
+	suite_free(&baseline);
+
+
+	// One run of the real workloads
+	suite_init(&suite);
+	assert_true(suite_run(&suite, 1));
+	assert_eq(suite.amount_results, 4);
+
+	for (size_t i = 0; i < suite.amount_results; i++) {
+		assert_true(suite.results[i].amount_samples > 0);
+		assert_true(suite.results[i].median > 0);
+	}
+
+	suite_free(&suite);
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Runs BENCH_RUNS times, writes BENCH_SUITE and fails on regressions against BENCH_BASELINE
+test_result_t bench_suite(void) {
+	FUNC_START();
+	TEST_START;
+
+	size_t runs = SUITE_RUNS;
+	double threshold = SUITE_THRESHOLD;
+
+	if (getenv("BENCH_RUNS") != NULL) {
+		runs = (size_t) strtoul(getenv("BENCH_RUNS"), NULL, 10);
+	}
+
+	// In percent
+	if (getenv("BENCH_THRESHOLD") != NULL) {
+		threshold = strtod(getenv("BENCH_THRESHOLD"), NULL) / 100;
+	}
+
+	suite_t suite;
+	suite_init(&suite);
+
+	assert_true(runs > 0 && suite_run(&suite, runs));
+	suite_print(&suite);
+
+	if (getenv("BENCH_SUITE") != NULL) {
+		assert_true(suite_write_json(&suite, getenv("BENCH_SUITE")));
+	}
+
+	if (getenv("BENCH_BASELINE") != NULL) {
+		suite_t baseline;
+		suite_init(&baseline);
+
+		printf("\n");
+		assert_true(suite_read_json(&baseline, getenv("BENCH_BASELINE")));
+		assert_eq(suite_compare(&suite, &baseline, threshold), 0);
+
+		suite_free(&baseline);
+	}
+
+	suite_free(&suite);
+
+	FUNC_END();
+	TEST_END;
+}
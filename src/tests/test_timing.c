@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../timing.h"
+#include "../generate.h"
+#include "../intern.h"
+#include "../test.h"
+#include "../benchmark.h"
+#include "helpers.h"
+
+
+// Bits of the adders in test_timing
+#define TIMING_TEST_BITS 16
+#define TIMING_TEST_VECTORS 32
+
+// Adders in bench_timing, from TIMING_BENCH_MIN_BITS up to TIMING_BENCH_MAX_BITS
+#define TIMING_BENCH_MIN_BITS 256
+#define TIMING_BENCH_MAX_BITS 16384
+#define TIMING_BENCH_VECTORS 64
+
+
+// Change an input now
+static void set_input(void *timing, char *name, bool state) {
+	timing_set_input(timing, name, state, timing_now(timing));
+}
+
+
+static uint64_t get_sum(timing_t *timing, size_t bits) {
+	return helpers_get_bus(timing->netlist, timing->state, "S", bits)
+		| (uint64_t) timing->state[netlist_get_output_by_name(timing->netlist, "Co")->net] << bits;
+}
+
+
+// A static hazard: O0 = I0 AND NOT I0 pulses when I0 rises
+static void generate_hazard(generate_t *gen) {
+	generate_template_t *template = generate_template(gen, "timing_hazard");
+	generate_signal_t in = generate_input(template, "I0");
+
+	generate_output(template, "O0", generate_op(template, "AND", in, generate_not(template, in)));
+}
+
+
+static char *get_not_name(netlist_t *netlist) {
+	for (size_t i = 0; i < netlist->amount_ops; i++) {
+		if (netlist->ops[i].op == NetlistOp_NOT) {
+			return netlist->op_names[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+test_result_t test_timing(void) {
+	FUNC_START();
+	TEST_START;
+
+	// The pulse is as wide as the NOT is slow
+	generate_t gen;
+	generate_init(&gen);
+	generate_hazard(&gen);
+
+	netlist_t netlist;
+	netlist_init(&netlist);
+	assert_true(helpers_compile_design(&gen, GenerateFormat_JSON, &netlist));
+
+	uint32_t out = netlist_get_output_by_name(&netlist, "O0")->net;
+
+	timing_t timing;
+	timing_init(&timing, &netlist);
+
+	assert_true(timing_set_input(&timing, "I0", true, 0));
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+	assert_false(timing.state[out]);
+	assert_eq(timing.transitions[out], 2);
+	assert_eq(timing_glitches(&timing, out), 1);
+	assert_eq(timing_settle_time(&timing), 3);
+	assert_eq(timing_total_glitches(&timing), 1);
+
+	// Falling has no hazard
+	timing_start(&timing);
+	assert_true(timing_set_gate_delay(&timing, get_not_name(&netlist), 5));
+	assert_true(timing_set_input(&timing, "I0", false, timing_now(&timing)));
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+	assert_eq(timing.transitions[out], 0);
+	assert_eq(timing_total_glitches(&timing), 0);
+
+	timing_start(&timing);
+	assert_true(timing_set_input(&timing, "I0", true, timing_now(&timing)));
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+	assert_eq(timing_glitches(&timing, out), 1);
+	assert_eq(timing_settle_time(&timing), 7);
+
+	// The NOT keeps its own delay
+	timing_set_type_delay(&timing, NetlistOp_AND, 10);
+	timing_set_type_delay(&timing, NetlistOp_NOT, 1);
+	assert_true(timing_set_input(&timing, "I0", false, timing_now(&timing)));
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+
+	timing_start(&timing);
+	assert_true(timing_set_input(&timing, "I0", true, timing_now(&timing)));
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+	assert_eq(timing_settle_time(&timing), 15);
+
+	// Unknown names
+	assert_false(timing_set_input(&timing, "I1", true, timing_now(&timing)));
+	assert_false(timing_set_gate_delay(&timing, "does_not_exist", 1));
+
+	timing_free(&timing);
+
+
+	// A change of an input can't overtake a pending one
+	timing_init(&timing, &netlist);
+	uint32_t in = netlist_get_input_by_name(&netlist, "I0")->net;
+
+	assert_true(timing_set_input(&timing, "I0", true, 10));
+	assert_false(timing_set_input(&timing, "I0", false, 5));
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+	assert_true(timing.state[in]);
+	assert_eq(timing.transitions[in], 1);
+	assert_eq(timing.last_change[in], 10);
+
+	// The last change at a time replaces the one before
+	timing_start(&timing);
+	uint64_t now = timing_now(&timing);
+
+	assert_true(timing_set_input(&timing, "I0", false, now + 10));
+	assert_true(timing_set_input(&timing, "I0", true, now + 10));
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+	assert_true(timing.state[in]);
+	assert_eq(timing.transitions[in], 0);
+
+	// Only the changes that are still pending count
+	timing_start(&timing);
+	now = timing_now(&timing);
+
+	assert_true(timing_set_input(&timing, "I0", false, now + 10));
+	assert_true(timing_set_input(&timing, "I0", true, now + 20));
+	assert_false(timing_set_input(&timing, "I0", false, now + 15));
+	assert_false(timing_run(&timing, now + 10));
+	assert_false(timing_set_input(&timing, "I0", false, now + 15));
+	assert_true(timing_set_input(&timing, "I0", false, now + 25));
+
+	// The change that just happened isn't pending anymore, so it isn't replaced
+	assert_false(timing_run(&timing, now + 25));
+	assert_eq(timing_now(&timing), now + 25);
+	assert_false(timing.state[in]);
+
+	assert_true(timing_set_input(&timing, "I0", true, now + 25));
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+	assert_true(timing.state[in]);
+	assert_eq(timing.transitions[in], 4);
+
+	timing_free(&timing);
+
+
+	// Times that cascade through the higher levels of the wheel
+	timing_init(&timing, &netlist);
+	timing_set_gate_delay(&timing, get_not_name(&netlist), UINT32_MAX);
+
+	uint64_t far = 1ull << 40;
+	assert_true(timing_set_input(&timing, "I0", true, far));
+
+	assert_false(timing_run(&timing, far + 1));
+	assert_false(timing.state[out]);
+	assert_eq(timing.transitions[out], 0);
+	assert_true(timing_now(&timing) <= far + 1);
+
+	assert_false(timing_run(&timing, far + 2));
+	assert_true(timing.state[out]);
+
+	assert_true(timing_run(&timing, TIMING_FOREVER));
+	assert_false(timing.state[out]);
+	assert_eq(timing_glitches(&timing, out), 1);
+	assert_eq(timing.last_change[out], far + UINT32_MAX + 2);
+
+	timing_free(&timing);
+	netlist_free(&netlist);
+	generate_free(&gen);
+
+
+	// Adders add up after any vector, and carries ripple slower than they look ahead
+	uint64_t settle[2];
+
+	for (size_t lookahead = 0; lookahead < 2; lookahead++) {
+		generate_init(&gen);
+		assert_true(lookahead ? generate_lookahead_adder(&gen, TIMING_TEST_BITS) : generate_ripple_adder(&gen, TIMING_TEST_BITS));
+
+		netlist_init(&netlist);
+		assert_true(helpers_compile_design(&gen, GenerateFormat_JSON, &netlist));
+		timing_init(&timing, &netlist);
+
+		uint64_t mask = (1ull << TIMING_TEST_BITS) - 1;
+		srand(42);
+
+		for (size_t i = 0; i < TIMING_TEST_VECTORS; i++) {
+			uint64_t a = (uint64_t) rand() & mask;
+			uint64_t b = (uint64_t) rand() & mask;
+			bool ci = rand() & 1;
+
+			helpers_set_bus("A", TIMING_TEST_BITS, a, set_input, &timing);
+			helpers_set_bus("B", TIMING_TEST_BITS, b, set_input, &timing);
+			timing_set_input(&timing, "Ci", ci, timing_now(&timing));
+
+			assert_true(timing_run(&timing, TIMING_FOREVER));
+			assert_eq(get_sum(&timing, TIMING_TEST_BITS), a + b + ci);
+		}
+
+		// The carry in goes through every bit
+		helpers_set_bus("A", TIMING_TEST_BITS, mask, set_input, &timing);
+		helpers_set_bus("B", TIMING_TEST_BITS, 0, set_input, &timing);
+		timing_set_input(&timing, "Ci", false, timing_now(&timing));
+		assert_true(timing_run(&timing, TIMING_FOREVER));
+
+		timing_start(&timing);
+		timing_set_input(&timing, "Ci", true, timing_now(&timing));
+		assert_true(timing_run(&timing, TIMING_FOREVER));
+		assert_eq(get_sum(&timing, TIMING_TEST_BITS), mask + 1);
+
+		settle[lookahead] = timing_settle_time(&timing);
+
+		timing_free(&timing);
+		netlist_free(&netlist);
+		generate_free(&gen);
+	}
+
+	assert_true(settle[1] < settle[0]);
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Random vectors through big adders, in events per second
+test_result_t bench_timing(void) {
+	FUNC_START();
+	TEST_START;
+
+	for (size_t bits = TIMING_BENCH_MIN_BITS; bits <= TIMING_BENCH_MAX_BITS; bits *= 4) {
+		for (size_t lookahead = 0; lookahead < 2; lookahead++) {
+			generate_t gen;
+			generate_init(&gen);
+			assert_true(lookahead ? generate_lookahead_adder(&gen, bits) : generate_ripple_adder(&gen, bits));
+
+			netlist_t netlist;
+			netlist_init(&netlist);
+			assert_true(helpers_compile_design(&gen, GenerateFormat_JSON, &netlist));
+
+			timing_t timing;
+			timing_init(&timing, &netlist);
+
+			uint64_t settle = 0;
+			size_t glitches = 0;
+			srand(42);
+
+			for (size_t i = 0; i < TIMING_BENCH_VECTORS; i++) {
+				timing_start(&timing);
+
+				for (size_t j = 0; j < netlist.amount_inputs; j++) {
+					timing_set_input(&timing, netlist.inputs[j].name, rand() & 1, timing_now(&timing));
+				}
+
+				assert_true(timing_run(&timing, TIMING_FOREVER));
+
+				if (timing_settle_time(&timing) > settle) {
+					settle = timing_settle_time(&timing);
+				}
+
+				glitches += timing_total_glitches(&timing);
+			}
+
+			printf("%-28s %8lu ops %10lu events %10.2f ms %12.0f events/s, settles within %5lu, %8lu glitches\n",
+				generate_top(&gen)->name, netlist.amount_ops, timing.events, (double) timing.time / 1e6,
+				timing_events_per_second(&timing), settle, glitches);
+
+			timing_free(&timing);
+			netlist_free(&netlist);
+			generate_free(&gen);
+		}
+	}
+
+	FUNC_END();
+	TEST_END;
+}
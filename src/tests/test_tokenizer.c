@@ -0,0 +1,185 @@
+#include <stdio.h>
+
+#include "../read_template.h"
+#include "../tokenizer.h"
+#include "../test.h"
+#include "../benchmark.h"
+#include "helpers.h"
+
+
+#define TOKENIZER_TEST_PATH "build/test_tokenizer.txt"
+
+
+test_result_t test_tokenizer(void) {
+	FUNC_START();
+	TEST_START;
+
+	string_view_t tokens[4];
+	tokenizer_t tokenizer;
+
+
+	// Empty lines are skipped, and all kinds of whitespace separate tokens
+	helpers_write_string(TOKENIZER_TEST_PATH, "first\n\n  \r\n\ta  bb\tccc \r\nab:cd\n\nlast");
+
+	assert_true(tokenizer_open(&tokenizer, TOKENIZER_TEST_PATH));
+
+	assert_eq(tokenizer_next_line(&tokenizer, tokens, 4), 1);
+	assert_true(string_view_equals(tokens[0], "first"));
+	assert_eq(tokenizer.line, 1);
+
+	assert_eq(tokenizer_next_line(&tokenizer, tokens, 4), 3);
+	assert_true(string_view_equals(tokens[0], "a"));
+	assert_true(string_view_equals(tokens[1], "bb"));
+	assert_true(string_view_equals(tokens[2], "ccc"));
+	assert_false(string_view_equals(tokens[2], "cc"));
+	assert_eq(tokenizer.line, 4);
+
+	// Only max_tokens are stored, but all are counted
+	assert_eq(tokenizer_next_line(&tokenizer, tokens, 0), 1);
+
+	assert_eq(tokenizer_next_line(&tokenizer, tokens, 4), 1);
+	assert_true(string_view_equals(tokens[0], "last"));
+
+	assert_eq(tokenizer_next_line(&tokenizer, tokens, 4), 0);
+	assert_eq(tokenizer_next_line(&tokenizer, tokens, 4), 0);
+
+	tokenizer_close(&tokenizer);
+
+
+	// String views
+	string_view_t wire = { .start = "da2ecd25:O0", .length = 11 };
+	string_view_t left;
+	string_view_t right;
+
+	assert_true(string_view_split(wire, ':', &left, &right));
+	assert_true(string_view_equals(left, "da2ecd25"));
+	assert_true(string_view_equals(right, "O0"));
+	assert_false(string_view_split(left, ':', &left, &right));
+
+	size_t value = 0;
+	string_view_t number = { .start = "1234x", .length = 4 };
+
+	assert_true(string_view_to_size(number, &value));
+	assert_eq(value, 1234);
+
+	number.length = 5;
+	assert_false(string_view_to_size(number, &value));
+
+
+	// Empty and missing files
+	helpers_write_string(TOKENIZER_TEST_PATH, "");
+
+	assert_true(tokenizer_open(&tokenizer, TOKENIZER_TEST_PATH));
+	assert_eq(tokenizer_next_line(&tokenizer, tokens, 4), 0);
+	tokenizer_close(&tokenizer);
+
+	assert_false(tokenizer_open(&tokenizer, "build/does_not_exist.txt"));
+
+
+	// All templates are valid
+	char *templates[] = { "tests/nand", "tests/nor", "tests/xor", "tests/xand", "tests/half_adder", "tests/full_adder", "tests/notor2" };
+
+	for (size_t i = 0; i < sizeof(templates) / sizeof(templates[0]); i++) {
+		assert_true(read_template_parse(templates[i]));
+	}
+
+
+	// The counts have to match the gates and wires
+	char *invalid[] = {
+		"",
+		"name\n[gates] 2\n0 IN #I0\n[wires] 0\n",
+		"name\n[gates] 1\n0 IN #I0\n[wires] 1\n",
+		"name\n[gates] 1\n0 IN #I0\n[wires] 0\n1 NOT\n",
+		"name\n[gates] 1\n0 IN I0\n[wires] 0\n",
+		"name\n[gates] 1\n0 IN #I0\n[wires] 1\n0I0 0:I0\n",
+		"name\n[gates] x\n",
+		"name\n[wires] 0\n"
+	};
+
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		helpers_write_string(TOKENIZER_TEST_PATH, invalid[i]);
+		assert_false(read_template_parse(TOKENIZER_TEST_PATH));
+	}
+
+	helpers_write_string(TOKENIZER_TEST_PATH, "name\n[gates] 1\n0 IN #I0\n[wires] 0\n");
+	assert_true(read_template_parse(TOKENIZER_TEST_PATH));
+
+	remove(TOKENIZER_TEST_PATH);
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Write a template of many NOT gates side by side, each with its own input and output
+static size_t write_not_array(char *filename, size_t amount) {
+	FUNC_START();
+
+	FILE *file = fopen(filename, "w");
+
+	fprintf(file, "not_array\n\n[gates] %lu\n", 3 * amount);
+
+	for (size_t i = 0; i < amount; i++) {
+		fprintf(file, "%08lx IN #I%lu\n", 3 * i, i);
+		fprintf(file, "%08lx NOT\n", 3 * i + 1);
+		fprintf(file, "%08lx OUT #O%lu\n", 3 * i + 2, i);
+	}
+
+	fprintf(file, "\n[wires] %lu\n", 2 * amount);
+
+	for (size_t i = 0; i < amount; i++) {
+		fprintf(file, "%08lx:I%lu %08lx:I0\n", 3 * i, i, 3 * i + 1);
+		fprintf(file, "%08lx:O0 %08lx:O%lu\n", 3 * i + 1, 3 * i + 2, i);
+	}
+
+	size_t size = (size_t) ftell(file);
+	fclose(file);
+
+	FUNC_END();
+	return size;
+}
+
+
+// Compare only parsing a large template with building it
+test_result_t bench_tokenizer(void) {
+	FUNC_START();
+	TEST_START;
+
+	size_t size = write_not_array(TOKENIZER_TEST_PATH, 100000);
+
+	struct timespec start = {0, 0};
+	struct timespec end = {0, 0};
+
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t i = 0; i < 10; i++) {
+		assert_true(read_template_parse(TOKENIZER_TEST_PATH));
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double parse_time = (double) (long_time(end) - long_time(start)) / 10e9;
+
+
+	circuit_t circ;
+	circuit_init(&circ);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	assert_true(read_template(TOKENIZER_TEST_PATH, &circ, NULL));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double read_time = (double) (long_time(end) - long_time(start)) / 1e9;
+
+	circuit_free(&circ);
+
+	remove(TOKENIZER_TEST_PATH);
+
+
+	printf("not_array parse         %8.1f MB/s\n", (double) size / parse_time / 1e6);
+	printf("not_array read_template %8.1f MB/s, %.3f s\n", (double) size / read_time / 1e6, read_time);
+
+	FUNC_END();
+	TEST_END;
+}
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../truth_table.h"
+#include "../generate.h"
+#include "../library.h"
+#include "../read_template.h"
+#include "../thread_pool.h"
+#include "../test.h"
+#include "../benchmark.h"
+#include "helpers.h"
+
+
+// Checked against every product, in test_truth_table
+#define TRUTH_TABLE_TEST_BITS 10
+
+// The biggest multiplier in bench_truth_table
+#define TRUTH_TABLE_BENCH_BITS 14
+
+
+// Compare the table against setting the ports one combination at a time
+static bool check_ports(truth_table_t *table, circuit_t *circ) {
+	for (uint64_t combination = 0; combination < truth_table_combinations(table); combination++) {
+		for (size_t i = 0; i < table->amount_inputs; i++) {
+			port_set_state(circuit_get_io_port_by_name(circ, table->netlist.inputs[i].name), (combination >> i) & 1);
+		}
+
+		for (size_t i = 0; i < table->amount_outputs; i++) {
+			if (circuit_get_io_port_by_name(circ, table->netlist.outputs[i].name)->state != truth_table_get(table, combination, i)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+// A bus from a combination, where the inputs are sorted by name
+static uint64_t get_bus(truth_table_t *table, uint64_t combination, char prefix, size_t bits) {
+	uint64_t value = 0;
+
+	for (size_t i = 0; i < table->amount_inputs; i++) {
+		char *name = table->netlist.inputs[i].name;
+
+		if (name[0] == prefix) {
+			size_t bit = strtoul(name + 1, NULL, 10);
+
+			if (bit >= bits) {
+				continue;
+			}
+
+			value |= ((combination >> i) & 1) << bit;
+		}
+	}
+
+	return value;
+}
+
+
+// Every product of the multiplier
+static bool check_multiplier(truth_table_t *table, size_t bits) {
+	uint64_t *outputs[2 * bits];
+	char name[BUF_SIZE];
+
+	for (size_t i = 0; i < 2 * bits; i++) {
+		sprintf(name, "P%lu", i);
+		outputs[i] = truth_table_get_output(table, name);
+
+		if (outputs[i] == NULL) {
+			return false;
+		}
+	}
+
+	for (uint64_t combination = 0; combination < truth_table_combinations(table); combination++) {
+		uint64_t product = get_bus(table, combination, 'A', bits) * get_bus(table, combination, 'B', bits);
+
+		for (size_t i = 0; i < 2 * bits; i++) {
+			bool bit = (outputs[i][combination / 64] >> (combination % 64)) & 1;
+
+			if (bit != ((product >> i) & 1)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+static circuit_t *load_multiplier(generate_t *gen, library_t *library, size_t bits) {
+	generate_init(gen);
+	generate_multiplier(gen, bits);
+
+	circuit_t *circ = helpers_load_design(gen, GenerateFormat_JSON, library);
+	generate_remove(gen, "build");
+
+	return circ;
+}
+
+
+test_result_t test_truth_table(void) {
+	FUNC_START();
+	TEST_START;
+
+	// Small templates, against the circuit itself
+	circuit_t ha_circ;
+	circuit_init(&ha_circ);
+	circuit_t fa_circ;
+	circuit_init(&fa_circ);
+
+	library_t library;
+	library_init(&library);
+
+	assert_true(read_template("tests/half_adder", &ha_circ, NULL));
+	assert_true(library_add(&library, &ha_circ, false));
+	assert_true(read_template("tests/full_adder", &fa_circ, &library));
+
+	circuit_t *circs[] = { &ha_circ, &fa_circ };
+
+	for (size_t i = 0; i < 2; i++) {
+		for (size_t threads = 1; threads <= 4; threads *= 2) {
+			truth_table_t table;
+			truth_table_init(&table);
+
+			assert_true(truth_table_compute(&table, circs[i], threads));
+			assert_eq(table.amount_inputs, i + 2);
+			assert_eq(table.amount_outputs, 2);
+			assert_eq(table.words_per_output, 1);
+			assert_true(check_ports(&table, circs[i]));
+
+			// Nothing beyond the last combination
+			assert_eq(table.words[0] >> truth_table_combinations(&table), 0);
+
+			truth_table_free(&table);
+		}
+	}
+
+	// The sum of a full adder is the parity of its inputs
+	truth_table_t table;
+	truth_table_init(&table);
+
+	assert_true(truth_table_compute(&table, &fa_circ, 0));
+	assert_eq(*truth_table_get_output(&table, "S"), 0x96);
+	assert_eq(*truth_table_get_output(&table, "Co"), 0xe8);
+	assert_true(truth_table_get_output(&table, "I0") == NULL);
+
+	truth_table_free(&table);
+
+	circuit_free(&fa_circ);
+	circuit_free(&ha_circ);
+	library_free(&library);
+
+
+	// Many chunks, split over threads that don't line up with them
+	generate_t gen;
+	circuit_t *circ = load_multiplier(&gen, &library, TRUTH_TABLE_TEST_BITS);
+	assert_not_null(circ);
+
+	for (size_t threads = 1; threads <= 3; threads++) {
+		truth_table_init(&table);
+
+		assert_true(truth_table_compute(&table, circ, threads));
+		assert_eq(table.amount_inputs, 2 * TRUTH_TABLE_TEST_BITS);
+		assert_eq(table.words_per_output, truth_table_combinations(&table) / 64);
+		assert_true(check_multiplier(&table, TRUTH_TABLE_TEST_BITS));
+
+		truth_table_free(&table);
+	}
+
+	library_free(&library);
+	generate_free(&gen);
+
+
+	// Loops have no truth table
+	circuit_t loop;
+	circuit_init(&loop);
+
+	generate_init(&gen);
+	generate_feedback_chain(&gen, 2);
+	assert_true(generate_write(&gen, "build", GenerateFormat_TEXT));
+
+	char filename[BUF_SIZE];
+	sprintf(filename, "build/%s", generate_top(&gen)->name);
+	assert_true(read_template(filename, &loop, NULL));
+	remove(filename);
+
+	truth_table_init(&table);
+	assert_false(truth_table_compute(&table, &loop, 1));
+	truth_table_free(&table);
+
+	circuit_free(&loop);
+	generate_free(&gen);
+
+
+	FUNC_END();
+	TEST_END;
+}
+
+
+// Multipliers up to 2 * TRUTH_TABLE_BENCH_BITS inputs, on 1 thread and on all cores
+test_result_t bench_truth_table(void) {
+	FUNC_START();
+	TEST_START;
+
+	size_t cores = thread_pool_cores();
+
+	for (size_t bits = 8; bits <= TRUTH_TABLE_BENCH_BITS; bits += 2) {
+		generate_t gen;
+		library_t library;
+
+		circuit_t *circ = load_multiplier(&gen, &library, bits);
+		assert_not_null(circ);
+
+		for (size_t threads = 1; threads <= cores; threads = (threads == cores) ? cores + 1 : cores) {
+			truth_table_t table;
+			truth_table_init(&table);
+
+			struct timespec start, end;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+			assert_true(truth_table_compute(&table, circ, threads));
+
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			double ms = (double) (long_time(end) - long_time(start)) / 1e6;
+
+			printf("%-24s %2lu inputs %3lu threads %10.2f ms %10.2f Mcombinations/s\n",
+				generate_top(&gen)->name, table.amount_inputs, threads, ms,
+				(double) truth_table_combinations(&table) / ms / 1e3);
+
+			truth_table_free(&table);
+		}
+
+		library_free(&library);
+		generate_free(&gen);
+	}
+
+	FUNC_END();
+	TEST_END;
+}
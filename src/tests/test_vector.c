@@ -0,0 +1,119 @@
+#include "../read_template.h"
+#include "../event_queue.h"
+#include "../intern.h"
+#include "../test.h"
+#include "../benchmark.h"
+
+
+#define FANOUT 1000
+
+
+test_result_t test_vector(void) {
+	FUNC_START();
+	TEST_START;
+
+	static int values[FANOUT];
+
+	// Small vectors don't allocate
+	vector_t vec;
+	vector_init(&vec, 0);
+
+	for (size_t i = 0; i < VECTOR_INLINE_SIZE; i++) {
+		assert_true(vector_push(&vec, &values[i]));
+	}
+
+	assert_eq(vec.items, vec.inline_items);
+
+	// ... until they grow
+	for (size_t i = VECTOR_INLINE_SIZE; i < FANOUT; i++) {
+		assert_true(vector_push(&vec, &values[i]));
+	}
+
+	assert_neq(vec.items, vec.inline_items);
+	assert_eq(vec.amount, FANOUT);
+	assert_true(vec.size >= FANOUT);
+
+	VEC_EACH_INDEX(vec, int *value, i) {
+		assert_eq(value, &values[i]);
+	}
+
+	// Removing keeps the order
+	assert_true(vector_remove(&vec, &values[0]));
+	assert_true(vector_remove(&vec, &values[FANOUT - 1]));
+	assert_false(vector_contains(&vec, &values[0]));
+	assert_eq(vec.amount, FANOUT - 2);
+	assert_eq(vec.items[0], &values[1]);
+	assert_eq(vector_last(&vec), &values[FANOUT - 2]);
+
+	// Copying into a small vector
+	vector_t copy;
+	vector_init(&copy, 0);
+
+	assert_true(vector_copy(&copy, &vec));
+	assert_eq(copy.amount, vec.amount);
+	assert_eq(memcmp(copy.items, vec.items, vec.amount * sizeof(void *)), 0);
+
+	vector_free(&copy);
+	vector_free(&vec);
+
+
+	// A net can drive more gates than used to fit in a vector
+	circuit_t circ;
+	circuit_init(&circ);
+	circ.name = intern("fanout");
+
+	gate_t *in = malloc(sizeof(gate_t));
+	gate_init(in);
+	in->name = intern("0");
+	in->type = intern("IN");
+	gate_set_ports(in, intern("I0"), NULL);
+	hex_hashmap_add_item(&circ.gates, in->name, in);
+
+	port_t *input = in->ports.items[0];
+	port_t *outputs[FANOUT];
+
+	for (size_t i = 0; i < FANOUT; i++) {
+		char name[BUF_SIZE];
+		sprintf(name, "1%lu", i);
+
+		gate_t *g = malloc(sizeof(gate_t));
+		gate_init(g);
+		g->name = intern(name);
+		g->type = intern("NOT");
+		gate_set_ports(g, NULL, NULL);
+		hex_hashmap_add_item(&circ.gates, g->name, g);
+
+		assert_true(port_connect(input, g->ports.items[0]));
+		outputs[i] = g->ports.items[1];
+	}
+
+	assert_eq(input->connections.amount, FANOUT);
+	assert_true(circuit_update_state(&circ));
+
+	SimEngine_t old_engine = sim_get_engine();
+	SimEngine_t engines[] = { SimEngine_RECURSIVE, SimEngine_QUEUE };
+
+	for (size_t e = 0; e < 2; e++) {
+		sim_set_engine(engines[e]);
+
+		for (int state = 1; state >= 0; state--) {
+			port_set_state(input, state);
+
+			size_t correct = 0;
+
+			for (size_t i = 0; i < FANOUT; i++) {
+				correct += outputs[i]->state == ! state;
+			}
+
+			assert_eq(correct, FANOUT);
+		}
+	}
+
+	sim_set_engine(old_engine);
+
+	circuit_free(&circ);
+
+
+	FUNC_END();
+	TEST_END;
+}
@@ -0,0 +1,171 @@
+#include "thread_pool.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "event_queue.h"
+
+
+// The initial amount of jobs that can wait, always a power of 2
+#define THREAD_POOL_INITIAL_JOBS 64
+
+
+static void *thread_pool_worker(void *arg) {
+	thread_pool_t *pool = arg;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (true) {
+		while (pool->jobs_amount == 0 && ! pool->stopping) {
+			pthread_cond_wait(&pool->work, &pool->lock);
+		}
+
+		if (pool->jobs_amount == 0) {
+			break;
+		}
+
+		thread_pool_job_t job = pool->jobs[pool->jobs_start];
+
+		pool->jobs_start = (pool->jobs_start + 1) & (pool->jobs_size - 1);
+		pool->jobs_amount--;
+
+		pthread_mutex_unlock(&pool->lock);
+		job.task(job.arg);
+		pthread_mutex_lock(&pool->lock);
+
+		if (--pool->pending == 0) {
+			pthread_cond_broadcast(&pool->done);
+		}
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	// Jobs can simulate, which gives every thread its own queue
+	sim_free_queue();
+
+	return NULL;
+}
+
+
+// Amount of cores that are online, at least 1
+size_t thread_pool_cores(void) {
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (cores < 1) ? 1 : (size_t) cores;
+}
+
+
+void thread_pool_push(thread_pool_t *pool, thread_pool_task_t task, void *arg) {
+	FUNC_START();
+
+	assert_not_null(pool);
+	assert_not_null(task);
+
+	pthread_mutex_lock(&pool->lock);
+
+	// Grow the ring buffer when it's full, unwrapping it
+	if (pool->jobs_amount == pool->jobs_size) {
+		size_t size = 2 * pool->jobs_size;
+		thread_pool_job_t *jobs = malloc(size * sizeof(thread_pool_job_t));
+		assert_not_null(jobs);
+
+		for (size_t i = 0; i < pool->jobs_amount; i++) {
+			jobs[i] = pool->jobs[(pool->jobs_start + i) & (pool->jobs_size - 1)];
+		}
+
+		free(pool->jobs);
+
+		pool->jobs = jobs;
+		pool->jobs_size = size;
+		pool->jobs_start = 0;
+	}
+
+	size_t end = (pool->jobs_start + pool->jobs_amount) & (pool->jobs_size - 1);
+
+	pool->jobs[end].task = task;
+	pool->jobs[end].arg = arg;
+
+	pool->jobs_amount++;
+	pool->pending++;
+
+	pthread_cond_signal(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	FUNC_END();
+}
+
+
+// Wait until all jobs are done, including the ones they pushed
+void thread_pool_wait(thread_pool_t *pool) {
+	FUNC_START();
+
+	assert_not_null(pool);
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (pool->pending > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	FUNC_END();
+}
+
+
+
+// Start the threads, 0 threads uses all cores
+void thread_pool_init(thread_pool_t *pool, size_t threads) {
+	assert_not_null(pool);
+
+	if (threads == 0) {
+		threads = thread_pool_cores();
+	}
+
+	pool->amount_threads = threads;
+	pool->threads = malloc(threads * sizeof(pthread_t));
+	assert_not_null(pool->threads);
+
+	pool->jobs_size = THREAD_POOL_INITIAL_JOBS;
+	pool->jobs = malloc(pool->jobs_size * sizeof(thread_pool_job_t));
+	assert_not_null(pool->jobs);
+
+	pool->jobs_start = 0;
+	pool->jobs_amount = 0;
+	pool->pending = 0;
+	pool->stopping = false;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	for (size_t i = 0; i < threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, thread_pool_worker, pool) != 0) {
+			panic("Failed to start thread %lu of %lu", i + 1, threads);
+		}
+	}
+}
+
+
+// Finish all jobs, then stop the threads
+void thread_pool_free(thread_pool_t *pool) {
+	assert_not_null(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = true;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (size_t i = 0; i < pool->amount_threads; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->lock);
+
+	free(pool->jobs);
+	free(pool->threads);
+}
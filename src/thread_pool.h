@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+typedef void (*thread_pool_task_t)(void *arg);
+
+
+typedef struct thread_pool_job {
+	thread_pool_task_t task;
+	void *arg;
+} thread_pool_job_t;
+
+
+// A fixed amount of threads running jobs in the order they're pushed.
+// Jobs can push more jobs.
+typedef struct thread_pool {
+	pthread_t *threads;
+	size_t amount_threads;
+
+	// Ring buffer of jobs waiting for a thread
+	thread_pool_job_t *jobs;
+	size_t jobs_size;
+	size_t jobs_start;
+	size_t jobs_amount;
+
+	// Jobs that are waiting or running
+	size_t pending;
+	bool stopping;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+} thread_pool_t;
+
+
+size_t thread_pool_cores(void);
+void thread_pool_push(thread_pool_t *pool, thread_pool_task_t task, void *arg);
+void thread_pool_wait(thread_pool_t *pool);
+
+
+void thread_pool_init(thread_pool_t *pool, size_t threads);
+void thread_pool_free(thread_pool_t *pool);
+
+
+#endif
@@ -0,0 +1,517 @@
+#include "timing.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "assert.h"
+#include "benchmark.h"
+
+
+// Slots of a level in one word of its occupied bits
+#define TIMING_WORD_SLOTS 64
+
+#define TIMING_SLOT_MASK (TIMING_WHEEL_SLOTS - 1)
+
+
+// Delays of the types when timing_set_type_delay isn't called
+static const uint32_t timing_default_delays[NETLIST_OP_AMOUNT] = {
+	[NetlistOp_AND] = 2,
+	[NetlistOp_OR] = 2,
+	[NetlistOp_XOR] = 3,
+	[NetlistOp_NOT] = 1
+};
+
+
+// NOTE: No benchmarking in the wheel functions, they are the innermost loop
+
+
+static void timing_wheel_insert(timing_wheel_t *wheel, uint32_t event) {
+	uint64_t time = wheel->events[event].time;
+	uint64_t differ = time ^ wheel->now;
+
+	unsigned int level = (differ == 0) ? 0 : (unsigned int) (63 - __builtin_clzll(differ)) / TIMING_WHEEL_BITS;
+	unsigned int slot = (unsigned int) (time >> (level * TIMING_WHEEL_BITS)) & TIMING_SLOT_MASK;
+
+	wheel->events[event].next = wheel->slots[level][slot];
+	wheel->slots[level][slot] = event;
+	wheel->occupied[level][slot / TIMING_WORD_SLOTS] |= 1ull << (slot % TIMING_WORD_SLOTS);
+}
+
+
+static uint32_t timing_wheel_push(timing_wheel_t *wheel, uint32_t net, bool state, uint64_t time) {
+	assert(time >= wheel->now);
+
+	if (wheel->free == TIMING_NO_EVENT) {
+		if (wheel->amount_events == wheel->size_events) {
+			wheel->size_events = (wheel->size_events == 0) ? 1024 : 2 * wheel->size_events;
+			wheel->events = realloc(wheel->events, wheel->size_events * sizeof(timing_event_t));
+			assert_not_null(wheel->events);
+		}
+
+		wheel->free = (uint32_t) wheel->amount_events++;
+		wheel->events[wheel->free].next = TIMING_NO_EVENT;
+	}
+
+	uint32_t event = wheel->free;
+	wheel->free = wheel->events[event].next;
+
+	wheel->events[event].time = time;
+	wheel->events[event].net = net;
+	wheel->events[event].state = state;
+
+	timing_wheel_insert(wheel, event);
+	wheel->pending++;
+
+	return event;
+}
+
+
+// Take all events of a slot, as a list
+static uint32_t timing_wheel_take(timing_wheel_t *wheel, unsigned int level, unsigned int slot) {
+	uint32_t first = wheel->slots[level][slot];
+
+	wheel->slots[level][slot] = TIMING_NO_EVENT;
+	wheel->occupied[level][slot / TIMING_WORD_SLOTS] &= ~(1ull << (slot % TIMING_WORD_SLOTS));
+
+	return first;
+}
+
+
+// The first slot of a level from start on that has events, TIMING_WHEEL_SLOTS if there is none
+static unsigned int timing_wheel_find(timing_wheel_t *wheel, unsigned int level, unsigned int start) {
+	for (unsigned int word = start / TIMING_WORD_SLOTS; word < TIMING_WHEEL_SLOTS / TIMING_WORD_SLOTS; word++) {
+		uint64_t bits = wheel->occupied[level][word];
+
+		if (word == start / TIMING_WORD_SLOTS) {
+			bits &= ~0ull << (start % TIMING_WORD_SLOTS);
+		}
+
+		if (bits != 0) {
+			return word * TIMING_WORD_SLOTS + (unsigned int) __builtin_ctzll(bits);
+		}
+	}
+
+	return TIMING_WHEEL_SLOTS;
+}
+
+
+// Move now to the next time with events, as long as it's not after until, and take them
+static uint32_t timing_wheel_next(timing_wheel_t *wheel, uint64_t until) {
+	while (wheel->pending > 0) {
+		bool cascaded = false;
+
+		for (unsigned int level = 0; level < TIMING_WHEEL_LEVELS && ! cascaded; level++) {
+			unsigned int shift = level * TIMING_WHEEL_BITS;
+			unsigned int current = (unsigned int) (wheel->now >> shift) & TIMING_SLOT_MASK;
+
+			// The current slot of a higher level is always empty, it was spread when now reached it
+			unsigned int slot = timing_wheel_find(wheel, level, (level == 0) ? current : current + 1);
+
+			if (slot == TIMING_WHEEL_SLOTS) {
+				continue;
+			}
+
+			// Now with the slot in this level, and zeros below it
+			uint64_t above = (shift + TIMING_WHEEL_BITS < 64) ? wheel->now >> (shift + TIMING_WHEEL_BITS) << (shift + TIMING_WHEEL_BITS) : 0;
+			uint64_t time = above | (uint64_t) slot << shift;
+
+			if (time > until) {
+				return TIMING_NO_EVENT;
+			}
+
+			wheel->now = time;
+			uint32_t event = timing_wheel_take(wheel, level, slot);
+
+			if (level == 0) {
+				return event;
+			}
+
+			// Every lower level is empty, so the events are spread over them
+			while (event != TIMING_NO_EVENT) {
+				uint32_t next = wheel->events[event].next;
+				timing_wheel_insert(wheel, event);
+				event = next;
+			}
+
+			cascaded = true;
+		}
+
+		assert(cascaded);
+	}
+
+	return TIMING_NO_EVENT;
+}
+
+
+static void timing_wheel_release(timing_wheel_t *wheel, uint32_t event) {
+	wheel->events[event].next = wheel->free;
+	wheel->free = event;
+	wheel->pending--;
+}
+
+
+static void timing_wheel_init(timing_wheel_t *wheel) {
+	wheel->now = 0;
+
+	for (size_t level = 0; level < TIMING_WHEEL_LEVELS; level++) {
+		for (size_t slot = 0; slot < TIMING_WHEEL_SLOTS; slot++) {
+			wheel->slots[level][slot] = TIMING_NO_EVENT;
+		}
+
+		for (size_t word = 0; word < TIMING_WHEEL_SLOTS / TIMING_WORD_SLOTS; word++) {
+			wheel->occupied[level][word] = 0;
+		}
+	}
+
+	wheel->events = NULL;
+	wheel->amount_events = 0;
+	wheel->size_events = 0;
+	wheel->free = TIMING_NO_EVENT;
+
+	wheel->pending = 0;
+}
+
+
+// Schedule the new output of an op, unless the output already ends up that way
+static void timing_schedule(timing_t *timing, uint32_t net, bool state, uint64_t time) {
+	if (timing->projected[net] == state) {
+		return;
+	}
+
+	timing->projected[net] = state;
+	timing->last_event[net] = timing_wheel_push(&timing->wheel, net, state, time);
+}
+
+
+// Delay of all ops of a type, except the ones set by name
+void timing_set_type_delay(timing_t *timing, NetlistOp_t op, uint32_t delay) {
+	FUNC_START();
+
+	assert_not_null(timing);
+	assert(delay > 0);
+
+	timing->type_delays[op] = delay;
+
+	for (size_t i = 0; i < timing->netlist->amount_ops; i++) {
+		if (timing->netlist->ops[i].op == op && ! timing->overridden[i]) {
+			timing->delays[i] = delay;
+		}
+	}
+
+	FUNC_END();
+}
+
+
+// Delay of a single op, by the hierarchical name of its gate
+bool timing_set_gate_delay(timing_t *timing, char *name, uint32_t delay) {
+	FUNC_START();
+
+	assert_not_null(timing);
+	assert(delay > 0);
+
+	netlist_op_t *op = netlist_get_op_by_name(timing->netlist, name);
+
+	if (op == NULL) {
+		FUNC_END();
+		return false;
+	}
+
+	size_t index = (size_t) (op - timing->netlist->ops);
+
+	timing->delays[index] = delay;
+	timing->overridden[index] = true;
+
+	FUNC_END();
+	return true;
+}
+
+
+// Change an input at some time, which can't be before now. A change that's still pending
+// for the input can't be overtaken, since the projected state follows from the last
+// change, but a change at the same time replaces it.
+bool timing_set_input(timing_t *timing, char *name, bool state, uint64_t time) {
+	FUNC_START();
+
+	assert_not_null(timing);
+	assert(time >= timing->wheel.now);
+
+	netlist_io_t *io = netlist_get_input_by_name(timing->netlist, name);
+
+	if (io == NULL) {
+		FUNC_END();
+		return false;
+	}
+
+	uint32_t last = timing->last_event[io->net];
+
+	if (last != TIMING_NO_EVENT && timing->wheel.events[last].time > time) {
+		warn("Can't change %s at %lu, before its pending change at %lu", name, time, timing->wheel.events[last].time);
+		FUNC_END();
+		return false;
+	}
+
+	if (last != TIMING_NO_EVENT && timing->wheel.events[last].time == time) {
+		timing->wheel.events[last].state = state;
+		timing->projected[io->net] = state;
+
+		FUNC_END();
+		return true;
+	}
+
+	timing_schedule(timing, io->net, state, time);
+
+	FUNC_END();
+	return true;
+}
+
+
+// Run all events up to until, returns whether none are left
+bool timing_run(timing_t *timing, uint64_t until) {
+	FUNC_START();
+
+	assert_not_null(timing);
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	timing_wheel_t *wheel = &timing->wheel;
+	netlist_op_t *ops = timing->netlist->ops;
+	uint32_t *fanout_start = timing->netlist->fanout_start;
+	uint32_t *fanout = timing->netlist->fanout;
+	bool *state = timing->state;
+
+	uint32_t event;
+
+	while ((event = timing_wheel_next(wheel, until)) != TIMING_NO_EVENT) {
+		uint64_t now = wheel->now;
+
+		// All changes at a time happen before any op sees them, so inputs
+		// changing together don't cause a glitch
+		while (event != TIMING_NO_EVENT) {
+			timing_event_t *current = &wheel->events[event];
+			uint32_t next = current->next;
+			uint32_t net = current->net;
+
+			if (state[net] != current->state) {
+				state[net] = current->state;
+				timing->transitions[net]++;
+				timing->last_change[net] = now;
+
+				for (uint32_t i = fanout_start[net]; i < fanout_start[net + 1]; i++) {
+					if (! timing->marked[fanout[i]]) {
+						timing->marked[fanout[i]] = true;
+						timing->evaluate[timing->amount_evaluate++] = fanout[i];
+					}
+				}
+			}
+
+			if (timing->last_event[net] == event) {
+				timing->last_event[net] = TIMING_NO_EVENT;
+			}
+
+			timing_wheel_release(wheel, event);
+			timing->events++;
+			event = next;
+		}
+
+		for (size_t i = 0; i < timing->amount_evaluate; i++) {
+			uint32_t index = timing->evaluate[i];
+			netlist_op_t *op = &ops[index];
+
+			unsigned int inputs = (unsigned int) state[op->in0] << 1 | (unsigned int) state[op->in1];
+
+			timing->marked[index] = false;
+			timing_schedule(timing, op->out, (op->table >> inputs) & 1, now + timing->delays[index]);
+		}
+
+		timing->amount_evaluate = 0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	timing->time += long_time(end) - long_time(start);
+
+	FUNC_END();
+	return wheel->pending == 0;
+}
+
+
+uint64_t timing_now(timing_t *timing) {
+	return timing->wheel.now;
+}
+
+
+// Pulses of a net, every two changes that didn't change its state
+size_t timing_glitches(timing_t *timing, uint32_t net) {
+	assert_not_null(timing);
+	assert(net < timing->netlist->amount_nets);
+
+	uint32_t changes = timing->transitions[net] - (timing->state[net] != timing->initial[net]);
+
+	return changes / 2;
+}
+
+
+// Glitches of all nets, including the ones inside
+size_t timing_total_glitches(timing_t *timing) {
+	FUNC_START();
+
+	size_t glitches = 0;
+
+	for (uint32_t net = 0; net < timing->netlist->amount_nets; net++) {
+		glitches += timing_glitches(timing, net);
+	}
+
+	FUNC_END();
+	return glitches;
+}
+
+
+// Time from start until the last output changed
+uint64_t timing_settle_time(timing_t *timing) {
+	FUNC_START();
+
+	uint64_t settle = 0;
+
+	for (size_t i = 0; i < timing->netlist->amount_outputs; i++) {
+		uint32_t net = timing->netlist->outputs[i].net;
+
+		if (timing->transitions[net] > 0 && timing->last_change[net] - timing->start > settle) {
+			settle = timing->last_change[net] - timing->start;
+		}
+	}
+
+	FUNC_END();
+	return settle;
+}
+
+
+// Count the changes of every net from now on, for the next change of the inputs
+void timing_start(timing_t *timing) {
+	FUNC_START();
+
+	assert_not_null(timing);
+
+	timing->start = timing->wheel.now;
+
+	for (uint32_t net = 0; net < timing->netlist->amount_nets; net++) {
+		timing->initial[net] = timing->state[net];
+		timing->transitions[net] = 0;
+		timing->last_change[net] = 0;
+	}
+
+	FUNC_END();
+}
+
+
+double timing_events_per_second(timing_t *timing) {
+	assert_not_null(timing);
+
+	if (timing->time == 0) {
+		return 0;
+	}
+
+	return (double) timing->events * 1e9 / (double) timing->time;
+}
+
+
+void timing_reset_stats(timing_t *timing) {
+	assert_not_null(timing);
+
+	timing->events = 0;
+	timing->time = 0;
+}
+
+
+// Every output with its changes since timing_start, times are relative to its start
+void timing_print(timing_t *timing) {
+	FUNC_START();
+
+	assert_not_null(timing);
+
+	printf("%s at %lu: %lu events in %.3f ms (%.0f events/s), %lu pending, settled after %lu, %lu glitches\n",
+		timing->netlist->name, timing->wheel.now, timing->events, (double) timing->time / 1e6,
+		timing_events_per_second(timing), timing->wheel.pending, timing_settle_time(timing), timing_total_glitches(timing));
+
+	for (size_t i = 0; i < timing->netlist->amount_outputs; i++) {
+		uint32_t net = timing->netlist->outputs[i].net;
+
+		printf("\t%s = %d, %u transitions, %lu glitches", timing->netlist->outputs[i].name,
+			timing->state[net], timing->transitions[net], timing_glitches(timing, net));
+
+		if (timing->transitions[net] > 0) {
+			printf(", last at %lu", timing->last_change[net] - timing->start);
+		}
+
+		printf("\n");
+	}
+
+	FUNC_END();
+}
+
+
+// Starts at time 0 in the state of the netlist, the netlist has to outlive the simulation
+void timing_init(timing_t *timing, netlist_t *netlist) {
+	FUNC_START();
+
+	assert_not_null(timing);
+	assert_not_null(netlist);
+
+	timing->netlist = netlist;
+	timing_wheel_init(&timing->wheel);
+
+	size_t amount_ops = netlist->amount_ops;
+	size_t amount_nets = netlist->amount_nets;
+
+	timing->delays = malloc((amount_ops + 1) * sizeof(uint32_t));
+	timing->overridden = calloc(amount_ops + 1, sizeof(bool));
+	timing->evaluate = malloc((amount_ops + 1) * sizeof(uint32_t));
+	timing->marked = calloc(amount_ops + 1, sizeof(bool));
+	timing->amount_evaluate = 0;
+
+	for (size_t op = 0; op < NETLIST_OP_AMOUNT; op++) {
+		timing->type_delays[op] = timing_default_delays[op];
+	}
+
+	for (size_t i = 0; i < amount_ops; i++) {
+		timing->delays[i] = timing->type_delays[netlist->ops[i].op];
+	}
+
+	timing->state = malloc((amount_nets + 1) * sizeof(bool));
+	timing->projected = malloc((amount_nets + 1) * sizeof(bool));
+	timing->last_event = malloc((amount_nets + 1) * sizeof(uint32_t));
+	timing->initial = malloc((amount_nets + 1) * sizeof(bool));
+	timing->transitions = malloc((amount_nets + 1) * sizeof(uint32_t));
+	timing->last_change = malloc((amount_nets + 1) * sizeof(uint64_t));
+
+	for (size_t net = 0; net < amount_nets; net++) {
+		timing->state[net] = netlist->state[net];
+		timing->projected[net] = netlist->state[net];
+		timing->last_event[net] = TIMING_NO_EVENT;
+	}
+
+	timing_start(timing);
+	timing_reset_stats(timing);
+
+	FUNC_END();
+}
+
+
+void timing_free(timing_t *timing) {
+	FUNC_START();
+
+	free(timing->wheel.events);
+
+	free(timing->delays);
+	free(timing->overridden);
+	free(timing->evaluate);
+	free(timing->marked);
+
+	free(timing->state);
+	free(timing->projected);
+	free(timing->last_event);
+	free(timing->initial);
+	free(timing->transitions);
+	free(timing->last_change);
+
+	FUNC_END();
+}
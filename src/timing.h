@@ -0,0 +1,106 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+
+#include <stdint.h>
+
+#include "netlist.h"
+
+
+// Every level of the wheel splits time in 2^TIMING_WHEEL_BITS slots, and all levels
+// together cover the 64 bits of a time
+#define TIMING_WHEEL_BITS 8
+#define TIMING_WHEEL_SLOTS (1 << TIMING_WHEEL_BITS)
+#define TIMING_WHEEL_LEVELS (64 / TIMING_WHEEL_BITS)
+
+// End of the list of events in a slot
+#define TIMING_NO_EVENT UINT32_MAX
+
+// Run until no events are left
+#define TIMING_FOREVER UINT64_MAX
+
+
+// The new state of a net at some time, in the list of its slot
+typedef struct timing_event {
+	uint64_t time;
+	uint32_t net;
+	bool state;
+	uint32_t next;
+} timing_event_t;
+
+
+// A hierarchical timing wheel, where an event is in the lowest level at which its time
+// and now have the same higher bits. Inserting is O(1), and a slot of a higher level
+// is spread over the lower levels once now reaches it.
+typedef struct timing_wheel {
+	uint64_t now;
+
+	uint32_t slots[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS];
+	uint64_t occupied[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS / 64];
+
+	// Pool of events, the unused ones are a list starting at free
+	timing_event_t *events;
+	size_t amount_events;
+	size_t size_events;
+	uint32_t free;
+
+	size_t pending;
+} timing_wheel_t;
+
+
+// Simulates a netlist where every op takes some time to change its output. Changes are
+// transport delays, so pulses shorter than a gate delay still come through as glitches.
+typedef struct timing {
+	netlist_t *netlist;
+	timing_wheel_t wheel;
+
+	// Delay of every op, from its type unless it's set by name
+	uint32_t type_delays[NETLIST_OP_AMOUNT];
+	uint32_t *delays;
+	bool *overridden;
+
+	// State of every net now, and once all its events have happened
+	bool *state;
+	bool *projected;
+
+	// The last event of every net that's still pending, or TIMING_NO_EVENT
+	uint32_t *last_event;
+
+	// Ops to evaluate at the end of the current time
+	uint32_t *evaluate;
+	size_t amount_evaluate;
+	bool *marked;
+
+	// Every net since timing_start, at start
+	uint64_t start;
+	bool *initial;
+	uint32_t *transitions;
+	uint64_t *last_change;
+
+	// Statistics
+	unsigned long events;
+	long time;
+} timing_t;
+
+
+void timing_set_type_delay(timing_t *timing, NetlistOp_t op, uint32_t delay);
+bool timing_set_gate_delay(timing_t *timing, char *name, uint32_t delay);
+
+bool timing_set_input(timing_t *timing, char *name, bool state, uint64_t time);
+bool timing_run(timing_t *timing, uint64_t until);
+uint64_t timing_now(timing_t *timing);
+
+size_t timing_glitches(timing_t *timing, uint32_t net);
+size_t timing_total_glitches(timing_t *timing);
+uint64_t timing_settle_time(timing_t *timing);
+void timing_start(timing_t *timing);
+double timing_events_per_second(timing_t *timing);
+void timing_reset_stats(timing_t *timing);
+
+
+void timing_print(timing_t *timing);
+void timing_init(timing_t *timing, netlist_t *netlist);
+void timing_free(timing_t *timing);
+
+
+#endif
@@ -0,0 +1,181 @@
+#include "tokenizer.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "assert.h"
+#include "benchmark.h"
+
+
+// NOTE: No benchmarking in the string views, they're called for every token
+
+
+static inline bool tokenizer_is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+// Get the tokens of the next line that isn't empty, returns the amount of tokens on it.
+// Only the first max_tokens are stored, and 0 means the end of the file is reached.
+size_t tokenizer_next_line(tokenizer_t *tokenizer, string_view_t *tokens, size_t max_tokens) {
+	const char *data = tokenizer->data;
+	size_t size = tokenizer->size;
+
+	while (tokenizer->position < size) {
+		const char *start = &data[tokenizer->position];
+		const char *newline = memchr(start, '\n', size - tokenizer->position);
+		const char *end = (newline != NULL) ? newline : &data[size];
+
+		tokenizer->position = (size_t) (end - data) + 1;
+		tokenizer->line++;
+
+		size_t amount = 0;
+		const char *c = start;
+
+		while (c < end) {
+			while (c < end && tokenizer_is_space(*c)) {
+				c++;
+			}
+
+			if (c == end) {
+				break;
+			}
+
+			const char *token = c;
+
+			while (c < end && ! tokenizer_is_space(*c)) {
+				c++;
+			}
+
+			if (amount < max_tokens) {
+				tokens[amount].start = token;
+				tokens[amount].length = (size_t) (c - token);
+			}
+
+			amount++;
+		}
+
+		if (amount > 0) {
+			return amount;
+		}
+	}
+
+	return 0;
+}
+
+
+bool string_view_equals(string_view_t view, const char *str) {
+	return strlen(str) == view.length && memcmp(view.start, str, view.length) == 0;
+}
+
+
+// Split a view at the first separator, which is part of neither side
+bool string_view_split(string_view_t view, char separator, string_view_t *left, string_view_t *right) {
+	const char *found = memchr(view.start, separator, view.length);
+
+	if (found == NULL) {
+		return false;
+	}
+
+	left->start = view.start;
+	left->length = (size_t) (found - view.start);
+
+	right->start = found + 1;
+	right->length = view.length - left->length - 1;
+
+	return true;
+}
+
+
+bool string_view_to_size(string_view_t view, size_t *value) {
+	if (view.length == 0) {
+		return false;
+	}
+
+	size_t result = 0;
+
+	for (size_t i = 0; i < view.length; i++) {
+		char c = view.start[i];
+
+		if (c < '0' || c > '9') {
+			return false;
+		}
+
+		result = 10 * result + (size_t) (c - '0');
+	}
+
+	*value = result;
+	return true;
+}
+
+
+
+bool tokenizer_open(tokenizer_t *tokenizer, char *filename) {
+	FUNC_START();
+
+	assert_not_null(tokenizer);
+	assert_not_null(filename);
+
+	tokenizer->filename = filename;
+	tokenizer->data = NULL;
+	tokenizer->size = 0;
+	tokenizer->position = 0;
+	tokenizer->line = 0;
+
+
+	int fd = open(filename, O_RDONLY);
+
+	if (fd == -1) {
+		warn("Failed to open %s", filename);
+		FUNC_END();
+		return false;
+	}
+
+	struct stat stats;
+
+	if (fstat(fd, &stats) == -1) {
+		warn("Failed to get the size of %s", filename);
+		close(fd);
+		FUNC_END();
+		return false;
+	}
+
+	// Empty files can't be mapped, but are valid
+	if (stats.st_size > 0) {
+		void *data = mmap(NULL, (size_t) stats.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data == MAP_FAILED) {
+			warn("Failed to map %s", filename);
+			close(fd);
+			FUNC_END();
+			return false;
+		}
+
+		// The file is read front to back once
+		madvise(data, (size_t) stats.st_size, MADV_SEQUENTIAL);
+
+		tokenizer->data = data;
+		tokenizer->size = (size_t) stats.st_size;
+	}
+
+	close(fd);
+
+
+	FUNC_END();
+	return true;
+}
+
+
+void tokenizer_close(tokenizer_t *tokenizer) {
+	assert_not_null(tokenizer);
+
+	if (tokenizer->data != NULL) {
+		munmap((void *) tokenizer->data, tokenizer->size);
+	}
+
+	tokenizer->data = NULL;
+	tokenizer->size = 0;
+}
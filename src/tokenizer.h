@@ -0,0 +1,39 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+
+#include <stddef.h>
+#include <stdbool.h>
+
+
+// A piece of a string, not terminated by '\0'
+typedef struct string_view {
+	const char *start;
+	size_t length;
+} string_view_t;
+
+
+// Splits a mapped file into lines of whitespace separated tokens
+typedef struct tokenizer {
+	char *filename;
+
+	const char *data;
+	size_t size;
+
+	size_t position;
+	size_t line;
+} tokenizer_t;
+
+
+size_t tokenizer_next_line(tokenizer_t *tokenizer, string_view_t *tokens, size_t max_tokens);
+
+bool string_view_equals(string_view_t view, const char *str);
+bool string_view_split(string_view_t view, char separator, string_view_t *left, string_view_t *right);
+bool string_view_to_size(string_view_t view, size_t *value);
+
+
+bool tokenizer_open(tokenizer_t *tokenizer, char *filename);
+void tokenizer_close(tokenizer_t *tokenizer);
+
+
+#endif
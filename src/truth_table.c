@@ -0,0 +1,219 @@
+#include "truth_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "benchmark.h"
+#include "pattern.h"
+#include "pattern_kernels.h"
+#include "thread_pool.h"
+
+
+// The combinations one thread evaluates, with a pattern of its own
+typedef struct truth_table_shard {
+	truth_table_t *table;
+	uint64_t first;
+	uint64_t last;
+} truth_table_shard_t;
+
+
+static uint64_t truth_table_chunk(truth_table_t *table) {
+	uint64_t combinations = truth_table_combinations(table);
+	return (combinations < TRUTH_TABLE_CHUNK) ? combinations : TRUTH_TABLE_CHUNK;
+}
+
+
+// NOTE: Runs on a thread of the pool
+static void truth_table_run_shard(void *arg) {
+	FUNC_START();
+
+	truth_table_shard_t *shard = arg;
+	truth_table_t *table = shard->table;
+	uint64_t chunk = truth_table_chunk(table);
+
+	pattern_t pattern;
+	pattern_init(&pattern, &table->netlist, chunk);
+
+	for (uint64_t first = shard->first; first < shard->last; first += chunk) {
+		pattern_set_exhaustive(&pattern, first);
+		pattern_evaluate(&pattern);
+
+		// Chunks are whole words, so they're copied as they are
+		for (size_t i = 0; i < table->amount_outputs; i++) {
+			uint64_t *words = &table->words[i * table->words_per_output + first / PATTERN_WORD_BITS];
+			memcpy(words, pattern_get_net(&pattern, table->netlist.outputs[i].net), pattern.words * sizeof(uint64_t));
+		}
+	}
+
+	pattern_free(&pattern);
+
+	FUNC_END();
+}
+
+
+// Compile the circuit, then split the combinations over threads, all cores when it's 0.
+// Fails for circuits with loops, or more than TRUTH_TABLE_MAX_INPUTS inputs.
+bool truth_table_compute(truth_table_t *table, circuit_t *circ, size_t threads) {
+	FUNC_START();
+
+	assert_not_null(table);
+	assert_not_null(circ);
+
+	if (! netlist_compile(&table->netlist, circ)) {
+		FUNC_END();
+		return false;
+	}
+
+	if (table->netlist.amount_inputs > TRUTH_TABLE_MAX_INPUTS) {
+		warn("Can't make the truth table of %s: %lu inputs is over %d", circ->name, table->netlist.amount_inputs, TRUTH_TABLE_MAX_INPUTS);
+		FUNC_END();
+		return false;
+	}
+
+	table->amount_inputs = table->netlist.amount_inputs;
+	table->amount_outputs = table->netlist.amount_outputs;
+
+	uint64_t combinations = truth_table_combinations(table);
+	uint64_t chunk = truth_table_chunk(table);
+
+	table->words_per_output = (combinations + PATTERN_WORD_BITS - 1) / PATTERN_WORD_BITS;
+	table->words = calloc(table->amount_outputs * table->words_per_output + 1, sizeof(uint64_t));
+	assert_not_null(table->words);
+
+
+	// Every shard gets a range of whole chunks
+	if (threads == 0) {
+		threads = thread_pool_cores();
+	}
+
+	uint64_t chunks = combinations / chunk;
+	size_t amount_shards = (chunks < threads) ? chunks : threads;
+	truth_table_shard_t shards[amount_shards];
+
+	// Pick the kernels before the shards evaluate at once
+	pattern_kernels_get();
+
+	thread_pool_t pool;
+	thread_pool_init(&pool, amount_shards);
+
+	for (size_t i = 0; i < amount_shards; i++) {
+		shards[i] = (truth_table_shard_t) {
+			.table = table,
+			.first = chunks * i / amount_shards * chunk,
+			.last = chunks * (i + 1) / amount_shards * chunk
+		};
+
+		thread_pool_push(&pool, truth_table_run_shard, &shards[i]);
+	}
+
+	thread_pool_wait(&pool);
+	thread_pool_free(&pool);
+
+
+	// A single word has room for more combinations than there are
+	if (combinations < PATTERN_WORD_BITS) {
+		for (size_t i = 0; i < table->amount_outputs; i++) {
+			table->words[i] &= (1ull << combinations) - 1;
+		}
+	}
+
+	FUNC_END();
+	return true;
+}
+
+
+bool truth_table_get(truth_table_t *table, uint64_t combination, size_t output) {
+	assert_not_null(table);
+	assert(combination < truth_table_combinations(table));
+	assert(output < table->amount_outputs);
+
+	uint64_t word = table->words[output * table->words_per_output + combination / PATTERN_WORD_BITS];
+	return (word >> (combination % PATTERN_WORD_BITS)) & 1;
+}
+
+
+// The words of one output, NULL if there is no output with that name
+uint64_t *truth_table_get_output(truth_table_t *table, char *name) {
+	FUNC_START();
+
+	assert_not_null(table);
+	assert_not_null(name);
+
+	netlist_io_t *io = netlist_get_output_by_name(&table->netlist, name);
+
+	if (io == NULL) {
+		FUNC_END();
+		return NULL;
+	}
+
+	size_t output = (size_t) (io - table->netlist.outputs);
+
+	FUNC_END();
+	return &table->words[output * table->words_per_output];
+}
+
+
+uint64_t truth_table_combinations(truth_table_t *table) {
+	return (uint64_t) 1 << table->amount_inputs;
+}
+
+
+// One line per combination, inputs first
+void truth_table_print(truth_table_t *table) {
+	FUNC_START();
+
+	for (size_t i = 0; i < table->amount_inputs; i++) {
+		printf("%s ", table->netlist.inputs[i].name);
+	}
+
+	printf("|");
+
+	for (size_t i = 0; i < table->amount_outputs; i++) {
+		printf(" %s", table->netlist.outputs[i].name);
+	}
+
+	printf("\n");
+
+	for (uint64_t combination = 0; combination < truth_table_combinations(table); combination++) {
+		for (size_t i = 0; i < table->amount_inputs; i++) {
+			printf("%*d ", (int) strlen(table->netlist.inputs[i].name), (int) ((combination >> i) & 1));
+		}
+
+		printf("|");
+
+		for (size_t i = 0; i < table->amount_outputs; i++) {
+			printf(" %*d", (int) strlen(table->netlist.outputs[i].name), truth_table_get(table, combination, i));
+		}
+
+		printf("\n");
+	}
+
+	FUNC_END();
+}
+
+
+void truth_table_init(truth_table_t *table) {
+	FUNC_START();
+
+	netlist_init(&table->netlist);
+
+	table->amount_inputs = 0;
+	table->amount_outputs = 0;
+
+	table->words = NULL;
+	table->words_per_output = 0;
+
+	FUNC_END();
+}
+
+
+void truth_table_free(truth_table_t *table) {
+	FUNC_START();
+
+	netlist_free(&table->netlist);
+	free(table->words);
+
+	FUNC_END();
+}
@@ -0,0 +1,43 @@
+#ifndef TRUTH_TABLE_H
+#define TRUTH_TABLE_H
+
+
+#include <stdint.h>
+
+#include "netlist.h"
+
+
+// Inputs a table can have, one output of 32 inputs is 512 MiB
+#define TRUTH_TABLE_MAX_INPUTS 32
+
+// Vectors one thread evaluates at once
+#define TRUTH_TABLE_CHUNK 65536
+
+
+// Every output for every combination of the inputs, where input i is bit i of the
+// combination, and the IO are in the order of the netlist, sorted by name
+typedef struct truth_table {
+	netlist_t netlist;
+
+	size_t amount_inputs;
+	size_t amount_outputs;
+
+	// Combination c of output o is bit c % 64 of words[o * words_per_output + c / 64]
+	uint64_t *words;
+	size_t words_per_output;
+} truth_table_t;
+
+
+bool truth_table_compute(truth_table_t *table, circuit_t *circ, size_t threads);
+
+bool truth_table_get(truth_table_t *table, uint64_t combination, size_t output);
+uint64_t *truth_table_get_output(truth_table_t *table, char *name);
+uint64_t truth_table_combinations(truth_table_t *table);
+
+
+void truth_table_print(truth_table_t *table);
+void truth_table_init(truth_table_t *table);
+void truth_table_free(truth_table_t *table);
+
+
+#endif
@@ -35,7 +35,7 @@ char *__LEFT_PAD_SPACE(char *dest, double x, unsigned int width) {
 	// Calculate width of number
 	unsigned int num_width = 0;
 
-	for (int y = (int) ABS(x); y >= 1; y /= 10) {
+	for (double y = ABS(x); y >= 1; y /= 10) {
 		num_width++;
 	}
 
@@ -55,29 +55,3 @@ char *__LEFT_PAD_SPACE(char *dest, double x, unsigned int width) {
 	return dest;
 }
 
-
-circuit_t *find_dependency(vector_t *dependencies, char *name) {
-	FUNC_START();
-
-	assert_not_null(name);
-
-	if (dependencies == NULL) {
-		goto notfound;
-	}
-
-
-	for (size_t i = 0; i < dependencies->amount; i++) {
-		circuit_t *dep = dependencies->items[i];
-
-		if (strcmp(dep->name, name) == 0) {
-			FUNC_END();
-			return dep;
-		}
-	}
-
-
-	notfound:
-	warn("Failed to find dependency");
-	FUNC_END();
-	return NULL;
-}
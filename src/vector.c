@@ -13,9 +13,8 @@ bool vector_push(vector_t *vec, void *item) {
 	// NOTE: Blocks vectors from containing NULL
 	assert_not_null(item);
 
-	// Check for overflow
-	if (vec->amount == vec->size - 1) {
-		panic("Overflowing vector!");
+	// Grow geometrically when full
+	if (vec->amount == vec->size && ! vector_reserve(vec, 2 * vec->size)) {
 		return false;
 	}
 
@@ -65,7 +64,7 @@ void *vector_last(vector_t *vec) {
 bool vector_copy(vector_t *dest, vector_t *src) {
 	FUNC_START();
 
-	bool success = true;
+	bool success = vector_reserve(dest, dest->amount + src->amount);
 
 	VEC_EACH(*src, void *item) {
 		success &= vector_push(dest, item);
@@ -95,7 +94,7 @@ bool vector_remove(vector_t *vec, void *item) {
 	}
 
 	// Shift all items after the given item 1 to the left
-	for (size_t j = i + 1; j < vec->amount + 1; j++) {
+	for (size_t j = i + 1; j < vec->amount; j++) {
 		vec->items[j - 1] = vec->items[j];
 	}
 
@@ -107,19 +106,70 @@ bool vector_remove(vector_t *vec, void *item) {
 }
 
 
+bool vector_contains(vector_t *vec, void *item) {
+	assert_not_null(vec);
+
+	for (size_t i = 0; i < vec->amount; i++) {
+		if (vec->items[i] == item) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 
+// Make room for at least size items, moving out of the inline items if needed
+bool vector_reserve(vector_t *vec, size_t size) {
+	assert_not_null(vec);
+
+	if (size <= vec->size) {
+		return true;
+	}
+
+	void **items;
+
+	if (vec->items == vec->inline_items) {
+		items = malloc(size * sizeof(void*));
+
+		if (items != NULL) {
+			memcpy(items, vec->inline_items, vec->amount * sizeof(void*));
+		}
+	}
+	else {
+		items = realloc(vec->items, size * sizeof(void*));
+	}
+
+	if (items == NULL) {
+		panic("Failed to grow vector to %lu items!", size);
+		return false;
+	}
+
+	vec->items = items;
+	vec->size = size;
+
+	return true;
+}
+
+
+// Size is only a hint, the vector grows when needed
 void vector_init(vector_t *vec, size_t size) {
 	vec->amount = 0;
-	vec->size = size;
-	vec->items = malloc(size * sizeof(void*));
+	vec->size = VECTOR_INLINE_SIZE;
+	vec->items = vec->inline_items;
 
-	// Set all fields to zero (clear array)
-	memset(vec->items, 0, size * sizeof(void*));
+	vector_reserve(vec, size);
 }
 
 
 void vector_free(vector_t *vec) {
 	assert_not_null(vec);
 
-	free(vec->items);
+	if (vec->items != vec->inline_items) {
+		free(vec->items);
+	}
+
+	vec->amount = 0;
+	vec->size = VECTOR_INLINE_SIZE;
+	vec->items = vec->inline_items;
 }
@@ -8,10 +8,18 @@
 #include "defines.h"
 
 
+// Amount of items stored inside the vector itself, before anything is allocated
+#define VECTOR_INLINE_SIZE 3
+
+
+// NOTE: Small vectors point into themselves, so a vector_t must never be
+//       copied or moved by value once it's initialized
 typedef struct vector {
 	size_t amount;
 	size_t size;
 	void** items;
+
+	void *inline_items[VECTOR_INLINE_SIZE];
 } vector_t;
 
 
@@ -36,6 +44,8 @@ void *vector_pop(vector_t *vec);
 void *vector_last(vector_t *vec);
 bool vector_copy(vector_t *dest, vector_t *src);
 bool vector_remove(vector_t *vec, void *item);
+bool vector_contains(vector_t *vec, void *item);
+bool vector_reserve(vector_t *vec, size_t size);
 
 
 void vector_init(vector_t *vec, size_t size);